@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * CRC32 and CRC32C using the ARMv8 CRC32 instructions
+ *
+ * These are optional in ARMv8.0, so lib/crc32.c only calls crc32_le_arch()
+ * once crc32_arch_probe() has found them. The CRC can be running when EFI
+ * runtime services are called, so the code is kept with them.
+ */
+
+#include <efi_loader.h>
+#include <asm/system.h>
+#include <asm/byteorder.h>
+#include <u-boot/crc.h>
+
+bool __efi_runtime crc32_arch_probe(void)
+{
+	return read_id_aa64isar0() & ID_AA64ISAR0_EL1_CRC32;
+}
+
+bool crc32c_arch_probe(void)
+{
+	return crc32_arch_probe();
+}
+
+u32 __efi_runtime crc32_le_arch(u32 crc, const u8 *p, size_t len)
+{
+	for (; len && ((uintptr_t)p & 7); len--)
+		crc = __builtin_aarch64_crc32b(crc, *p++);
+
+	for (; len >= 8; len -= 8, p += 8)
+		crc = __builtin_aarch64_crc32x(crc,
+					       le64_to_cpu(*(const u64 *)p));
+
+	while (len--)
+		crc = __builtin_aarch64_crc32b(crc, *p++);
+
+	return crc;
+}
+
+u32 crc32c_le_arch(u32 crc, const u8 *p, size_t len)
+{
+	for (; len && ((uintptr_t)p & 7); len--)
+		crc = __builtin_aarch64_crc32cb(crc, *p++);
+
+	for (; len >= 8; len -= 8, p += 8)
+		crc = __builtin_aarch64_crc32cx(crc,
+						le64_to_cpu(*(const u64 *)p));
+
+	while (len--)
+		crc = __builtin_aarch64_crc32cb(crc, *p++);
+
+	return crc;
+}
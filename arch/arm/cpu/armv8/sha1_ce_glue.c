@@ -5,16 +5,22 @@
  * Copyright (C) 2022 Linaro Ltd <loic.poulain@linaro.org>
  */
 
-#include <u-boot/sha1.h>
+#include <hash.h>
+#include <asm/system.h>
 
-extern void sha1_armv8_ce_process(uint32_t state[5], uint8_t const *src,
-				  uint32_t blocks);
+extern void sha1_armv8_ce_process(void *state, uint8_t const *src,
+				  uint blocks);
 
-void sha1_process(sha1_context *ctx, const unsigned char *data,
-		  unsigned int blocks)
+static bool sha1_armv8_ce_probe(void)
 {
-	if (!blocks)
-		return;
-
-	sha1_armv8_ce_process(ctx->state, data, blocks);
+	return read_id_aa64isar0() & ID_AA64ISAR0_EL1_SHA1;
 }
+
+HASH_BACKEND(sha1_armv8_ce) = {
+	.algo		= "sha1",
+	.name		= "armv8-ce",
+	.block_size	= 64,
+	.priority	= 1,
+	.probe		= sha1_armv8_ce_probe,
+	.process	= sha1_armv8_ce_process,
+};
@@ -5,16 +5,22 @@
  * Copyright (C) 2022 Linaro Ltd <loic.poulain@linaro.org>
  */
 
-#include <u-boot/sha256.h>
+#include <hash.h>
+#include <asm/system.h>
 
-extern void sha256_armv8_ce_process(uint32_t state[8], uint8_t const *src,
-				    uint32_t blocks);
+extern void sha256_armv8_ce_process(void *state, uint8_t const *src,
+				    uint blocks);
 
-void sha256_process(sha256_context *ctx, const unsigned char *data,
-		    unsigned int blocks)
+static bool sha256_armv8_ce_probe(void)
 {
-	if (!blocks)
-		return;
-
-	sha256_armv8_ce_process(ctx->state, data, blocks);
+	return read_id_aa64isar0() & ID_AA64ISAR0_EL1_SHA2;
 }
+
+HASH_BACKEND(sha256_armv8_ce) = {
+	.algo		= "sha256",
+	.name		= "armv8-ce",
+	.block_size	= 64,
+	.priority	= 1,
+	.probe		= sha256_armv8_ce_probe,
+	.process	= sha256_armv8_ce_process,
+};
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * sha512_ce_glue.c - SHA-384/SHA-512 using ARMv8.2 Crypto Extensions
+ */
+
+#include <hash.h>
+#include <asm/system.h>
+
+extern void sha512_armv8_ce_process(void *state, uint8_t const *src,
+				    uint blocks);
+
+static bool sha512_armv8_ce_probe(void)
+{
+	return (read_id_aa64isar0() & ID_AA64ISAR0_EL1_SHA2) >=
+		ID_AA64ISAR0_EL1_SHA2_512;
+}
+
+HASH_BACKEND(sha512_armv8_ce) = {
+	.algo		= "sha512",
+	.name		= "armv8-ce",
+	.block_size	= 128,
+	.priority	= 1,
+	.probe		= sha512_armv8_ce_probe,
+	.process	= sha512_armv8_ce_process,
+};
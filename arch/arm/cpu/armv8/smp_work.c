@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Start secondary CPUs with PSCI to run jobs for smp_work_run()
+ *
+ * Each CPU listed in the device tree is turned on with CPU_ON, runs jobs
+ * with the boot CPU's translation tables and then turns itself off again
+ * with CPU_OFF, leaving it as the OS expects to find it.
+ */
+
+#define LOG_CATEGORY	LOGC_ARCH
+
+#include <cpu_func.h>
+#include <dm.h>
+#include <log.h>
+#include <malloc.h>
+#include <smp_work.h>
+#include <time.h>
+#include <asm/armv8/mmu.h>
+#include <asm/armv8/smp_work.h>
+#include <asm/cache.h>
+#include <asm/global_data.h>
+#include <asm/system.h>
+#include <linux/psci.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Affinity fields of MPIDR_EL1, as used in the device tree */
+#define MPIDR_HWID_BITMASK	0xff00ffffffUL
+
+#define SMP_WORK_STACK_SIZE	SZ_16K
+#define SMP_WORK_OFF_TIMEOUT_MS	100
+
+/* Each entry is on its own cache lines, for cleaning to memory */
+#define SMP_WORK_CPU_SIZE	roundup(sizeof(struct smp_work_cpu), \
+					ARCH_DMA_MINALIGN)
+
+static void *smp_work_buf;
+static int smp_work_count;
+static ulong smp_work_boot_mpidr;
+
+static struct smp_work_cpu *smp_work_cpu(int i)
+{
+	return smp_work_buf + i * SMP_WORK_CPU_SIZE;
+}
+
+void __noreturn smp_work_secondary(struct smp_work_cpu *cpu)
+{
+	cpu->entry(cpu->num);
+	invoke_psci_fn(PSCI_0_2_FN_CPU_OFF, 0, 0, 0);
+
+	/* CPU_OFF only returns on error */
+	while (1)
+		wfi();
+}
+
+int arch_smp_work_start(void (*entry)(uint cpu))
+{
+	const int max = CONFIG_SMP_WORK_CPUS - 1;
+	struct smp_work_cpu *cpu;
+	struct udevice *dev;
+	u64 ttbr, tcr, mair;
+	ulong mpidr;
+	void *stacks;
+	ofnode node;
+	long ret;
+	int el;
+
+	/* The other CPUs are only coherent with this one if caches are on */
+	if (!max || !dcache_status() || !(get_sctlr() & CR_M))
+		return -ENOSYS;
+	if (uclass_get_device_by_name(UCLASS_FIRMWARE, "psci", &dev))
+		return -ENOSYS;
+
+	smp_work_buf = memalign(ARCH_DMA_MINALIGN,
+				max * (SMP_WORK_CPU_SIZE + SMP_WORK_STACK_SIZE));
+	if (!smp_work_buf)
+		return -ENOMEM;
+	stacks = smp_work_buf + max * SMP_WORK_CPU_SIZE;
+
+	el = current_el();
+	get_ttbr_tcr_mair(el, &ttbr, &tcr, &mair);
+	smp_work_boot_mpidr = read_mpidr() & MPIDR_HWID_BITMASK;
+	smp_work_count = 0;
+	ofnode_for_each_subnode(node, ofnode_path("/cpus")) {
+		if (smp_work_count == max)
+			break;
+		if (!ofnode_is_enabled(node) ||
+		    strcmp(ofnode_read_string(node, "device_type") ?: "", "cpu"))
+			continue;
+		mpidr = ofnode_get_addr(node);
+		if (mpidr == FDT_ADDR_T_NONE || mpidr == smp_work_boot_mpidr)
+			continue;
+
+		cpu = smp_work_cpu(smp_work_count);
+		cpu->ttbr = ttbr;
+		cpu->tcr = tcr;
+		cpu->mair = mair;
+		cpu->sctlr = get_sctlr();
+		cpu->gd = (ulong)gd;
+		cpu->sp = (ulong)stacks +
+			(smp_work_count + 1) * SMP_WORK_STACK_SIZE;
+		cpu->mpidr = mpidr;
+		cpu->num = smp_work_count + 1;
+		cpu->entry = entry;
+		flush_dcache_range((ulong)cpu, (ulong)cpu + SMP_WORK_CPU_SIZE);
+
+		ret = invoke_psci_fn(PSCI_0_2_FN64_CPU_ON, mpidr,
+				     (ulong)smp_work_entry, (ulong)cpu);
+		if (ret) {
+			log_debug("CPU %lx did not start (err=%ld)\n", mpidr,
+				  ret);
+			continue;
+		}
+		smp_work_count++;
+	}
+
+	if (!smp_work_count) {
+		free(smp_work_buf);
+		smp_work_buf = NULL;
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+void arch_smp_work_finish(void)
+{
+	struct smp_work_cpu *cpu;
+	ulong start;
+	int i;
+
+	/*
+	 * The CPUs are still on their stacks until they are off, and must be
+	 * off before CPU_ON can start them again
+	 */
+	for (i = 0; i < smp_work_count; i++) {
+		cpu = smp_work_cpu(i);
+		start = get_timer(0);
+		while (invoke_psci_fn(PSCI_0_2_FN64_AFFINITY_INFO, cpu->mpidr,
+				      0, 0) != PSCI_0_2_AFFINITY_LEVEL_OFF) {
+			if (get_timer(start) > SMP_WORK_OFF_TIMEOUT_MS) {
+				log_warning("CPU %llx did not turn off\n",
+					    cpu->mpidr);
+				/* Leave its stack alone */
+				smp_work_buf = NULL;
+				return;
+			}
+		}
+	}
+	free(smp_work_buf);
+	smp_work_buf = NULL;
+}
+
+bool arch_smp_work_secondary(void)
+{
+	return (read_mpidr() & MPIDR_HWID_BITMASK) != smp_work_boot_mpidr;
+}
@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Secondary CPUs started with PSCI to run jobs for smp_work_run()
+ */
+
+#ifndef __ASM_ARMV8_SMP_WORK_H
+#define __ASM_ARMV8_SMP_WORK_H
+
+/* Offsets in struct smp_work_cpu, for smp_work_entry */
+#define SMP_WORK_CPU_TTBR		0
+#define SMP_WORK_CPU_TCR		8
+#define SMP_WORK_CPU_MAIR		16
+#define SMP_WORK_CPU_SCTLR		24
+#define SMP_WORK_CPU_GD			32
+#define SMP_WORK_CPU_SP			40
+
+#ifndef __ASSEMBLY__
+
+#include <linux/types.h>
+
+/**
+ * struct smp_work_cpu - What a secondary CPU needs to start running C code
+ *
+ * The CPU reads this with its MMU and caches off, so the boot CPU cleans it
+ * to memory before starting the CPU.
+ *
+ * @ttbr: Translation table base, as on the boot CPU
+ * @tcr: Translation control, as on the boot CPU
+ * @mair: Memory attributes, as on the boot CPU
+ * @sctlr: System control, as on the boot CPU, with the MMU and caches on
+ * @gd: Global data pointer
+ * @sp: Top of the stack for this CPU
+ * @mpidr: Affinity of this CPU, as in the device tree
+ * @num: CPU number passed to @entry
+ * @entry: Function to call
+ */
+struct smp_work_cpu {
+	u64 ttbr;
+	u64 tcr;
+	u64 mair;
+	u64 sctlr;
+	u64 gd;
+	u64 sp;
+	u64 mpidr;
+	uint num;
+	void (*entry)(uint cpu);
+};
+
+/**
+ * smp_work_entry() - Entry point given to PSCI CPU_ON
+ *
+ * @cpu: Description of the CPU, passed as the context ID
+ */
+void smp_work_entry(struct smp_work_cpu *cpu);
+
+/**
+ * smp_work_secondary() - Run jobs on a secondary CPU and then turn it off
+ *
+ * This is called by smp_work_entry() once the MMU is on.
+ *
+ * @cpu: Description of the CPU
+ */
+void __noreturn smp_work_secondary(struct smp_work_cpu *cpu);
+
+#endif /* !__ASSEMBLY__ */
+
+#endif
@@ -87,6 +87,10 @@
 #define HCR_EL2_AMO_EL2		(1 <<  5) /* Route SErrors to EL2             */
 
 #define ID_AA64ISAR0_EL1_RNDR	(0xFUL << 60) /* RNDR random registers */
+#define ID_AA64ISAR0_EL1_CRC32	(0xFUL << 16) /* CRC32 and CRC32C */
+#define ID_AA64ISAR0_EL1_SHA2	(0xFUL << 12) /* SHA256 instructions */
+#define ID_AA64ISAR0_EL1_SHA2_512	(0x2UL << 12) /* and SHA512 too */
+#define ID_AA64ISAR0_EL1_SHA1	(0xFUL << 8) /* SHA1 instructions */
 /*
  * ID_AA64ISAR1_EL1 bits definitions
  */
@@ -211,6 +215,15 @@ static inline unsigned long read_mpidr(void)
 	return val;
 }
 
+static inline unsigned long read_id_aa64isar0(void)
+{
+	unsigned long val;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (val));
+
+	return val;
+}
+
 #define BSP_COREID	0
 
 void __asm_flush_dcache_all(void);
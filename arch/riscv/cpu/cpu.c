@@ -94,6 +94,41 @@ static inline bool supports_extension(char ext)
 #endif /* CONFIG_CPU */
 }
 
+/* Check the multi-letter extensions of a riscv,isa string */
+static bool isa_string_has(const char *isa, const char *ext)
+{
+	int len = strlen(ext);
+	const char *p;
+
+	/* Each follows a '_', after the single-letter extensions */
+	for (p = strchr(isa, '_'); p; p = strchr(p, '_')) {
+		p++;
+		if (!strncmp(p, ext, len) && (p[len] == '_' || !p[len]))
+			return true;
+	}
+
+	return false;
+}
+
+bool riscv_has_extension(const char *ext)
+{
+	struct udevice *dev;
+	const char *isa;
+
+	if (!CONFIG_IS_ENABLED(CPU))
+		return false;
+	uclass_find_first_device(UCLASS_CPU, &dev);
+	if (!dev)
+		return false;
+
+	if (dev_read_prop(dev, "riscv,isa-extensions", NULL))
+		return dev_read_stringlist_search(dev, "riscv,isa-extensions",
+						  ext) >= 0;
+	isa = dev_read_string(dev, "riscv,isa");
+
+	return isa && isa_string_has(isa, ext);
+}
+
 static int riscv_cpu_probe(void)
 {
 #ifdef CONFIG_CPU
@@ -28,4 +28,15 @@ struct event;
 /* Hook to set up the CPU (called from SPL too) */
 int riscv_cpu_setup(void);
 
+/**
+ * riscv_has_extension() - Check whether the CPU has a multi-letter extension
+ *
+ * This looks at the riscv,isa-extensions property of the first CPU, or at
+ * riscv,isa if that is missing.
+ *
+ * @ext: Name of the extension, e.g. "zbc"
+ * Return: true if the CPU has it
+ */
+bool riscv_has_extension(const char *ext);
+
 #endif	/* __ASM_RISCV_SYSTEM_H */
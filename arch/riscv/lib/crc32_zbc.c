@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * CRC32 and CRC32C using the RISC-V Zbc extension
+ *
+ * Each 64-bit word is reduced with two carry-less multiplies (Barrett
+ * reduction): one by the quotient x^95 / P to find how many times P goes
+ * into the data, and one by P to subtract that. Whether a CPU has Zbc is
+ * only known from the device tree, so lib/crc32.c checks once it is up.
+ */
+
+#include <efi_loader.h>
+#include <linux/types.h>
+#include <asm/byteorder.h>
+#include <asm/system.h>
+#include <u-boot/crc.h>
+
+#define ZBC_OP(insn, a, b) ({				\
+	unsigned long __r;				\
+	asm (".option push\n"				\
+	     ".option arch,+zbc\n"			\
+	     #insn " %0, %1, %2\n"			\
+	     ".option pop"				\
+	     : "=r" (__r) : "r" (a), "r" (b));		\
+	__r; })
+
+/* Bit-reflected polynomials and floor(x^95 / P), reflected and shifted */
+#define CRC32_POLY		0xedb88320
+#define CRC32_POLY_QT		0x5a72d812fb808b20UL
+#define CRC32C_POLY		0x82f63b78
+#define CRC32C_POLY_QT		0x2434f61c6f5389f8UL
+
+/* Return the CRC of the 64 bits in @s, with a CRC of 0 before them */
+static __always_inline u32 crc32_zbc_fold(unsigned long s, u32 poly,
+					  unsigned long qt)
+{
+	unsigned long t;
+
+	t = ZBC_OP(clmul, s, qt);
+	t = (t << 1) ^ s;
+	t = ZBC_OP(clmulr, t, (unsigned long)poly << 32);
+
+	return t >> 32;
+}
+
+/* Add @n bytes, fewer than eight, by folding them at the top of a word */
+static __always_inline u32 crc32_zbc_bytes(u32 crc, const u8 *p, size_t n,
+					   u32 poly, unsigned long qt)
+{
+	unsigned long v = 0;
+	size_t i;
+
+	if (!n)
+		return crc;
+
+	for (i = 0; i < n; i++)
+		v |= (unsigned long)p[i] << (i * 8);
+	v = (v ^ crc) & ((1UL << (n * 8)) - 1);
+
+	return (n < 4 ? crc >> (n * 8) : 0) ^
+		crc32_zbc_fold(v << (64 - n * 8), poly, qt);
+}
+
+static __always_inline u32 crc32_zbc(u32 crc, const u8 *p, size_t len,
+				     u32 poly, unsigned long qt)
+{
+	size_t head;
+
+	head = min(len, -(uintptr_t)p & 7);
+	crc = crc32_zbc_bytes(crc, p, head, poly, qt);
+	p += head;
+	len -= head;
+
+	for (; len >= 8; len -= 8, p += 8)
+		crc = crc32_zbc_fold(crc ^ le64_to_cpu(*(const u64 *)p), poly,
+				     qt);
+
+	return crc32_zbc_bytes(crc, p, len, poly, qt);
+}
+
+bool crc32_arch_probe(void)
+{
+	return riscv_has_extension("zbc");
+}
+
+bool crc32c_arch_probe(void)
+{
+	return crc32_arch_probe();
+}
+
+u32 __efi_runtime crc32_le_arch(u32 crc, const u8 *p, size_t len)
+{
+	return crc32_zbc(crc, p, len, CRC32_POLY, CRC32_POLY_QT);
+}
+
+u32 crc32c_le_arch(u32 crc, const u8 *p, size_t len)
+{
+	return crc32_zbc(crc, p, len, CRC32C_POLY, CRC32C_POLY_QT);
+}
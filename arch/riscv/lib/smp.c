@@ -6,6 +6,7 @@
 
 #include <cpu_func.h>
 #include <dm.h>
+#include <smp_work.h>
 #include <asm/barrier.h>
 #include <asm/global_data.h>
 #include <asm/smp.h>
@@ -126,3 +127,29 @@ int smp_call_function(ulong addr, ulong arg0, ulong arg1, int wait)
 
 	return send_ipi_many(&ipi, wait);
 }
+
+#if CONFIG_IS_ENABLED(SMP_WORK)
+static void smp_work_hart(ulong hart, ulong entry, ulong arg1)
+{
+	void (*func)(uint cpu) = (void (*)(uint))entry;
+
+	/* Number the harts from 1, leaving 0 for the boot hart */
+	func(hart < gd->arch.boot_hart ? hart + 1 : hart);
+}
+
+int arch_smp_work_start(void (*entry)(uint cpu))
+{
+	/* The other harts run @entry from handle_ipi() and then wait again */
+	return smp_call_function((ulong)smp_work_hart, (ulong)entry, 0, 0);
+}
+
+bool arch_smp_work_secondary(void)
+{
+	ulong hart;
+
+	/* start.S keeps the hart ID in tp */
+	asm volatile ("mv %0, tp" : "=r" (hart));
+
+	return hart != gd->arch.boot_hart;
+}
+#endif
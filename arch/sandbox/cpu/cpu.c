@@ -10,6 +10,7 @@
 #include <errno.h>
 #include <log.h>
 #include <os.h>
+#include <smp_work.h>
 #include <asm/global_data.h>
 #include <asm/io.h>
 #include <asm/malloc.h>
@@ -343,6 +344,50 @@ void invalidate_dcache_range(unsigned long start, unsigned long stop)
 {
 }
 
+#if IS_ENABLED(CONFIG_SMP_WORK)
+/* Host threads standing in for secondary CPUs */
+static void *smp_threads[CONFIG_SMP_WORK_CPUS];
+static void (*smp_entry)(uint cpu);
+static __thread bool smp_secondary;
+
+static void sandbox_smp_thread(void *arg)
+{
+	smp_secondary = true;
+	smp_entry((ulong)arg);
+}
+
+int arch_smp_work_start(void (*entry)(uint cpu))
+{
+	int cpu, count = 0;
+
+	smp_entry = entry;
+	for (cpu = 1; cpu < CONFIG_SMP_WORK_CPUS; cpu++) {
+		smp_threads[cpu] = os_thread_create(sandbox_smp_thread,
+						    (void *)(ulong)cpu);
+		if (smp_threads[cpu])
+			count++;
+	}
+
+	return count ? 0 : -ENOSYS;
+}
+
+bool arch_smp_work_secondary(void)
+{
+	return smp_secondary;
+}
+
+void arch_smp_work_finish(void)
+{
+	int cpu;
+
+	for (cpu = 1; cpu < CONFIG_SMP_WORK_CPUS; cpu++) {
+		if (smp_threads[cpu])
+			os_thread_join(smp_threads[cpu]);
+		smp_threads[cpu] = NULL;
+	}
+}
+#endif
+
 /**
  * setup_auto_tree() - Set up a basic device tree to allow sandbox to work
  *
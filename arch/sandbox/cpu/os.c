@@ -1032,6 +1032,46 @@ void os_set_time_offset(long offset)
 		       ENV_TIME_OFFSET);
 }
 
+struct os_thread {
+	pthread_t id;
+	void (*func)(void *arg);
+	void *arg;
+};
+
+static void *os_thread_main(void *arg)
+{
+	struct os_thread *thread = arg;
+
+	thread->func(thread->arg);
+
+	return NULL;
+}
+
+void *os_thread_create(void (*func)(void *arg), void *arg)
+{
+	struct os_thread *thread;
+
+	thread = os_malloc(sizeof(*thread));
+	if (!thread)
+		return NULL;
+	thread->func = func;
+	thread->arg = arg;
+	if (pthread_create(&thread->id, NULL, os_thread_main, thread)) {
+		os_free(thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+void os_thread_join(void *thread)
+{
+	struct os_thread *priv = thread;
+
+	pthread_join(priv->id, NULL);
+	os_free(priv);
+}
+
 void os_localtime(struct rtc_time *rt)
 {
 	time_t t = time(NULL);
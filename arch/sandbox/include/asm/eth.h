@@ -82,6 +82,10 @@ typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
  * recv_packets - number of packets returned
  * tx_handler - function to generate responses to sent packets
  * priv - a pointer to some structure a test may want to keep track of
+ * rx_copy - copy received packets out of their buffer, like a driver which
+ *	     cannot hand over its receive buffers
+ * rx_copy_buf - buffer packets are copied to if rx_copy is set
+ * mcast_groups - number of multicast groups joined
  */
 struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
@@ -92,6 +96,9 @@ struct eth_sandbox_priv {
 	int recv_packets;
 	sandbox_eth_tx_hand_f *tx_handler;
 	void *priv;
+	bool rx_copy;
+	uchar rx_copy_buf[PKTSIZE_ALIGN];
+	int mcast_groups;
 };
 
 /*
@@ -108,4 +115,13 @@ void sandbox_eth_set_tx_handler(int index, sandbox_eth_tx_hand_f *handler);
  */
 void sandbox_eth_set_priv(int index, void *priv);
 
+/*
+ * sandbox_eth_set_rx_copy()
+ *
+ * index - The alias index (also DM seq number)
+ * copy - If true, copy each received packet to a separate buffer before
+ *	  handing it to the network stack
+ */
+void sandbox_eth_set_rx_copy(int index, bool copy);
+
 #endif /* __ETH_H */
@@ -361,4 +361,17 @@ bool sandbox_sf_bootdev_enabled(void);
  */
 void sandbox_sf_set_enable_bootdevs(bool enable);
 
+/**
+ * sandbox_mmc_get_read_counts() - Find out how reads were sent to an MMC
+ *
+ * The counts start at zero when the device is probed
+ *
+ * @dev: Sandbox MMC device
+ * @countedp: Returns the number of multi-block reads sized by CMD23
+ * @preparedp: Returns the number of reads set up with prepare_data()
+ * @stopsp: Returns the number of CMD12 (stop transmission) commands
+ */
+void sandbox_mmc_get_read_counts(struct udevice *dev, uint *countedp,
+				 uint *preparedp, uint *stopsp);
+
 #endif
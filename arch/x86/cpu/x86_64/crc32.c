@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * CRC32 using PCLMULQDQ and CRC32C using the SSE4.2 crc32 instruction
+ *
+ * The crc32 instruction only handles the Castagnoli polynomial, so the IEEE
+ * CRC is done by folding with carry-less multiplies instead. Both need SSE to
+ * be enabled in CR4, which is only done with CONFIG_X86_HARDFP or when
+ * running as an EFI app.
+ */
+
+#include <efi_loader.h>
+#include <linux/bitops.h>
+#include <asm/control_regs.h>
+#include <asm/cpu.h>
+#include <asm/processor-flags.h>
+#include <u-boot/crc.h>
+
+#define CPUID1_ECX_PCLMULQDQ	BIT(1)
+#define CPUID1_ECX_SSE4_1	BIT(19)
+#define CPUID1_ECX_SSE4_2	BIT(20)
+
+/* Below this the setup of the folding costs more than it saves */
+#define PCLMUL_MIN_LEN		64
+
+u32 crc32_pclmul_le_16(u32 crc, const u8 *buf, size_t len);
+
+static bool __efi_runtime crc32_has_cpuid1(uint need)
+{
+	if (!(read_cr4() & X86_CR4_OSFXSR))
+		return false;
+
+	return (cpuid_ecx(1) & need) == need;
+}
+
+bool __efi_runtime crc32_arch_probe(void)
+{
+	return crc32_has_cpuid1(CPUID1_ECX_PCLMULQDQ | CPUID1_ECX_SSE4_1);
+}
+
+bool crc32c_arch_probe(void)
+{
+	return crc32_has_cpuid1(CPUID1_ECX_SSE4_2);
+}
+
+u32 __efi_runtime crc32_le_arch(u32 crc, const u8 *p, size_t len)
+{
+	size_t head, chunk;
+
+	head = -(uintptr_t)p & 15;
+	if (len < head + PCLMUL_MIN_LEN)
+		return crc32_le_base(crc, p, len);
+
+	crc = crc32_le_base(crc, p, head);
+	p += head;
+	len -= head;
+	chunk = len & ~15;
+	crc = crc32_pclmul_le_16(crc, p, chunk);
+
+	return crc32_le_base(crc, p + chunk, len - chunk);
+}
+
+u32 crc32c_le_arch(u32 crc, const u8 *p, size_t len)
+{
+	u64 crc64;
+
+	for (; len && ((uintptr_t)p & 7); len--)
+		asm("crc32b %1, %0" : "+r" (crc) : "rm" (*p++));
+
+	crc64 = crc;
+	for (; len >= 8; len -= 8, p += 8)
+		asm("crc32q %1, %0" : "+r" (crc64) : "rm" (*(const u64 *)p));
+	crc = crc64;
+
+	while (len--)
+		asm("crc32b %1, %0" : "+r" (crc) : "rm" (*p++));
+
+	return crc;
+}
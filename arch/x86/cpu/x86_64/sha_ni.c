@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-1 and SHA-256 using the Intel SHA extensions
+ *
+ * These are in most x86 CPUs from 2017 onwards. The routines also need SSSE3
+ * and SSE4.1, and SSE must be enabled in CR4, which is only done with
+ * CONFIG_X86_HARDFP or when running as an EFI app.
+ */
+
+#include <hash.h>
+#include <linux/bitops.h>
+#include <asm/control_regs.h>
+#include <asm/cpu.h>
+#include <asm/processor-flags.h>
+
+#define CPUID1_ECX_SSSE3	BIT(9)
+#define CPUID1_ECX_SSE4_1	BIT(19)
+#define CPUID7_EBX_SHA		BIT(29)
+
+void sha1_ni_process(void *state, const uint8_t *data, uint blocks);
+void sha256_ni_process(void *state, const uint8_t *data, uint blocks);
+
+static bool sha_ni_probe(void)
+{
+	const uint need = CPUID1_ECX_SSSE3 | CPUID1_ECX_SSE4_1;
+
+	if (!(read_cr4() & X86_CR4_OSFXSR))
+		return false;
+	if ((cpuid_ecx(1) & need) != need)
+		return false;
+	if (cpuid_eax(0) < 7)
+		return false;
+
+	return cpuid_ext(7, 0).ebx & CPUID7_EBX_SHA;
+}
+
+#if IS_ENABLED(CONFIG_SHA1_LEGACY)
+HASH_BACKEND(sha1_ni) = {
+	.algo		= "sha1",
+	.name		= "sha-ni",
+	.block_size	= 64,
+	.priority	= 1,
+	.probe		= sha_ni_probe,
+	.process	= sha1_ni_process,
+};
+#endif
+
+#if IS_ENABLED(CONFIG_SHA256_LEGACY)
+HASH_BACKEND(sha256_ni) = {
+	.algo		= "sha256",
+	.name		= "sha-ni",
+	.block_size	= 64,
+	.priority	= 1,
+	.probe		= sha_ni_probe,
+	.process	= sha256_ni_process,
+};
+#endif
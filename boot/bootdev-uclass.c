@@ -112,9 +112,10 @@ int bootdev_find_in_blk(struct udevice *dev, struct udevice *blk,
 	struct bootmeth_uc_plat *plat = dev_get_uclass_plat(bflow->method);
 	bool allow_any_part = plat->flags & BOOTMETHF_ANY_PART;
 	struct blk_desc *desc = dev_get_uclass_plat(blk);
-	struct disk_partition info;
+	struct disk_partition *info = &iter->probe_info;
 	char partstr[20];
 	char name[60];
+	bool first = false;
 	int ret;
 
 	/* Sanity check */
@@ -138,10 +139,21 @@ int bootdev_find_in_blk(struct udevice *dev, struct udevice *blk,
 		return log_msg_ret("check", ret);
 
 	/*
-	 * partition numbers start at 0 so this cannot succeed, but it can tell
-	 * us whether there is valid media there
+	 * Each bootmeth looks at the same partition in turn, so only examine
+	 * it for the first one and share the results with the others
 	 */
-	ret = part_get_info(desc, iter->part, &info);
+	if (iter->probe_blk != blk || iter->probe_part != iter->part) {
+		iter->probe_blk = blk;
+		iter->probe_part = iter->part;
+		/*
+		 * partition numbers start at 0 so this cannot succeed, but it
+		 * can tell us whether there is valid media there
+		 */
+		iter->probe_info_ret = part_get_info(desc, iter->part, info);
+		iter->probe_fs_ret = 1;
+		first = true;
+	}
+	ret = iter->probe_info_ret;
 	log_debug("part_get_info() returned %d\n", ret);
 	if (!iter->part && ret == -ENOENT)
 		ret = 0;
@@ -175,7 +187,8 @@ int bootdev_find_in_blk(struct udevice *dev, struct udevice *blk,
 		/* a particular partition was specified, scan it without checking */
 	} else if (!iter->part) {
 		/* This is the whole disk, check if we have bootable partitions */
-		iter->first_bootable = part_get_bootable(desc);
+		if (first)
+			iter->first_bootable = part_get_bootable(desc);
 		log_debug("checking bootable=%d\n", iter->first_bootable);
 	} else if (allow_any_part) {
 		/*
@@ -185,10 +198,15 @@ int bootdev_find_in_blk(struct udevice *dev, struct udevice *blk,
 
 	/* if there are bootable partitions, scan only those */
 	} else if (iter->first_bootable >= 0 &&
-		   (iter->first_bootable ? !info.bootable : iter->part != 1)) {
+		   (iter->first_bootable ? !info->bootable : iter->part != 1)) {
 		return log_msg_ret("boot", -EINVAL);
 	} else {
-		ret = fs_set_blk_dev_with_part(desc, bflow->part);
+		/* don't probe again for a filesystem which was not found */
+		ret = iter->probe_fs_ret;
+		if (ret >= 0) {
+			ret = fs_set_blk_dev_with_part(desc, bflow->part);
+			iter->probe_fs_ret = ret;
+		}
 		bflow->state = BOOTFLOWST_PART;
 		if (ret)
 			return log_msg_ret("fs", ret);
@@ -196,7 +214,7 @@ int bootdev_find_in_blk(struct udevice *dev, struct udevice *blk,
 		log_debug("%s: Found partition %x type %x fstype %d\n",
 			  blk->name, bflow->part,
 			  IS_ENABLED(CONFIG_DOS_PARTITION) ?
-			  disk_partition_sys_ind(&info) : 0,
+			  disk_partition_sys_ind(info) : 0,
 			  ret ? -1 : fs_get_type());
 		bflow->blk = blk;
 		bflow->state = BOOTFLOWST_FS;
@@ -14,6 +14,7 @@
 #include <env_internal.h>
 #include <malloc.h>
 #include <serial.h>
+#include <time.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
 
@@ -116,6 +117,19 @@ int bootflow_iter_drop_bootmeth(struct bootflow_iter *iter,
 	return 0;
 }
 
+/**
+ * bootflow_add_time() - Add to the time taken to scan a bootdev
+ *
+ * @dev: Bootdev being scanned
+ * @start: Value of timer_get_us() when the work started
+ */
+static void bootflow_add_time(struct udevice *dev, ulong start)
+{
+	struct bootdev_uc_plat *ucp = dev_get_uclass_plat(dev);
+
+	ucp->scan_time_us += timer_get_us() - start;
+}
+
 /**
  * bootflow_iter_set_dev() - switch to the next bootdev when iterating
  *
@@ -132,6 +146,11 @@ static void bootflow_iter_set_dev(struct bootflow_iter *iter,
 
 	log_debug("iter: Setting dev to %s, flags %x\n",
 		  dev ? dev->name : "(none)", method_flags);
+	if (dev && dev != iter->dev) {
+		struct bootdev_uc_plat *dev_ucp = dev_get_uclass_plat(dev);
+
+		dev_ucp->scan_time_us = 0;
+	}
 	iter->dev = dev;
 	iter->method_flags = method_flags;
 
@@ -185,6 +204,7 @@ static int iter_incr(struct bootflow_iter *iter)
 	struct udevice *dev;
 	bool inc_dev = true;
 	bool global;
+	ulong start;
 	int ret;
 
 	log_debug("entry: err=%d\n", iter->err);
@@ -240,6 +260,7 @@ static int iter_incr(struct bootflow_iter *iter)
 	iter->max_part = 0;
 
 	/* ...select next bootdev */
+	start = timer_get_us();
 	if (iter->flags & BOOTFLOWIF_SINGLE_DEV) {
 		ret = -ENOENT;
 	} else {
@@ -318,8 +339,10 @@ static int iter_incr(struct bootflow_iter *iter)
 			 */
 			ret = device_probe(dev);
 			log_debug("probe %s %d\n", dev->name, ret);
-			if (!log_msg_ret("probe", ret))
+			if (!log_msg_ret("probe", ret)) {
 				bootflow_iter_set_dev(iter, dev, method_flags);
+				bootflow_add_time(dev, start);
+			}
 		}
 	}
 
@@ -341,6 +364,7 @@ static int iter_incr(struct bootflow_iter *iter)
 static int bootflow_check(struct bootflow_iter *iter, struct bootflow *bflow)
 {
 	struct udevice *dev;
+	ulong start;
 	int ret;
 
 	if (IS_ENABLED(CONFIG_BOOTMETH_GLOBAL) && iter->doing_global) {
@@ -353,7 +377,9 @@ static int bootflow_check(struct bootflow_iter *iter, struct bootflow *bflow)
 	}
 
 	dev = iter->dev;
+	start = timer_get_us();
 	ret = bootdev_get_bootflow(dev, iter, bflow);
+	bootflow_add_time(dev, start);
 
 	/* If we got a valid bootflow, return it */
 	if (!ret) {
@@ -401,12 +427,15 @@ int bootflow_scan_first(struct udevice *dev, const char *label,
 	if (!IS_ENABLED(CONFIG_BOOTMETH_GLOBAL) || !iter->doing_global) {
 		struct udevice *dev = NULL;
 		int method_flags;
+		ulong start;
 
+		start = timer_get_us();
 		ret = bootdev_setup_iter(iter, label, &dev, &method_flags);
 		if (ret)
 			return log_msg_ret("obdev", -ENODEV);
 
 		bootflow_iter_set_dev(iter, dev, method_flags);
+		bootflow_add_time(dev, start);
 	}
 
 	ret = bootflow_check(iter, bflow);
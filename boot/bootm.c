@@ -34,6 +34,7 @@
 
 #include <bootm.h>
 #include <image.h>
+#include <image-stream.h>
 
 #define MAX_CMDLINE_SIZE	SZ_4K
 
@@ -191,11 +192,13 @@ static int boot_get_kernel(const char *addr_fit, struct bootm_headers *images,
 #endif
 #if CONFIG_IS_ENABLED(FIT)
 	case IMAGE_FORMAT_FIT:
+		/* The hash may be checked when bootm_load_os() loads it */
+		images->fit_hash_os = 0;
 		os_noffset = fit_image_load(images, img_addr,
 				&fit_uname_kernel, &fit_uname_config,
 				IH_ARCH_DEFAULT, IH_TYPE_KERNEL,
 				BOOTSTAGE_ID_FIT_KERNEL_START,
-				FIT_LOAD_IGNORED, os_data, os_len);
+				FIT_LOAD_STREAM, os_data, os_len);
 		if (os_noffset < 0)
 			return -ENOENT;
 
@@ -597,6 +600,52 @@ static int handle_decomp_error(int comp_type, size_t uncomp_size,
 #endif
 
 #ifndef USE_HOSTCC
+/**
+ * bootm_stream_os() - Load the OS image while checking its hash
+ *
+ * This is used for FIT images when fit_image_load() leaves the hash check to
+ * be done while loading, so the data is only read once.
+ *
+ * @images:	Images information, with @images->fit_hash_os set
+ * @os:		OS image to load
+ * @load_buf:	Buffer to load into
+ * @load_end:	Returns the end address of the loaded image
+ * Return: 0 if OK, -EACCES if the hash is wrong, other -ve value if the image
+ *	could not be loaded
+ */
+static int bootm_stream_os(struct bootm_headers *images,
+			   const struct image_info *os, void *load_buf,
+			   ulong *load_end)
+{
+	struct image_stream st = {
+		.comp = os->comp,
+		.src = map_sysmem(os->image_start, os->image_len),
+		.size = os->image_len,
+		.dst = load_buf,
+		.dst_size = CONFIG_SYS_BOOTM_LEN,
+	};
+	int ret;
+
+	print_decomp_msg(os->comp, os->type, os->load == os->image_start,
+			 os->load);
+	puts("   Verifying Hash Integrity ... ");
+	ret = fit_image_stream_verify(images->fit_hdr_os, images->fit_noffset_os,
+				      images->fit_hash_os, &st);
+	*load_end = os->load + st.len;
+	if (ret == -EACCES) {
+		puts("Bad Data Hash\n");
+		bootstage_error(BOOTSTAGE_ID_FIT_KERNEL_START +
+				BOOTSTAGE_SUB_HASH);
+		return ret;
+	} else if (ret) {
+		return ret;
+	}
+	puts("OK\n");
+	images->fit_hash_os = 0;
+
+	return 0;
+}
+
 static int bootm_load_os(struct bootm_headers *images, int boot_progress)
 {
 	struct image_info os = images->os;
@@ -632,9 +681,15 @@ static int bootm_load_os(struct bootm_headers *images, int boot_progress)
 
 	load_buf = map_sysmem(load, 0);
 	image_buf = map_sysmem(os.image_start, image_len);
-	err = image_decomp(os.comp, load, os.image_start, os.type,
-			   load_buf, image_buf, image_len,
-			   CONFIG_SYS_BOOTM_LEN, &load_end);
+	if (CONFIG_IS_ENABLED(IMAGE_STREAM) && images->fit_hash_os) {
+		err = bootm_stream_os(images, &os, load_buf, &load_end);
+		if (err == -EACCES)
+			return 1;
+	} else {
+		err = image_decomp(os.comp, load, os.image_start, os.type,
+				   load_buf, image_buf, image_len,
+				   CONFIG_SYS_BOOTM_LEN, &load_end);
+	}
 	if (err) {
 		err = handle_decomp_error(os.comp, load_end - load,
 					  CONFIG_SYS_BOOTM_LEN, err);
@@ -1006,6 +1061,15 @@ int bootm_run_states(struct bootm_info *bmi, int states)
 			ret = 0;
 	}
 
+	/* A FIT kernel may not have been checked yet if it was not loaded */
+	if (!ret && images->fit_hash_os &&
+	    (states & (BOOTM_STATE_OS_PREP | BOOTM_STATE_OS_FAKE_GO |
+		       BOOTM_STATE_OS_GO))) {
+		puts("ERROR: kernel hash not checked, use 'bootm loados'\n");
+		ret = 1;
+		goto err;
+	}
+
 	/* Relocate the ramdisk */
 #ifdef CONFIG_SYS_BOOT_RAMDISK_HIGH
 	if (!ret && (states & BOOTM_STATE_RAMDISK)) {
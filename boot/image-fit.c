@@ -35,6 +35,7 @@ DECLARE_GLOBAL_DATA_PTR;
 
 #include <bootm.h>
 #include <image.h>
+#include <image-stream.h>
 #include <bootstage.h>
 #include <upl.h>
 #include <u-boot/crc.h>
@@ -1137,6 +1138,22 @@ int fit_image_hash_get_value(const void *fit, int noffset, uint8_t **value,
 	return 0;
 }
 
+int fit_image_hash_get_chunk_size(const void *fit, int noffset,
+				  ulong *chunk_sizep)
+{
+	const fdt32_t *val;
+	int len;
+
+	val = fdt_getprop(fit, noffset, FIT_CHUNK_SIZE_PROP, &len);
+	if (!val)
+		return -ENOENT;
+	if (len != sizeof(*val) || !fdt32_to_cpu(*val))
+		return -EINVAL;
+	*chunk_sizep = fdt32_to_cpu(*val);
+
+	return 0;
+}
+
 /**
  * fit_image_hash_get_ignore - get hash ignore flag
  * @fit: pointer to the FIT format image header
@@ -1290,15 +1307,170 @@ int calculate_hash(const void *data, int data_len, const char *name,
 	return 0;
 }
 
+static int fit_image_hash_compare(const void *fit, int noffset,
+				  const uint8_t *value, int value_len,
+				  char **err_msgp)
+{
+	uint8_t *fit_value;
+	int fit_value_len;
+
+	if (fit_image_hash_get_value(fit, noffset, &fit_value,
+				     &fit_value_len)) {
+		*err_msgp = "Can't get hash value property";
+		return -1;
+	}
+
+	if (value_len != fit_value_len) {
+		*err_msgp = "Bad hash value len";
+		return -1;
+	} else if (memcmp(value, fit_value, value_len) != 0) {
+		*err_msgp = "Bad hash value";
+		return -1;
+	}
+
+	return 0;
+}
+
+int fit_hash_chunks(const void *data, size_t size, const char *algo,
+		    ulong chunk_size, uint8_t *values, int *value_len)
+{
+	int count = fit_hash_chunk_count(size, chunk_size);
+	int len = 0;
+	ulong offset;
+	int i;
+
+#ifndef USE_HOSTCC
+	if (CONFIG_IS_ENABLED(SMP_WORK) && !IS_ENABLED(CONFIG_DM_HASH) &&
+	    count > 1) {
+		struct hash_job *jobs;
+		int ret;
+
+		jobs = calloc(count, sizeof(*jobs));
+		if (jobs) {
+			for (i = 0, offset = 0; i < count;
+			     i++, offset += chunk_size) {
+				jobs[i].algo = algo;
+				jobs[i].data = data + offset;
+				jobs[i].len = min_t(ulong, chunk_size,
+						    size - offset);
+			}
+			ret = hash_run_jobs(jobs, count);
+			if (!ret) {
+				len = jobs[0].digest_len;
+				for (i = 0; i < count; i++)
+					memcpy(values + i * len,
+					       jobs[i].digest, len);
+				*value_len = len;
+			}
+			free(jobs);
+
+			return ret;
+		}
+	}
+#endif
+	for (i = 0, offset = 0; i < count; i++, offset += chunk_size) {
+		if (calculate_hash(data + offset,
+				   i < count - 1 ? chunk_size : size - offset,
+				   algo, values + i * len, &len))
+			return -EPROTONOSUPPORT;
+	}
+	*value_len = len;
+
+	return 0;
+}
+
+/**
+ * fit_image_check_chunks() - Check a hash node which hashes chunks
+ *
+ * The root hash in the value property is checked against the chunk hashes
+ * and then each of those against its chunk of the data.
+ *
+ * @fit: FIT to check
+ * @noffset: Offset of the hash node
+ * @data: Image data
+ * @size: Size of @data in bytes
+ * @algo: Hash algorithm
+ * @chunk_size: Size of each chunk in bytes
+ * @err_msgp: Returns an error message on failure
+ * Return: 0 if OK, -1 on failure
+ */
+static int fit_image_check_chunks(const void *fit, int noffset,
+				  const void *data, size_t size,
+				  const char *algo, ulong chunk_size,
+				  char **err_msgp)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(uint8_t, value, FIT_MAX_HASH_LEN);
+	const uint8_t *chunks;
+	uint8_t *values;
+	int value_len;
+	int len;
+	int ret;
+
+	chunks = fdt_getprop(fit, noffset, FIT_CHUNK_VALUE_PROP, &len);
+	if (!chunks) {
+		*err_msgp = "Can't get chunk value property";
+		return -1;
+	}
+	if (calculate_hash(chunks, len, algo, value, &value_len)) {
+		*err_msgp = "Unsupported hash algorithm";
+		return -1;
+	}
+	if (fit_image_hash_compare(fit, noffset, value, value_len, err_msgp))
+		return -1;
+	if (len != fit_hash_chunk_count(size, chunk_size) * value_len) {
+		*err_msgp = "Bad chunk value len";
+		return -1;
+	}
+	if (!len) {
+		/* Only empty data has no chunks */
+		if (size) {
+			*err_msgp = "Bad chunk value len";
+			return -1;
+		}
+		return 0;
+	}
+
+	values = malloc(fit_hash_chunk_count(size, chunk_size) *
+			FIT_MAX_HASH_LEN);
+	if (!values) {
+		*err_msgp = "Out of memory";
+		return -1;
+	}
+	ret = fit_hash_chunks(data, size, algo, chunk_size, values,
+			      &value_len);
+	if (ret) {
+		*err_msgp = "Unsupported hash algorithm";
+		ret = -1;
+	} else if (memcmp(values, chunks, len)) {
+		*err_msgp = "Bad chunk hash value";
+		ret = -1;
+	}
+	free(values);
+
+	return ret;
+}
+
+/**
+ * fit_image_check_hash() - Check the hash in one hash node
+ *
+ * @fit: FIT to check
+ * @noffset: Offset of the hash node
+ * @data: Image data
+ * @size: Size of @data in bytes
+ * @job: Hash already calculated for this node, or NULL to calculate it here
+ * @err_msgp: Returns an error message on failure
+ * Return: 0 if OK, -1 on failure
+ */
 static int fit_image_check_hash(const void *fit, int noffset, const void *data,
-				size_t size, char **err_msgp)
+				size_t size, const struct hash_job *job,
+				char **err_msgp)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(uint8_t, value, FIT_MAX_HASH_LEN);
+	ulong chunk_size;
 	int value_len;
 	const char *algo;
-	uint8_t *fit_value;
-	int fit_value_len;
 	int ignore;
+	int ret;
 
 	*err_msgp = NULL;
 
@@ -1316,31 +1488,48 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		}
 	}
 
-	if (fit_image_hash_get_value(fit, noffset, &fit_value,
-				     &fit_value_len)) {
-		*err_msgp = "Can't get hash value property";
-		return -1;
+	if (CONFIG_IS_ENABLED(FIT_HASH_CHUNKS) || tools_build()) {
+		ret = fit_image_hash_get_chunk_size(fit, noffset, &chunk_size);
+		if (!ret)
+			return fit_image_check_chunks(fit, noffset, data, size,
+						      algo, chunk_size,
+						      err_msgp);
+		if (ret != -ENOENT) {
+			*err_msgp = "Bad chunk size";
+			return -1;
+		}
 	}
 
+	if (job && job->digest_len)
+		return fit_image_hash_compare(fit, noffset, job->digest,
+					      job->digest_len, err_msgp);
+
 	if (calculate_hash(data, size, algo, value, &value_len)) {
 		*err_msgp = "Unsupported hash algorithm";
 		return -1;
 	}
 
-	if (value_len != fit_value_len) {
-		*err_msgp = "Bad hash value len";
-		return -1;
-	} else if (memcmp(value, fit_value, value_len) != 0) {
-		*err_msgp = "Bad hash value";
-		return -1;
+	return fit_image_hash_compare(fit, noffset, value, value_len,
+				      err_msgp);
+}
+
+static const struct hash_job *fit_find_hash_job(const struct hash_job *jobs,
+						int count, int noffset)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (jobs[i].id == noffset)
+			return &jobs[i];
 	}
 
-	return 0;
+	return NULL;
 }
 
-int fit_image_verify_with_data(const void *fit, int image_noffset,
-			       const void *key_blob, const void *data,
-			       size_t size)
+static int fit_image_verify_jobs(const void *fit, int image_noffset,
+				 const void *key_blob, const void *data,
+				 size_t size, const struct hash_job *jobs,
+				 int count)
 {
 	int		noffset = 0;
 	char		*err_msg = "";
@@ -1367,6 +1556,8 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 		if (!strncmp(name, FIT_HASH_NODENAME,
 			     strlen(FIT_HASH_NODENAME))) {
 			if (fit_image_check_hash(fit, noffset, data, size,
+						 fit_find_hash_job(jobs, count,
+								   noffset),
 						 &err_msg))
 				goto error;
 			puts("+ ");
@@ -1403,20 +1594,16 @@ error:
 	return 0;
 }
 
-/**
- * fit_image_verify - verify data integrity
- * @fit: pointer to the FIT format image header
- * @image_noffset: component image node offset
- *
- * fit_image_verify() goes over component image hash nodes,
- * re-calculates each data hash and compares with the value stored in hash
- * node.
- *
- * returns:
- *     1, if all hashes are valid
- *     0, otherwise (or on error)
- */
-int fit_image_verify(const void *fit, int image_noffset)
+int fit_image_verify_with_data(const void *fit, int image_noffset,
+			       const void *key_blob, const void *data,
+			       size_t size)
+{
+	return fit_image_verify_jobs(fit, image_noffset, key_blob, data, size,
+				     NULL, 0);
+}
+
+static int fit_image_verify_hashed(const void *fit, int image_noffset,
+				   const struct hash_job *jobs, int count)
 {
 	const char *name = fit_get_name(fit, image_noffset, NULL);
 	const void	*data;
@@ -1437,8 +1624,8 @@ int fit_image_verify(const void *fit, int image_noffset)
 		goto err;
 	}
 
-	return fit_image_verify_with_data(fit, image_noffset, gd_fdt_blob(),
-					  data, size);
+	return fit_image_verify_jobs(fit, image_noffset, gd_fdt_blob(), data,
+				     size, jobs, count);
 
 err:
 	printf("error!\n%s in '%s' image node\n", err_msg,
@@ -1446,6 +1633,235 @@ err:
 	return 0;
 }
 
+/**
+ * fit_image_verify - verify data integrity
+ * @fit: pointer to the FIT format image header
+ * @image_noffset: component image node offset
+ *
+ * fit_image_verify() goes over component image hash nodes,
+ * re-calculates each data hash and compares with the value stored in hash
+ * node.
+ *
+ * returns:
+ *     1, if all hashes are valid
+ *     0, otherwise (or on error)
+ */
+int fit_image_verify(const void *fit, int image_noffset)
+{
+	return fit_image_verify_hashed(fit, image_noffset, NULL, 0);
+}
+
+#ifndef USE_HOSTCC
+int fit_image_get_stream_hash(const void *fit, int image_noffset,
+			      const char **algop)
+{
+	struct hash_algo *algo;
+	int hash_noffset = -ENOENT;
+	int noffset, ignore;
+
+	if (!CONFIG_IS_ENABLED(IMAGE_STREAM))
+		return -ENOENT;
+	if (IS_ENABLED(CONFIG_FIT_SIGNATURE) &&
+	    strchr(fit_get_name(fit, image_noffset, NULL), '@'))
+		return -ENOENT;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		/* Signatures need all of the data at once */
+		if (!strncmp(name, FIT_SIG_NODENAME,
+			     strlen(FIT_SIG_NODENAME)))
+			return -ENOENT;
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (hash_noffset >= 0)
+			return -ENOENT;
+		hash_noffset = noffset;
+	}
+	if (hash_noffset < 0 ||
+	    fit_image_hash_get_algo(fit, hash_noffset, algop) ||
+	    hash_progressive_lookup_algo(*algop, &algo))
+		return -ENOENT;
+
+	fit_image_hash_get_ignore(fit, hash_noffset, &ignore);
+	if (ignore)
+		return -ENOENT;
+
+	return hash_noffset;
+}
+
+/**
+ * fit_image_stream_chunks() - Set up a pass to check each chunk as it arrives
+ *
+ * The root hash is checked against the chunk hashes here, before any data is
+ * read, and image_stream_run() checks each chunk against its hash.
+ *
+ * @fit: FIT containing the image
+ * @hash_noffset: Offset of the hash node
+ * @st: Description of the image, updated with the chunk hashes
+ * @err_msgp: Returns an error message on failure
+ * Return: 0 if OK, -ENOENT if the hash node does not use chunks, -EACCES if
+ *	the chunk hashes are not valid
+ */
+static int fit_image_stream_chunks(const void *fit, int hash_noffset,
+				   struct image_stream *st, char **err_msgp)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(uint8_t, value, FIT_MAX_HASH_LEN);
+	int value_len;
+	int len;
+
+	if (!CONFIG_IS_ENABLED(FIT_HASH_CHUNKS) ||
+	    fit_image_hash_get_chunk_size(fit, hash_noffset, &st->hash_chunk)) {
+		st->hash_chunk = 0;
+		return -ENOENT;
+	}
+
+	st->chunk_values = fdt_getprop(fit, hash_noffset, FIT_CHUNK_VALUE_PROP,
+				       &len);
+	if (!st->chunk_values) {
+		*err_msgp = "Can't get chunk value property";
+		return -EACCES;
+	}
+	if (calculate_hash(st->chunk_values, len, st->algo, value,
+			   &value_len)) {
+		*err_msgp = "Unsupported hash algorithm";
+		return -EACCES;
+	}
+	if (fit_image_hash_compare(fit, hash_noffset, value, value_len,
+				   err_msgp))
+		return -EACCES;
+	if (len !=
+	    fit_hash_chunk_count(st->size, st->hash_chunk) * value_len) {
+		*err_msgp = "Bad chunk value len";
+		return -EACCES;
+	}
+
+	return 0;
+}
+
+int fit_image_stream_verify(const void *fit, int image_noffset,
+			    int hash_noffset, struct image_stream *st)
+{
+	char *err_msg = "";
+	int verify_all;
+	int ret;
+
+	if (fit_image_hash_get_algo(fit, hash_noffset, &st->algo))
+		return -ENOENT;
+	ret = fit_image_stream_chunks(fit, hash_noffset, st, &err_msg);
+	if (ret == -EACCES) {
+		printf("%s", st->algo);
+		goto error;
+	}
+	ret = image_stream_run(st);
+	if (ret == -EACCES) {
+		printf("%s", st->algo);
+		err_msg = "Bad chunk hash value";
+		goto error;
+	} else if (ret) {
+		printf("error!\nCannot load '%s' image node (err=%d)\n",
+		       fit_get_name(fit, image_noffset, NULL), ret);
+		return ret;
+	}
+
+	/* There are no signature nodes, so this only checks none are needed */
+	if (FIT_IMAGE_ENABLE_VERIFY &&
+	    fit_image_verify_required_sigs(fit, image_noffset, NULL, 0,
+					   gd_fdt_blob(), &verify_all)) {
+		err_msg = "Unable to verify required signature";
+		goto error;
+	}
+
+	printf("%s", st->algo);
+	if (!st->hash_chunk &&
+	    fit_image_hash_compare(fit, hash_noffset, st->digest,
+				   st->digest_len, &err_msg))
+		goto error;
+	puts("+ ");
+
+	return 0;
+
+error:
+	printf(" error!\n%s for '%s' hash node in '%s' image node\n",
+	       err_msg, fit_get_name(fit, hash_noffset, NULL),
+	       fit_get_name(fit, image_noffset, NULL));
+	return -EACCES;
+}
+
+/**
+ * fit_hash_all_images() - Calculate the hashes of all images together
+ *
+ * The hashes are shared out between the CPUs by hash_run_jobs(), leaving
+ * only the comparisons for checking each image in turn.
+ *
+ * @fit: FIT to check
+ * @images_noffset: Offset of the images node
+ * @countp: Returns the number of jobs
+ * Return: jobs, one for each hash node, or NULL if the hashes should be
+ *	calculated as each image is checked. The caller must free this
+ */
+static struct hash_job *fit_hash_all_images(const void *fit,
+					    int images_noffset, int *countp)
+{
+	struct hash_job *jobs;
+	int image_noffset, noffset;
+	int count = 0, n = 0;
+	const char *algo;
+	const void *data;
+	size_t size;
+	int ignore;
+
+	*countp = 0;
+	if (!CONFIG_IS_ENABLED(SMP_WORK) || IS_ENABLED(CONFIG_DM_HASH))
+		return NULL;
+
+	fdt_for_each_subnode(image_noffset, fit, images_noffset) {
+		fdt_for_each_subnode(noffset, fit, image_noffset) {
+			if (!strncmp(fit_get_name(fit, noffset, NULL),
+				     FIT_HASH_NODENAME,
+				     strlen(FIT_HASH_NODENAME)))
+				count++;
+		}
+	}
+	if (count < 2)
+		return NULL;
+	jobs = calloc(count, sizeof(*jobs));
+	if (!jobs)
+		return NULL;
+
+	fdt_for_each_subnode(image_noffset, fit, images_noffset) {
+		if (fit_image_get_data_and_size(fit, image_noffset, &data,
+						&size))
+			continue;
+		fdt_for_each_subnode(noffset, fit, image_noffset) {
+			/* Hashes of chunks are shared out when checked */
+			if (strncmp(fit_get_name(fit, noffset, NULL),
+				    FIT_HASH_NODENAME,
+				    strlen(FIT_HASH_NODENAME)) ||
+			    fdt_getprop(fit, noffset, FIT_CHUNK_SIZE_PROP,
+					NULL) ||
+			    fit_image_hash_get_algo(fit, noffset, &algo))
+				continue;
+			fit_image_hash_get_ignore(fit, noffset, &ignore);
+			if (ignore)
+				continue;
+			jobs[n].algo = algo;
+			jobs[n].data = data;
+			jobs[n].len = size;
+			jobs[n].id = noffset;
+			n++;
+		}
+	}
+
+	/* Unsupported algorithms are reported when the image is checked */
+	hash_run_jobs(jobs, n);
+	*countp = n;
+
+	return jobs;
+}
+#endif /* !USE_HOSTCC */
+
 /**
  * fit_all_image_verify - verify data integrity for all images
  * @fit: pointer to the FIT format image header
@@ -1459,10 +1875,13 @@ err:
  */
 int fit_all_image_verify(const void *fit)
 {
+	struct hash_job *jobs = NULL;
 	int images_noffset;
 	int noffset;
 	int ndepth;
 	int count;
+	int njobs = 0;
+	int ret = 1;
 
 	/* Find images parent node offset */
 	images_noffset = fdt_path_offset(fit, FIT_IMAGES_PATH);
@@ -1475,6 +1894,9 @@ int fit_all_image_verify(const void *fit)
 	/* Process all image subnodes, check hashes for each */
 	printf("## Checking hash(es) for FIT Image at %08lx ...\n",
 	       (ulong)fit);
+#ifndef USE_HOSTCC
+	jobs = fit_hash_all_images(fit, images_noffset, &njobs);
+#endif
 	for (ndepth = 0, count = 0,
 	     noffset = fdt_next_node(fit, images_noffset, &ndepth);
 			(noffset >= 0) && (ndepth > 0);
@@ -1488,12 +1910,17 @@ int fit_all_image_verify(const void *fit)
 			       fit_get_name(fit, noffset, NULL));
 			count++;
 
-			if (!fit_image_verify(fit, noffset))
-				return 0;
+			if (!fit_image_verify_hashed(fit, noffset, jobs,
+						     njobs)) {
+				ret = 0;
+				break;
+			}
 			printf("\n");
 		}
 	}
-	return 1;
+	free(jobs);
+
+	return ret;
 }
 
 static int fit_image_uncipher(const void *fit, int image_noffset,
@@ -2047,6 +2474,81 @@ static const char *fit_get_image_type_property(int type)
 	return "unknown";
 }
 
+/**
+ * fit_image_can_stream() - Check whether fit_image_load() can stream an image
+ *
+ * Images which fit_image_load() decompresses or copies can have their hash
+ * checked at the same time, as can kernels which the caller loads with
+ * FIT_LOAD_STREAM. Anything which changes the data between checking and
+ * loading it rules this out.
+ *
+ * Return: true if the image can be checked while it is loaded
+ */
+static bool fit_image_can_stream(const void *fit, int noffset, int image_type,
+				 enum fit_load_op load_op)
+{
+	uint8_t comp;
+
+	if (tools_build() || IS_ENABLED(CONFIG_FIT_IMAGE_POST_PROCESS))
+		return false;
+	if (IS_ENABLED(CONFIG_FIT_CIPHER) &&
+	    fdt_subnode_offset(fit, noffset, FIT_CIPHER_NODENAME) >= 0)
+		return false;
+	if (fit_image_get_comp(fit, noffset, &comp))
+		comp = IH_COMP_NONE;
+
+	switch (image_type) {
+	case IH_TYPE_KERNEL:
+		return load_op == FIT_LOAD_STREAM &&
+			image_stream_supported(comp);
+	case IH_TYPE_RAMDISK:
+		/* Ramdisks are never decompressed here */
+		return true;
+	default:
+		return image_stream_supported(comp);
+	}
+}
+
+/**
+ * fit_image_stream_load() - Load an image while checking its hash
+ *
+ * @fit: FIT to use
+ * @noffset: Offset of the image node
+ * @hash_noffset: Offset of the hash node to check
+ * @comp: Compression to undo (IH_COMP_...)
+ * @buf: Image data
+ * @len: Size of the image data in bytes
+ * @loadbuf: Buffer to load the image into, or NULL to leave it in place
+ * @max_len: Size of @loadbuf in bytes
+ * @lenp: Returns the size of the loaded image
+ * Return: 0 if OK, -EACCES if the hash is wrong, other -ve value on error
+ */
+static int fit_image_stream_load(const void *fit, int noffset,
+				 int hash_noffset, int comp, const void *buf,
+				 ulong len, void *loadbuf, ulong max_len,
+				 ulong *lenp)
+{
+	struct image_stream st = {
+		.comp = comp,
+		.src = buf,
+		.size = len,
+		.dst = loadbuf,
+		.dst_size = max_len,
+	};
+	int ret;
+
+	puts("   Verifying Hash Integrity ... ");
+	ret = fit_image_stream_verify(fit, noffset, hash_noffset, &st);
+	if (ret) {
+		puts(ret == -EACCES ? "Bad Data Hash\n" : "\n");
+		return ret;
+	}
+	puts("OK\n");
+	*lenp = st.len;
+
+	return 0;
+}
+
 int fit_image_load(struct bootm_headers *images, ulong addr,
 		   const char **fit_unamep, const char **fit_uname_configp,
 		   int arch, int ph_type, int bootstage_id,
@@ -2065,6 +2567,8 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 	ulong load, load_end, data, len;
 	uint8_t os, comp;
 	const char *prop_name;
+	const char *hash_algo;
+	int hash_noffset;
 	int ret;
 
 	fit = map_sysmem(addr, 0);
@@ -2138,7 +2642,15 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 
 	printf("   Trying '%s' %s subimage\n", fit_uname, prop_name);
 
-	ret = fit_image_select(fit, noffset, images->verify);
+	/* Check the hash while loading the image, if possible */
+	hash_noffset = -ENOENT;
+	if (CONFIG_IS_ENABLED(IMAGE_STREAM) && images->verify &&
+	    fit_image_can_stream(fit, noffset, image_type, load_op))
+		hash_noffset = fit_image_get_stream_hash(fit, noffset,
+							 &hash_algo);
+
+	ret = fit_image_select(fit, noffset,
+			       images->verify && hash_noffset < 0);
 	if (ret) {
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
 		return ret;
@@ -2224,7 +2736,7 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 
 	data = map_to_sysmem(buf);
 	load = data;
-	if (load_op == FIT_LOAD_IGNORED) {
+	if (load_op == FIT_LOAD_IGNORED || load_op == FIT_LOAD_STREAM) {
 		/* Don't load */
 	} else if (fit_image_get_load(fit, noffset, &load)) {
 		if (load_op == FIT_LOAD_REQUIRED) {
@@ -2271,13 +2783,41 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 		} else {
 			loadbuf = map_sysmem(load, max_decomp_len);
 		}
-		if (image_decomp(comp, load, data, image_type,
+		if (hash_noffset >= 0) {
+			ret = fit_image_stream_load(fit, noffset, hash_noffset,
+						    comp, buf, len, loadbuf,
+						    max_decomp_len, &len);
+			if (ret == -EACCES) {
+				bootstage_error(bootstage_id +
+						BOOTSTAGE_SUB_HASH);
+				return ret;
+			} else if (ret) {
+				printf("Error decompressing %s\n", prop_name);
+				return -ENOEXEC;
+			}
+		} else if (image_decomp(comp, load, data, image_type,
 				loadbuf, buf, len, max_decomp_len, &load_end)) {
 			printf("Error decompressing %s\n", prop_name);
 
 			return -ENOEXEC;
+		} else {
+			len = load_end - load;
+		}
+	} else if (hash_noffset >= 0 && load_op == FIT_LOAD_STREAM) {
+		/* The caller checks the hash when it loads the image */
+		images->fit_hash_os = hash_noffset;
+	} else if (hash_noffset >= 0) {
+		/* Copy the image, or just hash it if it stays where it is */
+		if (load != data)
+			loadbuf = map_sysmem(load, len);
+		ret = fit_image_stream_load(fit, noffset, hash_noffset,
+					    IH_COMP_NONE, buf, len,
+					    load != data ? loadbuf : NULL, len,
+					    &len);
+		if (ret) {
+			bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
+			return ret;
 		}
-		len = load_end - load;
 	} else if (load != data) {
 		loadbuf = map_sysmem(load, len);
 		memcpy(loadbuf, buf, len);
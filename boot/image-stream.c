@@ -0,0 +1,380 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Single-pass loading, hashing and decompression of images
+ *
+ * Verifying and then decompressing a large image touches every byte of it
+ * twice, or three times if it was first read from storage into a temporary
+ * buffer. Here the data is instead handled a chunk at a time: each chunk is
+ * read, hashed and decompressed before moving to the next, so the source
+ * data only passes through the cache once.
+ */
+
+#define LOG_CATEGORY	LOGC_BOOT
+
+#include <gzip.h>
+#include <hash.h>
+#include <image.h>
+#include <image-stream.h>
+#include <log.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <u-boot/schedule.h>
+#include <u-boot/zlib.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/zstd.h>
+
+/**
+ * struct stream_priv - State of a pass over an image
+ *
+ * @st: Description of the image
+ * @algo: Hash algorithm, or NULL if not hashing
+ * @hash_ctx: Hash context, or NULL if not hashing
+ * @pos: Number of bytes of source data handled so far
+ * @chunk: Index of the hash chunk being hashed, with &image_stream->hash_chunk
+ * @chunk_pos: Number of bytes hashed in that chunk so far
+ * @done: true once the decompressor has seen the end of the data
+ * @zs: gzip state
+ * @zs_ready: true if @zs has been set up
+ * @zds: zstd state, or NULL
+ * @zws: Workspace for @zds
+ * @zout: Output buffer for @zds
+ */
+struct stream_priv {
+	struct image_stream *st;
+	struct hash_algo *algo;
+	void *hash_ctx;
+	ulong pos;
+	ulong chunk;
+	ulong chunk_pos;
+	bool done;
+	z_stream zs;
+	bool zs_ready;
+	zstd_dstream *zds;
+	void *zws;
+	zstd_out_buffer zout;
+};
+
+bool image_stream_supported(int comp)
+{
+	switch (comp) {
+	case IH_COMP_NONE:
+		return true;
+	case IH_COMP_GZIP:
+		return CONFIG_IS_ENABLED(GZIP);
+	case IH_COMP_ZSTD:
+		return CONFIG_IS_ENABLED(ZSTD);
+	}
+
+	return false;
+}
+
+static int stream_gzip(struct stream_priv *priv, const u8 *buf, ulong len)
+{
+	struct image_stream *st = priv->st;
+	z_stream *zs = &priv->zs;
+	int ret;
+
+	if (!priv->zs_ready) {
+		/* The header must be in the first chunk */
+		ret = gzip_parse_header(buf, len);
+		if (ret < 0)
+			return -EINVAL;
+		buf += ret;
+		len -= ret;
+
+		zs->zalloc = gzalloc;
+		zs->zfree = gzfree;
+		if (inflateInit2(zs, -MAX_WBITS) != Z_OK)
+			return -ENOMEM;
+		zs->next_out = st->dst;
+		zs->avail_out = st->dst_size;
+		priv->zs_ready = true;
+	}
+
+	zs->next_in = (u8 *)buf;
+	zs->avail_in = len;
+	while (zs->avail_in && !priv->done) {
+		ret = inflate(zs, Z_NO_FLUSH);
+		if (ret == Z_STREAM_END)
+			priv->done = true;
+		else if (ret == Z_BUF_ERROR && !zs->avail_out)
+			return -ENOSPC;
+		else if (ret != Z_OK)
+			return -EINVAL;
+	}
+	st->len = zs->next_out - (u8 *)st->dst;
+
+	return 0;
+}
+
+static int stream_zstd(struct stream_priv *priv, const u8 *buf, ulong len)
+{
+	struct image_stream *st = priv->st;
+	zstd_in_buffer in = { .src = buf, .size = len };
+	size_t wsize, ret;
+
+	if (!priv->zds) {
+		/*
+		 * Write straight into the destination, so that no window
+		 * buffer is needed, only space for one compressed block
+		 */
+		wsize = zstd_dctx_workspace_bound() + ZSTD_BLOCKSIZE_MAX;
+		priv->zws = malloc(wsize);
+		if (!priv->zws)
+			return -ENOMEM;
+		priv->zds = zstd_init_dstream(0, priv->zws, wsize);
+		if (!priv->zds ||
+		    zstd_is_error(ZSTD_DCtx_setParameter(priv->zds,
+							 ZSTD_d_stableOutBuffer,
+							 1)))
+			return -ENOMEM;
+		priv->zout.dst = st->dst;
+		priv->zout.size = st->dst_size;
+	}
+
+	/* Anything after the end of the frame is ignored, as in unzstd */
+	while (in.pos < in.size && !priv->done) {
+		size_t in_pos = in.pos, out_pos = priv->zout.pos;
+
+		ret = zstd_decompress_stream(priv->zds, &priv->zout, &in);
+		if (zstd_is_error(ret)) {
+			log_debug("zstd error %d\n", zstd_get_error_code(ret));
+			return zstd_get_error_code(ret) ==
+				ZSTD_error_dstSize_tooSmall ? -ENOSPC : -EINVAL;
+		}
+		if (!ret)
+			priv->done = true;
+		else if (in.pos == in_pos && priv->zout.pos == out_pos)
+			return -ENOSPC;
+	}
+	st->len = priv->zout.pos;
+
+	return 0;
+}
+
+static int stream_copy(struct stream_priv *priv, const u8 *buf, ulong len)
+{
+	struct image_stream *st = priv->st;
+
+	if (!st->dst || st->dst == st->src) {
+		st->len += len;
+		return 0;
+	}
+	if (st->len + len > st->dst_size)
+		return -ENOSPC;
+	memmove(st->dst + st->len, buf, len);
+	st->len += len;
+
+	return 0;
+}
+
+/**
+ * stream_hash_chunks() - Hash source data in separately hashed chunks
+ *
+ * Each chunk is checked against its expected hash as soon as it is complete,
+ * so bad data is found before it is used.
+ *
+ * @priv: State of the pass
+ * @buf: Source data
+ * @len: Number of bytes in @buf
+ * Return: 0 if OK, -EACCES if a chunk does not match, other -ve on error
+ */
+static int stream_hash_chunks(struct stream_priv *priv, const u8 *buf,
+			      ulong len)
+{
+	struct image_stream *st = priv->st;
+	struct hash_algo *algo = priv->algo;
+	uint8_t digest[HASH_MAX_DIGEST_SIZE];
+	ulong pos = priv->pos;
+	ulong n;
+	bool last;
+	int ret;
+
+	while (len) {
+		if (!priv->hash_ctx &&
+		    algo->hash_init(algo, &priv->hash_ctx))
+			return -ENOMEM;
+		n = min(len, st->hash_chunk - priv->chunk_pos);
+		last = priv->chunk_pos + n == st->hash_chunk ||
+			pos + n == st->size;
+		ret = algo->hash_update(algo, priv->hash_ctx, buf, n, last);
+		if (ret) {
+			priv->hash_ctx = NULL;
+			return -EINVAL;
+		}
+		buf += n;
+		len -= n;
+		pos += n;
+		priv->chunk_pos += n;
+		if (!last)
+			continue;
+
+		ret = algo->hash_finish(algo, priv->hash_ctx, digest,
+					sizeof(digest));
+		priv->hash_ctx = NULL;
+		if (ret)
+			return -EINVAL;
+		if (memcmp(digest, st->chunk_values +
+			   priv->chunk * algo->digest_size,
+			   algo->digest_size)) {
+			log_debug("Chunk %lx does not match its hash\n",
+				  priv->chunk);
+			return -EACCES;
+		}
+		priv->chunk++;
+		priv->chunk_pos = 0;
+	}
+
+	return 0;
+}
+
+/**
+ * stream_chunk() - Hash a chunk of source data and then decompress it
+ *
+ * @priv: State of the pass
+ * @buf: Source data
+ * @len: Number of bytes in @buf
+ * Return: 0 if OK, -ve on error
+ */
+static int stream_chunk(struct stream_priv *priv, const u8 *buf, ulong len)
+{
+	struct image_stream *st = priv->st;
+	bool last = priv->pos + len == st->size;
+	int ret;
+
+	if (st->hash_chunk && priv->algo) {
+		ret = stream_hash_chunks(priv, buf, len);
+		if (ret)
+			return ret;
+	} else if (priv->hash_ctx) {
+		ret = priv->algo->hash_update(priv->algo, priv->hash_ctx, buf,
+					      len, last);
+		if (ret) {
+			/* hash_update() frees the context on error */
+			priv->hash_ctx = NULL;
+			return -EINVAL;
+		}
+	}
+	priv->pos += len;
+
+	switch (st->comp) {
+	case IH_COMP_NONE:
+		ret = stream_copy(priv, buf, len);
+		break;
+	case IH_COMP_GZIP:
+		ret = stream_gzip(priv, buf, len);
+		break;
+	case IH_COMP_ZSTD:
+		ret = stream_zstd(priv, buf, len);
+		break;
+	default:
+		ret = -EPROTONOSUPPORT;
+	}
+	schedule();
+
+	return ret;
+}
+
+static int stream_mem(struct stream_priv *priv, ulong chunk)
+{
+	struct image_stream *st = priv->st;
+	ulong len;
+	int ret;
+
+	while (priv->pos < st->size) {
+		len = min(chunk, st->size - priv->pos);
+		ret = stream_chunk(priv, st->src + priv->pos, len);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int stream_read(struct stream_priv *priv, ulong chunk)
+{
+	struct image_stream *st = priv->st;
+	ulong align = st->align ?: 1;
+	ulong offset, skip, len, size;
+	long ret = 0;
+	u8 *buf;
+
+	chunk = ALIGN(chunk, align);
+	buf = malloc_cache_aligned(chunk);
+	if (!buf)
+		return -ENOMEM;
+
+	/* Reads must be aligned, so skip the start of the first block */
+	offset = ALIGN_DOWN(st->offset, align);
+	skip = st->offset - offset;
+	while (priv->pos < st->size) {
+		len = min(chunk - skip, st->size - priv->pos);
+		size = ALIGN(skip + len, align);
+		ret = st->read(st->priv, offset, size, buf);
+		if (ret >= 0 && (ulong)ret < skip + len)
+			ret = -EIO;
+		if (ret < 0) {
+			log_debug("Read %lx bytes at %lx failed (err=%ld)\n",
+				  size, offset, ret);
+			break;
+		}
+		ret = stream_chunk(priv, buf + skip, len);
+		if (ret)
+			break;
+		offset += size;
+		skip = 0;
+	}
+	free(buf);
+
+	return ret;
+}
+
+int image_stream_run(struct image_stream *st)
+{
+	struct stream_priv priv = { .st = st };
+	ulong chunk = st->chunk ?: IMAGE_STREAM_CHUNK;
+	int ret;
+
+	st->len = 0;
+	st->digest_len = 0;
+	if (!image_stream_supported(st->comp))
+		return -EPROTONOSUPPORT;
+	if (st->comp != IH_COMP_NONE && !st->dst)
+		return -EINVAL;
+
+	if (st->algo) {
+		ret = hash_progressive_lookup_algo(st->algo, &priv.algo);
+		if (ret)
+			return -EPROTONOSUPPORT;
+		if (priv.algo->digest_size > sizeof(st->digest))
+			return -EPROTONOSUPPORT;
+		/* With chunks, each has its own context */
+		if (!st->hash_chunk &&
+		    priv.algo->hash_init(priv.algo, &priv.hash_ctx))
+			return -ENOMEM;
+	}
+
+	if (!st->size)
+		ret = -EINVAL;
+	else if (st->src)
+		ret = stream_mem(&priv, chunk);
+	else
+		ret = stream_read(&priv, chunk);
+	if (!ret && st->comp != IH_COMP_NONE && !priv.done)
+		ret = -EINVAL;	/* truncated */
+
+	/* This also frees the context on error */
+	if (priv.hash_ctx &&
+	    priv.algo->hash_finish(priv.algo, priv.hash_ctx, st->digest,
+				   sizeof(st->digest)) && !ret)
+		ret = -EINVAL;
+	if (!ret && priv.algo && !st->hash_chunk)
+		st->digest_len = priv.algo->digest_size;
+
+	if (priv.zs_ready)
+		inflateEnd(&priv.zs);
+	free(priv.zws);
+
+	return ret;
+}
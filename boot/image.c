@@ -409,15 +409,7 @@ void image_print_contents(const void *ptr)
 	}
 }
 
-/**
- * print_decomp_msg() - Print a suitable decompression/loading message
- *
- * @type:	OS type (IH_OS_...)
- * @comp_type:	Compression type being used (IH_COMP_...)
- * @is_xip:	true if the load address matches the image start
- * @load:	Load address for printing
- */
-static void print_decomp_msg(int comp_type, int type, bool is_xip,
+void print_decomp_msg(int comp_type, int type, bool is_xip,
 			     ulong load)
 {
 	const char *name = genimg_get_type_name(type);
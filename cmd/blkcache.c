@@ -17,27 +17,34 @@ static int blkc_show(struct cmd_tbl *cmdtp, int flag,
 	blkcache_stats(&stats);
 
 	printf("hits: %u\n"
+	       "partial hits: %u\n"
 	       "misses: %u\n"
+	       "evictions: %u\n"
 	       "entries: %u\n"
-	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "size: %lu\n"
+	       "blocks/entry: %u\n"
+	       "max size: %lu\n",
+	       stats.hits, stats.partial_hits, stats.misses, stats.evictions,
+	       stats.entries, stats.size, stats.page_blocks, stats.max_size);
 	return 0;
 }
 
 static int blkc_configure(struct cmd_tbl *cmdtp, int flag,
 			  int argc, char *const argv[])
 {
-	unsigned blocks_per_entry, max_entries;
+	unsigned blocks_per_entry;
+	ulong max_size;
 	if (argc != 3)
 		return CMD_RET_USAGE;
 
 	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
-	max_entries = simple_strtoul(argv[2], 0, 0);
-	blkcache_configure(blocks_per_entry, max_entries);
-	printf("changed to max of %u entries of %u blocks each\n",
-	       max_entries, blocks_per_entry);
+	max_size = simple_strtoul(argv[2], 0, 0);
+	if (blkcache_configure(blocks_per_entry, max_size)) {
+		printf("blocks per entry must be a power of two up to 64\n");
+		return CMD_RET_FAILURE;
+	}
+	printf("changed to max of %lu bytes in entries of %u blocks each\n",
+	       max_size, blocks_per_entry);
 	return 0;
 }
 
@@ -70,6 +77,6 @@ U_BOOT_CMD(
 	blkcache, 4, 0, do_blkcache,
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
-	"blkcache configure <blocks> <entries> "
-	"- set max blocks per entry and max cache entries\n"
+	"blkcache configure <blocks> <size> "
+	"- set blocks per entry and max cache size in bytes\n"
 );
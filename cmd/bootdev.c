@@ -67,6 +67,7 @@ static int do_bootdev_select(struct cmd_tbl *cmdtp, int flag, int argc,
 static int do_bootdev_info(struct cmd_tbl *cmdtp, int flag, int argc,
 			   char *const argv[])
 {
+	struct bootdev_uc_plat *ucp;
 	struct bootstd_priv *priv;
 	struct bootflow *bflow;
 	int ret, i, num_valid;
@@ -80,6 +81,7 @@ static int do_bootdev_info(struct cmd_tbl *cmdtp, int flag, int argc,
 		return CMD_RET_FAILURE;
 
 	dev = priv->cur_bootdev;
+	ucp = dev_get_uclass_plat(dev);
 
 	/* Count the number of bootflows, including how many are valid*/
 	num_valid = 0;
@@ -102,6 +104,7 @@ static int do_bootdev_info(struct cmd_tbl *cmdtp, int flag, int argc,
 		"Probed" : "OK");
 	printf("Uclass:    %s\n", dev_get_uclass_name(dev_get_parent(dev)));
 	printf("Bootflows: %d (%d valid)\n", i, num_valid);
+	printf("Scan time: %lu ms\n", ucp->scan_time_us / 1000);
 
 	return 0;
 }
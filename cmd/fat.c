@@ -66,6 +66,7 @@ static int do_fat_fsinfo(struct cmd_tbl *cmdtp, int flag, int argc,
 	int dev, part;
 	struct blk_desc *dev_desc;
 	struct disk_partition info;
+	struct fat_cache_stats stats;
 
 	if (argc < 2) {
 		printf("usage: fatinfo <interface> [<dev[:part]>]\n");
@@ -77,12 +78,23 @@ static int do_fat_fsinfo(struct cmd_tbl *cmdtp, int flag, int argc,
 		return 1;
 
 	dev = dev_desc->devnum;
+	/* the driver state is shared with the fs layer's mount */
+	fs_unmount();
 	if (fat_set_blk_dev(dev_desc, &info) != 0) {
 		printf("\n** Unable to use %s %d:%d for fatinfo **\n",
 			argv[1], dev, part);
 		return 1;
 	}
-	return file_fat_detectfs();
+	if (file_fat_detectfs())
+		return 1;
+
+	fat_cache_stats(&stats);
+	printf("FAT cache:  %u windows of %u sectors\n", stats.windows,
+	       stats.window_sects);
+	printf("    hits: %lu, misses: %lu, cluster runs: %lu (%lu clusters)\n",
+	       stats.hits, stats.misses, stats.runs, stats.clusters);
+
+	return 0;
 }
 
 U_BOOT_CMD(
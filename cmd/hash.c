@@ -11,7 +11,11 @@
 
 #include <command.h>
 #include <hash.h>
+#include <malloc.h>
+#include <time.h>
+#include <vsprintf.h>
 #include <linux/ctype.h>
+#include <linux/sizes.h>
 
 #if IS_ENABLED(CONFIG_HASH_VERIFY)
 #define HARGS 6
@@ -19,12 +23,66 @@
 #define HARGS 5
 #endif
 
+/* Time each backend for this long */
+#define HASH_BENCH_US	100000
+
+static int do_hash_bench(int argc, char *const argv[])
+{
+	const struct hash_backend *start, *backend;
+	const int count = ll_entry_count(struct hash_backend, hash_backend);
+	ulong size = SZ_64K;
+	u64 state[8], base;
+	ulong bytes, us;
+	uint blocks;
+	void *buf;
+
+	if (argc > 2)
+		size = hextoul(argv[2], NULL);
+	buf = calloc(1, size);
+	if (!buf)
+		return CMD_RET_FAILURE;
+
+	start = ll_entry_start(struct hash_backend, hash_backend);
+	for (backend = start; backend != start + count; backend++) {
+		printf("%-8s %-10s ", backend->algo, backend->name);
+		blocks = size / backend->block_size;
+		if (!blocks) {
+			printf("size too small\n");
+			continue;
+		}
+		if (!hash_backend_usable(backend)) {
+			printf("not supported by this CPU\n");
+			continue;
+		}
+
+		/* The state is just a scratch area here */
+		memset(state, '\0', sizeof(state));
+		bytes = 0;
+		base = timer_get_us();
+		do {
+			backend->process(state, buf, blocks);
+			bytes += blocks * backend->block_size;
+			us = timer_get_us() - base;
+		} while (us < HASH_BENCH_US);
+		printf("%6lu MB/s%s\n", bytes / us,
+		       hash_backend_get(backend->algo) == backend ?
+		       " (in use)" : "");
+	}
+	free(buf);
+
+	return 0;
+}
+
 static int do_hash(struct cmd_tbl *cmdtp, int flag, int argc,
 		   char *const argv[])
 {
 	char *s;
 	int flags = HASH_FLAG_ENV;
 
+	if (IS_ENABLED(CONFIG_HASH_BACKEND) && argc > 1 &&
+	    !strcmp(argv[1], "bench"))
+		return do_hash_bench(argc, argv);
+
 	if (argc < 4)
 		return CMD_RET_USAGE;
 
@@ -53,4 +111,9 @@ U_BOOT_CMD(
 		"    - verify message digest of memory area to immediate value, \n"
 		"      env var or *address"
 #endif
+#if IS_ENABLED(CONFIG_HASH_BACKEND)
+	"\nhash bench [size]\n"
+		"    - show the speed of each SHA implementation, hashing size\n"
+		"      bytes (in hex) at a time"
+#endif
 );
@@ -8,6 +8,8 @@
 #include <dm/device.h>
 #include <dm/uclass.h>
 #include <net.h>
+#include <vsprintf.h>
+#include <net/sink.h>
 #include <linux/compat.h>
 #include <linux/ethtool.h>
 
@@ -28,6 +30,7 @@ static int do_net_list(struct cmd_tbl *cmdtp, int flag, int argc, char *const ar
 
 static int do_net_stats(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 {
+	struct eth_rx_stats rx_stats;
 	int nstats, err, i, off;
 	struct udevice *dev;
 	u64 *values;
@@ -42,12 +45,33 @@ static int do_net_stats(struct cmd_tbl *cmdtp, int flag, int argc, char *const a
 		return CMD_RET_FAILURE;
 	}
 
+	if (!eth_get_rx_stats(dev, &rx_stats)) {
+		printf("  rx_frames: %lu\n", rx_stats.frames);
+		printf("  rx_bytes: %lu\n", rx_stats.bytes);
+		printf("  rx_stored: %lu\n", rx_stats.stored);
+		printf("  rx_stored_bytes: %lu\n", rx_stats.stored_bytes);
+		printf("  rx_copied: %lu\n", rx_stats.copied);
+		if (rx_stats.stored_bytes) {
+			ulong pct = (u64)rx_stats.copied * 100 /
+				rx_stats.stored_bytes;
+
+			printf("  rx_copies_per_byte: %lu.%02lu\n", pct / 100,
+			       pct % 100);
+		}
+		printf("  rx_polls: %lu\n", rx_stats.polls);
+		if (rx_stats.polls)
+			printf("  rx_frames_per_poll: %lu\n",
+			       rx_stats.frames / rx_stats.polls);
+		printf("  rx_max_per_poll: %lu\n", rx_stats.max_per_poll);
+		printf("  rx_ring_full: %lu\n", rx_stats.ring_full);
+		printf("  rx_drops: %lu\n", rx_stats.drops);
+		printf("  rx_errors: %lu\n", rx_stats.errors);
+	}
+
 	if (!eth_get_ops(dev)->get_sset_count ||
 	    !eth_get_ops(dev)->get_strings ||
-	    !eth_get_ops(dev)->get_stats) {
-		printf("Driver does not implement stats dump!\n");
-		return CMD_RET_FAILURE;
-	}
+	    !eth_get_ops(dev)->get_stats)
+		return CMD_RET_SUCCESS;
 
 	nstats = eth_get_ops(dev)->get_sset_count(dev);
 	strings = kcalloc(nstats, ETH_GSTRING_LEN, GFP_KERNEL);
@@ -78,9 +102,46 @@ err_free_strings:
 	return CMD_RET_FAILURE;
 }
 
+#if CONFIG_IS_ENABLED(NET_SINK)
+static int do_net_sink(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
+{
+	int ret;
+
+	if (argc < 2) {
+		net_sink_show();
+		return CMD_RET_SUCCESS;
+	}
+
+	if (!strcmp(argv[1], "off") && argc == 2) {
+		net_sink_off();
+		return CMD_RET_SUCCESS;
+	} else if (!strcmp(argv[1], "blk") && argc >= 4) {
+		ret = net_sink_blk(argv[2], argv[3],
+				   argc > 4 ? hextoul(argv[4], NULL) : 0);
+	} else if (IS_ENABLED(CONFIG_MTD) && !strcmp(argv[1], "mtd") &&
+		   argc >= 3) {
+		ret = net_sink_mtd(argv[2],
+				   argc > 3 ? simple_strtoull(argv[3], NULL, 16) : 0);
+	} else if (!strcmp(argv[1], "hash") && argc >= 3) {
+		ret = net_sink_hash(argv[2], argc > 3 ? argv[3] : NULL);
+	} else {
+		return CMD_RET_USAGE;
+	}
+	if (ret) {
+		printf("Cannot set up sink (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return CMD_RET_SUCCESS;
+}
+#endif
+
 static struct cmd_tbl cmd_net[] = {
 	U_BOOT_CMD_MKENT(list, 1, 0, do_net_list, "", ""),
 	U_BOOT_CMD_MKENT(stats, 2, 0, do_net_stats, "", ""),
+#if CONFIG_IS_ENABLED(NET_SINK)
+	U_BOOT_CMD_MKENT(sink, 5, 0, do_net_sink, "", ""),
+#endif
 };
 
 static int do_net(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
@@ -101,6 +162,19 @@ static int do_net(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 	return cp->cmd(cmdtp, flag, argc, argv);
 }
 
-U_BOOT_CMD(net, 3, 1, do_net, "NET sub-system",
+U_BOOT_CMD(net, 6, 1, do_net, "NET sub-system",
 	   "list - list available devices\n"
-	   "stats <device> - dump statistics for specified device\n");
+	   "stats <device> - dump statistics for specified device\n"
+#if CONFIG_IS_ENABLED(NET_SINK)
+	   "sink - show where the next file downloaded goes\n"
+	   "sink blk <interface> <dev[:part]> [start] - write the next file\n"
+	   "    to a block device, from block 'start' (hex) of the partition\n"
+#if IS_ENABLED(CONFIG_MTD)
+	   "sink mtd <name> [offset] - write the next file to an MTD device\n"
+	   "    at 'offset' (hex), skipping bad blocks\n"
+#endif
+	   "sink hash <algo> [digest] - hash the file as it is written and\n"
+	   "    check it against 'digest' if given\n"
+	   "sink off - store the next file in memory\n"
+#endif
+	   );
@@ -11,6 +11,7 @@
 #include <cyclic.h>
 #include <log.h>
 #include <malloc.h>
+#include <smp_work.h>
 #include <time.h>
 #include <linux/errno.h>
 #include <linux/list.h>
@@ -90,6 +91,10 @@ static void cyclic_run(void)
 
 void schedule(void)
 {
+	/* Only the boot CPU feeds the watchdog and runs cyclic functions */
+	if (smp_work_secondary())
+		return;
+
 	/* The HW watchdog is not integrated into the cyclic IF (yet) */
 	if (IS_ENABLED(CONFIG_HW_WATCHDOG))
 		hw_watchdog_reset();
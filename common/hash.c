@@ -16,6 +16,7 @@
 #include <malloc.h>
 #include <mapmem.h>
 #include <hw_sha.h>
+#include <smp_work.h>
 #include <asm/cache.h>
 #include <asm/global_data.h>
 #include <asm/io.h>
@@ -192,7 +193,8 @@ static int __maybe_unused hash_finish_crc32(struct hash_algo *algo, void *ctx,
 	if (size < algo->digest_size)
 		return -1;
 
-	*((uint32_t *)dest_buf) = *((uint32_t *)ctx);
+	/* Big-endian, as from crc32_wd_buf() */
+	*((uint32_t *)dest_buf) = cpu_to_be32(*((uint32_t *)ctx));
 	free(ctx);
 	return 0;
 }
@@ -403,6 +405,52 @@ int hash_block(const char *algo_name, const void *data, unsigned int len,
 	return 0;
 }
 
+static int hash_job_run(void *arg)
+{
+	struct hash_job *job = arg;
+	struct hash_algo *algo;
+
+	if (hash_lookup_algo(job->algo, &algo))
+		return -EPROTONOSUPPORT;
+	algo->hash_func_ws(job->data, job->len, job->digest, algo->chunk_size);
+	job->digest_len = algo->digest_size;
+
+	return 0;
+}
+
+int hash_run_jobs(struct hash_job *jobs, int count)
+{
+	struct smp_job *work = NULL;
+	struct hash_algo *algo;
+	int ret = 0;
+	int i, n;
+
+	/* A hash accelerator can only be used by one CPU at a time */
+	if (CONFIG_IS_ENABLED(SMP_WORK) && !IS_ENABLED(CONFIG_SHA_HW_ACCEL))
+		work = calloc(count, sizeof(*work));
+
+	for (i = 0, n = 0; i < count; i++) {
+		jobs[i].digest_len = 0;
+		if (hash_lookup_algo(jobs[i].algo, &algo)) {
+			ret = -EPROTONOSUPPORT;
+			continue;
+		}
+		if (work) {
+			work[n].func = hash_job_run;
+			work[n].arg = &jobs[i];
+			n++;
+		} else {
+			hash_job_run(&jobs[i]);
+		}
+	}
+	if (work) {
+		smp_work_run(work, n);
+		free(work);
+	}
+
+	return ret;
+}
+
 #if !defined(CONFIG_XPL_BUILD) && (defined(CONFIG_CMD_HASH) || \
 	defined(CONFIG_CMD_SHA1SUM) || defined(CONFIG_CMD_CRC32)) || \
 	defined(CONFIG_CMD_MD5SUM)
@@ -8,6 +8,7 @@
 #include <fpga.h>
 #include <gzip.h>
 #include <image.h>
+#include <image-stream.h>
 #include <log.h>
 #include <memalign.h>
 #include <mapmem.h>
@@ -187,6 +188,76 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return ALIGN(data_size, spl_get_bl_len(info));
 }
 
+static long spl_fit_stream_read(void *priv, ulong offset, ulong size,
+				void *buf)
+{
+	struct spl_load_info *info = priv;
+
+	return info->read(info, offset, size, buf);
+}
+
+/**
+ * load_fit_stream() - Read, check and decompress an image in a single pass
+ *
+ * Each chunk of the image is hashed and decompressed as soon as it is read,
+ * so there is no need to read the whole compressed image into a temporary
+ * buffer first.
+ *
+ * @info:	Where to read the image from
+ * @offset:	Offset of the image data in bytes
+ * @fit:	FIT containing the image
+ * @node:	Image node
+ * @comp:	Compression type of the image (IH_COMP_...)
+ * @len:	Size of the image data in bytes
+ * @load_ptr:	Where to put the decompressed image
+ * @lengthp:	Returns the size of the decompressed image
+ * Return: 0 if OK, -EAGAIN if the image must be loaded in the usual way,
+ *	other -ve value on error
+ */
+static int load_fit_stream(struct spl_load_info *info, ulong offset,
+			   const void *fit, int node, int comp, ulong len,
+			   void *load_ptr, size_t *lengthp)
+{
+	struct image_stream st = {
+		.comp = comp,
+		.size = len,
+		.read = spl_fit_stream_read,
+		.priv = info,
+		.offset = offset,
+		.align = spl_get_bl_len(info),
+		.dst = load_ptr,
+		.dst_size = CONFIG_SYS_BOOTM_LEN,
+	};
+	const char *algo;
+	int hash_noffset;
+	int ret;
+
+	if (comp == IH_COMP_NONE || !image_stream_supported(comp) ||
+	    CONFIG_IS_ENABLED(FIT_IMAGE_POST_PROCESS))
+		return -EAGAIN;
+
+	if (CONFIG_IS_ENABLED(FIT_SIGNATURE)) {
+		hash_noffset = fit_image_get_stream_hash(fit, node, &algo);
+		if (hash_noffset < 0)
+			return -EAGAIN;
+		printf("## Checking hash(es) for Image %s ... ",
+		       fit_get_name(fit, node, NULL));
+		ret = fit_image_stream_verify(fit, node, hash_noffset, &st);
+		if (ret)
+			return ret == -EACCES ? -EPERM : -EIO;
+		puts("OK\n");
+	} else {
+		ret = image_stream_run(&st);
+		if (ret) {
+			puts("Uncompressing error\n");
+			return -EIO;
+		}
+	}
+	*lengthp = st.len;
+
+	return 0;
+}
+
 /**
  * load_simple_fit(): load the image described in a certain FIT node
  * @info:	points to information about the device to load data from
@@ -217,6 +288,7 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 	const void *data;
 	const void *fit = ctx->fit;
 	bool external_data = false;
+	int ret;
 
 	if (IS_ENABLED(CONFIG_SPL_FPGA) ||
 	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && spl_decompression_enabled())) {
@@ -226,7 +298,7 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 			debug("%s ", genimg_get_type_name(type));
 	}
 
-	if (spl_decompression_enabled()) {
+	if (spl_decompression_enabled() || CONFIG_IS_ENABLED(IMAGE_STREAM)) {
 		fit_image_get_comp(fit, node, &image_comp);
 		debug("%s ", genimg_get_comp_name(image_comp));
 	}
@@ -261,6 +333,17 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 			return 0;
 		}
 
+		if (CONFIG_IS_ENABLED(IMAGE_STREAM)) {
+			ret = load_fit_stream(info, fit_offset + offset, fit,
+					      node, image_comp, len,
+					      map_sysmem(load_addr, 0),
+					      &length);
+			if (!ret)
+				goto done;
+			else if (ret != -EAGAIN)
+				return ret;
+		}
+
 		if (spl_decompression_enabled() &&
 		    (image_comp == IH_COMP_GZIP || image_comp == IH_COMP_LZMA))
 			src_ptr = map_sysmem(ALIGN(CONFIG_SYS_LOAD_ADDR, ARCH_DMA_MINALIGN), len);
@@ -325,6 +408,7 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 		memcpy(load_ptr, src, length);
 	}
 
+done:
 	if (image_info) {
 		ulong entry_point;
 
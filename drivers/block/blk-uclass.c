@@ -8,6 +8,7 @@
 
 #include <blk.h>
 #include <dm.h>
+#include <fs.h>
 #include <log.h>
 #include <malloc.h>
 #include <part.h>
@@ -429,18 +430,30 @@ static int blk_buffer_aligned(struct bounce_buffer *state)
 	return 1;	/* Default, any buffer is OK */
 }
 
+/* Drop everything cached about the contents of a device which changes */
+static void blk_invalidate(struct blk_desc *desc)
+{
+	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	fs_blk_invalidate(desc);
+}
+
 long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
 {
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
 	const struct blk_ops *ops = blk_get_ops(dev);
 	ulong blks_read;
+	lbaint_t cached;
 
 	if (!ops->read)
 		return -ENOSYS;
 
-	if (blkcache_read(desc->uclass_id, desc->devnum,
-			  start, blkcnt, desc->blksz, buf))
+	cached = blkcache_read(desc->uclass_id, desc->devnum,
+			       start, blkcnt, desc->blksz, buf);
+	if (cached == blkcnt)
 		return blkcnt;
+	start += cached;
+	blkcnt -= cached;
+	buf += cached * desc->blksz;
 
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
@@ -460,11 +473,14 @@ long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
 		blks_read = ops->read(dev, start, blkcnt, buf);
 	}
 
+	if (IS_ERR_VALUE(blks_read))
+		return blks_read;
+
 	if (blks_read == blkcnt)
 		blkcache_fill(desc->uclass_id, desc->devnum, start, blkcnt,
 			      desc->blksz, buf);
 
-	return blks_read;
+	return cached + blks_read;
 }
 
 long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
@@ -477,7 +493,7 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 	if (!ops->write)
 		return -ENOSYS;
 
-	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blk_invalidate(desc);
 
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
@@ -509,11 +525,103 @@ long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
 	if (!ops->erase)
 		return -ENOSYS;
 
-	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blk_invalidate(desc);
 
 	return ops->erase(dev, start, blkcnt);
 }
 
+int blk_submit(struct udevice *dev, struct blk_req *req)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	long ret;
+
+	req->done = false;
+	req->result = 0;
+
+	if (!ops->submit || (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb)) {
+		if (req->op == BLK_REQ_WRITE)
+			ret = blk_write(dev, req->start, req->blkcnt,
+					req->buffer);
+		else
+			ret = blk_read(dev, req->start, req->blkcnt,
+				       req->buffer);
+		blk_req_complete(req, ret);
+
+		return 0;
+	}
+
+	if (req->op == BLK_REQ_WRITE) {
+		blk_invalidate(desc);
+	} else if (blkcache_read(desc->uclass_id, desc->devnum, req->start,
+				 req->blkcnt, desc->blksz,
+				 req->buffer) == req->blkcnt) {
+		blk_req_complete(req, req->blkcnt);
+
+		return 0;
+	}
+
+	return ops->submit(dev, req);
+}
+
+int blk_poll(struct udevice *dev)
+{
+	const struct blk_ops *ops = blk_get_ops(dev);
+
+	if (!ops->poll)
+		return 0;
+
+	return ops->poll(dev);
+}
+
+long blk_wait(struct udevice *dev, struct blk_req *req)
+{
+	int ret;
+
+	while (!req->done) {
+		ret = blk_poll(dev);
+		if (ret < 0)
+			return ret;
+	}
+
+	return req->result;
+}
+
+long blk_run_reqs(struct udevice *dev, struct blk_req *reqs, int count)
+{
+	long total = 0, err = 0, ret;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		do {
+			ret = blk_submit(dev, &reqs[i]);
+			if (ret == -EBUSY) {
+				ret = blk_poll(dev);
+				if (ret >= 0)
+					ret = -EBUSY;
+			}
+		} while (ret == -EBUSY);
+		if (ret) {
+			/* let the requests already queued finish */
+			while (i--)
+				blk_wait(dev, &reqs[i]);
+			return ret;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		ret = blk_wait(dev, &reqs[i]);
+		if (ret < 0) {
+			if (!err)
+				err = ret;
+			continue;
+		}
+		total += ret;
+	}
+
+	return err ? err : total;
+}
+
 ulong blk_dread(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
 		void *buffer)
 {
@@ -865,9 +973,18 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	/* another device may take over the same number */
+	blk_invalidate(dev_get_uclass_plat(dev));
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
 	.per_device_plat_auto	= sizeof(struct blk_desc),
 };
@@ -9,159 +9,259 @@
 #include <malloc.h>
 #include <part.h>
 #include <asm/global_data.h>
+#include <linux/build_bug.h>
 #include <linux/ctype.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 
-struct block_cache_node {
-	struct list_head lh;
+/*
+ * The cache is made up of pages, each holding page_blocks consecutive blocks
+ * starting at a multiple of page_blocks (a power of two). Pages are found
+ * through a small hash table keyed by (device, page index) and are kept on an
+ * LRU list so the least recently used ones can be dropped when the memory
+ * budget is exhausted. A bitmap records which blocks of a page hold valid
+ * data, so small reads (e.g. a single metadata block) can still be cached.
+ */
+#define BLKCACHE_HASH_BITS	6
+#define BLKCACHE_HASH_SIZE	(1 << BLKCACHE_HASH_BITS)
+#define BLKCACHE_MAX_PAGE_BLOCKS	64
+
+struct block_cache_page {
+	struct list_head lru;
+	struct hlist_node hash;
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
+	lbaint_t index;
 	unsigned long blksz;
-	char *cache;
+	u64 valid;
+	char *data;
 };
 
-static LIST_HEAD(block_cache);
+static LIST_HEAD(block_cache_lru);
+static struct hlist_head block_cache_hash[BLKCACHE_HASH_SIZE];
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.page_blocks = CONFIG_BLOCK_CACHE_PAGE_BLOCKS,
+	.max_size = CONFIG_BLOCK_CACHE_SIZE,
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+static uint page_shift = ilog2(CONFIG_BLOCK_CACHE_PAGE_BLOCKS);
+
+/* Pages are found by shifting and masking, see blkcache_configure() */
+static_assert(!(CONFIG_BLOCK_CACHE_PAGE_BLOCKS &
+		(CONFIG_BLOCK_CACHE_PAGE_BLOCKS - 1)),
+	      "BLOCK_CACHE_PAGE_BLOCKS must be a power of two");
+
+static uint cache_hash(int iftype, int devnum, lbaint_t index)
 {
-	struct block_cache_node *node;
-
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
-			}
-			return node;
-		}
-	return 0;
+	u32 key = (u32)index ^ ((u32)devnum << 20) ^ ((u32)iftype << 26);
+
+	/* Fibonacci hashing, as used by hash_32() in Linux */
+	return (key * 0x61c88647) >> (32 - BLKCACHE_HASH_BITS);
+}
+
+static u64 page_mask(uint first, uint count)
+{
+	u64 mask = count >= 64 ? ~0ULL : (1ULL << count) - 1;
+
+	return mask << first;
+}
+
+static struct block_cache_page *cache_find(int iftype, int devnum,
+					   lbaint_t index, unsigned long blksz)
+{
+	struct block_cache_page *page;
+	struct hlist_head *head;
+
+	head = &block_cache_hash[cache_hash(iftype, devnum, index)];
+	hlist_for_each_entry(page, head, hash) {
+		if (page->index == index && page->devnum == devnum &&
+		    page->iftype == iftype && page->blksz == blksz)
+			return page;
+	}
+
+	return NULL;
+}
+
+static void cache_drop(struct block_cache_page *page)
+{
+	debug("drop: page " LBAF "\n", page->index);
+	list_del(&page->lru);
+	hlist_del(&page->hash);
+	_stats.size -= page->blksz * _stats.page_blocks;
+	_stats.entries--;
+	free(page->data);
+	free(page);
 }
 
 int blkcache_read(int iftype, int devnum,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
+	lbaint_t done = 0;
+
+	while (done < blkcnt) {
+		struct block_cache_page *page;
+		lbaint_t blk = start + done;
+		uint first, count, avail;
+
+		first = blk & (_stats.page_blocks - 1);
+		blk >>= page_shift;
+		count = min_t(lbaint_t, _stats.page_blocks - first,
+			      blkcnt - done);
+
+		page = cache_find(iftype, devnum, blk, blksz);
+		if (!page)
+			break;
+
+		/* use the valid blocks at the start of the requested range */
+		for (avail = 0; avail < count; avail++)
+			if (!(page->valid & (1ULL << (first + avail))))
+				break;
+		if (!avail)
+			break;
+
+		memcpy(buffer + done * blksz, page->data + first * blksz,
+		       avail * blksz);
+		/* maintain MRU ordering */
+		list_move(&page->lru, &block_cache_lru);
+		done += avail;
+		if (avail < count)
+			break;
+	}
+
+	if (done == blkcnt) {
+		debug("hit: start " LBAF ", count " LBAFU "\n", start, blkcnt);
 		++_stats.hits;
-		return 1;
+	} else if (done) {
+		debug("partial: start " LBAF ", count " LBAFU "/" LBAFU "\n",
+		      start, done, blkcnt);
+		++_stats.partial_hits;
+	} else {
+		debug("miss: start " LBAF ", count " LBAFU "\n", start, blkcnt);
+		++_stats.misses;
 	}
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
-	return 0;
+	return done;
+}
+
+static struct block_cache_page *cache_alloc(int iftype, int devnum,
+					    lbaint_t index,
+					    unsigned long blksz)
+{
+	struct block_cache_page *page;
+	ulong bytes = blksz * _stats.page_blocks;
+
+	while (!list_empty(&block_cache_lru) &&
+	       _stats.size + bytes > _stats.max_size) {
+		page = list_last_entry(&block_cache_lru,
+				       struct block_cache_page, lru);
+		cache_drop(page);
+		_stats.evictions++;
+	}
+
+	page = malloc(sizeof(*page));
+	if (!page)
+		return NULL;
+	page->data = malloc(bytes);
+	if (!page->data) {
+		free(page);
+		return NULL;
+	}
+
+	page->iftype = iftype;
+	page->devnum = devnum;
+	page->index = index;
+	page->blksz = blksz;
+	page->valid = 0;
+	hlist_add_head(&page->hash,
+		       &block_cache_hash[cache_hash(iftype, devnum, index)]);
+	list_add(&page->lru, &block_cache_lru);
+	_stats.size += bytes;
+	_stats.entries++;
+
+	return page;
 }
 
 void blkcache_fill(int iftype, int devnum,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	lbaint_t done = 0;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
+	/* don't cache big stuff, it would only push out the metadata */
+	if (blksz * _stats.page_blocks > _stats.max_size ||
+	    blkcnt * blksz > _stats.max_size / 4)
 		return;
 
-	if (_stats.max_entries == 0)
-		return;
+	debug("fill: start " LBAF ", count " LBAFU "\n", start, blkcnt);
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
-	}
+	while (done < blkcnt) {
+		struct block_cache_page *page;
+		lbaint_t blk = start + done;
+		uint first, count;
 
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
-		}
-	}
+		first = blk & (_stats.page_blocks - 1);
+		blk >>= page_shift;
+		count = min_t(lbaint_t, _stats.page_blocks - first,
+			      blkcnt - done);
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
+		page = cache_find(iftype, devnum, blk, blksz);
+		if (page)
+			list_move(&page->lru, &block_cache_lru);
+		else
+			page = cache_alloc(iftype, devnum, blk, blksz);
+		if (!page)
+			return;
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+		memcpy(page->data + first * blksz, buffer + done * blksz,
+		       count * blksz);
+		page->valid |= page_mask(first, count);
+		done += count;
+	}
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	struct block_cache_page *page, *n;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
+	list_for_each_entry_safe(page, n, &block_cache_lru, lru) {
 		if (iftype == -1 ||
-		    (node->iftype == iftype && node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
-		}
+		    (page->iftype == iftype && page->devnum == devnum))
+			cache_drop(page);
 	}
 }
 
-void blkcache_configure(unsigned blocks, unsigned entries)
+int blkcache_configure(uint page_blocks, ulong max_size)
 {
+	if (!is_power_of_2(page_blocks) ||
+	    page_blocks > BLKCACHE_MAX_PAGE_BLOCKS)
+		return -EINVAL;
+
 	/* invalidate cache if there is a change */
-	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries))
+	if (page_blocks != _stats.page_blocks ||
+	    max_size != _stats.max_size)
 		blkcache_invalidate(-1, 0);
 
-	_stats.max_blocks_per_entry = blocks;
-	_stats.max_entries = entries;
+	_stats.page_blocks = page_blocks;
+	page_shift = ilog2(page_blocks);
+	_stats.max_size = max_size;
 
 	_stats.hits = 0;
+	_stats.partial_hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
+
+	return 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
 {
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
+	_stats.partial_hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
 
 void blkcache_free(void)
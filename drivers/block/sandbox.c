@@ -17,6 +17,20 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Number of requests which can be queued before the device must be polled */
+#define HOST_BLK_QUEUE_DEPTH	4
+
+/**
+ * struct host_blk_priv - private data for a host block device
+ *
+ * @queue: Requests queued by host_block_submit()
+ * @count: Number of requests in @queue
+ */
+struct host_blk_priv {
+	struct blk_req *queue[HOST_BLK_QUEUE_DEPTH];
+	int count;
+};
+
 static unsigned long host_block_read(struct udevice *dev,
 				     unsigned long start, lbaint_t blkcnt,
 				     void *buffer)
@@ -55,13 +69,49 @@ static unsigned long host_block_write(struct udevice *dev,
 	return -EIO;
 }
 
+static int host_block_submit(struct udevice *dev, struct blk_req *req)
+{
+	struct host_blk_priv *priv = dev_get_priv(dev);
+
+	if (priv->count == HOST_BLK_QUEUE_DEPTH)
+		return -EBUSY;
+	priv->queue[priv->count++] = req;
+
+	return 0;
+}
+
+/* Requests complete newest first, so that callers must cope with reordering */
+static int host_block_poll(struct udevice *dev)
+{
+	struct host_blk_priv *priv = dev_get_priv(dev);
+	int completed = priv->count;
+
+	while (priv->count) {
+		struct blk_req *req = priv->queue[--priv->count];
+		ulong ret;
+
+		if (req->op == BLK_REQ_WRITE)
+			ret = host_block_write(dev, req->start, req->blkcnt,
+					       req->buffer);
+		else
+			ret = host_block_read(dev, req->start, req->blkcnt,
+					      req->buffer);
+		blk_req_complete(req, ret);
+	}
+
+	return completed;
+}
+
 static const struct blk_ops sandbox_host_blk_ops = {
 	.read	= host_block_read,
 	.write	= host_block_write,
+	.submit	= host_block_submit,
+	.poll	= host_block_poll,
 };
 
 U_BOOT_DRIVER(sandbox_host_blk) = {
 	.name		= "sandbox_host_blk",
 	.id		= UCLASS_BLK,
 	.ops		= &sandbox_host_blk_ops,
+	.priv_auto	= sizeof(struct host_blk_priv),
 };
@@ -55,6 +55,48 @@ int mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 	return dm_mmc_send_cmd(mmc->dev, cmd, data);
 }
 
+#if CONFIG_IS_ENABLED(MMC_STREAM_READ)
+int mmc_prepare_data(struct mmc *mmc, struct mmc_data *data)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(mmc->dev);
+
+	if (!ops->prepare_data || !ops->start_cmd || !ops->finish_cmd)
+		return -ENOSYS;
+
+	return ops->prepare_data(mmc->dev, data);
+}
+
+int mmc_start_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(mmc->dev);
+	int ret;
+
+	mmmc_trace_before_send(mmc, cmd);
+	if (ops->start_cmd)
+		ret = ops->start_cmd(mmc->dev, cmd, data);
+	else
+		ret = -ENOSYS;
+	if (ret)
+		mmmc_trace_after_send(mmc, cmd, ret);
+
+	return ret;
+}
+
+int mmc_finish_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(mmc->dev);
+	int ret;
+
+	if (ops->finish_cmd)
+		ret = ops->finish_cmd(mmc->dev, cmd, data);
+	else
+		ret = -ENOSYS;
+	mmmc_trace_after_send(mmc, cmd, ret);
+
+	return ret;
+}
+#endif
+
 static int dm_mmc_set_ios(struct udevice *dev)
 {
 	struct dm_mmc_ops *ops = mmc_get_ops(dev);
@@ -455,33 +455,72 @@ int mmc_send_stop_transmission(struct mmc *mmc, bool write)
 	return mmc_send_cmd(mmc, &cmd, NULL);
 }
 
-static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
-			   lbaint_t blkcnt)
+/*
+ * CMD23 sets the number of blocks for the following CMD18, so that no CMD12
+ * is needed to end it. It is mandatory for MMC since v3.1 and optional for SD.
+ */
+static bool mmc_use_cmd23(struct mmc *mmc, lbaint_t blkcnt)
+{
+	if (blkcnt < 2 || blkcnt > 0xffff || mmc_host_is_spi(mmc) ||
+	    !(mmc->cfg->host_caps & MMC_CAP_SET_BLOCK_COUNT))
+		return false;
+
+	if (IS_SD(mmc))
+		return mmc->scr[0] & SD_SCR_CMD23_SUPPORT;
+
+	return true;
+}
+
+static int mmc_set_block_count(struct mmc *mmc, lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
-	struct mmc_data data;
 
+	cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+	cmd.cmdarg = blkcnt & 0xffff;
+	cmd.resp_type = MMC_RSP_R1;
+
+	return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
+static void mmc_setup_read(struct mmc *mmc, void *dst, lbaint_t start,
+			   lbaint_t blkcnt, struct mmc_cmd *cmd,
+			   struct mmc_data *data)
+{
 	if (blkcnt > 1)
-		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
+		cmd->cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
 	else
-		cmd.cmdidx = MMC_CMD_READ_SINGLE_BLOCK;
+		cmd->cmdidx = MMC_CMD_READ_SINGLE_BLOCK;
 
 	if (mmc->high_capacity)
-		cmd.cmdarg = start;
+		cmd->cmdarg = start;
 	else
-		cmd.cmdarg = start * mmc->read_bl_len;
+		cmd->cmdarg = start * mmc->read_bl_len;
 
-	cmd.resp_type = MMC_RSP_R1;
+	cmd->resp_type = MMC_RSP_R1;
 
-	data.dest = dst;
-	data.blocks = blkcnt;
-	data.blocksize = mmc->read_bl_len;
-	data.flags = MMC_DATA_READ;
+	data->dest = dst;
+	data->blocks = blkcnt;
+	data->blocksize = mmc->read_bl_len;
+	data->flags = MMC_DATA_READ;
+}
+
+static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
+			   lbaint_t blkcnt)
+{
+	struct mmc_cmd cmd;
+	struct mmc_data data;
+	bool stop = blkcnt > 1;
+
+	mmc_setup_read(mmc, dst, start, blkcnt, &cmd, &data);
+
+	/* fall back to an open-ended read if CMD23 is rejected */
+	if (mmc_use_cmd23(mmc, blkcnt) && !mmc_set_block_count(mmc, blkcnt))
+		stop = false;
 
 	if (mmc_send_cmd(mmc, &cmd, &data))
 		return 0;
 
-	if (blkcnt > 1) {
+	if (stop) {
 		if (mmc_send_stop_transmission(mmc, false)) {
 #if !defined(CONFIG_XPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
 			log_err("mmc fail to send stop cmd\n");
@@ -493,6 +532,72 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	return blkcnt;
 }
 
+#if CONFIG_IS_ENABLED(MMC_STREAM_READ)
+/**
+ * mmc_read_stream() - read blocks as a stream of chunks
+ *
+ * Each chunk of up to @b_max blocks is read with CMD23 and CMD18. While a
+ * chunk is transferring, the host prepares the DMA for the next one, so
+ * the next command can be sent as soon as the transfer ends.
+ *
+ * @mmc:	MMC device to read from
+ * @dst:	Destination buffer
+ * @start:	First block to read
+ * @blkcnt:	Number of blocks to read
+ * @b_max:	Maximum number of blocks in a chunk, at least 2
+ * Return: 0 if OK, -ENOSYS if the host does not support this, other -ve on
+ *	error
+ */
+static int mmc_read_stream(struct mmc *mmc, void *dst, lbaint_t start,
+			   lbaint_t blkcnt, uint b_max)
+{
+	struct mmc_cmd cmd[2];
+	struct mmc_data data[2];
+	lbaint_t done = 0, cur, next;
+	int i = 0;
+	int ret;
+
+	cur = min_t(lbaint_t, blkcnt, b_max);
+	mmc_setup_read(mmc, dst, start, cur, &cmd[0], &data[0]);
+	ret = mmc_prepare_data(mmc, &data[0]);
+	if (ret)
+		return ret;
+
+	while (done < blkcnt) {
+		cur = data[i].blocks;
+		if (cur > 1) {
+			ret = mmc_set_block_count(mmc, cur);
+			if (ret)
+				break;
+		}
+		ret = mmc_start_cmd(mmc, &cmd[i], &data[i]);
+		if (ret)
+			break;
+
+		/* get the next chunk ready while this one transfers */
+		next = min_t(lbaint_t, blkcnt - done - cur, b_max);
+		if (next) {
+			mmc_setup_read(mmc, dst + (done + cur) *
+				       mmc->read_bl_len, start + done + cur,
+				       next, &cmd[!i], &data[!i]);
+			mmc_prepare_data(mmc, &data[!i]);
+		}
+
+		ret = mmc_finish_cmd(mmc, &cmd[i], &data[i]);
+		if (ret)
+			break;
+		done += cur;
+		i = !i;
+	}
+	if (ret) {
+		mmc_prepare_data(mmc, NULL);
+		return ret == -ENOSYS ? -EIO : ret;
+	}
+
+	return 0;
+}
+#endif
+
 #if !CONFIG_IS_ENABLED(DM_MMC)
 static int mmc_get_b_max(struct mmc *mmc, void *dst, lbaint_t blkcnt)
 {
@@ -548,6 +653,18 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 
 	b_max = mmc_get_b_max(mmc, dst, blkcnt);
 
+#if CONFIG_IS_ENABLED(MMC_STREAM_READ)
+	if (blkcnt > b_max && mmc_use_cmd23(mmc, b_max)) {
+		err = mmc_read_stream(mmc, dst, start, blkcnt, b_max);
+		if (!err)
+			return blkcnt;
+		if (err != -ENOSYS) {
+			pr_debug("%s: Failed to read blocks\n", __func__);
+			return 0;
+		}
+	}
+#endif
+
 	do {
 		cur = (blocks_todo > b_max) ? b_max : blocks_todo;
 		if (mmc_read_blocks(mmc, dst, start, cur) != cur) {
@@ -30,6 +30,12 @@ struct sandbox_mmc_priv {
 	char *buf;
 	int csize;	/* CSIZE value to report */
 	int size;
+	uint block_count;	/* set by CMD23, 0 if none */
+	struct mmc_data *prepared;	/* data passed to prepare_data() */
+	struct mmc_data *started;	/* data passed to start_cmd() */
+	uint counted_reads;	/* CMD18s preceded by CMD23 */
+	uint prepared_reads;	/* reads started after prepare_data() */
+	uint stops;		/* CMD12s */
 };
 
 /**
@@ -77,8 +83,18 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 			resp[4] = (cmd->cmdarg & 0xF) << 24;
 		break;
 	}
-	case MMC_CMD_READ_SINGLE_BLOCK:
+	case MMC_CMD_SET_BLOCK_COUNT:
+		priv->block_count = cmd->cmdarg & 0xffff;
+		break;
 	case MMC_CMD_READ_MULTIPLE_BLOCK:
+		/* a pre-defined count must match the transfer */
+		if (priv->block_count && priv->block_count != data->blocks)
+			return -EIO;
+		if (priv->block_count)
+			priv->counted_reads++;
+		priv->block_count = 0;
+		fallthrough;
+	case MMC_CMD_READ_SINGLE_BLOCK:
 		memcpy(data->dest, &priv->buf[cmd->cmdarg * data->blocksize],
 		       data->blocks * data->blocksize);
 		break;
@@ -88,6 +104,7 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		       data->blocks * data->blocksize);
 		break;
 	case MMC_CMD_STOP_TRANSMISSION:
+		priv->stops++;
 		break;
 	case SD_CMD_ERASE_WR_BLK_START:
 		erase_start = cmd->cmdarg;
@@ -117,7 +134,8 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	case SD_CMD_APP_SEND_SCR: {
 		u32 *scr = (u32 *)data->dest;
 
-		scr[0] = cpu_to_be32(2 << 24 | 1 << 15);  /* SD version 3 */
+		/* SD version 3, with CMD23 */
+		scr[0] = cpu_to_be32(2 << 24 | 1 << 15 | SD_SCR_CMD23_SUPPORT);
 		break;
 	}
 	default:
@@ -138,10 +156,64 @@ static int sandbox_mmc_get_cd(struct udevice *dev)
 	return 1;
 }
 
+#if CONFIG_IS_ENABLED(MMC_STREAM_READ)
+static int sandbox_mmc_prepare_data(struct udevice *dev, struct mmc_data *data)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	priv->prepared = data;
+
+	return 0;
+}
+
+static int sandbox_mmc_start_cmd(struct udevice *dev, struct mmc_cmd *cmd,
+				 struct mmc_data *data)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	if (priv->started)
+		return -EBUSY;
+	if (data == priv->prepared) {
+		priv->prepared = NULL;
+		priv->prepared_reads++;
+	}
+	priv->started = data;
+
+	return sandbox_mmc_send_cmd(dev, cmd, data);
+}
+
+static int sandbox_mmc_finish_cmd(struct udevice *dev, struct mmc_cmd *cmd,
+				  struct mmc_data *data)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	if (data != priv->started)
+		return -EINVAL;
+	priv->started = NULL;
+
+	return 0;
+}
+#endif
+
+void sandbox_mmc_get_read_counts(struct udevice *dev, uint *countedp,
+				 uint *preparedp, uint *stopsp)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	*countedp = priv->counted_reads;
+	*preparedp = priv->prepared_reads;
+	*stopsp = priv->stops;
+}
+
 static const struct dm_mmc_ops sandbox_mmc_ops = {
 	.send_cmd = sandbox_mmc_send_cmd,
 	.set_ios = sandbox_mmc_set_ios,
 	.get_cd = sandbox_mmc_get_cd,
+#if CONFIG_IS_ENABLED(MMC_STREAM_READ)
+	.prepare_data = sandbox_mmc_prepare_data,
+	.start_cmd = sandbox_mmc_start_cmd,
+	.finish_cmd = sandbox_mmc_finish_cmd,
+#endif
 };
 
 static int sandbox_mmc_of_to_plat(struct udevice *dev)
@@ -212,7 +284,8 @@ static int sandbox_mmc_bind(struct udevice *dev)
 	struct mmc_config *cfg = &plat->cfg;
 
 	cfg->name = dev->name;
-	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT;
+	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT |
+			 MMC_CAP_SET_BLOCK_COUNT;
 	cfg->voltages = MMC_VDD_165_195 | MMC_VDD_32_33 | MMC_VDD_33_34;
 	cfg->f_min = 1000000;
 	cfg->f_max = 52000000;
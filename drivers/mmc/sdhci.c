@@ -70,6 +70,36 @@ static void sdhci_transfer_pio(struct sdhci_host *host, struct mmc_data *data)
 	}
 }
 
+#if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
+static void sdhci_set_adma_addr(struct sdhci_host *host)
+{
+	sdhci_writel(host, lower_32_bits(host->adma_addr), SDHCI_ADMA_ADDRESS);
+	if (host->flags & USE_ADMA64)
+		sdhci_writel(host, upper_32_bits(host->adma_addr),
+			     SDHCI_ADMA_ADDRESS_HI);
+}
+#endif
+
+#if CONFIG_IS_ENABLED(MMC_STREAM_READ) && CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
+/*
+ * Switch to the table filled in by sdhci_prepare_data(). The current one
+ * becomes the spare, ready for the next transfer to be prepared.
+ */
+static void sdhci_use_next_table(struct sdhci_host *host)
+{
+	struct sdhci_adma_desc *table = host->adma_desc_table;
+	dma_addr_t addr = host->adma_addr;
+
+	host->adma_desc_table = host->adma_next_table;
+	host->adma_addr = host->adma_next_addr;
+	host->adma_next_table = table;
+	host->adma_next_addr = addr;
+	host->start_addr = host->prepared_start;
+	host->prepared_data = NULL;
+	sdhci_set_adma_addr(host);
+}
+#endif
+
 #if (CONFIG_IS_ENABLED(MMC_SDHCI_SDMA) || CONFIG_IS_ENABLED(MMC_SDHCI_ADMA))
 static void sdhci_prepare_dma(struct sdhci_host *host, struct mmc_data *data,
 			      int *is_aligned, int trans_bytes)
@@ -91,6 +121,13 @@ static void sdhci_prepare_dma(struct sdhci_host *host, struct mmc_data *data,
 		ctrl |= SDHCI_CTRL_ADMA32;
 	sdhci_writeb(host, ctrl, SDHCI_HOST_CONTROL);
 
+#if CONFIG_IS_ENABLED(MMC_STREAM_READ) && CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
+	if (data == host->prepared_data) {
+		sdhci_use_next_table(host);
+		return;
+	}
+#endif
+
 	if (host->flags & USE_SDMA &&
 	    (host->force_align_buffer ||
 	     (host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR &&
@@ -112,12 +149,7 @@ static void sdhci_prepare_dma(struct sdhci_host *host, struct mmc_data *data,
 	else if (host->flags & (USE_ADMA | USE_ADMA64)) {
 		sdhci_prepare_adma_table(host, host->adma_desc_table, data,
 					 host->start_addr);
-
-		sdhci_writel(host, lower_32_bits(host->adma_addr),
-			     SDHCI_ADMA_ADDRESS);
-		if (host->flags & USE_ADMA64)
-			sdhci_writel(host, upper_32_bits(host->adma_addr),
-				     SDHCI_ADMA_ADDRESS_HI);
+		sdhci_set_adma_addr(host);
 	}
 #endif
 }
@@ -195,21 +227,50 @@ static int sdhci_transfer_data(struct sdhci_host *host, struct mmc_data *data)
 #define SDHCI_CMD_DEFAULT_TIMEOUT		100
 #define SDHCI_READ_STATUS_TIMEOUT		1000
 
-#ifdef CONFIG_DM_MMC
-static int sdhci_send_command(struct udevice *dev, struct mmc_cmd *cmd,
-			      struct mmc_data *data)
+/*
+ * Finish off a command started by sdhci_start_command(), transferring its
+ * data if @ret is 0
+ */
+static int sdhci_end_command(struct sdhci_host *host, struct mmc_data *data,
+			     int ret, int is_aligned)
 {
-	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	unsigned int stat;
 
-#else
-static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
-			      struct mmc_data *data)
+	if (!ret && data)
+		ret = sdhci_transfer_data(host, data);
+
+	if (host->quirks & SDHCI_QUIRK_WAIT_SEND_CMD)
+		udelay(1000);
+
+	stat = sdhci_readl(host, SDHCI_INT_STATUS);
+	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
+	if (!ret) {
+		if ((host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR) &&
+				!is_aligned && (data->flags == MMC_DATA_READ))
+			memcpy(data->dest, host->align_buffer,
+			       data->blocks * data->blocksize);
+		return 0;
+	}
+
+	sdhci_reset(host, SDHCI_RESET_CMD);
+	sdhci_reset(host, SDHCI_RESET_DATA);
+	if (stat & SDHCI_INT_TIMEOUT)
+		return -ETIMEDOUT;
+	else
+		return -ECOMM;
+}
+
+/*
+ * Send a command and wait for its response. This returns 0 if the command
+ * must be completed with sdhci_end_command(), 1 if it is already complete,
+ * or -ve on error.
+ */
+static int sdhci_start_command(struct sdhci_host *host, struct mmc_cmd *cmd,
+			       struct mmc_data *data, int *is_aligned)
 {
-#endif
-	struct sdhci_host *host = mmc->priv;
+	struct mmc *mmc = host->mmc;
 	unsigned int stat = 0;
-	int ret = 0;
-	int trans_bytes = 0, is_aligned = 1;
+	int trans_bytes = 0;
 	u32 mask, flags, mode = 0;
 	unsigned int time = 0;
 	int mmc_dev = mmc_get_blk_desc(mmc)->devnum;
@@ -284,7 +345,7 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 
 		if (host->flags & USE_DMA) {
 			mode |= SDHCI_TRNS_DMA;
-			sdhci_prepare_dma(host, data, &is_aligned, trans_bytes);
+			sdhci_prepare_dma(host, data, is_aligned, trans_bytes);
 		}
 
 		sdhci_writew(host, SDHCI_MAKE_BLKSZ(SDHCI_DEFAULT_BOUNDARY_ARG,
@@ -310,7 +371,7 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 				sdhci_readl(host, SDHCI_PRESENT_STATE);
 
 			if (!(state & SDHCI_DAT_ACTIVE))
-				return 0;
+				return 1;
 		}
 
 		if (get_timer(start) >= SDHCI_READ_STATUS_TIMEOUT) {
@@ -320,35 +381,100 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 		}
 	} while ((stat & mask) != mask);
 
-	if ((stat & (SDHCI_INT_ERROR | mask)) == mask) {
-		sdhci_cmd_done(host, cmd);
-		sdhci_writel(host, mask, SDHCI_INT_STATUS);
-	} else
-		ret = -1;
+	if ((stat & (SDHCI_INT_ERROR | mask)) != mask)
+		return sdhci_end_command(host, data, -1, *is_aligned);
 
-	if (!ret && data)
-		ret = sdhci_transfer_data(host, data);
+	sdhci_cmd_done(host, cmd);
+	sdhci_writel(host, mask, SDHCI_INT_STATUS);
 
-	if (host->quirks & SDHCI_QUIRK_WAIT_SEND_CMD)
-		udelay(1000);
+	return 0;
+}
 
-	stat = sdhci_readl(host, SDHCI_INT_STATUS);
-	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
-	if (!ret) {
-		if ((host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR) &&
-				!is_aligned && (data->flags == MMC_DATA_READ))
-			memcpy(data->dest, host->align_buffer, trans_bytes);
+#ifdef CONFIG_DM_MMC
+static int sdhci_send_command(struct udevice *dev, struct mmc_cmd *cmd,
+			      struct mmc_data *data)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+
+#else
+static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
+			      struct mmc_data *data)
+{
+#endif
+	struct sdhci_host *host = mmc->priv;
+	int is_aligned = 1;
+	int ret;
+
+	ret = sdhci_start_command(host, cmd, data, &is_aligned);
+	if (ret)
+		return ret > 0 ? 0 : ret;
+
+	return sdhci_end_command(host, data, 0, is_aligned);
+}
+
+#if CONFIG_IS_ENABLED(MMC_STREAM_READ) && CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
+/* Data can be prepared ahead of time only when the host uses ADMA */
+static bool sdhci_can_prepare(struct sdhci_host *host)
+{
+	return !(host->flags & USE_SDMA) &&
+	       (host->flags & (USE_ADMA | USE_ADMA64)) && host->adma_next_table;
+}
+
+static int sdhci_prepare_data(struct udevice *dev, struct mmc_data *data)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+	uint trans_bytes;
+	void *buf;
+
+	host->prepared_data = NULL;
+	if (!data)
 		return 0;
-	}
+	if (!sdhci_can_prepare(host))
+		return -ENOSYS;
 
-	sdhci_reset(host, SDHCI_RESET_CMD);
-	sdhci_reset(host, SDHCI_RESET_DATA);
-	if (stat & SDHCI_INT_TIMEOUT)
-		return -ETIMEDOUT;
+	if (data->flags == MMC_DATA_READ)
+		buf = data->dest;
 	else
-		return -ECOMM;
+		buf = (void *)data->src;
+	trans_bytes = data->blocks * data->blocksize;
+
+	/* the table in use by a running transfer is left alone */
+	host->prepared_start = dma_map_single(buf, trans_bytes,
+					      mmc_get_dma_dir(data));
+	sdhci_prepare_adma_table(host, host->adma_next_table, data,
+				 host->prepared_start);
+	host->prepared_data = data;
+
+	return 0;
+}
+
+static int sdhci_start_cmd(struct udevice *dev, struct mmc_cmd *cmd,
+			   struct mmc_data *data)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+	int is_aligned = 1;
+	int ret;
+
+	if (!data || !sdhci_can_prepare(host))
+		return -ENOSYS;
+
+	ret = sdhci_start_command(host, cmd, data, &is_aligned);
+
+	return ret > 0 ? 0 : ret;
 }
 
+static int sdhci_finish_cmd(struct udevice *dev, struct mmc_cmd *cmd,
+			    struct mmc_data *data)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+
+	/* only ADMA is used here, so there is no bounce buffer */
+	return sdhci_end_command(mmc->priv, data, 0, 1);
+}
+#endif
+
 #if defined(CONFIG_DM_MMC) && CONFIG_IS_ENABLED(MMC_SUPPORTS_TUNING)
 static int sdhci_execute_tuning(struct udevice *dev, uint opcode)
 {
@@ -850,6 +976,11 @@ const struct dm_mmc_ops sdhci_ops = {
 #if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
 	.set_enhanced_strobe = sdhci_set_enhanced_strobe,
 #endif
+#if CONFIG_IS_ENABLED(MMC_STREAM_READ) && CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
+	.prepare_data	= sdhci_prepare_data,
+	.start_cmd	= sdhci_start_cmd,
+	.finish_cmd	= sdhci_finish_cmd,
+#endif
 };
 #else
 static const struct mmc_ops sdhci_ops = {
@@ -894,6 +1025,12 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 		host->adma_desc_table = sdhci_adma_init();
 		host->adma_addr = virt_to_phys(host->adma_desc_table);
 	}
+#if CONFIG_IS_ENABLED(MMC_STREAM_READ)
+	if (!host->adma_next_table) {
+		host->adma_next_table = sdhci_adma_init();
+		host->adma_next_addr = virt_to_phys(host->adma_next_table);
+	}
+#endif
 
 	if (IS_ENABLED(CONFIG_MMC_SDHCI_ADMA_64BIT))
 		host->flags |= USE_ADMA64;
@@ -976,6 +1113,8 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 		cfg->host_caps |= MMC_MODE_HS | MMC_MODE_HS_52MHz;
 
 	cfg->host_caps |= MMC_MODE_4BIT;
+	if (CONFIG_IS_ENABLED(MMC_STREAM_READ))
+		cfg->host_caps |= MMC_CAP_SET_BLOCK_COUNT;
 
 	/* Since Host Controller Version3.0 */
 	if (SDHCI_GET_VERSION(host) >= SDHCI_SPEC_300) {
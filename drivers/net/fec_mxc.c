@@ -350,6 +350,7 @@ static void fec_rbd_init(struct fec_priv *fec, int count, int dsize)
 	/* Mark the last RBD to close the ring. */
 	fec->rbd_base[i - 1].status = FEC_RBD_WRAP | FEC_RBD_EMPTY;
 	fec->rbd_index = 0;
+	fec->rbd_held = false;
 
 	flush_dcache_range((ulong)fec->rbd_base,
 			   (ulong)fec->rbd_base + size);
@@ -796,8 +797,44 @@ out:
 	return ret;
 }
 
+/**
+ * Give the current receive buffer back to the card and move to the next one
+ * @param[in] fec all we know about the device yet
+ */
+static void fec_rbd_release(struct fec_priv *fec)
+{
+	ulong addr, size;
+	int i;
+
+	/*
+	 * Free the current buffer, restart the engine and move forward
+	 * to the next buffer. Here we check if the whole cacheline of
+	 * descriptors was already processed and if so, we mark it free
+	 * as whole.
+	 */
+	size = RXDESC_PER_CACHELINE - 1;
+	if ((fec->rbd_index & size) == size) {
+		i = fec->rbd_index - size;
+		addr = (ulong)&fec->rbd_base[i];
+		for (; i <= fec->rbd_index ; i++) {
+			fec_rbd_clean(i == (FEC_RBD_NUM - 1),
+				      &fec->rbd_base[i]);
+		}
+		flush_dcache_range(addr,
+				   addr + ARCH_DMA_MINALIGN);
+	}
+
+	fec_rx_task_enable(fec);
+	fec->rbd_index = (fec->rbd_index + 1) % FEC_RBD_NUM;
+}
+
 /**
  * Pull one frame from the card
+ *
+ * The frame is handed over in the DMA buffer it was received in, which is
+ * only given back to the card by fecmxc_free_pkt(), so the network stack
+ * copies its payload straight to its destination.
+ *
  * @param[in] dev Our ethernet device to handle
  * Return: Length of packet read
  */
@@ -806,17 +843,11 @@ static int fecmxc_recv(struct udevice *dev, int flags, uchar **packetp)
 	struct fec_priv *fec = dev_get_priv(dev);
 	struct fec_bd *rbd = &fec->rbd_base[fec->rbd_index];
 	unsigned long ievent;
-	int frame_length, len = 0;
+	int frame_length;
 	uint16_t bd_status;
 	ulong addr, size, end;
-	int i;
-
-	*packetp = memalign(ARCH_DMA_MINALIGN, FEC_MAX_PKT_SIZE);
-	if (*packetp == 0) {
-		printf("%s: error allocating packetp\n", __func__);
-		return -ENOMEM;
-	}
 
+	*packetp = NULL;
 	if (!(readl(&fec->eth->ecntrl) & FEC_ECNTRL_ETHER_EN))
 		return 0;
 
@@ -866,54 +897,34 @@ static int fecmxc_recv(struct udevice *dev, int flags, uchar **packetp)
 	bd_status = readw(&rbd->status);
 	debug("fec_recv: status 0x%x\n", bd_status);
 
-	if (!(bd_status & FEC_RBD_EMPTY)) {
-		if ((bd_status & FEC_RBD_LAST) && !(bd_status & FEC_RBD_ERR) &&
-		    ((readw(&rbd->data_length) - 4) > 14)) {
-			/* Get buffer address and size */
-			addr = readl(&rbd->data_pointer);
-			frame_length = readw(&rbd->data_length) - 4;
-			/* Invalidate data cache over the buffer */
-			end = roundup(addr + frame_length, ARCH_DMA_MINALIGN);
-			addr &= ~(ARCH_DMA_MINALIGN - 1);
-			invalidate_dcache_range(addr, end);
-
-			/* Fill the buffer and pass it to upper layers */
-#ifdef CFG_FEC_MXC_SWAP_PACKET
-			swap_packet((uint32_t *)addr, frame_length);
-#endif
+	if (bd_status & FEC_RBD_EMPTY)
+		return 0;
 
-			memcpy(*packetp, (char *)addr, frame_length);
-			len = frame_length;
-		} else {
-			if (bd_status & FEC_RBD_ERR)
-				debug("error frame: 0x%08lx 0x%08x\n",
-				      addr, bd_status);
-		}
+	if ((bd_status & FEC_RBD_LAST) && !(bd_status & FEC_RBD_ERR) &&
+	    ((readw(&rbd->data_length) - 4) > 14)) {
+		/* Get buffer address and size */
+		addr = readl(&rbd->data_pointer);
+		frame_length = readw(&rbd->data_length) - 4;
+		/* Invalidate data cache over the buffer */
+		end = roundup(addr + frame_length, ARCH_DMA_MINALIGN);
+		invalidate_dcache_range(addr & ~(ARCH_DMA_MINALIGN - 1), end);
 
-		/*
-		 * Free the current buffer, restart the engine and move forward
-		 * to the next buffer. Here we check if the whole cacheline of
-		 * descriptors was already processed and if so, we mark it free
-		 * as whole.
-		 */
-		size = RXDESC_PER_CACHELINE - 1;
-		if ((fec->rbd_index & size) == size) {
-			i = fec->rbd_index - size;
-			addr = (ulong)&fec->rbd_base[i];
-			for (; i <= fec->rbd_index ; i++) {
-				fec_rbd_clean(i == (FEC_RBD_NUM - 1),
-					      &fec->rbd_base[i]);
-			}
-			flush_dcache_range(addr,
-					   addr + ARCH_DMA_MINALIGN);
-		}
+		/* Pass the buffer to upper layers */
+#ifdef CFG_FEC_MXC_SWAP_PACKET
+		swap_packet((uint32_t *)addr, frame_length);
+#endif
 
-		fec_rx_task_enable(fec);
-		fec->rbd_index = (fec->rbd_index + 1) % FEC_RBD_NUM;
+		*packetp = (uchar *)addr;
+		fec->rbd_held = true;
+		return frame_length;
 	}
-	debug("fec_recv: stop\n");
 
-	return len;
+	if (bd_status & FEC_RBD_ERR)
+		debug("error frame: 0x%08lx 0x%08x\n", addr, bd_status);
+	eth_count_rx_drop(dev);
+	fec_rbd_release(fec);
+
+	return 0;
 }
 
 static void fec_set_dev_name(char *dest, int dev_id)
@@ -1116,8 +1127,21 @@ static int fecmxc_set_promisc(struct udevice *dev, bool enable)
 
 static int fecmxc_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
-	if (packet)
-		free(packet);
+	struct fec_priv *fec = dev_get_priv(dev);
+	ulong addr;
+
+	if (!fec->rbd_held)
+		return 0;
+
+	/*
+	 * The stack may have written to the buffer (e.g. to answer an ARP
+	 * request), so make sure no dirty line is evicted over the next frame
+	 */
+	addr = readl(&fec->rbd_base[fec->rbd_index].data_pointer);
+	flush_dcache_range(addr, addr + roundup(FEC_MAX_PKT_SIZE,
+						FEC_DMA_RX_MINALIGN));
+	fec->rbd_held = false;
+	fec_rbd_release(fec);
 
 	return 0;
 }
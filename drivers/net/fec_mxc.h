@@ -242,6 +242,7 @@ struct fec_priv {
 	enum xceiver_type xcv_type;	/* transceiver type */
 	struct fec_bd *rbd_base;	/* RBD ring */
 	int rbd_index;			/* next receive BD to read */
+	bool rbd_held;			/* its buffer is in use by the stack */
 	struct fec_bd *tbd_base;	/* TBD ring */
 	int tbd_index;			/* next transmit BD to write */
 	struct bd_info *bd;
@@ -27,6 +27,14 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Set to report the link as down while autonegotiation is in progress */
+static bool phy_aneg_nowait;
+
+void phy_set_aneg_wait(bool wait)
+{
+	phy_aneg_nowait = !wait;
+}
+
 /* Generic PHY support and helper functions */
 
 /**
@@ -244,6 +252,11 @@ int genphy_update_link(struct phy_device *phydev)
 	    !(mii_reg & BMSR_ANEGCOMPLETE)) {
 		int i = 0;
 
+		if (phy_aneg_nowait) {
+			phydev->link = 0;
+			return 0;
+		}
+
 		printf("%s Waiting for PHY auto negotiation to complete",
 		       phydev->dev->name);
 		while (!(mii_reg & BMSR_ANEGCOMPLETE)) {
@@ -132,6 +132,12 @@ static void sb_eth_raw_stop(struct udevice *dev)
 	sandbox_eth_raw_os_stop(priv);
 }
 
+static int sb_eth_raw_mcast(struct udevice *dev, const u8 *enetaddr, int join)
+{
+	/* The socket is promiscuous, so it already sees all multicast frames */
+	return 0;
+}
+
 static int sb_eth_raw_read_rom_hwaddr(struct udevice *dev)
 {
 	struct eth_pdata *pdata = dev_get_plat(dev);
@@ -146,6 +152,7 @@ static const struct eth_ops sb_eth_raw_ops = {
 	.send			= sb_eth_raw_send,
 	.recv			= sb_eth_raw_recv,
 	.stop			= sb_eth_raw_stop,
+	.mcast			= sb_eth_raw_mcast,
 	.read_rom_hwaddr	= sb_eth_raw_read_rom_hwaddr,
 };
 
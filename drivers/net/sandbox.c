@@ -73,8 +73,10 @@ int sandbox_eth_arp_req_to_reply(struct udevice *dev, void *packet,
 		return -EAGAIN;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		eth_count_rx_drop(dev);
 		return 0;
+	}
 
 	/* store this as the assumed IP of the fake host */
 	priv->fake_host_ipaddr = net_read_ip(&arp->ar_tpa);
@@ -135,8 +137,10 @@ int sandbox_eth_ping_req_to_reply(struct udevice *dev, void *packet,
 		return -EAGAIN;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		eth_count_rx_drop(dev);
 		return 0;
+	}
 
 	/* reply to the ping */
 	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
@@ -319,6 +323,27 @@ void sandbox_eth_set_priv(int index, void *priv)
 	dev_priv->priv = priv;
 }
 
+/*
+ * sandbox_eth_set_rx_copy()
+ *
+ * index - The alias index (also DM seq number)
+ * copy - If true, copy each received packet to a separate buffer before
+ *	  handing it to the network stack
+ */
+void sandbox_eth_set_rx_copy(int index, bool copy)
+{
+	struct udevice *dev;
+	struct eth_sandbox_priv *priv;
+	int ret;
+
+	ret = uclass_get_device(UCLASS_ETH, index, &dev);
+	if (ret)
+		return;
+
+	priv = dev_get_priv(dev);
+	priv->rx_copy = copy;
+}
+
 static int sb_eth_start(struct udevice *dev)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -361,6 +386,12 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 		debug("eth_sandbox: received packet[%d], %d waiting\n",
 		      lcl_recv_packet_length, priv->recv_packets - 1);
 		*packetp = priv->recv_packet_buffer[0];
+		if (priv->rx_copy) {
+			memcpy(priv->rx_copy_buf, *packetp,
+			       lcl_recv_packet_length);
+			eth_count_rx_copy(dev, lcl_recv_packet_length);
+			*packetp = priv->rx_copy_buf;
+		}
 		return lcl_recv_packet_length;
 	}
 	return 0;
@@ -402,6 +433,15 @@ static int sb_eth_write_hwaddr(struct udevice *dev)
 	return 0;
 }
 
+static int sb_eth_mcast(struct udevice *dev, const u8 *enetaddr, int join)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	priv->mcast_groups += join ? 1 : -1;
+
+	return 0;
+}
+
 static const struct eth_ops sb_eth_ops = {
 	.start			= sb_eth_start,
 	.send			= sb_eth_send,
@@ -409,6 +449,7 @@ static const struct eth_ops sb_eth_ops = {
 	.free_pkt		= sb_eth_free_pkt,
 	.stop			= sb_eth_stop,
 	.write_hwaddr		= sb_eth_write_hwaddr,
+	.mcast			= sb_eth_mcast,
 };
 
 static int sb_eth_remove(struct udevice *dev)
@@ -17,7 +17,7 @@
 #include <linux/compat.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+#define NVME_Q_DEPTH		CONFIG_NVME_QUEUE_DEPTH
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
@@ -25,7 +25,8 @@
 				      ARCH_DMA_MINALIGN)
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
+/* Largest transfer carried out by a single read/write command */
+#define NVME_MAX_TRANSFER_SHIFT	20
 
 static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 {
@@ -44,8 +45,38 @@ static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
-			   int total_len, u64 dma_addr)
+/**
+ * nvme_prp_list_pages() - get the number of pages needed for a PRP list
+ *
+ * @dev:	NVMe device
+ * @nprps:	Number of PRP entries after the first
+ * Return: number of pages, each ending with a pointer to the next one
+ */
+static u32 nvme_prp_list_pages(struct nvme_dev *dev, u32 nprps)
+{
+	u32 prps_per_page = dev->page_size >> 3;
+
+	if (nprps <= 1)
+		return 1;
+
+	return DIV_ROUND_UP(nprps - 1, prps_per_page - 1);
+}
+
+/**
+ * nvme_setup_prps() - set up the PRP entries for a transfer
+ *
+ * The PRP list is written to @prp_list, which must be large enough for the
+ * largest transfer (see nvme_alloc_io_cmds()). It is preallocated so that it
+ * can be reused by each command using the same slot.
+ *
+ * @dev:	NVMe device
+ * @prp_list:	Page-aligned PRP list to fill in, if needed
+ * @prp2:	Returns the value for the PRP2 field of the command
+ * @total_len:	Number of bytes to transfer
+ * @dma_addr:	Address of the data buffer
+ */
+static void nvme_setup_prps(struct nvme_dev *dev, u64 *prp_list, u64 *prp2,
+			    int total_len, u64 dma_addr)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
@@ -59,7 +90,7 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 
 	if (length <= 0) {
 		*prp2 = 0;
-		return 0;
+		return;
 	}
 
 	if (length)
@@ -67,45 +98,29 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 
 	if (length <= page_size) {
 		*prp2 = dma_addr;
-		return 0;
+		return;
 	}
 
 	nprps = DIV_ROUND_UP(length, page_size);
-	num_pages = DIV_ROUND_UP(nprps - 1, prps_per_page - 1);
-
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
-		/*
-		 * Always increase in increments of pages.  It doesn't waste
-		 * much memory and reduces the number of allocations.
-		 */
-		dev->prp_pool = memalign(page_size, num_pages * page_size);
-		if (!dev->prp_pool) {
-			printf("Error: malloc prp_pool fail\n");
-			return -ENOMEM;
-		}
-		dev->prp_entry_num = num_pages * (prps_per_page - 1) + 1;
-	}
+	num_pages = nvme_prp_list_pages(dev, nprps);
 
-	prp_pool = dev->prp_pool;
+	prp_pool = prp_list;
 	i = 0;
 	while (nprps) {
 		if ((i == (prps_per_page - 1)) && nprps > 1) {
 			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
 					page_size);
 			i = 0;
-			prp_pool += page_size;
+			prp_pool += prps_per_page;
 		}
 		*(prp_pool + i++) = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
 		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	*prp2 = (ulong)prp_list;
 
-	flush_dcache_range((ulong)dev->prp_pool, (ulong)dev->prp_pool +
+	flush_dcache_range((ulong)prp_list, (ulong)prp_list +
 			   num_pages * page_size);
-
-	return 0;
 }
 
 static __le16 nvme_get_cmd_id(void)
@@ -132,12 +147,16 @@ static u16 nvme_read_completion_status(struct nvme_queue *nvmeq, u16 index)
 }
 
 /**
- * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ * nvme_queue_cmd() - copy a command into a queue
+ *
+ * Unless the controller has its own submission method, the doorbell is not
+ * rung, so that several commands can be passed to the controller at once with
+ * nvme_ring_sq().
  *
  * @nvmeq:	The queue to use
  * @cmd:	The command to send
  */
-static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+static void nvme_queue_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 {
 	struct nvme_ops *ops;
 	u16 tail = nvmeq->sq_tail;
@@ -154,10 +173,37 @@ static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 
 	if (++tail == nvmeq->q_depth)
 		tail = 0;
-	writel(tail, nvmeq->q_db);
 	nvmeq->sq_tail = tail;
 }
 
+/**
+ * nvme_ring_sq() - tell the controller about commands added to a queue
+ *
+ * @nvmeq:	The queue to use
+ */
+static void nvme_ring_sq(struct nvme_queue *nvmeq)
+{
+	struct nvme_ops *ops;
+
+	ops = (struct nvme_ops *)nvmeq->dev->udev->driver->ops;
+	if (ops && ops->submit_cmd)
+		return;
+
+	writel(nvmeq->sq_tail, nvmeq->q_db);
+}
+
+/**
+ * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ *
+ * @nvmeq:	The queue to use
+ * @cmd:	The command to send
+ */
+static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+{
+	nvme_queue_cmd(nvmeq, cmd);
+	nvme_ring_sq(nvmeq);
+}
+
 static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 				struct nvme_command *cmd,
 				u32 *result, unsigned timeout)
@@ -618,6 +664,45 @@ static int nvme_setup_io_queues(struct nvme_dev *dev)
 	return 0;
 }
 
+/**
+ * nvme_alloc_io_cmds() - allocate the slots for I/O commands in flight
+ *
+ * Each slot has its own PRP list, large enough for the largest transfer, so
+ * that PRP lists are set up once rather than allocated for each command.
+ * Controllers with their own submission method only get a single slot.
+ *
+ * @dev:	NVMe device
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+static int nvme_alloc_io_cmds(struct nvme_dev *dev)
+{
+	struct nvme_ops *ops = (struct nvme_ops *)dev->udev->driver->ops;
+	u32 nprps = (1 << dev->max_transfer_shift) / dev->page_size;
+	u32 list_size;
+	int i;
+
+	dev->io_slots = dev->queues[NVME_IO_Q]->q_depth - 1;
+	if (ops && ops->submit_cmd)
+		dev->io_slots = 1;
+
+	list_size = nvme_prp_list_pages(dev, nprps) * dev->page_size;
+	dev->prp_pool = memalign(dev->page_size, dev->io_slots * list_size);
+	dev->io_cmds = calloc(dev->io_slots, sizeof(struct nvme_io_cmd));
+	if (!dev->prp_pool || !dev->io_cmds) {
+		free(dev->prp_pool);
+		free(dev->io_cmds);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < dev->io_slots; i++)
+		dev->io_cmds[i].prp_list = (void *)dev->prp_pool +
+			i * list_size;
+	dev->io_inflight = 0;
+	dev->io_disabled = false;
+
+	return 0;
+}
+
 static int nvme_get_info_from_identify(struct nvme_dev *dev)
 {
 	struct nvme_id_ctrl *ctrl;
@@ -662,6 +747,9 @@ static int nvme_get_info_from_identify(struct nvme_dev *dev)
 		 */
 		dev->max_transfer_shift = 20;
 	}
+	/* larger transfers are split into several commands in flight */
+	dev->max_transfer_shift = min(dev->max_transfer_shift,
+				      (u32)NVME_MAX_TRANSFER_SHIFT);
 
 	free(ctrl);
 	return 0;
@@ -741,65 +829,292 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
-static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
-			 lbaint_t blkcnt, void *buffer, bool read)
+/**
+ * nvme_io_end() - drop a reference to a block request
+ *
+ * Each command in flight holds a reference to its request, as does the code
+ * issuing the commands. When the last one is dropped the request completes.
+ *
+ * @ns:		Namespace the request is for
+ * @req:	Request to update
+ * @result:	Number of blocks transferred, or -ve error
+ * Return: true if the request is now complete
+ */
+static bool nvme_io_end(struct nvme_ns *ns, struct blk_req *req, long result)
+{
+	ulong refs = (ulong)req->priv - 1;
+
+	if (result < 0 || req->result < 0)
+		req->result = min(result, req->result);
+	else
+		req->result += result;
+
+	req->priv = (void *)refs;
+	if (refs)
+		return false;
+
+	if (req->op == BLK_REQ_READ)
+		invalidate_dcache_range((ulong)req->buffer,
+					(ulong)req->buffer +
+					(req->blkcnt << ns->lba_shift));
+	blk_req_complete(req, req->result);
+
+	return true;
+}
+
+/**
+ * nvme_io_queue_cmd() - queue a read/write command for part of a request
+ *
+ * The doorbell is not rung; see nvme_ring_sq()
+ *
+ * @ns:		Namespace to access
+ * @req:	Request being carried out
+ * @offset:	Offset of the first block to transfer, within the request
+ * @blkcnt:	Number of blocks to transfer
+ * Return: 0 if OK, -EBUSY if all command slots are in use
+ */
+static int nvme_io_queue_cmd(struct nvme_ns *ns, struct blk_req *req,
+			     lbaint_t offset, u32 blkcnt)
 {
-	struct nvme_ns *ns = dev_get_priv(udev);
 	struct nvme_dev *dev = ns->dev;
-	struct nvme_command c;
-	struct blk_desc *desc = dev_get_uclass_plat(udev);
-	int status;
+	ulong buf = (ulong)req->buffer + (offset << ns->lba_shift);
+	struct nvme_io_cmd *io;
+	struct nvme_command *c;
 	u64 prp2;
-	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
-	uintptr_t temp_buffer = (uintptr_t)buffer;
-
-	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-	u64 total_lbas = blkcnt;
-
-	flush_dcache_range((unsigned long)buffer,
-			   (unsigned long)buffer + total_len);
-
-	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
-	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
-		} else {
-			total_lbas -= lbas;
+	int cid;
+
+	for (cid = 0; cid < dev->io_slots; cid++)
+		if (!dev->io_cmds[cid].busy)
+			break;
+	if (cid == dev->io_slots)
+		return -EBUSY;
+	io = &dev->io_cmds[cid];
+
+	nvme_setup_prps(dev, io->prp_list, &prp2, blkcnt << ns->lba_shift,
+			buf);
+
+	c = &io->cmd;
+	memset(c, 0, sizeof(*c));
+	c->rw.opcode = req->op == BLK_REQ_WRITE ? nvme_cmd_write :
+		       nvme_cmd_read;
+	c->rw.command_id = cpu_to_le16(cid);
+	c->rw.nsid = cpu_to_le32(ns->ns_id);
+	c->rw.slba = cpu_to_le64(req->start + offset);
+	c->rw.length = cpu_to_le16(blkcnt - 1);
+	c->rw.prp1 = cpu_to_le64(buf);
+	c->rw.prp2 = cpu_to_le64(prp2);
+
+	io->req = req;
+	io->ns = ns;
+	io->blkcnt = blkcnt;
+	io->start = timer_get_us();
+	io->busy = true;
+	dev->io_inflight++;
+	req->priv = (void *)((ulong)req->priv + 1);
+
+	nvme_queue_cmd(dev->queues[NVME_IO_Q], c);
+
+	return 0;
+}
+
+/**
+ * nvme_io_reset() - give up on the commands on the I/O queue
+ *
+ * This is used when a command times out. The controller may still complete
+ * it and write to its buffer, so its slot cannot simply be reused. Deleting
+ * the queue makes the controller abort every command on it, then the queue
+ * is created again, empty. If the controller does not respond, the queue is
+ * disabled until the device is probed again.
+ *
+ * All requests in flight are failed with -ETIMEDOUT.
+ *
+ * @dev:	NVMe device
+ * Return: number of block requests completed
+ */
+static int nvme_io_reset(struct nvme_dev *dev)
+{
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	struct nvme_io_cmd *io;
+	int completed = 0;
+	int cid;
+
+	dev->online_queues--;
+	if (nvme_delete_sq(dev, NVME_IO_Q) || nvme_delete_cq(dev, NVME_IO_Q) ||
+	    nvme_create_queue(nvmeq, NVME_IO_Q)) {
+		printf("ERROR: cannot reset the I/O queue, disabling it\n");
+		dev->io_disabled = true;
+	}
+
+	for (cid = 0; cid < dev->io_slots; cid++) {
+		io = &dev->io_cmds[cid];
+		if (!io->busy)
+			continue;
+		io->busy = false;
+		if (nvme_io_end(io->ns, io->req, -ETIMEDOUT))
+			completed++;
+	}
+	dev->io_inflight = 0;
+
+	return completed;
+}
+
+/**
+ * nvme_io_reap() - process completions on the I/O queue
+ *
+ * This does not wait. If a command has been in flight for too long, the
+ * queue is reset and every request in flight fails; see nvme_io_reset()
+ *
+ * @dev:	NVMe device
+ * Return: number of block requests completed
+ */
+static int nvme_io_reap(struct nvme_dev *dev)
+{
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	struct nvme_ops *ops = (struct nvme_ops *)dev->udev->driver->ops;
+	u16 head = nvmeq->cq_head;
+	u8 phase = nvmeq->cq_phase;
+	ulong timeout_us = IO_TIMEOUT * 100000;
+	int reaped = 0, completed = 0;
+	struct nvme_io_cmd *io;
+	u16 status, cid;
+
+	if (dev->io_disabled)
+		return 0;
+
+	for (;;) {
+		status = nvme_read_completion_status(nvmeq, head);
+		if ((status & 0x01) != phase)
+			break;
+
+		cid = le16_to_cpu(readw(&nvmeq->cqes[head].command_id));
+		if (++head == nvmeq->q_depth) {
+			head = 0;
+			phase = !phase;
+		}
+		reaped++;
+
+		if (cid >= dev->io_slots || !dev->io_cmds[cid].busy) {
+			printf("ERROR: unexpected completion %x\n", cid);
+			continue;
 		}
+		io = &dev->io_cmds[cid];
+		if (ops && ops->complete_cmd)
+			ops->complete_cmd(nvmeq, &io->cmd);
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, temp_buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
-		c.rw.length = cpu_to_le16(lbas - 1);
-		c.rw.prp1 = cpu_to_le64(temp_buffer);
-		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
+		status >>= 1;
 		if (status)
+			printf("ERROR: status = %x, cid = %d\n", status, cid);
+		io->busy = false;
+		dev->io_inflight--;
+		if (nvme_io_end(io->ns, io->req, status ? -EIO : io->blkcnt))
+			completed++;
+	}
+
+	if (reaped) {
+		writel(head, nvmeq->q_db + dev->db_stride);
+		nvmeq->cq_head = head;
+		nvmeq->cq_phase = phase;
+	}
+
+	for (cid = 0; cid < dev->io_slots; cid++) {
+		io = &dev->io_cmds[cid];
+		if (io->busy && timer_get_us() - io->start >= timeout_us) {
+			printf("ERROR: command %d timed out\n", cid);
+			return completed + nvme_io_reset(dev);
+		}
+	}
+
+	return completed;
+}
+
+/**
+ * nvme_io_start() - prepare a block request for issuing
+ *
+ * This takes the issuing reference, dropped by nvme_io_end() once all
+ * commands have been queued.
+ *
+ * @ns:		Namespace to access
+ * @req:	Request to prepare
+ */
+static void nvme_io_start(struct nvme_ns *ns, struct blk_req *req)
+{
+	flush_dcache_range((ulong)req->buffer,
+			   (ulong)req->buffer + (req->blkcnt << ns->lba_shift));
+	req->result = 0;
+	req->done = false;
+	req->priv = (void *)1UL;
+}
+
+/**
+ * nvme_io_issue() - queue as many commands for a request as slots allow
+ *
+ * Transfers are split into commands of at most the maximum transfer size,
+ * then the controller is told about all the new commands at once.
+ *
+ * @ns:		Namespace to access
+ * @req:	Request being carried out
+ * @donep:	Number of blocks already queued; updated on exit
+ * Return: 0 if OK, -EIO if the I/O queue is disabled, other -ve on error
+ */
+static int nvme_io_issue(struct nvme_ns *ns, struct blk_req *req,
+			 lbaint_t *donep)
+{
+	struct nvme_dev *dev = ns->dev;
+	u32 max_lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
+	lbaint_t done = *donep;
+	int queued = 0;
+	int ret = 0;
+
+	if (dev->io_disabled)
+		return -EIO;
+
+	while (done < req->blkcnt && dev->io_inflight < dev->io_slots) {
+		u32 count = min_t(lbaint_t, req->blkcnt - done, max_lbas);
+
+		ret = nvme_io_queue_cmd(ns, req, done, count);
+		if (ret)
 			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		temp_buffer += lbas << ns->lba_shift;
+		done += count;
+		queued++;
 	}
+	if (queued)
+		nvme_ring_sq(dev->queues[NVME_IO_Q]);
+	*donep = done;
 
-	if (read)
-		invalidate_dcache_range((unsigned long)buffer,
-					(unsigned long)buffer + total_len);
+	return ret;
+}
 
-	return (total_len - temp_len) >> desc->log2blksz;
+static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
+			 lbaint_t blkcnt, void *buffer, bool read)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	struct blk_req req = {
+		.op = read ? BLK_REQ_READ : BLK_REQ_WRITE,
+		.start = blknr,
+		.blkcnt = blkcnt,
+		.buffer = buffer,
+	};
+	lbaint_t done = 0;
+	int ret;
+
+	/*
+	 * Keep the queue full until everything has been issued, stopping
+	 * early if part of the request has already failed
+	 */
+	nvme_io_start(ns, &req);
+	for (;;) {
+		ret = nvme_io_issue(ns, &req, &done);
+		if (ret || done == blkcnt || req.result < 0)
+			break;
+		nvme_io_reap(dev);
+	}
+	nvme_io_end(ns, &req, ret);
+
+	while (!req.done)
+		nvme_io_reap(dev);
+
+	return req.result;
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -814,9 +1129,45 @@ static ulong nvme_blk_write(struct udevice *udev, lbaint_t blknr,
 	return nvme_blk_rw(udev, blknr, blkcnt, (void *)buffer, false);
 }
 
+static int nvme_blk_submit(struct udevice *udev, struct blk_req *req)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	u32 max_lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
+	lbaint_t done = 0;
+	int ret;
+
+	if (DIV_ROUND_UP(req->blkcnt, max_lbas) >
+	    dev->io_slots - dev->io_inflight) {
+		if (dev->io_inflight)
+			return -EBUSY;
+
+		/* too large to queue in one go, so carry it out now */
+		blk_req_complete(req, nvme_blk_rw(udev, req->start,
+						  req->blkcnt, req->buffer,
+						  req->op == BLK_REQ_READ));
+		return 0;
+	}
+
+	nvme_io_start(ns, req);
+	ret = nvme_io_issue(ns, req, &done);
+	nvme_io_end(ns, req, ret);
+
+	return 0;
+}
+
+static int nvme_blk_poll(struct udevice *udev)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+
+	return nvme_io_reap(ns->dev);
+}
+
 static const struct blk_ops nvme_blk_ops = {
 	.read	= nvme_blk_read,
 	.write	= nvme_blk_write,
+	.submit	= nvme_blk_submit,
+	.poll	= nvme_blk_poll,
 };
 
 U_BOOT_DRIVER(nvme_blk) = {
@@ -860,15 +1211,6 @@ int nvme_init(struct udevice *udev)
 		goto free_queue;
 	}
 
-	/* Allocate after the page size is known */
-	ndev->prp_pool = memalign(ndev->page_size, MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
-		ret = -ENOMEM;
-		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
-	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
-
 	ret = nvme_setup_io_queues(ndev);
 	if (ret) {
 		log_debug("Unable to setup I/O queues(err=%dE)\n", ret);
@@ -877,6 +1219,13 @@ int nvme_init(struct udevice *udev)
 
 	nvme_get_info_from_identify(ndev);
 
+	/* Allocate after the page size and transfer size are known */
+	ret = nvme_alloc_io_cmds(ndev);
+	if (ret) {
+		printf("Error: %s: Out of memory!\n", udev->name);
+		goto free_queue;
+	}
+
 	/* Create a blk device for each namespace */
 
 	id = memalign(ndev->page_size, sizeof(struct nvme_id_ns));
@@ -619,7 +619,10 @@ struct nvme_dev {
 	u32 page_size;
 	u8 vwc;
 	u64 *prp_pool;
-	u32 prp_entry_num;
+	struct nvme_io_cmd *io_cmds;
+	int io_slots;
+	int io_inflight;
+	bool io_disabled;
 	u32 nn;
 };
 
@@ -650,6 +653,29 @@ struct nvme_queue {
 	unsigned long cmdid_data[];
 };
 
+/**
+ * struct nvme_io_cmd - a slot for a read/write command on the I/O queue
+ *
+ * The slot index is used as the command identifier.
+ *
+ * @cmd: Command as sent to the controller
+ * @req: Block request the command belongs to
+ * @ns: Namespace the command accesses
+ * @prp_list: PRP list for this slot, reused by each command using it
+ * @blkcnt: Number of blocks transferred by the command
+ * @start: Time the command was submitted, in microseconds
+ * @busy: true if the slot is in use
+ */
+struct nvme_io_cmd {
+	struct nvme_command cmd;
+	struct blk_req *req;
+	struct nvme_ns *ns;
+	u64 *prp_list;
+	u32 blkcnt;
+	ulong start;
+	bool busy;
+};
+
 /*
  * An NVM Express namespace is equivalent to a SCSI LUN.
  * Each namespace is operated as an independent "device".
@@ -14,12 +14,56 @@
 #include <virtio_ring.h>
 #include "virtio_blk.h"
 
+/* Number of requests which can be in flight at once */
+#define VIRTIO_BLK_QUEUE_DEPTH	16
+/* Largest transfer carried out by a single request, in sectors */
+#define VIRTIO_BLK_MAX_SECTORS	1024
+/* Maximum number of data segments in a request, leaving room for hdr/status */
+#define VIRTIO_BLK_MAX_SEGS	(VIRTQUEUE_MAX_INDIRECT - 2)
+
+/**
+ * struct virtio_blk_slot - a request passed to the device
+ *
+ * @out_hdr: Request header; its address identifies the slot on completion
+ * @wz: Write-zeroes descriptor, for VIRTIO_BLK_T_WRITE_ZEROES
+ * @status: Status written by the device
+ * @req: Block request this is part of, or NULL if abandoned
+ * @blkcnt: Number of sectors transferred by this request
+ * @busy: true if the slot is in use
+ */
+struct virtio_blk_slot {
+	struct virtio_blk_outhdr out_hdr;
+	struct virtio_blk_discard_write_zeroes wz;
+	u8 status;
+	struct blk_req *req;
+	lbaint_t blkcnt;
+	bool busy;
+};
+
+/**
+ * struct virtio_blk_priv - private data for a virtio block device
+ *
+ * @vq: Request virtqueue
+ * @slots: Requests which may be in flight
+ * @inflight: Number of busy slots
+ * @max_segs: Maximum number of data segments in a request
+ * @seg_size: Maximum size of a data segment, in bytes (multiple of 512)
+ * @max_sectors: Maximum number of sectors transferred by a request
+ */
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+	struct virtio_blk_slot slots[VIRTIO_BLK_QUEUE_DEPTH];
+	uint inflight;
+	uint max_segs;
+	u32 seg_size;
+	lbaint_t max_sectors;
 };
 
 static const u32 feature[] = {
-	VIRTIO_BLK_F_WRITE_ZEROES
+	VIRTIO_BLK_F_SIZE_MAX,
+	VIRTIO_BLK_F_SEG_MAX,
+	VIRTIO_BLK_F_WRITE_ZEROES,
+	VIRTIO_RING_F_INDIRECT_DESC,
 };
 
 static void virtio_blk_init_header_sg(struct udevice *dev, u64 sector, u32 type,
@@ -53,87 +97,328 @@ static void virtio_blk_init_status_sg(u8 *status, struct virtio_sg *sg)
 	sg->length = sizeof(*status);
 }
 
-static void virtio_blk_init_data_sg(void *buffer, lbaint_t blkcnt, struct virtio_sg *sg)
+/**
+ * virtio_blk_init_data_sgs() - split a data buffer into segments
+ *
+ * @priv: Device private data, giving the segment limits
+ * @buffer: Data buffer
+ * @blkcnt: Number of sectors in the buffer
+ * @sg: Returns the segments, which must have room for priv->max_segs entries
+ * Return: number of segments used
+ */
+static uint virtio_blk_init_data_sgs(struct virtio_blk_priv *priv,
+				     void *buffer, lbaint_t blkcnt,
+				     struct virtio_sg *sg)
+{
+	size_t len = blkcnt * 512;
+	uint n;
+
+	for (n = 0; len; n++) {
+		sg[n].addr = buffer;
+		sg[n].length = min_t(size_t, len, priv->seg_size);
+		buffer += sg[n].length;
+		len -= sg[n].length;
+	}
+
+	return n;
+}
+
+/**
+ * virtio_blk_req_end() - drop a reference to a block request
+ *
+ * Each virtio request in flight holds a reference to its block request, as
+ * does the code issuing them. When the last one is dropped the request
+ * completes.
+ *
+ * @req: Request to update
+ * @result: Number of sectors transferred, or -ve error
+ * Return: true if the request is now complete
+ */
+static bool virtio_blk_req_end(struct blk_req *req, long result)
+{
+	ulong refs = (ulong)req->priv - 1;
+
+	if (result < 0 || req->result < 0)
+		req->result = min(result, req->result);
+	else
+		req->result += result;
+
+	req->priv = (void *)refs;
+	if (refs)
+		return false;
+	blk_req_complete(req, req->result);
+
+	return true;
+}
+
+/**
+ * virtio_blk_req_start() - prepare a block request for issuing
+ *
+ * This takes the issuing reference, dropped by virtio_blk_req_end() once all
+ * virtio requests have been queued.
+ *
+ * @req: Request to prepare
+ */
+static void virtio_blk_req_start(struct blk_req *req)
 {
-	sg->addr = buffer;
-	sg->length = blkcnt * 512;
+	req->result = 0;
+	req->done = false;
+	req->priv = (void *)1UL;
 }
 
-static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
-			       lbaint_t blkcnt, void *buffer, u32 type)
+/**
+ * virtio_blk_queue() - add a virtio request to the queue
+ *
+ * The device is not notified; see virtqueue_kick()
+ *
+ * @dev: Block device
+ * @req: Block request this is part of
+ * @sector: First sector to access
+ * @blkcnt: Number of sectors to access
+ * @buffer: Data buffer, or NULL for VIRTIO_BLK_T_WRITE_ZEROES
+ * @type: Request type (VIRTIO_BLK_T_...)
+ * Return: 0 if OK, -EBUSY if there is no room in the queue, other -ve on error
+ */
+static int virtio_blk_queue(struct udevice *dev, struct blk_req *req,
+			    u64 sector, lbaint_t blkcnt, void *buffer, u32 type)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
-	struct virtio_blk_outhdr out_hdr;
-	struct virtio_blk_discard_write_zeroes wz_hdr;
-	unsigned int num_out = 0, num_in = 0;
-	struct virtio_sg hdr_sg, wz_sg, data_sg, status_sg;
-	struct virtio_sg *sgs[3];
-	u8 status;
+	struct virtio_sg sg[VIRTIO_BLK_MAX_SEGS + 2];
+	struct virtio_sg *sgs[VIRTIO_BLK_MAX_SEGS + 2];
+	unsigned int num_out = 0, num_in = 0, nsegs, i;
+	struct virtio_blk_slot *slot;
 	int ret;
 
-	virtio_blk_init_header_sg(dev, sector, type, &out_hdr, &hdr_sg);
-	sgs[num_out++] = &hdr_sg;
+	for (i = 0; i < VIRTIO_BLK_QUEUE_DEPTH; i++)
+		if (!priv->slots[i].busy)
+			break;
+	if (i == VIRTIO_BLK_QUEUE_DEPTH)
+		return -EBUSY;
+	slot = &priv->slots[i];
+
+	for (i = 0; i < ARRAY_SIZE(sgs); i++)
+		sgs[i] = &sg[i];
+
+	virtio_blk_init_header_sg(dev, sector, type, &slot->out_hdr, &sg[0]);
+	num_out++;
 
 	switch (type) {
 	case VIRTIO_BLK_T_IN:
 	case VIRTIO_BLK_T_OUT:
-		virtio_blk_init_data_sg(buffer, blkcnt, &data_sg);
+		nsegs = virtio_blk_init_data_sgs(priv, buffer, blkcnt, &sg[1]);
 		if (type & VIRTIO_BLK_T_OUT)
-			sgs[num_out++] = &data_sg;
+			num_out += nsegs;
 		else
-			sgs[num_out + num_in++] = &data_sg;
+			num_in += nsegs;
 		break;
 
 	case VIRTIO_BLK_T_WRITE_ZEROES:
-		virtio_blk_init_write_zeroes_sg(dev, sector, blkcnt, &wz_hdr, &wz_sg);
-		sgs[num_out++] = &wz_sg;
+		virtio_blk_init_write_zeroes_sg(dev, sector, blkcnt, &slot->wz,
+						&sg[1]);
+		num_out++;
 		break;
 
 	default:
 		return -EINVAL;
 	}
 
-	virtio_blk_init_status_sg(&status, &status_sg);
-	sgs[num_out + num_in++] = &status_sg;
-	log_debug("dev=%s, active=%d, priv=%p, priv->vq=%p\n", dev->name,
-		  device_active(dev), priv, priv->vq);
+	virtio_blk_init_status_sg(&slot->status, &sg[num_out + num_in]);
+	num_in++;
 
 	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
+	if (ret == -ENOSPC && priv->inflight)
+		return -EBUSY;
 	if (ret)
 		return ret;
 
-	virtqueue_kick(priv->vq);
+	slot->req = req;
+	slot->blkcnt = blkcnt;
+	slot->busy = true;
+	priv->inflight++;
+	req->priv = (void *)((ulong)req->priv + 1);
+
+	return 0;
+}
 
-	log_debug("wait...");
-	while (!virtqueue_get_buf(priv->vq, NULL))
-		;
-	log_debug("done\n");
+/**
+ * virtio_blk_reap() - process completed virtio requests
+ *
+ * This does not wait.
+ *
+ * @dev: Block device
+ * Return: number of block requests completed
+ */
+static int virtio_blk_reap(struct udevice *dev)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_outhdr *out_hdr;
+	struct virtio_blk_slot *slot;
+	int completed = 0;
+
+	while ((out_hdr = virtqueue_get_buf(priv->vq, NULL))) {
+		slot = container_of(out_hdr, struct virtio_blk_slot, out_hdr);
+		if (slot < priv->slots ||
+		    slot >= priv->slots + VIRTIO_BLK_QUEUE_DEPTH ||
+		    !slot->busy) {
+			log_err("%s: unexpected completion %p\n", dev->name,
+				out_hdr);
+			continue;
+		}
+		slot->busy = false;
+		priv->inflight--;
+		if (slot->req &&
+		    virtio_blk_req_end(slot->req,
+				       slot->status == VIRTIO_BLK_S_OK ?
+				       slot->blkcnt : -EIO))
+			completed++;
+	}
 
-	return status == VIRTIO_BLK_S_OK ? blkcnt : -EIO;
+	return completed;
+}
+
+/**
+ * virtio_blk_issue() - queue as many virtio requests as there is room for
+ *
+ * Transfers are split into requests of at most VIRTIO_BLK_MAX_SECTORS, also
+ * limited by the device's segment count and size, then the device is notified
+ * once for all of them.
+ *
+ * @dev: Block device
+ * @req: Block request being carried out
+ * @donep: Number of sectors already queued; updated on exit
+ * Return: 0 if OK, -EBUSY if the queue filled up, other -ve on error
+ */
+static int virtio_blk_issue(struct udevice *dev, struct blk_req *req,
+			    lbaint_t *donep)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	lbaint_t done = *donep;
+	u32 type = req->op == BLK_REQ_WRITE ? VIRTIO_BLK_T_OUT :
+		   VIRTIO_BLK_T_IN;
+	int queued = 0;
+	int ret = 0;
+
+	while (done < req->blkcnt) {
+		lbaint_t count = min(req->blkcnt - done, priv->max_sectors);
+
+		ret = virtio_blk_queue(dev, req, req->start + done, count,
+				       req->buffer + done * 512, type);
+		if (ret)
+			break;
+		done += count;
+		queued++;
+	}
+	if (queued)
+		virtqueue_kick(priv->vq);
+	*donep = done;
+
+	return ret;
+}
+
+static ulong virtio_blk_rw(struct udevice *dev, lbaint_t start,
+			   lbaint_t blkcnt, void *buffer, enum blk_req_op op)
+{
+	struct blk_req req = {
+		.op = op,
+		.start = start,
+		.blkcnt = blkcnt,
+		.buffer = buffer,
+	};
+	lbaint_t done = 0;
+	int ret;
+
+	log_debug("dev=%s, start=" LBAF ", blkcnt=" LBAF "\n", dev->name,
+		  start, blkcnt);
+
+	/* keep the queue full until everything has been issued */
+	virtio_blk_req_start(&req);
+	for (;;) {
+		ret = virtio_blk_issue(dev, &req, &done);
+		if (ret != -EBUSY)
+			break;
+		virtio_blk_reap(dev);
+	}
+	virtio_blk_req_end(&req, ret);
+
+	while (!req.done)
+		virtio_blk_reap(dev);
+
+	return req.result;
 }
 
 static ulong virtio_blk_read(struct udevice *dev, lbaint_t start,
 			     lbaint_t blkcnt, void *buffer)
 {
-	log_debug("read %s\n", dev->name);
-	return virtio_blk_do_req(dev, start, blkcnt, buffer,
-				 VIRTIO_BLK_T_IN);
+	return virtio_blk_rw(dev, start, blkcnt, buffer, BLK_REQ_READ);
 }
 
 static ulong virtio_blk_write(struct udevice *dev, lbaint_t start,
 			      lbaint_t blkcnt, const void *buffer)
 {
-	return virtio_blk_do_req(dev, start, blkcnt, (void *)buffer,
-				 VIRTIO_BLK_T_OUT);
+	return virtio_blk_rw(dev, start, blkcnt, (void *)buffer,
+			     BLK_REQ_WRITE);
 }
 
 static ulong virtio_blk_erase(struct udevice *dev, lbaint_t start,
 			      lbaint_t blkcnt)
 {
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct blk_req req = {
+		.start = start,
+		.blkcnt = blkcnt,
+	};
+	int ret;
+
 	if (!virtio_has_feature(dev, VIRTIO_BLK_F_WRITE_ZEROES))
 		return -EOPNOTSUPP;
 
-	return virtio_blk_do_req(dev, start, blkcnt, NULL, VIRTIO_BLK_T_WRITE_ZEROES);
+	virtio_blk_req_start(&req);
+	do {
+		ret = virtio_blk_queue(dev, &req, start, blkcnt, NULL,
+				       VIRTIO_BLK_T_WRITE_ZEROES);
+		if (ret == -EBUSY)
+			virtio_blk_reap(dev);
+	} while (ret == -EBUSY);
+	if (!ret)
+		virtqueue_kick(priv->vq);
+	virtio_blk_req_end(&req, ret);
+
+	while (!req.done)
+		virtio_blk_reap(dev);
+
+	return req.result;
+}
+
+static int virtio_blk_submit(struct udevice *dev, struct blk_req *req)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	lbaint_t done = 0;
+	int ret;
+
+	/*
+	 * Only start a request if there are enough free slots for it; a
+	 * request too large for the whole queue waits for its own completions
+	 */
+	if (priv->inflight &&
+	    DIV_ROUND_UP(req->blkcnt, priv->max_sectors) >
+	    VIRTIO_BLK_QUEUE_DEPTH - priv->inflight)
+		return -EBUSY;
+
+	virtio_blk_req_start(req);
+	for (;;) {
+		ret = virtio_blk_issue(dev, req, &done);
+		if (ret != -EBUSY)
+			break;
+		virtio_blk_reap(dev);
+	}
+	virtio_blk_req_end(req, ret);
+
+	return 0;
+}
+
+static int virtio_blk_poll(struct udevice *dev)
+{
+	return virtio_blk_reap(dev);
 }
 
 static int virtio_blk_bind(struct udevice *dev)
@@ -175,6 +460,7 @@ static int virtio_blk_probe(struct udevice *dev)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	u32 seg_max, size_max;
 	u64 cap;
 	int ret;
 
@@ -187,6 +473,32 @@ static int virtio_blk_probe(struct udevice *dev)
 	virtio_cread(dev, struct virtio_blk_config, capacity, &cap);
 	desc->lba = cap;
 
+	/*
+	 * Several data segments only fit in a request if each one does not
+	 * use up a ring entry, i.e. with indirect descriptors
+	 */
+	priv->max_segs = 1;
+	if (priv->vq->indirect_desc) {
+		priv->max_segs = VIRTIO_BLK_MAX_SEGS;
+		if (virtio_has_feature(dev, VIRTIO_BLK_F_SEG_MAX)) {
+			virtio_cread(dev, struct virtio_blk_config, seg_max,
+				     &seg_max);
+			priv->max_segs = clamp_t(u32, seg_max, 1,
+						 VIRTIO_BLK_MAX_SEGS);
+		}
+	}
+	priv->seg_size = VIRTIO_BLK_MAX_SECTORS * 512;
+	if (virtio_has_feature(dev, VIRTIO_BLK_F_SIZE_MAX)) {
+		virtio_cread(dev, struct virtio_blk_config, size_max,
+			     &size_max);
+		priv->seg_size = clamp_t(u32, ALIGN_DOWN(size_max, 512), 512,
+					 priv->seg_size);
+	}
+	priv->max_sectors = min_t(lbaint_t, VIRTIO_BLK_MAX_SECTORS,
+				  priv->max_segs * (priv->seg_size / 512));
+	log_debug("%s: max_segs=%u, seg_size=%u\n", dev->name, priv->max_segs,
+		  priv->seg_size);
+
 	return 0;
 }
 
@@ -194,6 +506,8 @@ static const struct blk_ops virtio_blk_ops = {
 	.read	= virtio_blk_read,
 	.write	= virtio_blk_write,
 	.erase	= virtio_blk_erase,
+	.submit	= virtio_blk_submit,
+	.poll	= virtio_blk_poll,
 };
 
 U_BOOT_DRIVER(virtio_blk) = {
@@ -97,12 +97,45 @@ static void virtqueue_detach_desc(struct virtqueue *vq, unsigned int idx)
 	desc->addr = cpu_to_virtio64(vq->vdev, (u64)(uintptr_t)bb->user_buffer);
 }
 
+/*
+ * Write a chain of buffers to the indirect table belonging to the ring entry
+ * @head, then point @sg at the table
+ */
+static void virtqueue_setup_indirect(struct virtqueue *vq, unsigned int head,
+				     struct virtio_sg *sgs[],
+				     unsigned int out_sgs, unsigned int in_sgs,
+				     struct virtio_sg *sg)
+{
+	unsigned int total = out_sgs + in_sgs;
+	struct vring_desc *table;
+	unsigned int n;
+
+	table = &vq->indirect_desc[head * VIRTQUEUE_MAX_INDIRECT];
+	for (n = 0; n < total; n++) {
+		u16 flags = 0;
+
+		if (n >= out_sgs)
+			flags |= VRING_DESC_F_WRITE;
+		if (n + 1 < total)
+			flags |= VRING_DESC_F_NEXT;
+		table[n].addr = cpu_to_virtio64(vq->vdev,
+						(u64)(uintptr_t)sgs[n]->addr);
+		table[n].len = cpu_to_virtio32(vq->vdev, sgs[n]->length);
+		table[n].flags = cpu_to_virtio16(vq->vdev, flags);
+		table[n].next = cpu_to_virtio16(vq->vdev, n + 1);
+	}
+
+	sg->addr = table;
+	sg->length = total * sizeof(struct vring_desc);
+}
+
 int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		  unsigned int out_sgs, unsigned int in_sgs)
 {
 	struct vring_desc *desc;
 	unsigned int descs_used = out_sgs + in_sgs;
 	unsigned int i, n, avail, uninitialized_var(prev);
+	struct virtio_sg indirect_sg, *indirect_sgs[1];
 	int head;
 
 	WARN_ON(descs_used == 0);
@@ -112,6 +145,17 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 	desc = vq->vring.desc;
 	i = head;
 
+	if (vq->indirect_desc && descs_used > 1 &&
+	    descs_used <= VIRTQUEUE_MAX_INDIRECT && vq->num_free) {
+		virtqueue_setup_indirect(vq, head, sgs, out_sgs, in_sgs,
+					 &indirect_sg);
+		indirect_sgs[0] = &indirect_sg;
+		sgs = indirect_sgs;
+		out_sgs = 1;
+		in_sgs = 0;
+		descs_used = 1;
+	}
+
 	if (vq->num_free < descs_used) {
 		debug("Can't add buf len %i - avail = %i\n",
 		      descs_used, vq->num_free);
@@ -130,6 +174,8 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 
 		if (n >= out_sgs)
 			flags |= VRING_DESC_F_WRITE;
+		if (sgs[n] == &indirect_sg)
+			flags |= VRING_DESC_F_INDIRECT;
 		prev = i;
 		i = virtqueue_attach_desc(vq, i, sgs[n], flags);
 	}
@@ -280,6 +326,15 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		virtio_store_mb(&vring_used_event(&vq->vring),
 				cpu_to_virtio16(vq->vdev, vq->last_used_idx));
 
+	/* Bounce buffers are gone now, so give the caller its own buffer */
+	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && vq->vring.bouncebufs)
+		return vq->vring.bouncebufs[i].user_buffer;
+
+	/* Return the first buffer of the chain, as for a direct chain */
+	if (vq->vring_desc_shadow[i].flags & VRING_DESC_F_INDIRECT)
+		return (void *)(uintptr_t)virtio64_to_cpu(vq->vdev,
+			vq->indirect_desc[i * VIRTQUEUE_MAX_INDIRECT].addr);
+
 	return (void *)(uintptr_t)vq->vring_desc_shadow[i].addr;
 }
 
@@ -312,6 +367,21 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->avail_flags_shadow = 0;
 	vq->avail_idx_shadow = 0;
 	vq->num_added = 0;
+
+	/* Indirect tables cannot be used with per-descriptor bounce buffers */
+	vq->indirect_desc = NULL;
+	if (virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
+	    !vring.bouncebufs) {
+		vq->indirect_desc = memalign(VRING_DESC_ALIGN_SIZE,
+					     vring.num * VIRTQUEUE_MAX_INDIRECT *
+					     sizeof(struct vring_desc));
+		if (!vq->indirect_desc) {
+			free(vring_desc_shadow);
+			free(vq);
+			return NULL;
+		}
+	}
+
 	list_add_tail(&vq->list, &uc_priv->vqs);
 
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
@@ -397,6 +467,7 @@ void vring_del_virtqueue(struct virtqueue *vq)
 	virtio_free_pages(vq->vdev, vq->vring.desc,
 			  DIV_ROUND_UP(vq->vring.size, PAGE_SIZE));
 	free(vq->vring_desc_shadow);
+	free(vq->indirect_desc);
 	list_del(&vq->list);
 	free(vq->vring.bouncebufs);
 	free(vq);
@@ -75,6 +75,8 @@ static int env_ext4_save_buffer(env_t *env_new)
 		return 1;
 
 	dev = dev_desc->devnum;
+	/* the driver state is shared with the fs layer's mount */
+	fs_unmount();
 	ext4fs_set_blk_dev(dev_desc, &info);
 
 	if (!ext4fs_mount()) {
@@ -162,6 +164,8 @@ static int env_ext4_load(void)
 		goto err_env_relocate;
 
 	dev = dev_desc->devnum;
+	/* the driver state is shared with the fs layer's mount */
+	fs_unmount();
 	ext4fs_set_blk_dev(dev_desc, &info);
 
 	if (!ext4fs_mount()) {
@@ -1993,6 +1993,250 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	return blknr;
 }
 
+/* Largest number of extents kept for a file */
+#define EXT4_EXTENT_MAP_MAX	4096
+/* Deepest extent tree followed, as in Linux */
+#define EXT4_EXTENT_MAX_DEPTH	5
+/* Extents longer than this are unwritten, i.e. read as zeroes */
+#define EXT4_EXT_INIT_MAX_LEN	32768
+
+/**
+ * struct ext4_extent_run - a run of file blocks stored together
+ *
+ * @lblk: First block within the file
+ * @len: Number of blocks
+ * @pblk: First filesystem block, or 0 if the blocks are unwritten
+ */
+struct ext4_extent_run {
+	u32 lblk;
+	u32 len;
+	u64 pblk;
+};
+
+/**
+ * struct ext4_extent_map - all extents of the most recently read file
+ *
+ * This survives unmounting, so a file can be read again (e.g. 'size'
+ * followed by 'load') without walking its extent tree. It is only used if
+ * the device, filesystem and inode are unchanged.
+ *
+ * @valid: true if the map holds the extents of the file below
+ * @dev_desc: Block device holding the filesystem
+ * @part_offset: Start of the partition holding the filesystem
+ * @uuid: UUID of the filesystem
+ * @ino: Inode number of the file
+ * @inode: Copy of the inode, to detect changes to the file
+ * @runs: Extents of the file, sorted by file block
+ * @count: Number of entries in @runs
+ * @alloced: Number of entries allocated for @runs
+ */
+struct ext4_extent_map {
+	bool valid;
+	struct blk_desc *dev_desc;
+	lbaint_t part_offset;
+	u8 uuid[16];
+	int ino;
+	struct ext2_inode inode;
+	struct ext4_extent_run *runs;
+	uint count;
+	uint alloced;
+};
+
+static struct ext4_extent_map ext4fs_extent_map;
+
+void ext4fs_invalidate_extent_map(void)
+{
+	struct ext4_extent_map *map = &ext4fs_extent_map;
+
+	free(map->runs);
+	memset(map, '\0', sizeof(*map));
+}
+
+static int ext4fs_add_extent(struct ext4_extent_map *map,
+			     struct ext4_extent *ext)
+{
+	struct ext4_extent_run *run;
+	u32 len = le16_to_cpu(ext->ee_len);
+	u64 start;
+
+	if (map->count == map->alloced) {
+		uint alloced = map->alloced ? map->alloced * 2 : 16;
+
+		if (alloced > EXT4_EXTENT_MAP_MAX)
+			return -E2BIG;
+		run = realloc(map->runs, alloced * sizeof(*run));
+		if (!run)
+			return -ENOMEM;
+		map->runs = run;
+		map->alloced = alloced;
+	}
+
+	start = le16_to_cpu(ext->ee_start_hi);
+	start = (start << 32) + le32_to_cpu(ext->ee_start_lo);
+	if (len > EXT4_EXT_INIT_MAX_LEN) {
+		len -= EXT4_EXT_INIT_MAX_LEN;
+		start = 0;
+	}
+
+	run = &map->runs[map->count];
+	run->lblk = le32_to_cpu(ext->ee_block);
+	run->len = len;
+	run->pblk = start;
+
+	/* lookups rely on the extents being in order */
+	if (map->count && run->lblk < run[-1].lblk + run[-1].len)
+		return -EINVAL;
+	map->count++;
+
+	return 0;
+}
+
+/* Add the extents below an extent-tree node to the map, in order */
+static int ext4fs_add_extents(struct ext4_extent_map *map,
+			      struct ext4_extent_header *hdr, int size,
+			      int depth_left)
+{
+	int log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) -
+			 get_fs()->dev_desc->log2blksz;
+	int blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	int entries = le16_to_cpu(hdr->eh_entries);
+	struct ext4_extent_idx *index;
+	unsigned long long block;
+	char *buf;
+	int i, ret = 0;
+
+	if (le16_to_cpu(hdr->eh_magic) != EXT4_EXT_MAGIC || !depth_left ||
+	    sizeof(*hdr) + entries * sizeof(struct ext4_extent) > size)
+		return -EINVAL;
+
+	if (!hdr->eh_depth) {
+		struct ext4_extent *ext = (struct ext4_extent *)(hdr + 1);
+
+		for (i = 0; i < entries && !ret; i++)
+			ret = ext4fs_add_extent(map, &ext[i]);
+
+		return ret;
+	}
+
+	buf = memalign(ARCH_DMA_MINALIGN, blksz);
+	if (!buf)
+		return -ENOMEM;
+
+	index = (struct ext4_extent_idx *)(hdr + 1);
+	for (i = 0; i < entries && !ret; i++) {
+		block = le16_to_cpu(index[i].ei_leaf_hi);
+		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
+		if (!ext4fs_devread((lbaint_t)block << log2_blksz, 0, blksz,
+				    buf))
+			ret = -EIO;
+		else
+			ret = ext4fs_add_extents(map,
+						 (struct ext4_extent_header *)buf,
+						 blksz, depth_left - 1);
+	}
+	free(buf);
+
+	return ret;
+}
+
+/*
+ * Get the extent map for a file, walking the whole extent tree once if it
+ * is not already known. Returns NULL if the file cannot be mapped this way,
+ * e.g. because it has too many extents.
+ */
+static struct ext4_extent_map *ext4fs_get_extent_map(struct ext2fs_node *node)
+{
+	struct ext4_extent_map *map = &ext4fs_extent_map;
+	u8 *uuid = (u8 *)ext4fs_root->sblock.unique_id;
+	int ret;
+
+	if (map->valid && map->dev_desc == get_fs()->dev_desc &&
+	    map->part_offset == part_offset && map->ino == node->ino &&
+	    !memcmp(map->uuid, uuid, sizeof(map->uuid)) &&
+	    !memcmp(&map->inode, &node->inode, sizeof(map->inode)))
+		return map;
+
+	map->valid = false;
+	map->count = 0;
+	ret = ext4fs_add_extents(map, (struct ext4_extent_header *)
+				 node->inode.b.blocks.dir_blocks,
+				 sizeof(node->inode.b.blocks),
+				 EXT4_EXTENT_MAX_DEPTH);
+	if (ret) {
+		log_debug("cannot map inode %d: %d\n", node->ino, ret);
+		return NULL;
+	}
+
+	map->dev_desc = get_fs()->dev_desc;
+	map->part_offset = part_offset;
+	memcpy(map->uuid, uuid, sizeof(map->uuid));
+	map->ino = node->ino;
+	memcpy(&map->inode, &node->inode, sizeof(map->inode));
+	map->valid = true;
+
+	return map;
+}
+
+static long ext4fs_map_lookup(struct ext4_extent_map *map, lbaint_t fileblock,
+			      lbaint_t count, lbaint_t *blknr)
+{
+	struct ext4_extent_run *run;
+	uint lo = 0, hi = map->count;
+	lbaint_t offset;
+
+	/* find the first run which ends after fileblock */
+	while (lo < hi) {
+		uint mid = (lo + hi) / 2;
+
+		run = &map->runs[mid];
+		if ((lbaint_t)run->lblk + run->len <= fileblock)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	*blknr = 0;
+	if (lo == map->count)
+		return count;
+
+	run = &map->runs[lo];
+	if (fileblock < run->lblk)
+		return min_t(lbaint_t, count, run->lblk - fileblock);
+
+	offset = fileblock - run->lblk;
+	if (run->pblk)
+		*blknr = run->pblk + offset;
+
+	return min_t(lbaint_t, count, run->len - offset);
+}
+
+long ext4fs_map_blocks(struct ext2fs_node *node, lbaint_t fileblock,
+		       lbaint_t count, lbaint_t *blknr,
+		       struct ext_block_cache *cache)
+{
+	struct ext4_extent_map *map = NULL;
+	long first, next;
+	long n;
+
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL)
+		map = ext4fs_get_extent_map(node);
+	if (map)
+		return ext4fs_map_lookup(map, fileblock, count, blknr);
+
+	/* look up one block at a time, stopping where the run ends */
+	first = read_allocated_block(&node->inode, fileblock, cache);
+	if (first < 0)
+		return first;
+	for (n = 1; n < count; n++) {
+		next = read_allocated_block(&node->inode, fileblock + n, cache);
+		if (next < 0 || (first ? next != first + n : next != 0))
+			break;
+	}
+	*blknr = first;
+
+	return n;
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
@@ -2313,7 +2557,11 @@ int ext4fs_open(const char *filename, loff_t *len)
 	if (ext4fs_root == NULL)
 		return -1;
 
-	ext4fs_file = NULL;
+	/* the filesystem may stay mounted, so drop any previous file */
+	if (ext4fs_file) {
+		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
+		ext4fs_file = NULL;
+	}
 	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
 				  FILETYPE_REG);
 	if (status == 0)
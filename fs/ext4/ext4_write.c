@@ -700,6 +700,9 @@ void ext4fs_deinit(void)
 	struct ext_filesystem *fs = get_fs();
 	uint32_t new_feature_incompat;
 
+	/* files may have changed */
+	ext4fs_invalidate_extent_map();
+
 	/* free journal */
 	char *temp_buff = zalloc(fs->blksz);
 	if (temp_buff) {
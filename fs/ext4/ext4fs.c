@@ -28,6 +28,7 @@
 #include <malloc.h>
 #include <part.h>
 #include <u-boot/uuid.h>
+#include <linux/sizes.h>
 #include "ext4_common.h"
 
 int ext4fs_symlinknest;
@@ -71,21 +72,14 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		loff_t len, char *buf, loff_t *actread)
 {
 	struct ext_filesystem *fs = get_fs();
-	int i;
-	lbaint_t blockcnt;
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
 	int blocksize = (1 << (log2_fs_blocksize + log2blksz));
 	unsigned int filesize = le32_to_cpu(node->inode.size);
-	lbaint_t previous_block_number = -1;
-	lbaint_t delayed_start = 0;
-	lbaint_t delayed_extent = 0;
-	lbaint_t delayed_skipfirst = 0;
-	lbaint_t delayed_next = 0;
-	char *delayed_buf = NULL;
-	char *start_buf = buf;
-	short status;
+	lbaint_t blockcnt, fileblock, max_run;
 	struct ext_block_cache cache;
+	loff_t done = 0;
+	int ret = 0;
 
 	ext_cache_init(&cache);
 
@@ -100,105 +94,45 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
-	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
-		long int blknr;
-		int blockoff = pos - (blocksize * i);
-		int blockend = blocksize;
-		int skipfirst = 0;
-		blknr = read_allocated_block(&node->inode, i, &cache);
-		if (blknr < 0) {
-			ext_cache_fini(&cache);
-			return -1;
+	/* Keep each device read within the range of an int */
+	max_run = SZ_1G / blocksize;
+
+	/* Read each run of consecutive blocks (or hole) in one go */
+	for (fileblock = lldiv(pos, blocksize); done < len; ) {
+		int skipfirst = pos + done - (loff_t)fileblock * blocksize;
+		lbaint_t blknr;
+		loff_t bytes;
+		long n;
+
+		n = ext4fs_map_blocks(node, fileblock,
+				      min(blockcnt - fileblock, max_run),
+				      &blknr, &cache);
+		if (n <= 0) {
+			ret = -1;
+			break;
 		}
 
-		blknr = blknr << log2_fs_blocksize;
-
-		/* Last block.  */
-		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
+		bytes = ((loff_t)n * blocksize) - skipfirst;
+		if (bytes > len - done)
+			bytes = len - done;
 
-			/* The last portion is exactly blocksize. */
-			if (!blockend)
-				blockend = blocksize;
-		}
-
-		/* First block. */
-		if (i == lldiv(pos, blocksize)) {
-			skipfirst = blockoff;
-			blockend -= skipfirst;
-		}
 		if (blknr) {
-			int status;
-
-			if (previous_block_number != -1) {
-				if (delayed_next == blknr) {
-					delayed_extent += blockend;
-					delayed_next += blockend >> log2blksz;
-				} else {	/* spill */
-					status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-					if (status == 0) {
-						ext_cache_fini(&cache);
-						return -1;
-					}
-					previous_block_number = blknr;
-					delayed_start = blknr;
-					delayed_extent = blockend;
-					delayed_skipfirst = skipfirst;
-					delayed_buf = buf;
-					delayed_next = blknr +
-						(blockend >> log2blksz);
-				}
-			} else {
-				previous_block_number = blknr;
-				delayed_start = blknr;
-				delayed_extent = blockend;
-				delayed_skipfirst = skipfirst;
-				delayed_buf = buf;
-				delayed_next = blknr +
-					(blockend >> log2blksz);
+			if (!ext4fs_devread(blknr << log2_fs_blocksize,
+					    skipfirst, bytes, buf + done)) {
+				ret = -1;
+				break;
 			}
 		} else {
-			int n;
-			int n_left;
-			if (previous_block_number != -1) {
-				/* spill */
-				status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-				if (status == 0) {
-					ext_cache_fini(&cache);
-					return -1;
-				}
-				previous_block_number = -1;
-			}
-			/* Zero no more than `len' bytes. */
-			n = blocksize - skipfirst;
-			n_left = len - ( buf - start_buf );
-			if (n > n_left)
-				n = n_left;
-			memset(buf, 0, n);
-		}
-		buf += blocksize - skipfirst;
-	}
-	if (previous_block_number != -1) {
-		/* spill */
-		status = ext4fs_devread(delayed_start,
-					delayed_skipfirst, delayed_extent,
-					delayed_buf);
-		if (status == 0) {
-			ext_cache_fini(&cache);
-			return -1;
+			memset(buf + done, 0, bytes);
 		}
-		previous_block_number = -1;
+		done += bytes;
+		fileblock += n;
 	}
 
-	*actread  = len;
+	if (!ret)
+		*actread = len;
 	ext_cache_fini(&cache);
-	return 0;
+	return ret;
 }
 
 int ext4fs_opendir(const char *dirname, struct fs_dir_stream **dirsp)
@@ -25,6 +25,7 @@
 #include <linux/compiler.h>
 #include <linux/ctype.h>
 #include <linux/log2.h>
+#include <linux/math64.h>
 
 /* maximum number of clusters for FAT12 */
 #define MAX_FAT12	0xFF4
@@ -161,6 +162,119 @@ int flush_dirty_fat_buffer(fsdata *mydata)
 }
 #endif
 
+static struct fat_cache_stats fat_stats;
+
+/**
+ * fat_cache_init() - allocate the FAT table cache of a filesystem
+ *
+ * @mydata:	filesystem description
+ * Return:	0 on success, -1 if out of memory
+ */
+static int fat_cache_init(fsdata *mydata)
+{
+	int i;
+
+	mydata->fatbuf = NULL;
+	mydata->fatbufnum = -1;
+	mydata->fat_dirty = 0;
+	mydata->fatcacheclock = 0;
+	for (i = 0; i < FATCACHEWINDOWS; i++) {
+		mydata->fatcachenum[i] = -1;
+		mydata->fatcacheage[i] = 0;
+	}
+
+	mydata->fatcache = malloc_cache_aligned(FATBUFSIZE * FATCACHEWINDOWS);
+	if (!mydata->fatcache) {
+		debug("Error: allocating memory\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * fat_cache_free() - free the FAT table cache of a filesystem
+ *
+ * @mydata:	filesystem description
+ */
+static void fat_cache_free(fsdata *mydata)
+{
+	free(mydata->fatcache);
+	mydata->fatcache = NULL;
+	mydata->fatbuf = NULL;
+	mydata->fatbufnum = -1;
+}
+
+/**
+ * fat_cache_get() - make a window of the FAT table the current FAT buffer
+ *
+ * Windows are FATBUFBLOCKS sectors long. The least recently used one is
+ * replaced when the window is not cached yet. Only the current window may be
+ * dirty, so it is written back before switching to another one.
+ *
+ * @mydata:	filesystem description
+ * @bufnum:	index of the window in the FAT table
+ * Return:	0 on success, -1 on error
+ */
+static int fat_cache_get(fsdata *mydata, __u32 bufnum)
+{
+	__u32 startblock = bufnum * FATBUFBLOCKS;
+	__u32 getsize = FATBUFBLOCKS;
+	int i, slot = 0;
+
+	if (bufnum == mydata->fatbufnum) {
+		fat_stats.hits++;
+		return 0;
+	}
+
+	/* Write back the fatbuf to the disk */
+	if (flush_dirty_fat_buffer(mydata) < 0)
+		return -1;
+	mydata->fatbufnum = -1;
+
+	for (i = 0; i < FATCACHEWINDOWS; i++) {
+		if (mydata->fatcachenum[i] == bufnum)
+			break;
+		if (mydata->fatcacheage[i] < mydata->fatcacheage[slot])
+			slot = i;
+	}
+
+	if (i < FATCACHEWINDOWS) {
+		slot = i;
+		fat_stats.hits++;
+	} else {
+		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+		if (startblock + getsize > mydata->fatlength)
+			getsize = mydata->fatlength - startblock;
+
+		/* Offset from start of disk */
+		startblock += mydata->fat_sect;
+
+		mydata->fatcachenum[slot] = -1;
+		if (disk_read(startblock, getsize,
+			      mydata->fatcache + slot * FATBUFSIZE) < 0) {
+			debug("Error reading FAT blocks\n");
+			return -1;
+		}
+		mydata->fatcachenum[slot] = bufnum;
+		fat_stats.misses++;
+	}
+
+	mydata->fatbuf = mydata->fatcache + slot * FATBUFSIZE;
+	mydata->fatbufnum = bufnum;
+	mydata->fatcacheage[slot] = ++mydata->fatcacheclock;
+
+	return 0;
+}
+
+void fat_cache_stats(struct fat_cache_stats *stats)
+{
+	fat_stats.windows = FATCACHEWINDOWS;
+	fat_stats.window_sects = FATBUFBLOCKS;
+	memcpy(stats, &fat_stats, sizeof(*stats));
+	memset(&fat_stats, '\0', sizeof(fat_stats));
+}
+
 /*
  * Get the entry at index 'entry' in a FAT (12/16/32) table.
  * On failure 0x00 is returned.
@@ -199,28 +313,8 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	       mydata->fatsize, entry, entry, offset, offset);
 
 	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		startblock += mydata->fat_sect;	/* Offset from start of disk */
-
-		/* Write back the fatbuf to the disk */
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return ret;
-		}
-		mydata->fatbufnum = bufnum;
-	}
+	if (fat_cache_get(mydata, bufnum) < 0)
+		return ret;
 
 	/* Get the actual entry from the table */
 	switch (mydata->fatsize) {
@@ -308,6 +402,68 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/* Number of cluster runs mapped per walk of the FAT in get_contents() */
+#define FAT_WALK_RUNS	64
+
+/**
+ * struct fat_run - run of consecutive clusters of a file
+ *
+ * @start:	first cluster of the run
+ * @count:	number of clusters in the run
+ */
+struct fat_run {
+	__u32 start;
+	__u32 count;
+};
+
+/**
+ * get_runs() - map clusters of a file to runs of consecutive clusters
+ *
+ * Follow the cluster chain from *@clustp for at most *@nclustp clusters, until
+ * @maxruns runs are found, so that the FAT is walked separately from reading
+ * the file and each run can be read from the disk with a single request.
+ * *@clustp and *@nclustp are updated to continue the walk on the next call.
+ *
+ * @mydata:	file system description
+ * @clustp:	first cluster to map, updated to the next one to map
+ * @nclustp:	number of clusters to map, updated to the number left
+ * @runs:	array to fill with runs
+ * @maxruns:	size of @runs
+ * Return:	number of runs found, -1 on error
+ */
+static int get_runs(fsdata *mydata, __u32 *clustp, __u32 *nclustp,
+		    struct fat_run *runs, int maxruns)
+{
+	__u32 clust = *clustp;
+	int nruns = 0;
+
+	while (*nclustp) {
+		if (CHECK_CLUST(clust, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", clust);
+			printf("Invalid FAT entry\n");
+			return -1;
+		}
+
+		if (nruns && runs[nruns - 1].start +
+			     runs[nruns - 1].count == clust) {
+			runs[nruns - 1].count++;
+		} else if (nruns < maxruns) {
+			runs[nruns].start = clust;
+			runs[nruns].count = 1;
+			nruns++;
+		} else {
+			break;
+		}
+
+		if (!--*nclustp)
+			break;
+		clust = get_fatent(mydata, clust);
+	}
+	*clustp = clust;
+
+	return nruns;
+}
+
 /**
  * get_contents() - read from file
  *
@@ -328,9 +484,11 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
+	struct fat_run runs[FAT_WALK_RUNS];
 	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	__u32 nclust, clust, skip;
 	loff_t actsize;
+	int nruns, i;
 
 	*gotsize = 0;
 	debug("Filesize: %llu bytes\n", filesize);
@@ -345,101 +503,78 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
+	nclust = DIV_ROUND_UP(filesize, bytesperclust);
 
 	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize += bytesperclust;
-	}
-
-	/* actsize > pos */
-	actsize -= bytesperclust;
+	skip = div_u64(pos, bytesperclust);
+	actsize = (loff_t)skip * bytesperclust;
 	filesize -= actsize;
 	pos -= actsize;
 
-	/* align to beginning of next cluster if any */
-	if (pos) {
-		__u8 *tmp_buffer;
-
-		actsize = min(filesize, (loff_t)bytesperclust);
-		tmp_buffer = malloc_cache_aligned(actsize);
-		if (!tmp_buffer) {
-			debug("Error: allocating buffer\n");
-			return -1;
-		}
-
-		if (get_cluster(mydata, curclust, tmp_buffer, actsize) != 0) {
-			printf("Error reading cluster\n");
-			free(tmp_buffer);
+	while (filesize) {
+		nruns = get_runs(mydata, &curclust, &nclust, runs,
+				 FAT_WALK_RUNS);
+		if (nruns <= 0)
 			return -1;
-		}
-		filesize -= actsize;
-		actsize -= pos;
-		memcpy(buffer, tmp_buffer + pos, actsize);
-		free(tmp_buffer);
-		*gotsize += actsize;
-		if (!filesize)
-			return 0;
-		buffer += actsize;
 
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-	}
+		for (i = 0; i < nruns && filesize; i++) {
+			if (skip >= runs[i].count) {
+				skip -= runs[i].count;
+				continue;
+			}
+			clust = runs[i].start + skip;
+			actsize = (loff_t)(runs[i].count - skip) *
+				  bytesperclust;
+			skip = 0;
+
+			/* align to beginning of next cluster if any */
+			if (pos) {
+				__u8 *tmp_buffer;
+				loff_t len = min(filesize,
+						 (loff_t)bytesperclust);
+
+				tmp_buffer = malloc_cache_aligned(len);
+				if (!tmp_buffer) {
+					debug("Error: allocating buffer\n");
+					return -1;
+				}
+
+				if (get_cluster(mydata, clust, tmp_buffer,
+						len) != 0) {
+					printf("Error reading cluster\n");
+					free(tmp_buffer);
+					return -1;
+				}
+				memcpy(buffer, tmp_buffer + pos, len - pos);
+				free(tmp_buffer);
+				fat_stats.runs++;
+				fat_stats.clusters++;
+				*gotsize += len - pos;
+				buffer += len - pos;
+				filesize -= len;
+				actsize -= bytesperclust;
+				clust++;
+				pos = 0;
+			}
 
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				printf("Invalid FAT entry\n");
+			/* read the rest of the run at once */
+			actsize = min(actsize, filesize);
+			if (actsize <= 0)
+				continue;
+			if (get_cluster(mydata, clust, buffer, actsize) != 0) {
+				printf("Error reading cluster\n");
 				return -1;
 			}
-			endclust = newclust;
-			actsize += bytesperclust;
+			fat_stats.runs++;
+			fat_stats.clusters += DIV_ROUND_UP(actsize,
+							   bytesperclust);
+			*gotsize += actsize;
+			filesize -= actsize;
+			buffer += actsize;
 		}
+	}
 
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
-		filesize -= actsize;
-		buffer += actsize;
-
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return 0;
 }
 
 /*
@@ -683,13 +818,8 @@ static int get_fs_info(fsdata *mydata)
 		mydata->root_cluster = 0;
 	}
 
-	mydata->fatbufnum = -1;
-	mydata->fat_dirty = 0;
-	mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
-	if (mydata->fatbuf == NULL) {
-		debug("Error: allocating memory\n");
+	if (fat_cache_init(mydata))
 		return -1;
-	}
 
 	debug("FAT%d, fat_sect: %d, fatlength: %d\n",
 	       mydata->fatsize, mydata->fat_sect, mydata->fatlength);
@@ -1237,7 +1367,7 @@ int fat_exists(const char *filename)
 		goto out;
 
 	ret = fat_itr_resolve(itr, filename, TYPE_ANY);
-	free(fsdata.fatbuf);
+	fat_cache_free(&fsdata);
 out:
 	free(itr);
 	return ret == 0;
@@ -1284,7 +1414,7 @@ int fat_size(const char *filename, loff_t *size)
 		 * Directories don't have size, but fs_size() is not
 		 * expected to fail if passed a directory path:
 		 */
-		free(fsdata.fatbuf);
+		fat_cache_free(&fsdata);
 		ret = fat_itr_root(itr, &fsdata);
 		if (ret)
 			goto out_free_itr;
@@ -1296,7 +1426,7 @@ int fat_size(const char *filename, loff_t *size)
 
 	*size = FAT2CPU32(itr->dent->size);
 out_free_both:
-	free(fsdata.fatbuf);
+	fat_cache_free(&fsdata);
 out_free_itr:
 	free(itr);
 	return ret;
@@ -1328,7 +1458,7 @@ int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 	ret = get_contents(&fsdata, dentptr, offset, buf, len, actread);
 
 out_free_both:
-	free(fsdata.fatbuf);
+	fat_cache_free(&fsdata);
 out_free_itr:
 	free(itr);
 	return ret;
@@ -1375,7 +1505,7 @@ int fat_opendir(const char *filename, struct fs_dir_stream **dirsp)
 	return 0;
 
 fail_free_both:
-	free(dir->fsdata.fatbuf);
+	fat_cache_free(&dir->fsdata);
 fail_free_dir:
 	free(dir);
 	return ret;
@@ -1415,7 +1545,7 @@ int fat_readdir(struct fs_dir_stream *dirs, struct fs_dirent **dentp)
 void fat_closedir(struct fs_dir_stream *dirs)
 {
 	fat_dir *dir = (fat_dir *)dirs;
-	free(dir->fsdata.fatbuf);
+	fat_cache_free(&dir->fsdata);
 	free(dir);
 }
 
@@ -462,27 +462,8 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 	}
 
 	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		startblock += mydata->fat_sect;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return -1;
-		}
-		mydata->fatbufnum = bufnum;
-	}
+	if (fat_cache_get(mydata, bufnum) < 0)
+		return -1;
 
 	/* Mark as dirty */
 	mydata->fat_dirty = 1;
@@ -1354,7 +1335,7 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 		      loff_t size, loff_t *actwrite)
 {
 	dir_entry *retdent;
-	fsdata datablock = { .fatbuf = NULL, };
+	fsdata datablock = { .fatcache = NULL, };
 	fsdata *mydata = &datablock;
 	fat_itr *itr = NULL;
 	int ret = -1;
@@ -1474,7 +1455,7 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 
 exit:
 	free(filename_copy);
-	free(mydata->fatbuf);
+	fat_cache_free(mydata);
 	free(itr);
 	return ret;
 }
@@ -1488,8 +1469,7 @@ int file_fat_write(const char *filename, void *buffer, loff_t offset,
 static int fat_dir_entries(fat_itr *itr)
 {
 	fat_itr *dirs;
-	fsdata fsdata = { .fatbuf = NULL, }, *mydata = &fsdata;
-						/* for FATBUFSIZE */
+	fsdata fsdata = { .fatcache = NULL, };
 	int count;
 
 	dirs = malloc_cache_aligned(sizeof(fat_itr));
@@ -1503,21 +1483,18 @@ static int fat_dir_entries(fat_itr *itr)
 	fat_itr_child(dirs, itr);
 	fsdata = *dirs->fsdata;
 
-	/* allocate local fat buffer */
-	fsdata.fatbuf = malloc_cache_aligned(FATBUFSIZE);
-	if (!fsdata.fatbuf) {
-		debug("Error: allocating memory\n");
+	/* allocate local fat cache */
+	if (fat_cache_init(&fsdata)) {
 		count = -ENOMEM;
 		goto exit;
 	}
-	fsdata.fatbufnum = -1;
 	dirs->fsdata = &fsdata;
 
 	for (count = 0; fat_itr_next(dirs); count++)
 		;
 
 exit:
-	free(fsdata.fatbuf);
+	fat_cache_free(&fsdata);
 	free(dirs);
 	return count;
 }
@@ -1608,7 +1585,7 @@ static int delete_dentry_long(fat_itr *itr)
 
 int fat_unlink(const char *filename)
 {
-	fsdata fsdata = { .fatbuf = NULL, };
+	fsdata fsdata = { .fatcache = NULL, };
 	fat_itr *itr = NULL;
 	int n_entries, ret;
 	char *filename_copy, *dirname, *basename;
@@ -1664,7 +1641,7 @@ int fat_unlink(const char *filename)
 	ret = delete_dentry_long(itr);
 
 exit:
-	free(fsdata.fatbuf);
+	fat_cache_free(&fsdata);
 	free(itr);
 	free(filename_copy);
 
@@ -1674,7 +1651,7 @@ exit:
 int fat_mkdir(const char *dirname)
 {
 	dir_entry *retdent;
-	fsdata datablock = { .fatbuf = NULL, };
+	fsdata datablock = { .fatcache = NULL, };
 	fsdata *mydata = &datablock;
 	fat_itr *itr = NULL;
 	char *dirname_copy, *parent, *basename;
@@ -1808,7 +1785,7 @@ int fat_mkdir(const char *dirname)
 
 exit:
 	free(dirname_copy);
-	free(mydata->fatbuf);
+	fat_cache_free(mydata);
 	free(itr);
 	free(dotdent);
 	return ret;
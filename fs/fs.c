@@ -395,6 +395,122 @@ static struct fstype_info *fs_get_info(int fstype)
 	return info;
 }
 
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/*
+ * The filesystem drivers keep their mount state in globals, so only one
+ * filesystem can be mounted at a time. Rather than closing it at the end of
+ * each operation, it is kept here until another filesystem is selected or
+ * the block device is written, re-initialised or removed.
+ */
+static struct {
+	struct blk_desc *desc;
+	int part;
+	int hwpart;
+	struct disk_partition info;
+	int fstype;
+	bool stale;
+} fs_mount = {
+	.fstype = FS_TYPE_ANY,
+};
+
+/**
+ * fs_mount_reuse() - Select the mounted filesystem if it matches
+ *
+ * @part: Partition number which was resolved into fs_partition
+ * @fstype: Requested filesystem type (FS_TYPE_...), or FS_TYPE_ANY
+ * Return: true if the mounted filesystem was selected
+ */
+static bool fs_mount_reuse(int part, int fstype)
+{
+	if (fs_mount.fstype == FS_TYPE_ANY || fs_mount.stale ||
+	    fs_mount.desc != fs_dev_desc || fs_mount.part != part ||
+	    fs_mount.hwpart != fs_dev_desc->hwpart ||
+	    fs_mount.info.start != fs_partition.start ||
+	    fs_mount.info.size != fs_partition.size)
+		return false;
+	if (fstype != FS_TYPE_ANY && fstype != fs_mount.fstype)
+		return false;
+
+	fs_type = fs_mount.fstype;
+	fs_dev_part = part;
+
+	return true;
+}
+
+/**
+ * fs_mount_set() - Remember the filesystem which has just been probed
+ *
+ * Filesystems which are not on a block device are not kept mounted.
+ */
+static void fs_mount_set(void)
+{
+	if (!fs_dev_desc)
+		return;
+
+	fs_mount.desc = fs_dev_desc;
+	fs_mount.part = fs_dev_part;
+	fs_mount.hwpart = fs_dev_desc->hwpart;
+	fs_mount.info = fs_partition;
+	fs_mount.fstype = fs_type;
+	fs_mount.stale = false;
+}
+
+static bool fs_mount_active(void)
+{
+	return fs_mount.fstype != FS_TYPE_ANY && fs_type == fs_mount.fstype &&
+	       fs_dev_desc == fs_mount.desc;
+}
+
+/* Finish an operation on the mounted filesystem */
+static void fs_mount_put(void)
+{
+	if (fs_mount.stale)
+		fs_unmount();
+}
+
+void fs_unmount(void)
+{
+	int fstype = fs_mount.fstype;
+
+	if (fstype == FS_TYPE_ANY)
+		return;
+
+	fs_mount.fstype = FS_TYPE_ANY;
+	fs_mount.desc = NULL;
+	fs_get_info(fstype)->close();
+}
+
+void fs_blk_invalidate(struct blk_desc *desc)
+{
+	if (fs_mount.fstype == FS_TYPE_ANY || fs_mount.desc != desc)
+		return;
+
+	/* the filesystem is in use, so unmount it when the operation ends */
+	if (fs_mount_active())
+		fs_mount.stale = true;
+	else
+		fs_unmount();
+}
+#else
+static inline bool fs_mount_reuse(int part, int fstype)
+{
+	return false;
+}
+
+static inline void fs_mount_set(void)
+{
+}
+
+static inline bool fs_mount_active(void)
+{
+	return false;
+}
+
+static inline void fs_mount_put(void)
+{
+}
+#endif
+
 /**
  * fs_get_type() - Get type of current filesystem
  *
@@ -431,6 +547,10 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	if (part < 0)
 		return -1;
 
+	if (fs_dev_desc && fs_mount_reuse(part, fstype))
+		return 0;
+	fs_unmount();
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
 				fstype != info->fstype)
@@ -442,6 +562,7 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
+			fs_mount_set();
 			return 0;
 		}
 	}
@@ -463,10 +584,15 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 		return ret;
 	fs_dev_desc = desc;
 
+	if (fs_mount_reuse(part, FS_TYPE_ANY))
+		return 0;
+	fs_unmount();
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
+			fs_mount_set();
 			return 0;
 		}
 	}
@@ -478,7 +604,10 @@ void fs_close(void)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	info->close();
+	if (fs_mount_active())
+		fs_mount_put();
+	else
+		info->close();
 
 	fs_type = FS_TYPE_ANY;
 }
@@ -14,6 +14,7 @@
 #include <linux/types.h>
 #include <asm/byteorder.h>
 #include <linux/compat.h>
+#include <linux/list.h>
 #include <memalign.h>
 #include <stdlib.h>
 #include <string.h>
@@ -98,6 +99,133 @@ static int sqfs_calc_n_blks(__le64 start, __le64 end, u64 *offset)
 	return DIV_ROUND_UP(table_size + *offset, ctxt.cur_dev->blksz);
 }
 
+/**
+ * struct sqfs_cache_block - block of a SquashFS filesystem kept in the cache
+ *
+ * @list:	entry in the cache, most recently used first
+ * @start:	position of the block on the disk, in bytes
+ * @size:	size of the allocated @data
+ * @len:	length of the valid data
+ * @data:	contents of the block, decompressed if needed
+ */
+struct sqfs_cache_block {
+	struct list_head list;
+	u64 start;
+	size_t size;
+	size_t len;
+	unsigned char data[];
+};
+
+/*
+ * The decompressed tables and blocks of the last filesystem probed are kept
+ * over sqfs_close(), up to CONFIG_FS_SQUASHFS_CACHE_SIZE bytes, so that later
+ * lookups and small-file reads need neither disk reads nor decompression. The
+ * filesystem is recognised by its device, partition and super block.
+ */
+static struct {
+	struct blk_desc *dev;
+	lbaint_t part_start;
+	struct squashfs_super_block sblk;
+	struct squashfs_tables *tables;
+	struct list_head blocks;
+	size_t size;
+} cache = {
+	.blocks = LIST_HEAD_INIT(cache.blocks),
+};
+
+static void sqfs_put_tables(struct squashfs_tables *tables)
+{
+	if (!tables || --tables->refcnt)
+		return;
+
+	free(tables->inode_table);
+	free(tables->dir_table);
+	free(tables->pos_list);
+	free(tables);
+}
+
+static void sqfs_cache_drop(struct sqfs_cache_block *blk)
+{
+	list_del(&blk->list);
+	cache.size -= blk->size;
+	free(blk);
+}
+
+static void sqfs_cache_invalidate(void)
+{
+	struct sqfs_cache_block *blk, *n;
+
+	list_for_each_entry_safe(blk, n, &cache.blocks, list)
+		sqfs_cache_drop(blk);
+
+	if (cache.tables) {
+		cache.size -= cache.tables->size;
+		sqfs_put_tables(cache.tables);
+		cache.tables = NULL;
+	}
+	cache.dev = NULL;
+}
+
+/*
+ * Drops the least recently used blocks until 'size' more bytes fit in the
+ * cache. Returns false if they cannot fit.
+ */
+static bool sqfs_cache_reserve(size_t size)
+{
+	struct sqfs_cache_block *blk;
+
+	if (size > CONFIG_FS_SQUASHFS_CACHE_SIZE)
+		return false;
+
+	while (cache.size + size > CONFIG_FS_SQUASHFS_CACHE_SIZE &&
+	       !list_empty(&cache.blocks)) {
+		blk = list_last_entry(&cache.blocks, struct sqfs_cache_block,
+				      list);
+		sqfs_cache_drop(blk);
+	}
+
+	return cache.size + size <= CONFIG_FS_SQUASHFS_CACHE_SIZE;
+}
+
+static struct sqfs_cache_block *sqfs_cache_find(u64 start)
+{
+	struct sqfs_cache_block *blk;
+
+	list_for_each_entry(blk, &cache.blocks, list) {
+		if (blk->start == start) {
+			list_move(&blk->list, &cache.blocks);
+			return blk;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Adds a block of 'size' bytes to the cache, to be filled by the caller, or
+ * dropped with sqfs_cache_drop() if that fails. Returns NULL if the block
+ * cannot be cached.
+ */
+static struct sqfs_cache_block *sqfs_cache_new(u64 start, size_t size)
+{
+	struct sqfs_cache_block *blk;
+
+	if (!sqfs_cache_reserve(size))
+		return NULL;
+
+	blk = malloc(sizeof(*blk) + size);
+	if (!blk)
+		return NULL;
+
+	blk->start = start;
+	blk->size = size;
+	blk->len = size;
+	list_add(&blk->list, &cache.blocks);
+	cache.size += size;
+
+	return blk;
+}
+
 /*
  * Retrieves fragment block entry and returns true if the fragment block is
  * compressed
@@ -109,18 +237,28 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	unsigned char *metadata_buffer, *metadata, *table;
 	struct squashfs_fragment_block_entry *entries;
 	struct squashfs_super_block *sblk = ctxt.sblk;
+	struct sqfs_cache_block *index, *blk;
 	unsigned long dest_len;
 	int block, offset, ret;
+	u32 index_len;
 	u16 header;
 
 	metadata_buffer = NULL;
 	entries = NULL;
 	table = NULL;
+	blk = NULL;
 
 	if (inode_fragment_index >= get_unaligned_le32(&sblk->fragments))
 		return -EINVAL;
 
+	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
+	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
+
 	start = get_unaligned_le64(&sblk->fragment_table_start);
+	index = sqfs_cache_find(start);
+	if (index)
+		goto index_found;
+
 	end = get_unaligned_le64(&sblk->id_table_start);
 	exp_tbl = get_unaligned_le64(&sblk->export_table_start);
 
@@ -144,15 +282,33 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 		goto out;
 	}
 
-	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
-	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
+	/* Keep the part of the index table which is in use */
+	index_len = DIV_ROUND_UP(get_unaligned_le32(&sblk->fragments),
+				 SQFS_MAX_ENTRIES) * sizeof(u64);
+	if (index_len <= n_blks * ctxt.cur_dev->blksz - table_offset) {
+		index = sqfs_cache_new(get_unaligned_le64(&sblk->fragment_table_start),
+				       index_len);
+		if (index)
+			memcpy(index->data, table + table_offset, index_len);
+	}
 
+index_found:
 	/*
 	 * Get the start offset of the metadata block that contains the right
 	 * fragment block entry
 	 */
-	start_block = get_unaligned_le64(table + table_offset + block *
-					 sizeof(u64));
+	if (index)
+		start_block = get_unaligned_le64(index->data +
+						 block * sizeof(u64));
+	else
+		start_block = get_unaligned_le64(table + table_offset + block *
+						 sizeof(u64));
+
+	blk = sqfs_cache_find(start_block);
+	if (blk) {
+		entries = (void *)blk->data;
+		goto found;
+	}
 
 	start = start_block / ctxt.cur_dev->blksz;
 	n_blks = sqfs_calc_n_blks(cpu_to_le64(start_block),
@@ -178,7 +334,11 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 		goto out;
 	}
 
-	entries = malloc(SQFS_METADATA_BLOCK_SIZE);
+	blk = sqfs_cache_new(start_block, SQFS_METADATA_BLOCK_SIZE);
+	if (blk)
+		entries = (void *)blk->data;
+	else
+		entries = malloc(SQFS_METADATA_BLOCK_SIZE);
 	if (!entries) {
 		ret = -ENOMEM;
 		goto out;
@@ -197,11 +357,18 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 		memcpy(entries, metadata, SQFS_METADATA_SIZE(header));
 	}
 
+found:
 	*e = entries[offset];
 	ret = SQFS_COMPRESSED_BLOCK(e->size);
 
 out:
-	free(entries);
+	if (blk) {
+		/* drop the block if it could not be filled */
+		if (ret < 0)
+			sqfs_cache_drop(blk);
+	} else {
+		free(entries);
+	}
 	free(metadata_buffer);
 	free(table);
 
@@ -791,6 +958,8 @@ static int sqfs_read_inode_table(unsigned char **inode_table)
 		src_table += src_len + SQFS_HEADER_SIZE;
 	}
 
+	ret = metablks_count;
+
 free_itb:
 	free(itb);
 
@@ -897,13 +1066,56 @@ out:
 	return metablks_count;
 }
 
+/*
+ * Returns the decompressed inode and directory tables, from the cache if they
+ * are there, with a reference to be released by sqfs_put_tables(). Returns
+ * NULL on error.
+ */
+static struct squashfs_tables *sqfs_get_tables(void)
+{
+	struct squashfs_tables *tables;
+	int inode_blks;
+
+	if (cache.tables) {
+		cache.tables->refcnt++;
+		return cache.tables;
+	}
+
+	tables = calloc(1, sizeof(*tables));
+	if (!tables)
+		return NULL;
+	tables->refcnt = 1;
+
+	inode_blks = sqfs_read_inode_table(&tables->inode_table);
+	if (inode_blks < 1)
+		goto err;
+
+	tables->metablks_count = sqfs_read_directory_table(&tables->dir_table,
+							   &tables->pos_list);
+	if (tables->metablks_count < 1)
+		goto err;
+
+	tables->size = (inode_blks + tables->metablks_count) *
+		       SQFS_METADATA_BLOCK_SIZE;
+	if (sqfs_cache_reserve(tables->size)) {
+		tables->refcnt++;
+		cache.tables = tables;
+		cache.size += tables->size;
+	}
+
+	return tables;
+
+err:
+	sqfs_put_tables(tables);
+	return NULL;
+}
+
 static int sqfs_opendir_nest(const char *filename, struct fs_dir_stream **dirsp)
 {
-	unsigned char *inode_table = NULL, *dir_table = NULL;
-	int j, token_count = 0, ret = 0, metablks_count;
+	int j, token_count = 0, ret = 0;
 	struct squashfs_dir_stream *dirs;
 	char **token_list = NULL, *path = NULL;
-	u32 *pos_list = NULL;
+	struct squashfs_tables *tables;
 
 	dirs = calloc(1, sizeof(*dirs));
 	if (!dirs)
@@ -916,17 +1128,12 @@ static int sqfs_opendir_nest(const char *filename, struct fs_dir_stream **dirsp)
 	dirs->inode_table = NULL;
 	dirs->dir_table = NULL;
 
-	ret = sqfs_read_inode_table(&inode_table);
-	if (ret) {
-		ret = -EINVAL;
-		goto out;
-	}
-
-	metablks_count = sqfs_read_directory_table(&dir_table, &pos_list);
-	if (metablks_count < 1) {
+	tables = sqfs_get_tables();
+	if (!tables) {
 		ret = -EINVAL;
 		goto out;
 	}
+	dirs->tables = tables;
 
 	/* Tokenize filename */
 	token_count = sqfs_count_tokens(filename);
@@ -955,10 +1162,10 @@ static int sqfs_opendir_nest(const char *filename, struct fs_dir_stream **dirsp)
 	 * ldir's (extended directory) size is greater than dir, so it works as
 	 * a general solution for the malloc size, since 'i' is a union.
 	 */
-	dirs->inode_table = inode_table;
-	dirs->dir_table = dir_table;
-	ret = sqfs_search_dir(dirs, token_list, token_count, pos_list,
-			      metablks_count);
+	dirs->inode_table = tables->inode_table;
+	dirs->dir_table = tables->dir_table;
+	ret = sqfs_search_dir(dirs, token_list, token_count, tables->pos_list,
+			      tables->metablks_count);
 	if (ret)
 		goto out;
 
@@ -982,12 +1189,9 @@ out:
 	for (j = 0; j < token_count; j++)
 		free(token_list[j]);
 	free(token_list);
-	free(pos_list);
 	free(path);
-	if (ret) {
-		free(inode_table);
-		free(dirs);
-	}
+	if (ret)
+		sqfs_closedir((struct fs_dir_stream *)dirs);
 
 	return ret;
 }
@@ -1142,6 +1346,16 @@ int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition
 
 	ctxt.sblk = sblk;
 
+	/* Keep the cache if this is the filesystem it was filled from */
+	if (cache.dev != fs_dev_desc ||
+	    cache.part_start != fs_partition->start ||
+	    memcmp(&cache.sblk, sblk, sizeof(*sblk))) {
+		sqfs_cache_invalidate();
+		cache.dev = fs_dev_desc;
+		cache.part_start = fs_partition->start;
+		memcpy(&cache.sblk, sblk, sizeof(*sblk));
+	}
+
 	ret = sqfs_decompressor_init(&ctxt);
 	if (ret) {
 		goto error;
@@ -1350,11 +1564,88 @@ static int sqfs_get_lregfile_info(struct squashfs_lreg_inode *lreg,
 	return datablk_count;
 }
 
+/*
+ * Copies 'len' bytes from 'offset' in the fragment block described by 'entry'
+ * to 'dest', decompressing the block if 'comp' is set. The block is kept in the
+ * cache, since it is shared by many small files.
+ */
+static int sqfs_read_fragment(struct squashfs_fragment_block_entry *entry,
+			      bool comp, u32 offset, void *dest, size_t len)
+{
+	struct squashfs_super_block *sblk = ctxt.sblk;
+	u64 start, n_blks, table_size, table_offset;
+	unsigned char *fragment = NULL, *block = NULL;
+	struct sqfs_cache_block *blk;
+	unsigned long dest_len;
+	int ret;
+
+	blk = sqfs_cache_find(entry->start);
+	if (blk) {
+		dest_len = blk->len;
+		block = blk->data;
+		goto copy;
+	}
+
+	start = lldiv(entry->start, ctxt.cur_dev->blksz);
+	table_size = SQFS_BLOCK_SIZE(entry->size);
+	table_offset = entry->start - (start * ctxt.cur_dev->blksz);
+	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
+
+	fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
+	if (!fragment)
+		return -ENOMEM;
+
+	ret = sqfs_disk_read(start, n_blks, fragment);
+	if (ret < 0)
+		goto out;
+
+	dest_len = comp ? get_unaligned_le32(&sblk->block_size) : table_size;
+	blk = sqfs_cache_new(entry->start, dest_len);
+	block = blk ? blk->data : malloc(dest_len);
+	if (!block) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (comp) {
+		ret = sqfs_decompress(&ctxt, block, &dest_len,
+				      fragment + table_offset, entry->size);
+		if (ret)
+			goto out;
+	} else {
+		memcpy(block, fragment + table_offset, table_size);
+	}
+
+	if (blk)
+		blk->len = dest_len;
+	free(fragment);
+	fragment = NULL;
+
+copy:
+	if (offset + len > dest_len) {
+		ret = -EINVAL;
+		goto out;
+	}
+	memcpy(dest, block + offset, len);
+	ret = 0;
+
+out:
+	if (blk) {
+		if (ret)
+			sqfs_cache_drop(blk);
+	} else {
+		free(block);
+	}
+	free(fragment);
+
+	return ret;
+}
+
 static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 			  loff_t len, loff_t *actread)
 {
-	char *dir = NULL, *fragment_block, *datablock = NULL;
-	char *fragment = NULL, *file = NULL, *resolved, *data;
+	char *dir = NULL, *datablock = NULL;
+	char *file = NULL, *resolved, *data;
 	u64 start, n_blks, table_size, data_offset, table_offset, sparse_size;
 	int ret, j, i_number, datablk_count = 0;
 	struct squashfs_super_block *sblk = ctxt.sblk;
@@ -1568,53 +1859,14 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 		goto out;
 	}
 
-	start = lldiv(frag_entry.start, ctxt.cur_dev->blksz);
-	table_size = SQFS_BLOCK_SIZE(frag_entry.size);
-	table_offset = frag_entry.start - (start * ctxt.cur_dev->blksz);
-	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
-
-	fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-
-	if (!fragment) {
-		ret = -ENOMEM;
-		goto out;
-	}
-
-	ret = sqfs_disk_read(start, n_blks, fragment);
-	if (ret < 0)
+	ret = sqfs_read_fragment(&frag_entry, finfo.comp, finfo.offset,
+				 buf + *actread, finfo.size - *actread);
+	if (ret)
 		goto out;
 
-	/* File compressed and fragmented */
-	if (finfo.frag && finfo.comp) {
-		dest_len = get_unaligned_le32(&sblk->block_size);
-		fragment_block = malloc(dest_len);
-		if (!fragment_block) {
-			ret = -ENOMEM;
-			goto out;
-		}
-
-		ret = sqfs_decompress(&ctxt, fragment_block, &dest_len,
-				      (void *)fragment  + table_offset,
-				      frag_entry.size);
-		if (ret) {
-			free(fragment_block);
-			goto out;
-		}
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
-
-		free(fragment_block);
-
-	} else if (finfo.frag && !finfo.comp) {
-		fragment_block = (void *)fragment + table_offset;
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
-	}
+	*actread = finfo.size;
 
 out:
-	free(fragment);
 	free(datablock);
 	free(file);
 	free(dir);
@@ -1793,8 +2045,7 @@ void sqfs_closedir(struct fs_dir_stream *dirs)
 		return;
 
 	sqfs_dirs = (struct squashfs_dir_stream *)dirs;
-	free(sqfs_dirs->inode_table);
-	free(sqfs_dirs->dir_table);
+	sqfs_put_tables(sqfs_dirs->tables);
 	free(sqfs_dirs->dir_header);
 	free(sqfs_dirs);
 }
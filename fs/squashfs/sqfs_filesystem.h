@@ -80,6 +80,22 @@ struct squashfs_ctxt {
 #endif
 };
 
+/*
+ * Decompressed inode and directory tables, shared between the cache and the
+ * directory streams using them. They are freed when the last reference is
+ * released.
+ */
+struct squashfs_tables {
+	int refcnt;
+	/* Memory used by the tables, in bytes */
+	size_t size;
+	unsigned char *inode_table;
+	unsigned char *dir_table;
+	/* Positions of the directory table metadata blocks */
+	u32 *pos_list;
+	int metablks_count;
+};
+
 struct squashfs_directory_index {
 	u32 index;
 	u32 start;
@@ -272,8 +288,9 @@ struct squashfs_dir_stream {
 	struct squashfs_ldir_inode i_ldir;
 	/*
 	 * References to the tables' beginnings. They are assigned in
-	 * sqfs_opendir() and freed in sqfs_closedir().
+	 * sqfs_opendir() and released in sqfs_closedir().
 	 */
+	struct squashfs_tables *tables;
 	unsigned char *inode_table;
 	unsigned char *dir_table;
 };
@@ -111,6 +111,10 @@ struct blk_desc {
 /**
  * blkcache_read() - attempt to read a set of blocks from cache
  *
+ * Blocks are returned from the start of the range for as long as they are
+ * present in the cache. The caller must read any remaining blocks from the
+ * device.
+ *
  * @param iftype - uclass_id_x for type of device
  * @param dev - device index of particular type
  * @param start - starting block number
@@ -118,7 +122,7 @@ struct blk_desc {
  * @param blksz - size in bytes of each block
  * @param buffer - buffer to contain cached data
  *
- * Return: - 1 if block returned from cache, 0 otherwise.
+ * Return: number of leading blocks returned from cache, 0 if none
  */
 int blkcache_read(int iftype, int dev,
 		  lbaint_t start, lbaint_t blkcnt,
@@ -152,20 +156,26 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * The cache is invalidated if the configuration changes.
+ *
+ * @param page_blocks - blocks per cache page, a power of two up to 64
+ * @param max_size - maximum memory used for cached data, in bytes
+ * Return: 0 if OK, -EINVAL if @page_blocks is not valid
  */
-void blkcache_configure(unsigned blocks, unsigned entries);
+int blkcache_configure(uint page_blocks, ulong max_size);
 
 /*
  * statistics of the block cache
  */
 struct block_cache_stats {
 	unsigned hits;
+	unsigned partial_hits;	/* reads only partly satisfied by the cache */
 	unsigned misses;
-	unsigned entries; /* current entry count */
-	unsigned max_blocks_per_entry;
-	unsigned max_entries;
+	unsigned evictions;	/* pages dropped to stay within max_size */
+	unsigned entries;	/* current page count */
+	ulong size;		/* current memory used for cached data */
+	unsigned page_blocks;
+	ulong max_size;
 };
 
 /**
@@ -199,6 +209,55 @@ static inline void blkcache_free(void) {}
 
 struct udevice;
 
+/**
+ * enum blk_req_op - operation carried out by a queued block request
+ *
+ * @BLK_REQ_READ: Read blocks from the device into the buffer
+ * @BLK_REQ_WRITE: Write blocks from the buffer to the device
+ */
+enum blk_req_op {
+	BLK_REQ_READ,
+	BLK_REQ_WRITE,
+};
+
+/**
+ * struct blk_req - a block request which can be queued with blk_submit()
+ *
+ * The caller fills in @op, @start, @blkcnt and @buffer. The request and its
+ * buffer must remain valid until @done is set.
+ *
+ * @op: Operation to perform
+ * @start: Start block number (0=first)
+ * @blkcnt: Number of blocks to transfer
+ * @buffer: Destination buffer for reads, source buffer for writes
+ * @result: Number of blocks transferred, or -ve error; valid once @done is set
+ * @done: Set to true when the request has completed
+ * @priv: Private data for the driver while the request is in flight
+ */
+struct blk_req {
+	enum blk_req_op op;
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buffer;
+	long result;
+	bool done;
+	void *priv;
+};
+
+/**
+ * blk_req_complete() - mark a request as complete
+ *
+ * This is for use by drivers when a queued request finishes.
+ *
+ * @req: Request which has completed
+ * @result: Number of blocks transferred, or -ve error
+ */
+static inline void blk_req_complete(struct blk_req *req, long result)
+{
+	req->result = result;
+	req->done = true;
+}
+
 /* Operations on block devices */
 struct blk_ops {
 	/**
@@ -258,6 +317,33 @@ struct blk_ops {
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
 
+	/**
+	 * submit() - queue a request without waiting for it to complete
+	 *
+	 * Drivers for devices with a command queue can implement this
+	 * together with poll(), to keep several requests in flight. Drivers
+	 * which do not are used synchronously through read() and write().
+	 *
+	 * @dev:	Block device to use
+	 * @req:	Request to queue
+	 * @return 0 if queued, -EBUSY if the queue is full (poll() must be
+	 * called before trying again), other -ve on error
+	 */
+	int (*submit)(struct udevice *dev, struct blk_req *req);
+
+	/**
+	 * poll() - check for completed requests
+	 *
+	 * This must not wait for requests to complete. Each completed request
+	 * is marked with blk_req_complete(). Requests may complete in any
+	 * order. The driver is responsible for failing requests which time
+	 * out.
+	 *
+	 * @dev:	Block device to check
+	 * @return number of requests completed, or -ve on error
+	 */
+	int (*poll)(struct udevice *dev);
+
 #if IS_ENABLED(CONFIG_BOUNCE_BUFFER)
 	/**
 	 * buffer_aligned() - test memory alignment of block operation buffer
@@ -331,6 +417,53 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
  */
 long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt);
 
+/**
+ * blk_submit() - Queue a request on a block device
+ *
+ * If the driver does not support queued requests, or the device needs a
+ * bounce buffer, the request is carried out immediately and is complete
+ * when this function returns. Reads which are fully satisfied by the block
+ * cache also complete immediately.
+ *
+ * @dev: Device to use
+ * @req: Request to queue, see struct blk_req
+ * Return: 0 if the request was queued or completed, -EBUSY if the device
+ * queue is full (call blk_poll() and try again), other -ve on error
+ */
+int blk_submit(struct udevice *dev, struct blk_req *req);
+
+/**
+ * blk_poll() - Check a block device for completed requests
+ *
+ * This does not wait. Each completed request has its @done flag set.
+ *
+ * @dev: Device to check
+ * Return: number of requests completed, or -ve on error
+ */
+int blk_poll(struct udevice *dev);
+
+/**
+ * blk_wait() - Wait for a queued request to complete
+ *
+ * @dev: Device the request was submitted to
+ * @req: Request to wait for
+ * Return: number of blocks transferred, or -ve on error
+ */
+long blk_wait(struct udevice *dev, struct blk_req *req);
+
+/**
+ * blk_run_reqs() - Carry out a set of requests, keeping the queue full
+ *
+ * The requests are submitted in order, polling for completions whenever the
+ * device queue is full, then all are waited for.
+ *
+ * @dev: Device to use
+ * @reqs: Requests to carry out
+ * @count: Number of requests in @reqs
+ * Return: total number of blocks transferred, or -ve on error
+ */
+long blk_run_reqs(struct udevice *dev, struct blk_req *reqs, int count);
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -529,7 +662,7 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 {
 	ulong blks_read;
 	if (blkcache_read(block_dev->uclass_id, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
+			  start, blkcnt, block_dev->blksz, buffer) == blkcnt)
 		return blkcnt;
 
 	/*
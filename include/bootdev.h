@@ -111,10 +111,13 @@ struct bootdev_hunter {
  *
  * @bootflows: List of available bootflows for this bootdev
  * @piro: Priority of this bootdev
+ * @scan_time_us: Time taken by the last scan of this bootdev in microseconds,
+ *	including hunting for it and reading its media
  */
 struct bootdev_uc_plat {
 	struct list_head bootflow_head;
 	enum bootdev_prio_t prio;
+	ulong scan_time_us;
 };
 
 /** struct bootdev_ops - Operations for the bootdev uclass */
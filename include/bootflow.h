@@ -8,6 +8,7 @@
 #define __bootflow_h
 
 #include <bootdev.h>
+#include <part.h>
 #include <dm/ofnode_decl.h>
 #include <linux/list.h>
 
@@ -221,6 +222,13 @@ enum bootflow_meth_flags_t {
  *	happens before the normal ones)
  * @method_flags: flags controlling which methods should be used for this @dev
  * (enum bootflow_meth_flags_t)
+ * @probe_blk: Block device of the partition in @probe_part, NULL if none yet.
+ *	The results below are shared by all bootmeths scanning that partition
+ * @probe_part: Partition last examined on @probe_blk
+ * @probe_info_ret: Result of part_get_info() for @probe_part
+ * @probe_info: Partition information for @probe_part
+ * @probe_fs_ret: Result of looking for a filesystem on @probe_part, or 1 if
+ *	this has not been done yet
  */
 struct bootflow_iter {
 	int flags;
@@ -242,6 +250,11 @@ struct bootflow_iter {
 	struct udevice **method_order;
 	bool doing_global;
 	int method_flags;
+	struct udevice *probe_blk;
+	int probe_part;
+	int probe_info_ret;
+	struct disk_partition probe_info;
+	int probe_fs_ret;
 };
 
 /**
@@ -188,6 +188,8 @@ enum bootstage_id {
 	BOOTSTAGE_ID_ETH_START,
 	BOOTSTAGE_ID_BOOTP_START,
 	BOOTSTAGE_ID_BOOTP_STOP,
+	BOOTSTAGE_ID_ETH_RACE_START,
+	BOOTSTAGE_ID_ETH_RACE_WON,
 	BOOTSTAGE_ID_BOOTM_START,
 	BOOTSTAGE_ID_BOOTM_HANDOFF,
 	BOOTSTAGE_ID_MAIN_LOOP,
@@ -210,6 +210,32 @@ int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf);
 void ext4fs_set_blk_dev(struct blk_desc *rbdd, struct disk_partition *info);
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache);
+
+/**
+ * ext4fs_map_blocks() - find where a run of file blocks is stored
+ *
+ * For files using extents, the extent tree is walked once and kept for
+ * later calls, as long as the file is unchanged.
+ *
+ * @node:	File to look up
+ * @fileblock:	First block within the file
+ * @count:	Maximum number of blocks to map
+ * @blknr:	Returns the filesystem block holding @fileblock, or 0 if the
+ *		blocks are not allocated and read as zeroes
+ * @cache:	Block cache for indirect and extent-tree blocks, or NULL
+ * Return: number of blocks from @fileblock stored consecutively from
+ *	@blknr (or all unallocated), -ve on error
+ */
+long ext4fs_map_blocks(struct ext2fs_node *node, lbaint_t fileblock,
+		       lbaint_t count, lbaint_t *blknr,
+		       struct ext_block_cache *cache);
+
+/**
+ * ext4fs_invalidate_extent_map() - forget the extents of the last file read
+ *
+ * This must be called when files may have been changed
+ */
+void ext4fs_invalidate_extent_map(void);
 int ext4fs_probe(struct blk_desc *fs_dev_desc,
 		 struct disk_partition *fs_partition);
 int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
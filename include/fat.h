@@ -30,6 +30,11 @@ struct disk_partition;
 #define FAT12BUFSIZE	((FATBUFSIZE*2)/3)
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
 #define FAT32BUFSIZE	(FATBUFSIZE/4)
+#ifdef CONFIG_FS_FAT_CACHE_WINDOWS
+#define FATCACHEWINDOWS	CONFIG_FS_FAT_CACHE_WINDOWS
+#else
+#define FATCACHEWINDOWS	1
+#endif
 
 /* Maximum number of entry for long file name according to spec */
 #define MAX_LFN_SLOT	20
@@ -172,6 +177,10 @@ typedef struct {
 	__u16	clust_size;	/* Size of clusters in sectors */
 	int	data_begin;	/* The sector of the first cluster, can be negative */
 	int	fatbufnum;	/* Used by get_fatent, init to -1 */
+	__u8	*fatcache;	/* FATCACHEWINDOWS buffers of FATBUFSIZE */
+	int	fatcachenum[FATCACHEWINDOWS];	/* Window held by each buffer */
+	uint	fatcacheage[FATCACHEWINDOWS];	/* Last use of each buffer */
+	uint	fatcacheclock;	/* Incremented on each buffer switch */
 	int	rootdir_size;	/* Size of root dir for non-FAT32 */
 	__u32	root_cluster;	/* First cluster of root dir for FAT32 */
 	u32	total_sect;	/* Number of sectors */
@@ -181,6 +190,25 @@ typedef struct {
 struct fat_itr;
 typedef struct fat_itr fat_itr;
 
+/**
+ * struct fat_cache_stats - statistics of the FAT table cache
+ *
+ * @windows:	number of FAT windows cached while a filesystem is in use
+ * @window_sects: number of sectors in each window
+ * @hits:	FAT entries found in a cached window
+ * @misses:	FAT entries which needed a window to be read from disk
+ * @runs:	file reads issued for runs of consecutive clusters
+ * @clusters:	clusters covered by these reads
+ */
+struct fat_cache_stats {
+	uint windows;
+	uint window_sects;
+	ulong hits;
+	ulong misses;
+	ulong runs;
+	ulong clusters;
+};
+
 static inline u32 clust_to_sect(fsdata *fsdata, u32 clust)
 {
 	return fsdata->data_begin + clust * fsdata->clust_size;
@@ -210,6 +238,13 @@ int fat_mkdir(const char *dirname);
 void fat_close(void);
 void *fat_next_cluster(fat_itr *itr, unsigned int *nbytes);
 
+/**
+ * fat_cache_stats() - return statistics of the FAT table cache and reset them
+ *
+ * @stats:	statistics are copied here
+ */
+void fat_cache_stats(struct fat_cache_stats *stats);
+
 /**
  * fat_uuid() - get FAT volume ID
  *
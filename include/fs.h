@@ -90,6 +90,37 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part);
  */
 void fs_close(void);
 
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/**
+ * fs_unmount() - Close the filesystem kept mounted between operations
+ *
+ * fs_close() leaves the last filesystem found on a block device mounted, so
+ * that the next operation on the same partition does not need to probe it
+ * again. This closes it. It must be called before using a filesystem driver
+ * directly, since the drivers only hold the state of one filesystem.
+ */
+void fs_unmount(void);
+
+/**
+ * fs_blk_invalidate() - Drop the mounted filesystem of a block device
+ *
+ * This is called by the block uclass when a device is written, erased,
+ * re-initialised or removed. If an operation on the filesystem is in
+ * progress, it is unmounted by the fs_close() which ends that operation.
+ *
+ * @desc: Block device whose contents changed
+ */
+void fs_blk_invalidate(struct blk_desc *desc);
+#else
+static inline void fs_unmount(void)
+{
+}
+
+static inline void fs_blk_invalidate(struct blk_desc *desc)
+{
+}
+#endif
+
 /**
  * fs_get_type() - Get type of current filesystem
  *
@@ -8,6 +8,9 @@
 
 #ifdef USE_HOSTCC
 #include <linux/kconfig.h>
+#else
+#include <linker_lists.h>
+#include <linux/types.h>
 #endif
 
 struct cmd_tbl;
@@ -82,6 +85,26 @@ struct hash_algo {
 			   int size);
 };
 
+/**
+ * struct hash_job - A hash to calculate with hash_run_jobs()
+ *
+ * @algo: Hash algorithm to use
+ * @data: Data to hash
+ * @len: Length of data to hash in bytes
+ * @id: For use by the caller, e.g. to find the hash node this job is for
+ * @digest: Returns the hash value
+ * @digest_len: Returns the number of bytes in @digest, or 0 if the algorithm
+ *	is not supported
+ */
+struct hash_job {
+	const char *algo;
+	const void *data;
+	ulong len;
+	int id;
+	uint8_t digest[HASH_MAX_DIGEST_SIZE];
+	int digest_len;
+};
+
 #ifndef USE_HOSTCC
 /**
  * hash_command: Process a hash command for a particular algorithm
@@ -120,6 +143,72 @@ int hash_command(const char *algo_name, int flags, struct cmd_tbl *cmdtp,
 int hash_block(const char *algo_name, const void *data, unsigned int len,
 	       uint8_t *output, int *output_size);
 
+/**
+ * hash_run_jobs() - Calculate a number of independent hashes
+ *
+ * With CONFIG_SMP_WORK the jobs are shared out between the CPUs, otherwise
+ * they run one after another.
+ *
+ * @jobs: Hashes to calculate
+ * @count: Number of jobs
+ * Return: 0 if ok, -EPROTONOSUPPORT if any job has an unknown algorithm (the
+ * other jobs are still run)
+ */
+int hash_run_jobs(struct hash_job *jobs, int count);
+
+/**
+ * struct hash_backend - An implementation of the block function of a hash
+ *
+ * The SHA code in lib/ handles padding and buffering and passes whole blocks
+ * to a backend. The generic C backend is always there; architectures can add
+ * faster ones which use CPU instructions for the algorithm, if the CPU they
+ * run on has them.
+ *
+ * @algo: Name of the algorithm, as in &struct hash_algo (sha384 uses sha512)
+ * @name: Name of this backend, e.g. "generic"
+ * @block_size: Number of bytes in each block
+ * @priority: Preference for this backend, where the highest usable one wins
+ * @probe: Check whether the CPU can run this backend, NULL if it always can
+ * @probe_needs_dm: true if @probe needs driver model, e.g. to read the
+ *	devicetree, so can only be called once EVT_LAST_STAGE_INIT is reached
+ * @process: Hash @blocks blocks (never 0) from @data into @state, which is
+ *	the algorithm's array of state words, as in the algorithm's context
+ */
+struct hash_backend {
+	const char *algo;
+	const char *name;
+	int block_size;
+	int priority;
+	bool (*probe)(void);
+	bool probe_needs_dm;
+	void (*process)(void *state, const uint8_t *data, uint blocks);
+};
+
+/* Declare a new hash backend */
+#define HASH_BACKEND(__name) \
+	ll_entry_declare(struct hash_backend, __name, hash_backend)
+
+/**
+ * hash_backend_get() - Get the best backend for an algorithm
+ *
+ * The first call for an algorithm probes the backends and keeps the result.
+ * Backends whose probe needs driver model are only considered once
+ * EVT_LAST_STAGE_INIT is reached. Other probes just read CPU ID registers, so
+ * this is safe to call from any CPU.
+ *
+ * @algo: Name of the algorithm
+ * Return: usable backend with the highest priority, or NULL if there is none
+ */
+const struct hash_backend *hash_backend_get(const char *algo);
+
+/**
+ * hash_backend_usable() - Check whether a backend can run on this CPU
+ *
+ * @backend: Backend to check
+ * Return: true if @backend can be used
+ */
+bool hash_backend_usable(const struct hash_backend *backend);
+
 #endif /* !USE_HOSTCC */
 
 /**
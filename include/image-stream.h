@@ -0,0 +1,95 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Single-pass loading, hashing and decompression of images
+ */
+
+#ifndef __IMAGE_STREAM_H
+#define __IMAGE_STREAM_H
+
+#include <hash.h>
+#include <linux/sizes.h>
+#include <linux/types.h>
+
+/* Default number of bytes handled in each step */
+#define IMAGE_STREAM_CHUNK	SZ_64K
+
+/**
+ * typedef image_stream_read_t - Read part of an image from its source
+ *
+ * @priv: Private data for the source (&struct image_stream->priv)
+ * @offset: Offset to read from in bytes, a multiple of the alignment
+ * @size: Number of bytes to read, a multiple of the alignment
+ * @buf: Buffer to read into
+ * Return: number of bytes read, or -ve on error
+ */
+typedef long (*image_stream_read_t)(void *priv, ulong offset, ulong size,
+				    void *buf);
+
+/**
+ * struct image_stream - A single pass over the data of an image
+ *
+ * The source data is handled a chunk at a time: each chunk is read (if not
+ * already in memory), added to the hash and then decompressed or copied to
+ * the destination, while it is still in the cache.
+ *
+ * @comp: Compression type of the source data (IH_COMP_...), see
+ *	image_stream_supported()
+ * @size: Number of bytes of source data
+ * @src: Source data in memory, or NULL to use @read
+ * @read: Function to read the source data, if @src is NULL
+ * @priv: Private data for @read
+ * @offset: Offset of the source data for @read
+ * @align: Alignment needed by @read (a power of two), 0 for none
+ * @chunk: Number of bytes to handle in each step, 0 for the default
+ * @algo: Name of the hash algorithm to run over the source data, or NULL
+ * @hash_chunk: 0 to hash all of the source data together, else the number of
+ *	bytes in each separately hashed chunk (see FIT_CHUNK_SIZE_PROP)
+ * @chunk_values: Expected hash of each chunk in turn, if @hash_chunk is not 0.
+ *	A chunk which does not match stops the pass with -EACCES
+ * @dst: Destination for the data. With IH_COMP_NONE this may be NULL (or
+ *	@src) to hash the data without copying it
+ * @dst_size: Size of @dst in bytes
+ * @len: Returns the number of bytes written to @dst
+ * @digest: Returns the hash of the source data, if @algo is not NULL and
+ *	@hash_chunk is 0
+ * @digest_len: Returns the number of bytes in @digest
+ */
+struct image_stream {
+	int comp;
+	ulong size;
+	const void *src;
+	image_stream_read_t read;
+	void *priv;
+	ulong offset;
+	ulong align;
+	ulong chunk;
+	const char *algo;
+	ulong hash_chunk;
+	const uint8_t *chunk_values;
+	void *dst;
+	ulong dst_size;
+	ulong len;
+	uint8_t digest[HASH_MAX_DIGEST_SIZE];
+	int digest_len;
+};
+
+/**
+ * image_stream_supported() - Check whether a compression type can stream
+ *
+ * @comp: Compression type (IH_COMP_...)
+ * Return: true if image_stream_run() can decompress @comp a chunk at a time
+ */
+bool image_stream_supported(int comp);
+
+/**
+ * image_stream_run() - Read, hash and decompress an image in one pass
+ *
+ * @st: Description of the image, see &struct image_stream
+ * Return: 0 if OK, -ENOSPC if @st->dst is too small, -EPROTONOSUPPORT if the
+ *	hash or compression is not supported, -EIO if the data could not be
+ *	read, -EACCES if a chunk does not match its hash, other -ve value if
+ *	the data is not valid
+ */
+int image_stream_run(struct image_stream *st);
+
+#endif
@@ -366,6 +366,7 @@ struct bootm_headers {
 	void		*fit_hdr_os;	/* os FIT image header */
 	const char	*fit_uname_os;	/* os subimage node unit name */
 	int		fit_noffset_os;	/* os subimage node offset */
+	int		fit_hash_os;	/* os hash node to check on load, or 0 */
 
 	void		*fit_hdr_rd;	/* init ramdisk FIT image header */
 	const char	*fit_uname_rd;	/* init ramdisk subimage node unit name */
@@ -591,6 +592,7 @@ enum fit_load_op {
 	FIT_LOAD_OPTIONAL,	/* Can be provided, but optional */
 	FIT_LOAD_OPTIONAL_NON_ZERO,	/* Optional, a value of 0 is ignored */
 	FIT_LOAD_REQUIRED,	/* Must be provided */
+	FIT_LOAD_STREAM,	/* Ignored, and the caller checks the hash */
 };
 
 int boot_get_setup(struct bootm_headers *images, uint8_t arch, ulong *setup_start,
@@ -982,6 +984,16 @@ static inline int image_check_target_arch(const struct legacy_img_hdr *hdr)
 }
 #endif /* USE_HOSTCC */
 
+/**
+ * print_decomp_msg() - Print a suitable decompression/loading message
+ *
+ * @comp_type:	Compression type being used (IH_COMP_...)
+ * @type:	Image type (IH_TYPE_...)
+ * @is_xip:	true if the load address matches the image start
+ * @load:	Load address for printing
+ */
+void print_decomp_msg(int comp_type, int type, bool is_xip, ulong load);
+
 /**
  * image_decomp_type() - Find out compression type of an image
  *
@@ -1068,6 +1080,8 @@ int booti_setup(ulong image, ulong *relocated_addr, ulong *size,
 #define FIT_ALGO_PROP		"algo"
 #define FIT_VALUE_PROP		"value"
 #define FIT_IGNORE_PROP		"uboot-ignore"
+#define FIT_CHUNK_SIZE_PROP	"chunk-size"
+#define FIT_CHUNK_VALUE_PROP	"chunk-value"
 #define FIT_SIG_NODENAME	"signature"
 #define FIT_KEY_REQUIRED	"required"
 #define FIT_KEY_HINT		"key-name-hint"
@@ -1245,6 +1259,53 @@ int fit_image_hash_get_algo(const void *fit, int noffset, const char **algo);
 int fit_image_hash_get_value(const void *fit, int noffset, uint8_t **value,
 				int *value_len);
 
+/**
+ * fit_image_hash_get_chunk_size() - Get the chunk size of a hash node
+ *
+ * A hash node with a chunk-size property hashes its image a chunk at a
+ * time. The chunk-value property holds the hash of each chunk in turn and
+ * the value property holds the hash of chunk-value, i.e. the root of a
+ * two-level hash tree.
+ *
+ * @fit: FIT to read
+ * @noffset: Offset of the hash node
+ * @chunk_sizep: Returns the chunk size in bytes
+ * Return: 0 if OK, -ENOENT if the hash covers the image in one go, -EINVAL
+ *	if the chunk size is not valid
+ */
+int fit_image_hash_get_chunk_size(const void *fit, int noffset,
+				  ulong *chunk_sizep);
+
+/**
+ * fit_hash_chunk_count() - Get the number of chunks in image data
+ *
+ * @size: Size of the data in bytes
+ * @chunk_size: Number of bytes in each chunk
+ * Return: number of chunks, the last of which may be shorter
+ */
+static inline int fit_hash_chunk_count(ulong size, ulong chunk_size)
+{
+	/* Avoid adding to @size, which may wrap */
+	return size / chunk_size + !!(size % chunk_size);
+}
+
+/**
+ * fit_hash_chunks() - Hash image data a chunk at a time
+ *
+ * With CONFIG_SMP_WORK the chunks are hashed on all CPUs at once.
+ *
+ * @data: Data to hash
+ * @size: Size of @data in bytes
+ * @algo: Hash algorithm to use
+ * @chunk_size: Number of bytes in each chunk; the last may be shorter
+ * @values: Returns the hash of each chunk in turn. There must be space for
+ *	fit_hash_chunk_count() hashes of FIT_MAX_HASH_LEN bytes
+ * @value_len: Returns the length of each hash
+ * Return: 0 if OK, -EPROTONOSUPPORT if @algo is not supported
+ */
+int fit_hash_chunks(const void *data, size_t size, const char *algo,
+		    ulong chunk_size, uint8_t *values, int *value_len);
+
 int fit_set_timestamp(void *fit, int noffset, time_t timestamp);
 
 /**
@@ -1328,6 +1389,42 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       size_t size);
 
 int fit_image_verify(const void *fit, int noffset);
+
+struct image_stream;
+
+/**
+ * fit_image_get_stream_hash() - Find the hash to check while loading an image
+ *
+ * An image can be checked while it is loaded with fit_image_stream_verify()
+ * if it has exactly one hash node, using an algorithm that supports
+ * progressive hashing, and no signature node.
+ *
+ * @fit:	Pointer to the FIT format image header
+ * @image_noffset: Offset in @fit of the image
+ * @algop:	Returns the name of the hash algorithm
+ * Return: offset of the hash node, or -ENOENT if the image must be checked
+ *	with fit_image_verify() instead
+ */
+int fit_image_get_stream_hash(const void *fit, int image_noffset,
+			      const char **algop);
+
+/**
+ * fit_image_stream_verify() - Load an image while checking its hash
+ *
+ * This runs @st, which hashes each chunk of the image data and then
+ * decompresses or copies it, then checks the result against the hash node
+ * and any signatures marked as required for images.
+ *
+ * @fit:	Pointer to the FIT format image header
+ * @image_noffset: Offset in @fit of the image
+ * @hash_noffset: Offset of the hash node, from fit_image_get_stream_hash()
+ * @st:		Stream to run, with everything except @st->algo set up
+ * Return: 0 if OK, -EACCES if the image does not verify, other -ve value if
+ *	the data could not be loaded (see image_stream_run())
+ */
+int fit_image_stream_verify(const void *fit, int image_noffset,
+			    int hash_noffset, struct image_stream *st);
+
 #if CONFIG_IS_ENABLED(FIT_SIGNATURE)
 int fit_config_verify(const void *fit, int conf_noffset);
 #else
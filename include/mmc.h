@@ -68,6 +68,7 @@ struct bd_info;
 #define MMC_CAP_NONREMOVABLE	BIT(14)
 #define MMC_CAP_NEEDS_POLL	BIT(15)
 #define MMC_CAP_CD_ACTIVE_HIGH  BIT(16)
+#define MMC_CAP_SET_BLOCK_COUNT	BIT(17)	/* host can send CMD23 */
 
 #define MMC_MODE_8BIT		BIT(30)
 #define MMC_MODE_4BIT		BIT(29)
@@ -75,6 +76,7 @@ struct bd_info;
 #define MMC_MODE_SPI		BIT(27)
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_SCR_CMD23_SUPPORT	0x00000002
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -560,6 +562,48 @@ struct dm_mmc_ops {
 	 * @return 0 if success, -ve on error
 	 */
 	int (*hs400_prepare_ddr)(struct udevice *dev);
+
+#if CONFIG_IS_ENABLED(MMC_STREAM_READ)
+	/**
+	 * prepare_data() - get ready for a later data transfer
+	 *
+	 * This sets up whatever the host needs for the transfer (e.g. DMA
+	 * descriptors and cache maintenance) without touching the hardware,
+	 * so it can be done while another transfer is in progress. The next
+	 * start_cmd() or send_cmd() with the same @data uses this state.
+	 *
+	 * @dev:	Device to prepare
+	 * @data:	Data transfer to prepare, or NULL to drop any prepared
+	 *		state
+	 * @return 0 if OK, -ENOSYS if not supported, other -ve on error
+	 */
+	int (*prepare_data)(struct udevice *dev, struct mmc_data *data);
+
+	/**
+	 * start_cmd() - Send a command, without waiting for its data
+	 *
+	 * This returns once the card has responded to the command. The data
+	 * transfer continues until finish_cmd() is called.
+	 *
+	 * @dev:	Device to receive the command
+	 * @cmd:	Command to send
+	 * @data:	Data to receive
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*start_cmd)(struct udevice *dev, struct mmc_cmd *cmd,
+			 struct mmc_data *data);
+
+	/**
+	 * finish_cmd() - Wait for the data transfer of a started command
+	 *
+	 * @dev:	Device which received the command
+	 * @cmd:	Command passed to start_cmd()
+	 * @data:	Data passed to start_cmd()
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*finish_cmd)(struct udevice *dev, struct mmc_cmd *cmd,
+			  struct mmc_data *data);
+#endif
 };
 
 #define mmc_get_ops(dev)        ((struct dm_mmc_ops *)(dev)->driver->ops)
@@ -577,6 +621,9 @@ int mmc_reinit(struct mmc *mmc);
 int mmc_get_b_max(struct mmc *mmc, void *dst, lbaint_t blkcnt);
 int mmc_hs400_prepare_ddr(struct mmc *mmc);
 int mmc_send_stop_transmission(struct mmc *mmc, bool write);
+int mmc_prepare_data(struct mmc *mmc, struct mmc_data *data);
+int mmc_start_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data);
+int mmc_finish_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data);
 
 #else
 struct mmc_ops {
@@ -9,10 +9,12 @@
 #include <hexdump.h>
 #include <linux/if_ether.h>
 #include <linux/types.h>
+#include <log.h>
 #include <rand.h>
 #include <time.h>
 
 #define DEBUG_NET_PKT_TRACE 0	/* Trace all packet data */
+#define DEBUG_INT_STATE 0	/* Internal network state changes */
 
 /*
  *	The number of receive packet buffers, and the required packet buffer
@@ -74,7 +76,7 @@ struct ip_udp_hdr {
 #define UDP_HDR_SIZE		(IP_UDP_HDR_SIZE - IP_HDR_SIZE)
 
 /* Number of packets processed together */
-#define ETH_PACKETS_BATCH_RECV	32
+#define ETH_PACKETS_BATCH_RECV	CONFIG_ETH_RX_BATCH
 
 /* ARP hardware address length */
 #define ARP_HLEN 6
@@ -122,6 +124,22 @@ extern struct in_addr	net_ip;		/* Our    IP addr (0 = unknown) */
 /* Indicates whether the pxe path prefix / config file was specified in dhcp option */
 extern char *pxelinux_configfile;
 
+/* Network loop state */
+enum net_loop_state {
+	NETLOOP_CONTINUE,
+	NETLOOP_RESTART,
+	NETLOOP_SUCCESS,
+	NETLOOP_FAIL
+};
+
+extern enum net_loop_state net_state;
+
+static inline void net_set_state(enum net_loop_state state)
+{
+	debug_cond(DEBUG_INT_STATE, "--- NetState set to %d\n", state);
+	net_state = state;
+}
+
 /**
  * compute_ip_checksum() - Compute IP checksum
  *
@@ -201,7 +219,7 @@ int eth_send(void *packet, int length);	   /* Send a packet */
 int eth_receive(void *packet, int length); /* Receive a packet*/
 extern void (*push_packet)(void *packet, int length);
 #endif
-int eth_rx(void);			/* Check for received packets */
+int eth_rx(void);			/* Receive packets, return count */
 
 /**
  * reset_phy() - Reset the Ethernet PHY
@@ -291,7 +309,140 @@ struct eth_ops {
 
 struct udevice *eth_get_dev(void); /* get the current device */
 unsigned char *eth_get_ethaddr(void); /* get the current device MAC */
-int eth_rx(void);                      /* Check for received packets */
+int eth_rx(void);                      /* Receive packets, return count */
+
+/**
+ * struct eth_rx_stats - statistics of the frames received by a device
+ *
+ * @frames:	frames handed to the network stack by the driver
+ * @bytes:	total length of these frames
+ * @stored:	payloads stored by eth_rx_store() or eth_rx_sink_store()
+ * @stored_bytes: total length of these payloads
+ * @copied:	bytes of received data copied on the way, by the driver out of
+ *		its receive buffers and when payloads are stored (see
+ *		eth_count_rx_copy())
+ * @polls:	polls of the device which returned at least one frame
+ * @max_per_poll: largest number of frames returned by a single poll
+ * @ring_full:	polls which used up the whole batch (CONFIG_ETH_RX_BATCH),
+ *		leaving frames waiting in the receive ring
+ * @drops:	frames lost by the driver, e.g. received with errors or on
+ *		a receive ring overrun (see eth_count_rx_drop())
+ * @errors:	polls on which the driver returned an error
+ */
+struct eth_rx_stats {
+	ulong frames;
+	ulong bytes;
+	ulong stored;
+	ulong stored_bytes;
+	ulong copied;
+	ulong polls;
+	ulong max_per_poll;
+	ulong ring_full;
+	ulong drops;
+	ulong errors;
+};
+
+/**
+ * eth_count_rx() - account for a frame received by a device
+ *
+ * This is called for each frame passed to the network stack.
+ *
+ * @dev:	Ethernet device which received the frame
+ * @len:	length of the frame
+ */
+void eth_count_rx(struct udevice *dev, int len);
+
+/**
+ * eth_count_rx_drop() - account for a frame lost by a driver
+ *
+ * Drivers call this for frames they have to discard, such as frames
+ * received with errors or which did not fit in the receive ring.
+ *
+ * @dev:	Ethernet device which lost the frame
+ */
+void eth_count_rx_drop(struct udevice *dev);
+
+/**
+ * eth_count_rx_copy() - account for a copy of received data
+ *
+ * Drivers which cannot hand over the buffer a frame was received in call
+ * this for each frame they copy out of it, and payload sinks call it for
+ * the data they copy. Together with the copies made by eth_rx_store() this
+ * shows how many times downloaded data is copied.
+ *
+ * @dev:	Ethernet device which received the data, NULL for the
+ *		current one
+ * @len:	number of bytes copied
+ */
+void eth_count_rx_copy(struct udevice *dev, ulong len);
+
+/**
+ * eth_rx_store() - store the payload of a received frame at its destination
+ *
+ * Protocols which download data (tftp, nfs, wget) use this to write the
+ * payload of each packet to its place in memory. Drivers hand over the
+ * buffer the frame was received in, so this is the only copy made of the
+ * data on its way from the driver to its destination. The copy is accounted
+ * to the current Ethernet device.
+ *
+ * @addr:	address to store the data at
+ * @src:	payload, still in the buffer handed over by the driver
+ * @len:	number of bytes to store
+ * Return: 0 if OK, -ve on error
+ */
+int eth_rx_store(ulong addr, const void *src, ulong len);
+
+/**
+ * struct eth_rx_sink - destination for downloaded payloads
+ *
+ * While a sink is registered with eth_rx_set_sink(), protocols pass the
+ * payload of each packet to it with eth_rx_sink_store() instead of storing
+ * it in memory. The payload is still in the buffer handed over by the
+ * driver, so the sink can write it out with at most one copy.
+ *
+ * @name:	name of the sink, for messages
+ * @store:	accept @len bytes at @offset in the file being downloaded.
+ *		Data may arrive out of order and more than once. Returns 0 if
+ *		OK, -ve on error, which fails the transfer
+ */
+struct eth_rx_sink {
+	const char *name;
+	int (*store)(ulong offset, const void *src, ulong len);
+};
+
+/**
+ * eth_rx_set_sink() - send downloaded payloads to a sink
+ *
+ * @sink:	sink to use, NULL to store payloads in memory again
+ * Return: 0 if OK, -EBUSY if another sink is registered
+ */
+int eth_rx_set_sink(const struct eth_rx_sink *sink);
+
+/**
+ * eth_rx_get_sink() - get the sink downloaded payloads are sent to
+ *
+ * Return: registered sink, NULL if payloads are stored in memory
+ */
+const struct eth_rx_sink *eth_rx_get_sink(void);
+
+/**
+ * eth_rx_sink_store() - pass the payload of a received frame to the sink
+ *
+ * @offset:	offset of the payload in the file being downloaded
+ * @src:	payload, still in the buffer handed over by the driver
+ * @len:	number of bytes
+ * Return: 0 if OK, -ENODEV if there is no sink, other -ve on error
+ */
+int eth_rx_sink_store(ulong offset, const void *src, ulong len);
+
+/**
+ * eth_get_rx_stats() - get the receive statistics of a device
+ *
+ * @dev:	Ethernet device
+ * @stats:	returns the statistics
+ * Return: 0 if OK, -ENODEV if @dev has not been probed
+ */
+int eth_get_rx_stats(struct udevice *dev, struct eth_rx_stats *stats);
 void eth_halt(void);			/* stop SCC */
 const char *eth_get_name(void);		/* get name of current device */
 int eth_get_dev_index(void);
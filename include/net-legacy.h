@@ -25,7 +25,6 @@ struct udevice;
 #define DEBUG_LL_STATE 0	/* Link local state machine changes */
 #define DEBUG_DEV_PKT 0		/* Packets or info directed to the device */
 #define DEBUG_NET_PKT 0		/* Packets on info on the network at large */
-#define DEBUG_INT_STATE 0	/* Internal network state changes */
 
 /* ARP hardware address length */
 #define ARP_HLEN 6
@@ -110,6 +109,42 @@ extern void (*push_packet)(void *packet, int length);
 #endif
 int eth_mcast_join(struct in_addr mcast_addr, int join);
 
+#if CONFIG_IS_ENABLED(NET_RACE)
+/**
+ * eth_race_send() - Send a request on each interface in a race
+ *
+ * When 'ethrotate' is "race", eth_init() starts all the Ethernet interfaces
+ * and the first one to get a reply is used. While the race is on, @send is
+ * called once for each interface which has a link, with that interface
+ * made current and net_ethaddr set to its MAC address. Otherwise @send is
+ * just called once.
+ *
+ * @send: Function which builds a request and sends it with
+ * net_send_packet()
+ */
+void eth_race_send(void (*send)(void));
+
+/**
+ * eth_race_won() - End a race in favour of the current interface
+ *
+ * This is called when a reply showing that the network is reachable is
+ * received. The other interfaces are stopped.
+ *
+ * Return: true if a race was ended, false if there was none
+ */
+bool eth_race_won(void);
+#else
+static inline void eth_race_send(void (*send)(void))
+{
+	send();
+}
+
+static inline bool eth_race_won(void)
+{
+	return false;
+}
+#endif
+
 /**********************************************************************/
 /*
  *	Protocol headers.
@@ -289,6 +324,9 @@ extern char	net_root_path[CONFIG_BOOTP_MAX_ROOT_PATH_LEN];	/* Our root path */
 extern u8		net_ethaddr[ARP_HLEN];		/* Our ethernet address */
 extern u8		net_server_ethaddr[ARP_HLEN];	/* Boot server enet address */
 extern struct in_addr	net_server_ip;	/* Server IP addr (0 = unknown) */
+#ifdef CONFIG_TFTP_MCAST
+extern struct in_addr	net_mcast_addr;	/* Multicast group (0 = none) */
+#endif
 extern uchar		*net_tx_packet;		/* THE transmit packet */
 extern uchar		*net_rx_packets[PKTBUFSRX]; /* Receive packets */
 extern uchar		*net_rx_packet;		/* Current receive packet */
@@ -372,22 +410,6 @@ bool arp_is_waiting(void);		/* Waiting for ARP reply? */
 void net_set_icmp_handler(rxhand_icmp_f *f); /* Set ICMP RX handler */
 void net_set_timeout_handler(ulong t, thand_f *f);/* Set timeout handler */
 
-/* Network loop state */
-enum net_loop_state {
-	NETLOOP_CONTINUE,
-	NETLOOP_RESTART,
-	NETLOOP_SUCCESS,
-	NETLOOP_FAIL
-};
-
-extern enum net_loop_state net_state;
-
-static inline void net_set_state(enum net_loop_state state)
-{
-	debug_cond(DEBUG_INT_STATE, "--- NetState set to %d\n", state);
-	net_state = state;
-}
-
 /*
  * net_get_async_tx_pkt_buf - Get a packet buffer that is not in use for
  *			      sending an asynchronous reply
@@ -7,7 +7,9 @@
 #include <lwip/netif.h>
 
 enum proto_t {
-	TFTPGET
+	TFTPGET,
+	FASTBOOT_UDP,
+	FASTBOOT_TCP,
 };
 
 struct netif *net_lwip_new_netif(struct udevice *udev);
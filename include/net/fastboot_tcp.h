@@ -11,4 +11,14 @@
  */
 void fastboot_tcp_start_server(void);
 
+/**
+ * fastboot_tcp_loop() - Serve fastboot over TCP using lwIP
+ *
+ * This runs until a command ends fastboot (e.g. "continue") or the user
+ * presses Ctrl-C.
+ *
+ * Return: 0 if OK, -ve on error
+ */
+int fastboot_tcp_loop(void);
+
 #endif /* __NET_FASTBOOT_TCP_H__ */
@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Writing downloaded files straight to a storage device
+ */
+
+#ifndef __NET_SINK_H__
+#define __NET_SINK_H__
+
+#include <linux/errno.h>
+#include <linux/types.h>
+
+#if CONFIG_IS_ENABLED(NET_SINK)
+/**
+ * net_sink_blk() - Send the next file downloaded to a block device
+ *
+ * @ifname: Interface name, e.g. "mmc"
+ * @dev_part: Device number and optional partition, e.g. "0:1"
+ * @start: First block to write, relative to the start of the partition
+ * Return: 0 if OK, -ve on error
+ */
+int net_sink_blk(const char *ifname, const char *dev_part, ulong start);
+
+/**
+ * net_sink_mtd() - Send the next file downloaded to an MTD device
+ *
+ * Bad blocks are skipped and each erase block is erased before it is
+ * written.
+ *
+ * @name: Name of the MTD device or partition
+ * @offset: Offset to write at, which must be on an erase block boundary
+ * Return: 0 if OK, -ve on error
+ */
+int net_sink_mtd(const char *name, u64 offset);
+
+/**
+ * net_sink_hash() - Hash the file as it is written
+ *
+ * The sink must already have a device.
+ *
+ * @algo: Name of the hash algorithm, e.g. "sha256"
+ * @digest: Expected digest in hex, or NULL to just show the digest
+ * Return: 0 if OK, -ve on error
+ */
+int net_sink_hash(const char *algo, const char *digest);
+
+/** net_sink_off() - Store the next file downloaded in memory as usual */
+void net_sink_off(void);
+
+/** net_sink_show() - Show where the next file downloaded goes */
+void net_sink_show(void);
+
+/**
+ * net_sink_active() - Check if downloaded files go to a device
+ *
+ * Return: true if a device is set, in which case the sink is registered
+ * with eth_rx_set_sink()
+ */
+bool net_sink_active(void);
+
+/**
+ * net_sink_size() - Get how far ahead data can be accepted
+ *
+ * Data this far past the end of the data received in order always fits in
+ * the sink buffer, so this is the most that a protocol should have in
+ * flight.
+ *
+ * Return: size in bytes, 0 if the sink is off
+ */
+ulong net_sink_size(void);
+
+/**
+ * net_sink_start() - Prepare for a new transfer
+ *
+ * This is called by net_loop() whenever it (re)starts a protocol, and
+ * drops any data from an earlier, failed attempt.
+ */
+void net_sink_start(void);
+
+/**
+ * net_sink_finish() - Write the rest of the file and check its hash
+ *
+ * The sink is turned off afterwards, so it only applies to one file.
+ *
+ * @size: Size of the file
+ * Return: 0 if OK, -ve on error
+ */
+int net_sink_finish(ulong size);
+#else
+static inline bool net_sink_active(void)
+{
+	return false;
+}
+
+static inline ulong net_sink_size(void)
+{
+	return 0;
+}
+
+static inline void net_sink_start(void)
+{
+}
+
+static inline int net_sink_finish(ulong size)
+{
+	return 0;
+}
+#endif
+
+#endif /* __NET_SINK_H__ */
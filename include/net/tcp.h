@@ -68,8 +68,8 @@ struct ip_tcp_hdr {
  * TCP header options, Seq, MSS, and SACK
  */
 
-#define TCP_SACK 32			/* Number of packets analyzed   */
-					/* on leading edge of stream    */
+#define TCP_SACK 64			/* Number of blocks received out */
+					/* of order which are tracked    */
 
 #define TCP_O_END	0x00		/* End of option list		*/
 #define TCP_1_NOP	0x01		/* Single padding NOP		*/
@@ -87,6 +87,7 @@ struct ip_tcp_hdr {
 #define TCP_OPT_LEN_A	0x0a		/* Timestamp Length		*/
 #define TCP_MSS		1460		/* Max segment size		*/
 #define TCP_SCALE	0x01		/* Scale			*/
+#define TCP_SCALE_MAX	14		/* Largest scale (RFC 7323)	*/
 
 /**
  * struct tcp_mss - TCP option structure for MSS (Max segment size)
@@ -299,6 +300,51 @@ typedef void rxhand_tcp(uchar *pkt, u16 dport,
 			u8 action, unsigned int len);
 void tcp_set_tcp_handler(rxhand_tcp *f);
 
+/**
+ * tcp_set_rx_window() - set the memory available for received data
+ * @size: number of bytes which can be received before the application
+ *	has to wait, 0 for no limit
+ *
+ * The receive window advertised to the peer is the smaller of @size and
+ * CONFIG_PROT_TCP_RX_WINDOW. It applies to the connections opened next.
+ */
+void tcp_set_rx_window(ulong size);
+
+/**
+ * tcp_get_ack_edge() - get the edge of the data received in order
+ *
+ * Data received out of order past a hole is not included.
+ *
+ * Return: sequence number following the data received in order on the
+ *	current connection
+ */
+u32 tcp_get_ack_edge(void);
+
+/**
+ * tcp_ack_delayed() - check whether an acknowledgment can be delayed
+ * @dport: destination TCP port
+ * @sport: source TCP port
+ * @payload_len: length of the payload of the packet
+ * @action: TCP action (SYN, ACK, FIN, etc)
+ * @tcp_seq_num: TCP sequence number of the packet
+ *
+ * A packet which only acknowledges data received in order is held back
+ * until CONFIG_PROT_TCP_ACK_SEGS segments have been received, so that
+ * one acknowledgment covers them all.
+ *
+ * Return: true if the packet is not to be sent now
+ */
+bool tcp_ack_delayed(int dport, int sport, int payload_len, u8 action,
+		     u32 tcp_seq_num);
+
+/**
+ * tcp_flush_acks() - send the acknowledgments which were held back
+ *
+ * This is called once the packets waiting in the network device have
+ * been processed.
+ */
+void tcp_flush_acks(void);
+
 void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int len);
 
 u16 tcp_set_pseudo_header(uchar *pkt, struct in_addr src, struct in_addr dest,
@@ -22,6 +22,10 @@ void tftp_start(enum proto_t protocol);	/* Begin TFTP get/put */
 void tftp_start_server(void);	/* Wait for incoming TFTP put */
 #endif
 
+#ifdef CONFIG_TFTP_MCAST
+void tftp_mcast_reset(void);	/* Try multicast again on the next transfer */
+#endif
+
 extern ulong tftp_timeout_ms;
 extern int tftp_timeout_count_max;
 
@@ -548,4 +548,22 @@ long os_get_time_offset(void);
  */
 void os_set_time_offset(long offset);
 
+/**
+ * os_thread_create() - start a host thread
+ *
+ * @func:	function for the thread to run
+ * @arg:	argument for @func
+ * Return:	thread handle for os_thread_join(), or NULL on error
+ */
+void *os_thread_create(void (*func)(void *arg), void *arg);
+
+/**
+ * os_thread_join() - wait for a host thread to finish
+ *
+ * This also frees the handle.
+ *
+ * @thread:	thread handle from os_thread_create()
+ */
+void os_thread_join(void *thread);
+
 #endif
@@ -317,6 +317,18 @@ int phy_modify_mmd(struct phy_device *phydev, int devad, u32 regnum,
 
 int phy_startup(struct phy_device *phydev);
 int phy_config(struct phy_device *phydev);
+
+/**
+ * phy_set_aneg_wait() - Choose whether to wait for autonegotiation
+ *
+ * By default genphy_update_link() waits up to CONFIG_PHY_ANEG_TIMEOUT for
+ * autonegotiation to complete. This is used to bring up several interfaces
+ * at once, checking each one for a link in turn.
+ *
+ * @wait: false to report the link as down while autonegotiation is in
+ * progress, rather than waiting for it
+ */
+void phy_set_aneg_wait(bool wait);
 int phy_shutdown(struct phy_device *phydev);
 int phy_set_supported(struct phy_device *phydev, u32 max_speed);
 int phy_modify(struct phy_device *phydev, int devad, int regnum, u16 mask,
@@ -361,6 +361,13 @@ struct sdhci_host {
 	dma_addr_t adma_addr;
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	struct sdhci_adma_desc *adma_desc_table;
+#if CONFIG_IS_ENABLED(MMC_STREAM_READ)
+	/* spare table, filled in while the other one is in use */
+	struct sdhci_adma_desc *adma_next_table;
+	dma_addr_t adma_next_addr;
+	struct mmc_data *prepared_data;
+	dma_addr_t prepared_start;
+#endif
 #endif
 };
 
@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Running independent jobs on several CPUs
+ */
+
+#ifndef __SMP_WORK_H
+#define __SMP_WORK_H
+
+#include <linux/types.h>
+
+/**
+ * struct smp_job - A job which may run on any CPU
+ *
+ * Jobs may run on secondary CPUs at the same time as each other, so @func
+ * must only touch its own data: it must not print, allocate memory or use
+ * driver model. schedule() is allowed; on secondary CPUs it does nothing,
+ * leaving cyclic functions and the watchdog to the boot CPU.
+ *
+ * @func: Function to run
+ * @arg: Argument for @func
+ * @ret: Returns the value returned by @func
+ * @cpu: Returns the CPU which ran the job, 0 being the boot CPU
+ */
+struct smp_job {
+	int (*func)(void *arg);
+	void *arg;
+	int ret;
+	uint cpu;
+};
+
+/**
+ * smp_work_run() - Run jobs, using secondary CPUs if there are any
+ *
+ * The boot CPU works through the jobs along with any secondary CPUs the
+ * architecture can start, and this returns when all of them are done. If no
+ * secondary CPU can be started, or this is called from a job, the jobs run
+ * one after another on the current CPU.
+ *
+ * @jobs: Jobs to run
+ * @count: Number of jobs
+ * Return: 0 if all jobs returned 0, else the first non-zero return value
+ */
+int smp_work_run(struct smp_job *jobs, int count);
+
+#if IS_ENABLED(CONFIG_SMP_WORK) && !defined(CONFIG_XPL_BUILD)
+/**
+ * smp_work_secondary() - Check if this is a secondary CPU running jobs
+ *
+ * Return: true if called on a secondary CPU started by smp_work_run(), false
+ * on the boot CPU
+ */
+bool smp_work_secondary(void);
+#else
+static inline bool smp_work_secondary(void)
+{
+	return false;
+}
+#endif
+
+/**
+ * arch_smp_work_start() - Start secondary CPUs to help with jobs
+ *
+ * Each secondary CPU must call @entry once, with its own CPU number starting
+ * at 1. @entry returns when there is no more work. This may be called again
+ * once arch_smp_work_finish() has returned.
+ *
+ * @entry: Function for secondary CPUs to call
+ * Return: 0 if any secondary CPU may have been started, -ve if none was
+ */
+int arch_smp_work_start(void (*entry)(uint cpu));
+
+/**
+ * arch_smp_work_finish() - Tidy up once secondary CPUs are done
+ *
+ * This is called when every secondary CPU which entered the function passed
+ * to arch_smp_work_start() has returned from it.
+ */
+void arch_smp_work_finish(void);
+
+/**
+ * arch_smp_work_secondary() - Check if this is not the boot CPU
+ *
+ * This is only called while secondary CPUs may be running jobs.
+ *
+ * Return: true if the calling CPU is one started by arch_smp_work_start()
+ */
+bool arch_smp_work_secondary(void);
+
+#endif
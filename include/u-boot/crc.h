@@ -96,8 +96,76 @@ uint32_t crc32_no_comp(uint32_t crc, const unsigned char *buf, uint len);
 void crc32_wd_buf(const uint8_t *input, uint ilen, uint8_t *output,
 		  uint chunk_sz);
 
+/**
+ * crc32_le_base() - Calculate a CRC32 using the lookup tables
+ *
+ * This is crc32_no_comp() without the choice of CPU instructions, for use by
+ * architecture code when it has bytes left over
+ *
+ * @crc: Input crc, not inverted
+ * @p: Bytes to checksum
+ * @len: Number of bytes to checksum
+ * Return: updated crc, not inverted
+ */
+uint32_t crc32_le_base(uint32_t crc, const uint8_t *p, size_t len);
+
+/**
+ * crc32_arch_probe() - Check whether crc32_le_arch() can be used
+ *
+ * This is provided by the architecture when CONFIG_CRC32_ARCH is enabled and
+ * is called once, by the first crc32() or at EVT_LAST_STAGE_INIT with
+ * CONFIG_CRC32_ARCH_LATE_PROBE. In the first case it can be called from an
+ * EFI runtime service, so must be __efi_runtime
+ *
+ * Return: true if the CPU has the instructions needed by crc32_le_arch()
+ */
+bool crc32_arch_probe(void);
+
+/**
+ * crc32_le_arch() - Calculate a CRC32 using CPU instructions
+ *
+ * This has the same arguments and result as crc32_le_base()
+ *
+ * @crc: Input crc, not inverted
+ * @p: Bytes to checksum
+ * @len: Number of bytes to checksum
+ * Return: updated crc, not inverted
+ */
+uint32_t crc32_le_arch(uint32_t crc, const uint8_t *p, size_t len);
+
 /* lib/crc32c.c */
 
+/**
+ * crc32c_le_base() - Calculate a CRC32C using the lookup tables
+ *
+ * This uses the built-in tables for the Castagnoli polynomial (0x82f63b78)
+ *
+ * @crc: Input crc, not inverted
+ * @p: Bytes to checksum
+ * @len: Number of bytes to checksum
+ * Return: updated crc, not inverted
+ */
+uint32_t crc32c_le_base(uint32_t crc, const uint8_t *p, size_t len);
+
+/**
+ * crc32c_arch_probe() - Check whether crc32c_le_arch() can be used
+ *
+ * Return: true if the CPU has the instructions needed by crc32c_le_arch()
+ */
+bool crc32c_arch_probe(void);
+
+/**
+ * crc32c_le_arch() - Calculate a CRC32C using CPU instructions
+ *
+ * This has the same arguments and result as crc32c_le_base()
+ *
+ * @crc: Input crc, not inverted
+ * @p: Bytes to checksum
+ * @len: Number of bytes to checksum
+ * Return: updated crc, not inverted
+ */
+uint32_t crc32c_le_arch(uint32_t crc, const uint8_t *p, size_t len);
+
 /**
  * crc32c_init() - Set up a the CRC32 table
  *
@@ -112,7 +180,8 @@ void crc32c_init(uint32_t *crc32c_table, uint32_t pol);
  * crc32c_cal() - Perform CRC32 on a buffer given a table
  *
  * This algorithm uses the table (set up by crc32c_init() to speed up
- * processing.
+ * processing. If the table is for the Castagnoli polynomial, the built-in
+ * tables or the CPU's CRC32C instructions are used instead.
  *
  * @crc: Previous crc (use 0 at start)
  * @data: Data bytes to checksum
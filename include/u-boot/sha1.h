@@ -59,6 +59,8 @@ typedef struct
     unsigned long total[2];	/*!< number of bytes processed	*/
     uint32_t state[5];		/*!< intermediate digest state	*/
     unsigned char buffer[64];	/*!< data block being processed */
+    /*!< block function, chosen by sha1_starts() */
+    void (*process)(void *state, const uint8_t *data, unsigned int blocks);
 }
 sha1_context;
 #endif
@@ -35,6 +35,8 @@ typedef struct {
 	uint32_t total[2];
 	uint32_t state[8];
 	uint8_t buffer[64];
+	/* Block function, chosen by sha256_starts() */
+	void (*process)(void *state, const uint8_t *data, unsigned int blocks);
 } sha256_context;
 #endif
 
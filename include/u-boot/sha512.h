@@ -25,6 +25,8 @@ typedef struct {
 	uint64_t state[SHA512_SUM_LEN / 8];
 	uint64_t count[2];
 	uint8_t buf[SHA512_BLOCK_SIZE];
+	/* Block function, chosen by sha512_starts() or sha384_starts() */
+	void (*process)(void *state, const uint8_t *data, unsigned int blocks);
 } sha512_context;
 #endif
 
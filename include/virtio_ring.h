@@ -43,6 +43,9 @@
  */
 #define VIRTIO_RING_F_EVENT_IDX		29
 
+/* Maximum number of descriptors in an indirect table */
+#define VIRTQUEUE_MAX_INDIRECT		8
+
 /* Virtio ring descriptors: 16 bytes. These can chain together via "next". */
 struct vring_desc {
 	/* Address (guest-physical) */
@@ -102,6 +105,8 @@ struct vring {
  * @num_free: number of elements we expect to be able to fit
  * @vring: actual memory layout for this queue
  * @vring_desc_shadow: guest-only copy of descriptors
+ * @indirect_desc: indirect descriptor tables, VIRTQUEUE_MAX_INDIRECT entries
+ *	for each ring entry, or NULL if indirect descriptors are not in use
  * @event: host publishes avail event idx
  * @free_head: head of free buffer list
  * @num_added: number we've added since last sync
@@ -116,6 +121,7 @@ struct virtqueue {
 	unsigned int num_free;
 	struct vring vring;
 	struct vring_desc_shadow *vring_desc_shadow;
+	struct vring_desc *indirect_desc;
 	bool event;
 	unsigned int free_head;
 	unsigned int num_added;
@@ -190,6 +196,9 @@ struct virtio_sg;
  * Caller must ensure we don't call this with other virtqueue operations
  * at the same time (except where noted).
  *
+ * If VIRTIO_RING_F_INDIRECT_DESC has been negotiated, a chain of up to
+ * VIRTQUEUE_MAX_INDIRECT buffers only uses a single ring entry.
+ *
  * Returns zero or a negative error (ie. ENOSPC, ENOMEM, EIO).
  */
 int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
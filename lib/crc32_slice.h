@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Table-driven CRC update shared by crc32.c and crc32c.c
+ *
+ * The includer defines CRC32_TABLE_ROWS to 1 to go a byte at a time, or to
+ * 8 to use slice-by-8, which looks up eight bytes in separate tables and
+ * combines the results, so that each step depends on the previous one only
+ * once per eight bytes rather than once per byte.
+ */
+
+static __always_inline uint32_t crc32_slice(const uint32_t (*tab)[256],
+					    uint32_t crc, const uint8_t *p,
+					    size_t len)
+{
+#if CRC32_TABLE_ROWS == 8
+	uint32_t one, two;
+
+	for (; len && ((uintptr_t)p & 3); len--)
+		crc = tab[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	for (; len >= 8; len -= 8, p += 8) {
+		one = crc ^ le32_to_cpu(*(const uint32_t *)p);
+		two = le32_to_cpu(*(const uint32_t *)(p + 4));
+		crc = tab[7][one & 0xff] ^ tab[6][(one >> 8) & 0xff] ^
+		      tab[5][(one >> 16) & 0xff] ^ tab[4][one >> 24] ^
+		      tab[3][two & 0xff] ^ tab[2][(two >> 8) & 0xff] ^
+		      tab[1][(two >> 16) & 0xff] ^ tab[0][two >> 24];
+	}
+#endif
+	while (len--)
+		crc = tab[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
@@ -11,14 +11,64 @@
  */
 
 #include <compiler.h>
+#include <event.h>
+#include <linker_lists.h>
+#include <u-boot/crc.h>
+
+/* Bit-reflected Castagnoli polynomial, used by btrfs and others */
+#define CRC32C_POLY	0x82f63b78
+
+#if CONFIG_IS_ENABLED(CRC32_SLICE_BY_8)
+#define CRC32_TABLE_ROWS	8
+#else
+#define CRC32_TABLE_ROWS	1
+#endif
+
+#include "crc32ctable.h"
+#include "crc32_slice.h"
+
+#if CONFIG_IS_ENABLED(CRC32_ARCH)
+/* 1 if crc32c_le_arch() can be used, 0 if not, -1 until the CPU is checked */
+static int crc32c_use_arch = -1;
+
+#if IS_ENABLED(CONFIG_CRC32_ARCH_LATE_PROBE)
+static int crc32c_arch_init(void)
+{
+	crc32c_use_arch = crc32c_arch_probe();
+
+	return 0;
+}
+EVENT_SPY_SIMPLE(EVT_LAST_STAGE_INIT, crc32c_arch_init);
+#endif
+#endif
+
+uint32_t crc32c_le_base(uint32_t crc, const uint8_t *p, size_t len)
+{
+	return crc32_slice(crc32c_le_table, crc, p, len);
+}
 
 uint32_t crc32c_cal(uint32_t crc, const char *data, int length,
 		    uint32_t *crc32c_table)
 {
-	while (length--)
-		crc = crc32c_table[(u8)(crc ^ *data++)] ^ (crc >> 8);
+	/*
+	 * Entry 128 is the polynomial itself, so this tells whether the
+	 * caller's table is the Castagnoli one, which the built-in tables and
+	 * the CPU's instructions can stand in for
+	 */
+	if (crc32c_table[128] != CRC32C_POLY) {
+		while (length--)
+			crc = crc32c_table[(u8)(crc ^ *data++)] ^ (crc >> 8);
+
+		return crc;
+	}
 
-	return crc;
+#if CONFIG_IS_ENABLED(CRC32_ARCH)
+	if (!IS_ENABLED(CONFIG_CRC32_ARCH_LATE_PROBE) && crc32c_use_arch < 0)
+		crc32c_use_arch = crc32c_arch_probe();
+	if (crc32c_use_arch > 0)
+		return crc32c_le_arch(crc, (const uint8_t *)data, length);
+#endif
+	return crc32c_le_base(crc, (const uint8_t *)data, length);
 }
 
 void crc32c_init(uint32_t *crc32c_table, uint32_t pol)
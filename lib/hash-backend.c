@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Choosing between implementations of a hash algorithm
+ *
+ * Several backends can implement the block function of an algorithm, e.g.
+ * the generic C code and one using the CPU's SHA instructions. Whether the
+ * instructions are there is only known at runtime. Most probes just read a
+ * CPU ID register, so the CPU is checked the first time an algorithm is used,
+ * in SPL too, and the choice is kept. Probes which need driver model, e.g. to
+ * read the ISA from the devicetree, wait until EVT_LAST_STAGE_INIT, when the
+ * choice is made again with all backends.
+ */
+
+#include <event.h>
+#include <hash.h>
+#include <linker_lists.h>
+#include <string.h>
+#include <linux/kernel.h>
+
+/*
+ * Backend chosen for each algorithm, as an index into the linker list so that
+ * it is still right after relocation, or -1 until the CPU has been checked
+ */
+static struct {
+	const char *algo;
+	int index;
+} hash_backend_chosen[] = {
+	{ "sha1", -1 },
+	{ "sha256", -1 },
+	{ "sha512", -1 },
+};
+
+bool hash_backend_usable(const struct hash_backend *backend)
+{
+	return !backend->probe || backend->probe();
+}
+
+/**
+ * hash_backend_find() - Find the best backend for an algorithm
+ *
+ * @algo: Name of the algorithm
+ * @dm_ready: true if driver model is up, so all backends can be probed;
+ *	false to skip those whose probe needs it
+ * Return: usable backend with the highest priority, or NULL if there is none
+ */
+static const struct hash_backend *hash_backend_find(const char *algo,
+						    bool dm_ready)
+{
+	const struct hash_backend *start, *backend, *best = NULL;
+	const int count = ll_entry_count(struct hash_backend, hash_backend);
+
+	start = ll_entry_start(struct hash_backend, hash_backend);
+	for (backend = start; backend != start + count; backend++) {
+		if (strcmp(backend->algo, algo))
+			continue;
+		if (best && backend->priority <= best->priority)
+			continue;
+		if (backend->probe_needs_dm && !dm_ready)
+			continue;
+		if (hash_backend_usable(backend))
+			best = backend;
+	}
+
+	return best;
+}
+
+static void hash_backend_choose(int i, bool dm_ready)
+{
+	const struct hash_backend *backend;
+
+	backend = hash_backend_find(hash_backend_chosen[i].algo, dm_ready);
+	if (backend)
+		hash_backend_chosen[i].index = backend -
+			ll_entry_start(struct hash_backend, hash_backend);
+}
+
+#if IS_ENABLED(CONFIG_EVENT)
+static int hash_backend_init(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(hash_backend_chosen); i++)
+		hash_backend_choose(i, true);
+
+	return 0;
+}
+EVENT_SPY_SIMPLE(EVT_LAST_STAGE_INIT, hash_backend_init);
+#endif
+
+const struct hash_backend *hash_backend_get(const char *algo)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(hash_backend_chosen); i++) {
+		if (strcmp(hash_backend_chosen[i].algo, algo))
+			continue;
+		if (hash_backend_chosen[i].index < 0)
+			hash_backend_choose(i, false);
+		if (hash_backend_chosen[i].index < 0)
+			return NULL;
+
+		return ll_entry_start(struct hash_backend, hash_backend) +
+			hash_backend_chosen[i].index;
+	}
+
+	return hash_backend_find(algo, false);
+}
@@ -17,6 +17,7 @@
 #endif
 
 #ifndef USE_HOSTCC
+#include <hash.h>
 #include <u-boot/schedule.h>
 #endif /* USE_HOSTCC */
 #include <string.h>
@@ -49,6 +50,9 @@ const uint8_t sha1_der_prefix[SHA1_DER_LEN] = {
 }
 #endif
 
+static void sha1_process_generic(void *state, const uint8_t *data,
+				 unsigned int blocks);
+
 /*
  * SHA-1 context setup
  */
@@ -62,9 +66,15 @@ void sha1_starts (sha1_context * ctx)
 	ctx->state[2] = 0x98BADCFE;
 	ctx->state[3] = 0x10325476;
 	ctx->state[4] = 0xC3D2E1F0;
+
+#if !defined(USE_HOSTCC) && IS_ENABLED(CONFIG_HASH_BACKEND)
+	ctx->process = hash_backend_get("sha1")->process;
+#else
+	ctx->process = sha1_process_generic;
+#endif
 }
 
-static void __maybe_unused sha1_process_one(sha1_context *ctx, const unsigned char data[64])
+static void sha1_process_one(uint32_t state[5], const unsigned char data[64])
 {
 	unsigned long temp, W[16], A, B, C, D, E;
 
@@ -97,11 +107,11 @@ static void __maybe_unused sha1_process_one(sha1_context *ctx, const unsigned ch
 	e += S(a,5) + F(b,c,d) + K + x; b = S(b,30);	\
 }
 
-	A = ctx->state[0];
-	B = ctx->state[1];
-	C = ctx->state[2];
-	D = ctx->state[3];
-	E = ctx->state[4];
+	A = state[0];
+	B = state[1];
+	C = state[2];
+	D = state[3];
+	E = state[4];
 
 #define F(x,y,z) (z ^ (x & (y ^ z)))
 #define K 0x5A827999
@@ -211,23 +221,38 @@ static void __maybe_unused sha1_process_one(sha1_context *ctx, const unsigned ch
 #undef K
 #undef F
 
-	ctx->state[0] += A;
-	ctx->state[1] += B;
-	ctx->state[2] += C;
-	ctx->state[3] += D;
-	ctx->state[4] += E;
+	state[0] += A;
+	state[1] += B;
+	state[2] += C;
+	state[3] += D;
+	state[4] += E;
+}
+
+static void sha1_process_generic(void *state, const uint8_t *data,
+				 unsigned int blocks)
+{
+	while (blocks--) {
+		sha1_process_one(state, data);
+		data += 64;
+	}
 }
 
-__weak void sha1_process(sha1_context *ctx, const unsigned char *data,
+#if !defined(USE_HOSTCC) && IS_ENABLED(CONFIG_HASH_BACKEND)
+HASH_BACKEND(sha1_generic) = {
+	.algo		= "sha1",
+	.name		= "generic",
+	.block_size	= 64,
+	.process	= sha1_process_generic,
+};
+#endif
+
+static void sha1_process(sha1_context *ctx, const unsigned char *data,
 			 unsigned int blocks)
 {
 	if (!blocks)
 		return;
 
-	while (blocks--) {
-		sha1_process_one(ctx, data);
-		data += 64;
-	}
+	ctx->process(ctx->state, data, blocks);
 }
 
 /*
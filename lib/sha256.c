@@ -6,6 +6,7 @@
  */
 
 #ifndef USE_HOSTCC
+#include <hash.h>
 #include <u-boot/schedule.h>
 #endif /* USE_HOSTCC */
 #include <string.h>
@@ -39,6 +40,9 @@ const uint8_t sha256_der_prefix[SHA256_DER_LEN] = {
 }
 #endif
 
+static void sha256_process_generic(void *state, const uint8_t *data,
+				   unsigned int blocks);
+
 void sha256_starts(sha256_context * ctx)
 {
 	ctx->total[0] = 0;
@@ -52,9 +56,15 @@ void sha256_starts(sha256_context * ctx)
 	ctx->state[5] = 0x9B05688C;
 	ctx->state[6] = 0x1F83D9AB;
 	ctx->state[7] = 0x5BE0CD19;
+
+#if !defined(USE_HOSTCC) && IS_ENABLED(CONFIG_HASH_BACKEND)
+	ctx->process = hash_backend_get("sha256")->process;
+#else
+	ctx->process = sha256_process_generic;
+#endif
 }
 
-static void sha256_process_one(sha256_context *ctx, const uint8_t data[64])
+static void sha256_process_one(uint32_t state[8], const uint8_t data[64])
 {
 	uint32_t temp1, temp2;
 	uint32_t W[64];
@@ -101,14 +111,14 @@ static void sha256_process_one(sha256_context *ctx, const uint8_t data[64])
 	d += temp1; h = temp1 + temp2;		\
 }
 
-	A = ctx->state[0];
-	B = ctx->state[1];
-	C = ctx->state[2];
-	D = ctx->state[3];
-	E = ctx->state[4];
-	F = ctx->state[5];
-	G = ctx->state[6];
-	H = ctx->state[7];
+	A = state[0];
+	B = state[1];
+	C = state[2];
+	D = state[3];
+	E = state[4];
+	F = state[5];
+	G = state[6];
+	H = state[7];
 
 	P(A, B, C, D, E, F, G, H, W[0], 0x428A2F98);
 	P(H, A, B, C, D, E, F, G, W[1], 0x71374491);
@@ -175,26 +185,41 @@ static void sha256_process_one(sha256_context *ctx, const uint8_t data[64])
 	P(C, D, E, F, G, H, A, B, R(62), 0xBEF9A3F7);
 	P(B, C, D, E, F, G, H, A, R(63), 0xC67178F2);
 
-	ctx->state[0] += A;
-	ctx->state[1] += B;
-	ctx->state[2] += C;
-	ctx->state[3] += D;
-	ctx->state[4] += E;
-	ctx->state[5] += F;
-	ctx->state[6] += G;
-	ctx->state[7] += H;
+	state[0] += A;
+	state[1] += B;
+	state[2] += C;
+	state[3] += D;
+	state[4] += E;
+	state[5] += F;
+	state[6] += G;
+	state[7] += H;
+}
+
+static void sha256_process_generic(void *state, const uint8_t *data,
+				   unsigned int blocks)
+{
+	while (blocks--) {
+		sha256_process_one(state, data);
+		data += 64;
+	}
 }
 
-__weak void sha256_process(sha256_context *ctx, const unsigned char *data,
+#if !defined(USE_HOSTCC) && IS_ENABLED(CONFIG_HASH_BACKEND)
+HASH_BACKEND(sha256_generic) = {
+	.algo		= "sha256",
+	.name		= "generic",
+	.block_size	= 64,
+	.process	= sha256_process_generic,
+};
+#endif
+
+static void sha256_process(sha256_context *ctx, const unsigned char *data,
 			   unsigned int blocks)
 {
 	if (!blocks)
 		return;
 
-	while (blocks--) {
-		sha256_process_one(ctx, data);
-		data += 64;
-	}
+	ctx->process(ctx->state, data, blocks);
 }
 
 void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
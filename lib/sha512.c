@@ -11,6 +11,7 @@
  */
 
 #ifndef USE_HOSTCC
+#include <hash.h>
 #include <u-boot/schedule.h>
 #endif /* USE_HOSTCC */
 #include <compiler.h>
@@ -187,15 +188,41 @@ sha512_transform(uint64_t *state, const uint8_t *input)
 	a = b = c = d = e = f = g = h = t1 = t2 = 0;
 }
 
-static void sha512_block_fn(sha512_context *sst, const uint8_t *src,
-				    int blocks)
+static void sha512_process_generic(void *state, const uint8_t *src,
+				   unsigned int blocks)
 {
 	while (blocks--) {
-		sha512_transform(sst->state, src);
+		sha512_transform(state, src);
 		src += SHA512_BLOCK_SIZE;
 	}
 }
 
+#if !defined(USE_HOSTCC) && IS_ENABLED(CONFIG_HASH_BACKEND)
+HASH_BACKEND(sha512_generic) = {
+	.algo		= "sha512",
+	.name		= "generic",
+	.block_size	= SHA512_BLOCK_SIZE,
+	.process	= sha512_process_generic,
+};
+#endif
+
+/* SHA-384 uses the SHA-512 block function, with different initial state */
+static void sha512_base_init(sha512_context *sctx)
+{
+	sctx->count[0] = sctx->count[1] = 0;
+#if !defined(USE_HOSTCC) && IS_ENABLED(CONFIG_HASH_BACKEND)
+	sctx->process = hash_backend_get("sha512")->process;
+#else
+	sctx->process = sha512_process_generic;
+#endif
+}
+
+static void sha512_block_fn(sha512_context *sst, const uint8_t *src,
+				    int blocks)
+{
+	sst->process(sst->state, src, blocks);
+}
+
 static void sha512_base_do_update(sha512_context *sctx,
 					const uint8_t *data,
 					unsigned int len)
@@ -263,7 +290,7 @@ void sha384_starts(sha512_context * ctx)
 	ctx->state[5] = SHA384_H5;
 	ctx->state[6] = SHA384_H6;
 	ctx->state[7] = SHA384_H7;
-	ctx->count[0] = ctx->count[1] = 0;
+	sha512_base_init(ctx);
 }
 
 void sha384_update(sha512_context *ctx, const uint8_t *input, uint32_t length)
@@ -328,7 +355,7 @@ void sha512_starts(sha512_context * ctx)
 	ctx->state[5] = SHA512_H5;
 	ctx->state[6] = SHA512_H6;
 	ctx->state[7] = SHA512_H7;
-	ctx->count[0] = ctx->count[1] = 0;
+	sha512_base_init(ctx);
 }
 
 void sha512_update(sha512_context *ctx, const uint8_t *input, uint32_t length)
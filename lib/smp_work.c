@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Running independent jobs on several CPUs
+ *
+ * Secondary CPUs normally sit idle in U-Boot. For work which splits into
+ * independent jobs, such as hashing the images in a FIT, the boot CPU wakes
+ * them and every CPU takes jobs from a shared list until none are left.
+ */
+
+#define LOG_CATEGORY	LOGC_BOOT
+
+#include <log.h>
+#include <smp_work.h>
+#include <linux/errno.h>
+#include <u-boot/schedule.h>
+
+/**
+ * struct smp_work - Jobs being handed out
+ *
+ * @jobs: Jobs to run
+ * @count: Number of jobs
+ * @next: Next job to hand out, may be larger than @count once all are taken
+ * @done: Number of jobs finished
+ * @active: Number of secondary CPUs in smp_work_helper()
+ * @open: true while secondary CPUs may join in
+ */
+struct smp_work {
+	struct smp_job *jobs;
+	int count;
+	int next;
+	int done;
+	int active;
+	bool open;
+};
+
+static struct smp_work smp_work;
+
+static void smp_work_loop(struct smp_work *sw, uint cpu)
+{
+	struct smp_job *job;
+	int i;
+
+	while (1) {
+		i = __atomic_fetch_add(&sw->next, 1, __ATOMIC_SEQ_CST);
+		if (i >= sw->count)
+			break;
+		job = &sw->jobs[i];
+		job->cpu = cpu;
+		job->ret = job->func(job->arg);
+		__atomic_fetch_add(&sw->done, 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+static void smp_work_helper(uint cpu)
+{
+	struct smp_work *sw = &smp_work;
+
+	/*
+	 * A CPU which arrives late must not touch the jobs once the boot CPU
+	 * has returned them to the caller, so only join in while the work is
+	 * open. smp_work_run() closes it and then waits for @active to drop.
+	 */
+	__atomic_fetch_add(&sw->active, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&sw->open, __ATOMIC_SEQ_CST))
+		smp_work_loop(sw, cpu);
+	__atomic_fetch_sub(&sw->active, 1, __ATOMIC_SEQ_CST);
+}
+
+__weak int arch_smp_work_start(void (*entry)(uint cpu))
+{
+	return -ENOSYS;
+}
+
+__weak void arch_smp_work_finish(void)
+{
+}
+
+__weak bool arch_smp_work_secondary(void)
+{
+	return false;
+}
+
+bool smp_work_secondary(void)
+{
+	return __atomic_load_n(&smp_work.open, __ATOMIC_SEQ_CST) &&
+		arch_smp_work_secondary();
+}
+
+int smp_work_run(struct smp_job *jobs, int count)
+{
+	struct smp_work *sw = &smp_work;
+	int left = count;
+	int ret, i;
+
+	if (count > 1 && !__atomic_load_n(&sw->open, __ATOMIC_SEQ_CST)) {
+		sw->jobs = jobs;
+		sw->count = count;
+		sw->next = 0;
+		sw->done = 0;
+
+		/*
+		 * Cyclic functions are not safe to run on several CPUs at
+		 * once, so schedule() only runs them on this one, which keeps
+		 * calling it while the others finish
+		 */
+		__atomic_store_n(&sw->open, true, __ATOMIC_SEQ_CST);
+		ret = arch_smp_work_start(smp_work_helper);
+		if (ret) {
+			log_debug("No secondary CPUs (err=%d)\n", ret);
+			__atomic_store_n(&sw->open, false, __ATOMIC_SEQ_CST);
+		} else {
+			smp_work_loop(sw, 0);
+			while (__atomic_load_n(&sw->done, __ATOMIC_SEQ_CST) <
+			       count)
+				schedule();
+			__atomic_store_n(&sw->open, false, __ATOMIC_SEQ_CST);
+			while (__atomic_load_n(&sw->active, __ATOMIC_SEQ_CST))
+				;
+			arch_smp_work_finish();
+			left = 0;
+		}
+	}
+
+	/* Without help, the jobs run here one after another */
+	for (i = 0; i < left; i++) {
+		jobs[i].cpu = 0;
+		jobs[i].ret = jobs[i].func(jobs[i].arg);
+	}
+
+	for (i = 0; i < count; i++) {
+		if (jobs[i].ret)
+			return jobs[i].ret;
+	}
+
+	return 0;
+}
@@ -68,6 +68,11 @@ void arp_raw_request(struct in_addr source_ip, const uchar *target_ethaddr,
 	net_send_packet(arp_tx_packet, eth_hdr_size + ARP_HDR_SIZE);
 }
 
+static void arp_send_request(void)
+{
+	arp_raw_request(net_ip, net_null_ethaddr, net_arp_wait_reply_ip);
+}
+
 void arp_request(void)
 {
 	if ((net_arp_wait_packet_ip.s_addr & net_netmask.s_addr) !=
@@ -82,7 +87,7 @@ void arp_request(void)
 		net_arp_wait_reply_ip = net_arp_wait_packet_ip;
 	}
 
-	arp_raw_request(net_ip, net_null_ethaddr, net_arp_wait_reply_ip);
+	eth_race_send(arp_send_request);
 }
 
 int arp_timeout_check(void)
@@ -197,6 +202,11 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 				   "Got ARP REPLY, set eth addr (%pM)\n",
 				   arp->ar_data);
 
+			/* Send the waiting packet from the winning interface */
+			if (eth_race_won())
+				memcpy(((struct ethernet_hdr *)net_tx_packet)->et_src,
+				       net_ethaddr, ARP_HLEN);
+
 			/* save address for later use */
 			if (arp_wait_packet_ethaddr != NULL)
 				memcpy(arp_wait_packet_ethaddr,
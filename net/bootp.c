@@ -367,6 +367,9 @@ static void bootp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	if (check_reply_packet(pkt, dest, src, len))
 		return;
 
+	/* Stay on the interface which got the reply */
+	eth_race_won();
+
 	/*
 	 *	Got a good BOOTP reply.	 Copy the data into our variables.
 	 */
@@ -716,46 +719,18 @@ void bootp_reset(void)
 	bootp_timeout = 250;
 }
 
-void bootp_request(void)
+/* ID of the request being sent, the same on each interface in a race */
+static u32 bootp_req_id;
+
+static void bootp_send_request(void)
 {
 	uchar *pkt, *iphdr;
 	struct bootp_hdr *bp;
 	int extlen, pktlen, iplen;
 	int eth_hdr_size;
-#ifdef CONFIG_BOOTP_RANDOM_DELAY
-	ulong rand_ms;
-#endif
-	u32 bootp_id;
 	struct in_addr zero_ip;
 	struct in_addr bcast_ip;
-	char *ep;  /* Environment pointer */
-
-	bootstage_mark_name(BOOTSTAGE_ID_BOOTP_START, "bootp_start");
-#if defined(CONFIG_CMD_DHCP)
-	dhcp_state = INIT;
-#endif
-
-	ep = env_get("bootpretryperiod");
-	if (ep != NULL)
-		time_taken_max = dectoul(ep, NULL);
-	else
-		time_taken_max = TIMEOUT_MS;
-
-#ifdef CONFIG_BOOTP_RANDOM_DELAY		/* Random BOOTP delay */
-	if (bootp_try == 0)
-		srand_mac();
 
-	if (bootp_try <= 2)	/* Start with max 1024 * 1ms */
-		rand_ms = rand() >> (22 - bootp_try);
-	else		/* After 3rd BOOTP request max 8192 * 1ms */
-		rand_ms = rand() >> 19;
-
-	printf("Random delay: %ld ms...\n", rand_ms);
-	mdelay(rand_ms);
-
-#endif	/* CONFIG_BOOTP_RANDOM_DELAY */
-
-	printf("BOOTP broadcast %d\n", ++bootp_try);
 	pkt = net_tx_packet;
 	memset((void *)pkt, 0, PKTSIZE);
 
@@ -799,6 +774,53 @@ void bootp_request(void)
 #else
 	extlen = bootp_extended((u8 *)bp->bp_vend);
 #endif
+	net_copy_u32(&bp->bp_id, &bootp_req_id);
+
+	/*
+	 * Calculate proper packet lengths taking into account the
+	 * variable size of the options field
+	 */
+	iplen = BOOTP_HDR_SIZE - OPT_FIELD_SIZE + extlen;
+	pktlen = eth_hdr_size + IP_UDP_HDR_SIZE + iplen;
+	bcast_ip.s_addr = 0xFFFFFFFFL;
+	net_set_udp_header(iphdr, bcast_ip, PORT_BOOTPS, PORT_BOOTPC, iplen);
+	net_send_packet(net_tx_packet, pktlen);
+}
+
+void bootp_request(void)
+{
+#ifdef CONFIG_BOOTP_RANDOM_DELAY
+	ulong rand_ms;
+#endif
+	u32 bootp_id;
+	char *ep;  /* Environment pointer */
+
+	bootstage_mark_name(BOOTSTAGE_ID_BOOTP_START, "bootp_start");
+#if defined(CONFIG_CMD_DHCP)
+	dhcp_state = INIT;
+#endif
+
+	ep = env_get("bootpretryperiod");
+	if (ep != NULL)
+		time_taken_max = dectoul(ep, NULL);
+	else
+		time_taken_max = TIMEOUT_MS;
+
+#ifdef CONFIG_BOOTP_RANDOM_DELAY		/* Random BOOTP delay */
+	if (bootp_try == 0)
+		srand_mac();
+
+	if (bootp_try <= 2)	/* Start with max 1024 * 1ms */
+		rand_ms = rand() >> (22 - bootp_try);
+	else		/* After 3rd BOOTP request max 8192 * 1ms */
+		rand_ms = rand() >> 19;
+
+	printf("Random delay: %ld ms...\n", rand_ms);
+	mdelay(rand_ms);
+
+#endif	/* CONFIG_BOOTP_RANDOM_DELAY */
+
+	printf("BOOTP broadcast %d\n", ++bootp_try);
 
 	/*
 	 *	Bootp ID is the lower 4 bytes of our ethernet address
@@ -811,16 +833,7 @@ void bootp_request(void)
 	bootp_id += get_timer(0);
 	bootp_id = htonl(bootp_id);
 	bootp_add_id(bootp_id);
-	net_copy_u32(&bp->bp_id, &bootp_id);
-
-	/*
-	 * Calculate proper packet lengths taking into account the
-	 * variable size of the options field
-	 */
-	iplen = BOOTP_HDR_SIZE - OPT_FIELD_SIZE + extlen;
-	pktlen = eth_hdr_size + IP_UDP_HDR_SIZE + iplen;
-	bcast_ip.s_addr = 0xFFFFFFFFL;
-	net_set_udp_header(iphdr, bcast_ip, PORT_BOOTPS, PORT_BOOTPC, iplen);
+	bootp_req_id = bootp_id;
 	net_set_timeout_handler(bootp_timeout, bootp_timeout_handler);
 
 #if defined(CONFIG_CMD_DHCP)
@@ -829,7 +842,7 @@ void bootp_request(void)
 #else
 	net_set_udp_handler(bootp_handler);
 #endif
-	net_send_packet(net_tx_packet, pktlen);
+	eth_race_send(bootp_send_request);
 }
 
 #if defined(CONFIG_CMD_DHCP)
@@ -1101,6 +1114,8 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			    CONFIG_SYS_BOOTFILE_PREFIX,
 			    strlen(CONFIG_SYS_BOOTFILE_PREFIX)) == 0) {
 #endif	/* CONFIG_SYS_BOOTFILE_PREFIX */
+			/* Stay on the interface which got the offer */
+			eth_race_won();
 			if (CONFIG_IS_ENABLED(UNIT_TEST) &&
 			    dhcp_message_type((u8 *)bp->bp_vend) == -1) {
 				debug("got BOOTP response; transitioning to BOUND\n");
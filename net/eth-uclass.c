@@ -12,8 +12,10 @@
 #include <dm.h>
 #include <env.h>
 #include <log.h>
+#include <mapmem.h>
 #include <net.h>
 #include <nvmem.h>
+#include <phy.h>
 #include <asm/global_data.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
@@ -27,10 +29,14 @@ DECLARE_GLOBAL_DATA_PTR;
  * struct eth_device_priv - private structure for each Ethernet device
  *
  * @state: The state of the Ethernet MAC driver (defined by enum eth_state_t)
+ * @rx_stats: Statistics of the frames received by the device
+ * @racing: The device is taking part in a race, see eth_race_send()
  */
 struct eth_device_priv {
 	enum eth_state_t state;
 	bool running;
+	struct eth_rx_stats rx_stats;
+	bool racing;
 };
 
 /**
@@ -50,6 +56,18 @@ static int eth_errno;
 /* Are we currently in eth_init() or eth_halt()? */
 static bool in_init_halt;
 
+#if CONFIG_IS_ENABLED(NET_RACE)
+/* Time between attempts to start the interfaces with no link in a race */
+#define ETH_RACE_RETRY_MS	500
+
+/* Are the interfaces racing to reach the network? */
+static bool eth_racing;
+/* When the race started */
+static ulong eth_race_start_time;
+/* When the interfaces with no link were last tried */
+static ulong eth_race_retry_time;
+#endif
+
 /* board-specific Ethernet Interface initializations. */
 __weak int board_interface_eth_init(struct udevice *dev,
 				    phy_interface_t interface_type)
@@ -305,6 +323,138 @@ int eth_start_udev(struct udevice *dev)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(NET_RACE)
+static bool eth_race_enabled(void)
+{
+	const char *ethrotate = env_get("ethrotate");
+
+	return ethrotate && !strcmp(ethrotate, "race");
+}
+
+/* Make @dev the current device while it takes its turn in the race */
+static void eth_race_select(struct udevice *dev)
+{
+	struct eth_pdata *pdata = dev_get_plat(dev);
+
+	eth_get_uclass_priv()->current = dev;
+	memcpy(net_ethaddr, pdata->enetaddr, ARP_HLEN);
+}
+
+/* Try to start the devices in the race which are not running yet */
+static void eth_race_try_start(void)
+{
+	struct eth_device_priv *priv;
+	struct udevice *dev;
+	struct uclass *uc;
+
+	eth_race_retry_time = get_timer(0);
+	uclass_id_foreach_dev(UCLASS_ETH, dev, uc) {
+		priv = dev_get_uclass_priv(dev);
+		if (priv && priv->racing && !priv->running &&
+		    !eth_start_udev(dev))
+			debug("%s: started after %lu ms\n", dev->name,
+			      get_timer(eth_race_start_time));
+	}
+}
+
+/* Stop all the devices in the race other than @winner */
+static void eth_race_end(struct udevice *winner)
+{
+	struct eth_device_priv *priv;
+	struct udevice *dev;
+	struct uclass *uc;
+
+	uclass_id_foreach_dev(UCLASS_ETH, dev, uc) {
+		priv = dev_get_uclass_priv(dev);
+		if (!priv || !priv->racing)
+			continue;
+		priv->racing = false;
+		if (dev != winner && priv->running) {
+			eth_get_ops(dev)->stop(dev);
+			priv->state = ETH_STATE_PASSIVE;
+			priv->running = false;
+		}
+	}
+	eth_racing = false;
+	if (IS_ENABLED(CONFIG_PHYLIB))
+		phy_set_aneg_wait(true);
+}
+
+/*
+ * Start all the devices at once. Those without a link, including those still
+ * autonegotiating, are tried again from eth_rx() until one gets a reply.
+ */
+static int eth_race_start(void)
+{
+	struct eth_device_priv *priv;
+	struct udevice *dev, *first = NULL;
+
+	bootstage_mark_name(BOOTSTAGE_ID_ETH_RACE_START, "eth_race_start");
+	if (IS_ENABLED(CONFIG_PHYLIB))
+		phy_set_aneg_wait(false);
+
+	uclass_foreach_dev_probe(UCLASS_ETH, dev) {
+		/* DSA ports share their conduit, which takes part instead */
+		if (IS_ENABLED(CONFIG_DM_DSA) &&
+		    device_get_uclass_id(dev_get_parent(dev)) == UCLASS_DSA)
+			continue;
+		priv = dev_get_uclass_priv(dev);
+		priv->racing = true;
+		if (!first)
+			first = dev;
+	}
+	if (!first) {
+		log_err("No ethernet found.\n");
+		return -ENODEV;
+	}
+
+	eth_racing = true;
+	eth_race_start_time = get_timer(0);
+	eth_race_try_start();
+	eth_race_select(first);
+
+	return 0;
+}
+
+void eth_race_send(void (*send)(void))
+{
+	struct udevice *current = eth_get_dev();
+	struct eth_device_priv *priv;
+	struct udevice *dev;
+	struct uclass *uc;
+
+	if (!eth_racing) {
+		send();
+		return;
+	}
+
+	uclass_id_foreach_dev(UCLASS_ETH, dev, uc) {
+		priv = dev_get_uclass_priv(dev);
+		if (priv && priv->racing && priv->running) {
+			eth_race_select(dev);
+			send();
+		}
+	}
+	eth_race_select(current);
+}
+
+bool eth_race_won(void)
+{
+	struct udevice *winner = eth_get_dev();
+
+	if (!eth_racing)
+		return false;
+
+	eth_race_end(winner);
+	bootstage_mark_name(BOOTSTAGE_ID_ETH_RACE_WON, "eth_race_won");
+	printf("Using %s, replied after %lu ms\n", winner->name,
+	       get_timer(eth_race_start_time));
+	eth_current_changed();
+
+	return true;
+}
+#endif
+
 int eth_init(void)
 {
 	struct udevice *current = NULL;
@@ -318,6 +468,13 @@ int eth_init(void)
 
 	in_init_halt = true;
 
+#if CONFIG_IS_ENABLED(NET_RACE)
+	if (eth_race_enabled()) {
+		ret = eth_race_start();
+		goto end;
+	}
+#endif
+
 	ethact = env_get("ethact");
 	ethrotate = env_get("ethrotate");
 
@@ -384,6 +541,13 @@ void eth_halt(void)
 
 	in_init_halt = true;
 
+#if CONFIG_IS_ENABLED(NET_RACE)
+	if (eth_racing) {
+		eth_race_end(NULL);
+		goto end;
+	}
+#endif
+
 	current = eth_get_dev();
 	if (!current)
 		goto end;
@@ -435,40 +599,206 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
-int eth_rx(void)
+int eth_mcast_join(struct in_addr mcast_ip, int join)
 {
-	struct udevice *current;
-	uchar *packet;
-	int flags;
-	int ret;
-	int i;
+	struct udevice *dev = eth_get_dev();
+	u32 ip = ntohl(mcast_ip.s_addr);
+	u8 mcast_mac[ARP_HLEN];
+
+	if (!dev || !eth_get_ops(dev)->mcast)
+		return -ENOSYS;
+
+	/* RFC 1112: the low 23 bits of the group go in 01:00:5e:00:00:00 */
+	mcast_mac[0] = 0x01;
+	mcast_mac[1] = 0x00;
+	mcast_mac[2] = 0x5e;
+	mcast_mac[3] = (ip >> 16) & 0x7f;
+	mcast_mac[4] = (ip >> 8) & 0xff;
+	mcast_mac[5] = ip & 0xff;
+
+	return eth_get_ops(dev)->mcast(dev, mcast_mac, join);
+}
+
+void eth_count_rx(struct udevice *dev, int len)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	priv->rx_stats.frames++;
+	priv->rx_stats.bytes += len;
+}
+
+void eth_count_rx_drop(struct udevice *dev)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	priv->rx_stats.drops++;
+}
+
+void eth_count_rx_copy(struct udevice *dev, ulong len)
+{
+	struct eth_device_priv *priv;
+
+	if (!dev)
+		dev = eth_get_dev();
+	if (!dev)
+		return;
+	priv = dev_get_uclass_priv(dev);
+	priv->rx_stats.copied += len;
+}
+
+/* Account for a payload passed on by a protocol */
+static void eth_count_rx_stored(ulong len)
+{
+	struct udevice *current = eth_get_dev();
+	struct eth_device_priv *priv;
 
-	current = eth_get_dev();
 	if (!current)
+		return;
+	priv = dev_get_uclass_priv(current);
+	priv->rx_stats.stored++;
+	priv->rx_stats.stored_bytes += len;
+}
+
+int eth_rx_store(ulong addr, const void *src, ulong len)
+{
+	void *ptr;
+
+	ptr = map_sysmem(addr, len);
+	memcpy(ptr, src, len);
+	unmap_sysmem(ptr);
+
+	eth_count_rx_stored(len);
+	eth_count_rx_copy(NULL, len);
+
+	return 0;
+}
+
+/* Sink which downloaded payloads go to, NULL to store them in memory */
+static const struct eth_rx_sink *eth_rx_sink;
+
+int eth_rx_set_sink(const struct eth_rx_sink *sink)
+{
+	if (sink && eth_rx_sink && sink != eth_rx_sink) {
+		log_err("Cannot use sink '%s', '%s' is active\n", sink->name,
+			eth_rx_sink->name);
+		return -EBUSY;
+	}
+	eth_rx_sink = sink;
+
+	return 0;
+}
+
+const struct eth_rx_sink *eth_rx_get_sink(void)
+{
+	return eth_rx_sink;
+}
+
+int eth_rx_sink_store(ulong offset, const void *src, ulong len)
+{
+	if (!eth_rx_sink)
 		return -ENODEV;
+	eth_count_rx_stored(len);
 
-	if (!eth_is_active(current))
-		return -EINVAL;
+	return eth_rx_sink->store(offset, src, len);
+}
+
+int eth_get_rx_stats(struct udevice *dev, struct eth_rx_stats *stats)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	if (!priv)
+		return -ENODEV;
+	*stats = priv->rx_stats;
+
+	return 0;
+}
 
-	/* Process up to 32 packets at one time */
+static int eth_rx_dev(struct udevice *current)
+{
+	struct eth_device_priv *priv;
+	uchar *packet;
+	int flags;
+	int ret;
+	int i;
+
+	/* Process up to CONFIG_ETH_RX_BATCH packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
 	for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
 		ret = eth_get_ops(current)->recv(current, flags, &packet);
 		flags = 0;
-		if (ret > 0)
+		if (ret > 0) {
+			eth_count_rx(current, ret);
 			net_process_received_packet(packet, ret);
+		}
 		if (ret >= 0 && eth_get_ops(current)->free_pkt)
 			eth_get_ops(current)->free_pkt(current, packet, ret);
 		if (ret <= 0)
 			break;
 	}
-	if (ret == -EAGAIN)
-		ret = 0;
-	if (ret < 0) {
+
+	priv = dev_get_uclass_priv(current);
+	if (i) {
+		priv->rx_stats.polls++;
+		if (i > priv->rx_stats.max_per_poll)
+			priv->rx_stats.max_per_poll = i;
+		if (i == ETH_PACKETS_BATCH_RECV)
+			priv->rx_stats.ring_full++;
+	}
+	if (ret < 0 && ret != -EAGAIN) {
+		priv->rx_stats.errors++;
 		/* We cannot completely return the error at present */
 		debug("%s: recv() returned error %d\n", __func__, ret);
 	}
-	return ret;
+
+	return i;
+}
+
+#if CONFIG_IS_ENABLED(NET_RACE)
+/* Receive on each device in the race, until one gets the reply wanted */
+static int eth_race_rx(void)
+{
+	struct eth_device_priv *priv;
+	struct udevice *dev;
+	struct uclass *uc;
+	int count = 0;
+	int ret;
+
+	if (get_timer(eth_race_retry_time) >= ETH_RACE_RETRY_MS)
+		eth_race_try_start();
+
+	uclass_id_foreach_dev(UCLASS_ETH, dev, uc) {
+		priv = dev_get_uclass_priv(dev);
+		if (!priv || !priv->racing || !priv->running)
+			continue;
+		eth_race_select(dev);
+		ret = eth_rx_dev(dev);
+		if (ret > 0)
+			count += ret;
+		if (!eth_racing)
+			break;
+	}
+
+	return count;
+}
+#endif
+
+int eth_rx(void)
+{
+	struct udevice *current;
+
+#if CONFIG_IS_ENABLED(NET_RACE)
+	if (eth_racing)
+		return eth_race_rx();
+#endif
+
+	current = eth_get_dev();
+	if (!current)
+		return -ENODEV;
+
+	if (!eth_is_active(current))
+		return -EINVAL;
+
+	return eth_rx_dev(current);
 }
 
 int eth_initialize(void)
@@ -0,0 +1,326 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Fastboot over TCP using lwIP
+ *
+ * Each message after the "FB01" handshake is a 64-bit big-endian length
+ * followed by the payload. Unlike the legacy stack, messages may span any
+ * number of segments, so large downloads stream straight from the received
+ * pbufs into the fastboot buffer with the full lwIP receive window open.
+ */
+
+#include <console.h>
+#include <dm/device.h>
+#include <fastboot.h>
+#include <lwip/tcp.h>
+#include <lwip/timeouts.h>
+#include <net.h>
+#include <net/fastboot_tcp.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/unaligned/be_byteshift.h>
+
+#define FASTBOOT_TCP_PORT	5554
+#define HANDSHAKE		"FB01"
+#define HANDSHAKE_LEN		4
+#define LENGTH_LEN		8
+
+enum fastboot_tcp_state {
+	FASTBOOT_TCP_HANDSHAKE,	/* Waiting for the client's handshake */
+	FASTBOOT_TCP_LENGTH,	/* Reading the length of a message */
+	FASTBOOT_TCP_COMMAND,	/* Reading a command */
+	FASTBOOT_TCP_DATA,	/* Reading data for a download */
+};
+
+/**
+ * struct fastboot_tcp_ctx - State of the fastboot connection
+ *
+ * @pcb: Connection to the client, NULL if there is none
+ * @state: What the next bytes received are
+ * @hdr: Handshake or message length received so far
+ * @hdr_len: Number of bytes in @hdr
+ * @left: Bytes of the current message not yet received
+ * @downloading: true if the client was told to send data
+ * @cmd_len: Number of bytes in @command
+ * @command: Command received so far
+ * @response: Response to send to the client
+ */
+struct fastboot_tcp_ctx {
+	struct tcp_pcb *pcb;
+	enum fastboot_tcp_state state;
+	u8 hdr[LENGTH_LEN];
+	uint hdr_len;
+	u64 left;
+	bool downloading;
+	uint cmd_len;
+	char command[FASTBOOT_COMMAND_LEN];
+	char response[FASTBOOT_RESPONSE_LEN];
+};
+
+static int fastboot_tcp_send(struct fastboot_tcp_ctx *ctx, const char *msg)
+{
+	u8 len[LENGTH_LEN];
+	err_t err;
+
+	put_unaligned_be64(strlen(msg), len);
+	err = tcp_write(ctx->pcb, len, sizeof(len),
+			TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE);
+	if (!err)
+		err = tcp_write(ctx->pcb, msg, strlen(msg),
+				TCP_WRITE_FLAG_COPY);
+	if (!err)
+		err = tcp_output(ctx->pcb);
+
+	return err ? -EIO : 0;
+}
+
+static int fastboot_tcp_command(struct fastboot_tcp_ctx *ctx)
+{
+	int cmd;
+	int ret;
+
+	ctx->command[ctx->cmd_len] = '\0';
+	cmd = fastboot_handle_command(ctx->command, ctx->response);
+	ret = fastboot_tcp_send(ctx, ctx->response);
+	if (ret)
+		return ret;
+	ctx->downloading = !strncmp("DATA", ctx->response, 4);
+	fastboot_handle_boot(cmd, !strncmp("OKAY", ctx->response, 4));
+
+	return 0;
+}
+
+static int fastboot_tcp_header(struct fastboot_tcp_ctx *ctx)
+{
+	ctx->hdr_len = 0;
+	if (ctx->state == FASTBOOT_TCP_HANDSHAKE) {
+		if (memcmp(ctx->hdr, HANDSHAKE, HANDSHAKE_LEN))
+			return -EPROTO;
+		ctx->state = FASTBOOT_TCP_LENGTH;
+		if (tcp_write(ctx->pcb, HANDSHAKE, HANDSHAKE_LEN, 0) ||
+		    tcp_output(ctx->pcb))
+			return -EIO;
+		return 0;
+	}
+
+	ctx->left = get_unaligned_be64(ctx->hdr);
+	if (!ctx->left)
+		return 0;
+	if (ctx->downloading) {
+		if (ctx->left > fastboot_data_remaining())
+			return -EMSGSIZE;
+		ctx->state = FASTBOOT_TCP_DATA;
+	} else {
+		if (ctx->left >= FASTBOOT_COMMAND_LEN)
+			return -EMSGSIZE;
+		ctx->cmd_len = 0;
+		ctx->state = FASTBOOT_TCP_COMMAND;
+	}
+
+	return 0;
+}
+
+/**
+ * fastboot_tcp_input() - Process bytes received from the client
+ *
+ * Download data is copied straight from @data into the fastboot buffer.
+ *
+ * @ctx: Connection state
+ * @data: Bytes received
+ * @len: Number of bytes
+ * Return: 0 if OK, -ve if the connection must be dropped
+ */
+static int fastboot_tcp_input(struct fastboot_tcp_ctx *ctx, const u8 *data,
+			      uint len)
+{
+	uint want;
+	uint n;
+	int ret;
+
+	while (len) {
+		switch (ctx->state) {
+		case FASTBOOT_TCP_HANDSHAKE:
+		case FASTBOOT_TCP_LENGTH:
+			want = ctx->state == FASTBOOT_TCP_HANDSHAKE ?
+				HANDSHAKE_LEN : LENGTH_LEN;
+			n = min(len, want - ctx->hdr_len);
+			memcpy(ctx->hdr + ctx->hdr_len, data, n);
+			ctx->hdr_len += n;
+			if (ctx->hdr_len == want) {
+				ret = fastboot_tcp_header(ctx);
+				if (ret)
+					return ret;
+			}
+			break;
+		case FASTBOOT_TCP_COMMAND:
+			n = min_t(u64, len, ctx->left);
+			memcpy(ctx->command + ctx->cmd_len, data, n);
+			ctx->cmd_len += n;
+			ctx->left -= n;
+			if (!ctx->left) {
+				ctx->state = FASTBOOT_TCP_LENGTH;
+				ret = fastboot_tcp_command(ctx);
+				if (ret)
+					return ret;
+			}
+			break;
+		case FASTBOOT_TCP_DATA:
+			n = min_t(u64, len, ctx->left);
+			fastboot_data_download(data, n, ctx->response);
+			if (*ctx->response)
+				return -EIO;
+			ctx->left -= n;
+			if (!ctx->left)
+				ctx->state = FASTBOOT_TCP_LENGTH;
+			if (!fastboot_data_remaining()) {
+				ctx->downloading = false;
+				fastboot_data_complete(ctx->response);
+				ret = fastboot_tcp_send(ctx, ctx->response);
+				if (ret)
+					return ret;
+			}
+			break;
+		}
+		data += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static void fastboot_tcp_drop(struct fastboot_tcp_ctx *ctx)
+{
+	tcp_arg(ctx->pcb, NULL);
+	tcp_recv(ctx->pcb, NULL);
+	tcp_err(ctx->pcb, NULL);
+	ctx->pcb = NULL;
+}
+
+static err_t fastboot_tcp_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
+			       err_t err)
+{
+	struct fastboot_tcp_ctx *ctx = arg;
+	struct pbuf *q;
+	int ret = 0;
+
+	if (!p) {
+		/* The client closed the connection */
+		fastboot_tcp_drop(ctx);
+		if (!tcp_close(pcb))
+			return ERR_OK;
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+
+	for (q = p; q && !ret; q = q->next)
+		ret = fastboot_tcp_input(ctx, q->payload, q->len);
+	if (ret) {
+		log_err("fastboot: dropping connection (err=%d)\n", ret);
+		pbuf_free(p);
+		fastboot_tcp_drop(ctx);
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+
+	tcp_recved(pcb, p->tot_len);
+	pbuf_free(p);
+
+	return ERR_OK;
+}
+
+static void fastboot_tcp_err(void *arg, err_t err)
+{
+	struct fastboot_tcp_ctx *ctx = arg;
+
+	/* lwIP has already freed the pcb */
+	ctx->pcb = NULL;
+}
+
+static err_t fastboot_tcp_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+	struct fastboot_tcp_ctx *ctx = arg;
+
+	if (err || !pcb)
+		return ERR_VAL;
+
+	/* Only one client at a time */
+	if (ctx->pcb) {
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+
+	ctx->pcb = pcb;
+	ctx->state = FASTBOOT_TCP_HANDSHAKE;
+	ctx->hdr_len = 0;
+	ctx->downloading = false;
+	tcp_arg(pcb, ctx);
+	tcp_recv(pcb, fastboot_tcp_recv);
+	tcp_err(pcb, fastboot_tcp_err);
+	tcp_nagle_disable(pcb);
+
+	return ERR_OK;
+}
+
+int fastboot_tcp_loop(void)
+{
+	struct fastboot_tcp_ctx ctx = {};
+	struct tcp_pcb *listen;
+	struct tcp_pcb *pcb;
+	struct udevice *udev;
+	struct netif *netif;
+	int ret = 0;
+
+	eth_set_current();
+	udev = eth_get_dev();
+	if (!udev)
+		return -ENODEV;
+
+	netif = net_lwip_new_netif(udev);
+	if (!netif)
+		return -ENODEV;
+
+	pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+	if (!pcb) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	if (tcp_bind(pcb, IP_ANY_TYPE, FASTBOOT_TCP_PORT)) {
+		tcp_abort(pcb);
+		ret = -EADDRINUSE;
+		goto out;
+	}
+	listen = tcp_listen(pcb);
+	if (!listen) {
+		tcp_abort(pcb);
+		ret = -ENOMEM;
+		goto out;
+	}
+	tcp_arg(listen, &ctx);
+	tcp_accept(listen, fastboot_tcp_accept);
+
+	printf("Using %s device\n", udev->name);
+	printf("Listening for fastboot command on tcp %pI4\n",
+	       &netif->ip_addr);
+
+	net_set_state(NETLOOP_CONTINUE);
+	while (net_state == NETLOOP_CONTINUE) {
+		net_lwip_rx(udev, netif);
+		sys_check_timeouts();
+		if (ctrlc()) {
+			printf("\nAbort\n");
+			ret = -EINTR;
+			break;
+		}
+	}
+
+	if (ctx.pcb) {
+		pcb = ctx.pcb;
+		fastboot_tcp_drop(&ctx);
+		if (tcp_close(pcb))
+			tcp_abort(pcb);
+	}
+	tcp_close(listen);
+out:
+	net_lwip_remove_netif(netif);
+
+	return ret;
+}
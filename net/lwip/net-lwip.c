@@ -13,6 +13,7 @@
 #include <lwip/init.h>
 #include <lwip/prot/etharp.h>
 #include <net.h>
+#include <net/fastboot_tcp.h>
 
 /* xx:xx:xx:xx:xx:xx\0 */
 #define MAC_ADDR_STRLEN 18
@@ -21,6 +22,8 @@
 void (*push_packet)(void *, int len) = 0;
 #endif
 int net_restart_wrap;
+/* Network loop state */
+enum net_loop_state net_state;
 static uchar net_pkt_buf[(PKTBUFSRX) * PKTSIZE_ALIGN + PKTALIGN];
 uchar *net_rx_packets[PKTBUFSRX];
 uchar *net_rx_packet;
@@ -36,18 +39,20 @@ static err_t linkoutput(struct netif *netif, struct pbuf *p)
 	void *pp = NULL;
 	int err;
 
-	if ((unsigned long)p->payload % PKTALIGN) {
+	if ((unsigned long)p->payload % PKTALIGN || p->next) {
 		/*
 		 * Some net drivers have strict alignment requirements and may
 		 * fail or output invalid data if the packet is not aligned.
+		 * Drivers also take a single buffer, so flatten any chain, as
+		 * TCP makes when data is written without copying it.
 		 */
-		pp = memalign(PKTALIGN, p->len);
+		pp = memalign(PKTALIGN, p->tot_len);
 		if (!pp)
 			return ERR_ABRT;
-		memcpy(pp, p->payload, p->len);
+		pbuf_copy_partial(p, pp, p->tot_len, 0);
 	}
 
-	err = eth_get_ops(udev)->send(udev, pp ? pp : p->payload, p->len);
+	err = eth_get_ops(udev)->send(udev, pp ? pp : p->payload, p->tot_len);
 	free(pp);
 	if (err) {
 		log_err("send error %d\n", err);
@@ -260,6 +265,7 @@ int net_lwip_rx(struct udevice *udev, struct netif *netif)
 		flags = 0;
 
 		if (len > 0) {
+			eth_count_rx(udev, len);
 			pbuf = alloc_pbuf_and_copy(packet, len);
 			if (pbuf)
 				netif->input(pbuf, netif);
@@ -291,6 +297,10 @@ int net_loop(enum proto_t protocol)
 	case TFTPGET:
 		argv[0] = "tftpboot";
 		return do_tftpb(NULL, 0, 1, argv);
+	case FASTBOOT_TCP:
+		if (IS_ENABLED(CONFIG_TCP_FUNCTION_FASTBOOT))
+			return fastboot_tcp_loop();
+		return -EINVAL;
 	default:
 		return -EINVAL;
 	}
@@ -99,6 +99,7 @@
 #if defined(CONFIG_CMD_PCAP)
 #include <net/pcap.h>
 #endif
+#include <net/sink.h>
 #include <net/udp.h>
 #if defined(CONFIG_LED_STATUS)
 #include <miiphy.h>
@@ -150,6 +151,10 @@ u8 net_server_ethaddr[6];
 struct in_addr	net_ip;
 /* Server IP addr (0 = unknown) */
 struct in_addr	net_server_ip;
+#ifdef CONFIG_TFTP_MCAST
+/* Multicast group joined for TFTP (0 = none) */
+struct in_addr	net_mcast_addr;
+#endif
 /* Current receive packet */
 uchar *net_rx_packet;
 /* Current rx packet length */
@@ -435,10 +440,15 @@ int net_loop(enum proto_t protocol)
 {
 	int ret = -EINVAL;
 	enum net_loop_state prev_net_state = net_state;
+	int budget, rx;
+	bool sunk;
 
 #if defined(CONFIG_CMD_PING)
 	if (protocol != PING)
 		net_ping_ip.s_addr = 0;
+#endif
+#ifdef CONFIG_TFTP_MCAST
+	tftp_mcast_reset();
 #endif
 	net_restarted = 0;
 	net_dev_exists = 0;
@@ -482,6 +492,7 @@ restart:
 	 */
 	debug_cond(DEBUG_INT_STATE, "--- net_loop Init\n");
 	net_init_loop();
+	net_sink_start();
 
 	if (!test_eth_enabled())
 		return 0;
@@ -648,10 +659,20 @@ restart:
 		/*
 		 *	Check the ethernet for a new packet.  The ethernet
 		 *	receive routine will process it.
-		 *	Most drivers return the most recent packet size, but not
-		 *	errors that may have happened.
+		 *	Keep polling while the device has packets waiting, up
+		 *	to the budget, so that a burst is drained before the
+		 *	timers and the console are looked at.
 		 */
-		eth_rx();
+		budget = CONFIG_NET_RX_BUDGET;
+		do {
+			rx = eth_rx();
+			budget -= rx;
+		} while (rx == ETH_PACKETS_BATCH_RECV && budget > 0 &&
+			 net_state == NETLOOP_CONTINUE);
+
+		/* Acknowledge what the burst brought in */
+		if (IS_ENABLED(CONFIG_PROT_TCP))
+			tcp_flush_acks();
 
 		/*
 		 *	Abort if ctrl-c was pressed.
@@ -722,11 +743,19 @@ restart:
 
 		case NETLOOP_SUCCESS:
 			net_cleanup_loop();
+			sunk = net_sink_active();
+			if (sunk && net_sink_finish(net_boot_file_size)) {
+				eth_halt();
+				eth_set_last_protocol(BOOTP);
+				ret = -EIO;
+				goto done;
+			}
 			if (net_boot_file_size > 0) {
 				printf("Bytes transferred = %u (%x hex)\n",
 				       net_boot_file_size, net_boot_file_size);
 				env_set_hex("filesize", net_boot_file_size);
-				env_set_hex("fileaddr", image_load_addr);
+				if (!sunk)
+					env_set_hex("fileaddr", image_load_addr);
 			}
 			if (protocol != NETCONS && protocol != NCSI)
 				eth_halt();
@@ -911,6 +940,9 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 int net_send_tcp_packet(int payload_len, int dport, int sport, u8 action,
 			u32 tcp_seq_num, u32 tcp_ack_num)
 {
+	if (tcp_ack_delayed(dport, sport, payload_len, action, tcp_seq_num))
+		return 0;
+
 	return net_send_ip_packet(net_server_ethaddr, net_server_ip, dport,
 				  sport, payload_len, IPPROTO_TCP, action,
 				  tcp_seq_num, tcp_ack_num);
@@ -1353,6 +1385,10 @@ void net_process_received_packet(uchar *in_packet, int len)
 		dst_ip = net_read_ip(&ip->ip_dst);
 		if (net_ip.s_addr && dst_ip.s_addr != net_ip.s_addr &&
 		    dst_ip.s_addr != 0xFFFFFFFF) {
+#ifdef CONFIG_TFTP_MCAST
+			if (!net_mcast_addr.s_addr ||
+			    dst_ip.s_addr != net_mcast_addr.s_addr)
+#endif
 				return;
 		}
 		/* Read source IP address for later use */
@@ -50,12 +50,53 @@
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
+/* Amount of data received for each '#' */
+#define NFS_HASH_BYTES	(NFS_READ_SIZE / 2 * 10)
+
+/* Room left in a READ reply for the RPC header and the file attributes */
+#define NFS_READ_HDR_SIZE	((6 + NFS_MAX_ATTRS) * sizeof(uint32_t))
+
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
-static int nfs_len;
 static const ulong nfs_timeout = CONFIG_NFS_TIMEOUT;
 
+/**
+ * struct nfs_read_slot - a READ request waiting for its reply
+ *
+ * @xid:	RPC transaction ID of the request, 0 if the slot is free
+ * @offset:	offset in the file of the requested data
+ * @len:	number of bytes requested
+ */
+struct nfs_read_slot {
+	ulong xid;
+	int offset;
+	int len;
+};
+
+static struct nfs_read_slot nfs_read_slots[CONFIG_NFS_READ_WINDOW];
+static int nfs_read_window;	/* number of slots currently in use */
+static int nfs_read_size;	/* bytes requested by each READ */
+static int nfs_in_flight;	/* number of slots waiting for a reply */
+static int nfs_next_offset;	/* offset of the next READ to send */
+static int nfs_file_end;	/* file size once known, else -1 */
+
+/**
+ * struct nfs_read_stats - statistics of a file transfer
+ *
+ * @start:	time the first READ was sent, in ms
+ * @bytes:	file data received
+ * @reads:	READ requests sent, not counting retransmissions
+ * @resends:	READ requests retransmitted after a timeout
+ */
+struct nfs_read_stats {
+	ulong start;
+	ulong bytes;
+	ulong reads;
+	ulong resends;
+};
+
+static struct nfs_read_stats nfs_stats;
+
 static char dirfh[NFS3_FHSIZE]; /* NFSv2 / NFSv3 file handle of directory */
 static unsigned int dirfh3_length; /* (variable) length of dirfh when NFSv3 */
 static char filefh[NFS3_FHSIZE]; /* NFSv2 / NFSv3 file handle */
@@ -101,7 +142,13 @@ static inline int store_block(uchar *src, unsigned offset, unsigned len)
 			break;
 		}
 	}
+#endif /* CONFIG_SYS_DIRECT_FLASH_NFS */
 
+	if (eth_rx_get_sink()) {
+		if (eth_rx_sink_store(offset, src, len))
+			return -1;
+	} else
+#ifdef CONFIG_SYS_DIRECT_FLASH_NFS
 	if (rc) { /* Flash is destination for this packet */
 		rc = flash_write((uchar *)src, (ulong)image_load_addr + offset,
 				 len);
@@ -112,10 +159,7 @@ static inline int store_block(uchar *src, unsigned offset, unsigned len)
 	} else
 #endif /* CONFIG_SYS_DIRECT_FLASH_NFS */
 	{
-		void *ptr = map_sysmem(image_load_addr + offset, len);
-
-		memcpy(ptr, src, len);
-		unmap_sysmem(ptr);
+		eth_rx_store(image_load_addr + offset, src, len);
 	}
 
 	if (net_boot_file_size < (offset + len))
@@ -179,17 +223,16 @@ static uint32_t *rpc_add_credentials(uint32_t *p)
 }
 
 /**************************************************************************
-RPC_LOOKUP - Lookup RPC Port numbers
+RPC_SEND - Send an RPC call with a given transaction ID
 **************************************************************************/
-static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+static void rpc_send(unsigned long id, int rpc_prog, int rpc_proc,
+		     uint32_t *data, int datalen)
 {
 	struct rpc_t rpc_pkt;
-	unsigned long id;
 	uint32_t *p;
 	int pktlen;
 	int sport;
 
-	id = ++rpc_id;
 	rpc_pkt.u.call.id = htonl(id);
 	rpc_pkt.u.call.type = htonl(MSG_CALL);
 	rpc_pkt.u.call.rpcvers = htonl(2);	/* use RPC version 2 */
@@ -256,6 +299,14 @@ static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
 			    nfs_our_port, pktlen);
 }
 
+/**************************************************************************
+RPC_REQ - Send an RPC call with a new transaction ID
+**************************************************************************/
+static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+{
+	rpc_send(++rpc_id, rpc_prog, rpc_proc, data, datalen);
+}
+
 /**************************************************************************
 RPC_LOOKUP - Lookup RPC Port numbers
 **************************************************************************/
@@ -395,7 +446,7 @@ static void nfs_lookup_req(char *fname)
 /**************************************************************************
 NFS_READ - Read File on NFS Server
 **************************************************************************/
-static void nfs_read_req(int offset, int readlen)
+static void nfs_read_req(struct nfs_read_slot *slot)
 {
 	uint32_t data[1024];
 	uint32_t *p;
@@ -407,22 +458,104 @@ static void nfs_read_req(int offset, int readlen)
 	if (choosen_nfs_version != NFS_V3) {
 		memcpy(p, filefh, NFS_FHSIZE);
 		p += (NFS_FHSIZE / 4);
-		*p++ = htonl(offset);
-		*p++ = htonl(readlen);
+		*p++ = htonl(slot->offset);
+		*p++ = htonl(slot->len);
 		*p++ = 0;
 	} else { /* NFS_V3 */
 		*p++ = htonl(filefh3_length);
 		memcpy(p, filefh, filefh3_length);
 		p += (filefh3_length / 4);
 		*p++ = htonl(0); /* offset is 64-bit long, so fill with 0 */
-		*p++ = htonl(offset);
-		*p++ = htonl(readlen);
+		*p++ = htonl(slot->offset);
+		*p++ = htonl(slot->len);
 		*p++ = 0;
 	}
 
 	len = (uint32_t *)p - (uint32_t *)&(data[0]);
 
-	rpc_req(PROG_NFS, NFS_READ, data, len);
+	rpc_send(slot->xid, PROG_NFS, NFS_READ, data, len);
+}
+
+/*
+ * Ask for @len bytes at @offset using @slot, which gets a new transaction ID
+ * so that late replies to an earlier use of the slot are dropped.
+ */
+static void nfs_read_issue(struct nfs_read_slot *slot, int offset, int len)
+{
+	if (!slot->xid)
+		nfs_in_flight++;
+	slot->xid = ++rpc_id;
+	slot->offset = offset;
+	slot->len = len;
+	nfs_stats.reads++;
+	nfs_read_req(slot);
+}
+
+/* Keep as many READ requests in flight as the window allows */
+static void nfs_read_fill(void)
+{
+	int i;
+
+	for (i = 0; i < nfs_read_window; i++) {
+		struct nfs_read_slot *slot = &nfs_read_slots[i];
+
+		if (slot->xid)
+			continue;
+		if (nfs_file_end >= 0 && nfs_next_offset >= nfs_file_end)
+			break;
+		nfs_read_issue(slot, nfs_next_offset, nfs_read_size);
+		nfs_next_offset += nfs_read_size;
+	}
+}
+
+/* Send again all READ requests still waiting for a reply */
+static void nfs_read_resend(void)
+{
+	int i;
+
+	for (i = 0; i < nfs_read_window; i++) {
+		if (nfs_read_slots[i].xid) {
+			nfs_stats.resends++;
+			nfs_read_req(&nfs_read_slots[i]);
+		}
+	}
+}
+
+/*
+ * Work out how much to ask for in each READ: a reply must fit in an Ethernet
+ * frame unless IP fragments are reassembled.
+ */
+static int nfs_get_read_size(void)
+{
+	int size = CONFIG_NFS_READ_SIZE;
+
+#ifdef CONFIG_IP_DEFRAG
+	size = min_t(int, size, CONFIG_NET_MAXDEFRAG - IP_UDP_HDR_SIZE -
+		     NFS_READ_HDR_SIZE);
+#else
+	size = NFS_READ_SIZE;
+#endif
+	if (choosen_nfs_version != NFS_V3)
+		size = min(size, NFS2_MAXDATA);
+
+	return max(rounddown(size, NFS_READ_SIZE), NFS_READ_SIZE);
+}
+
+static void nfs_read_start(void)
+{
+	memset(nfs_read_slots, '\0', sizeof(nfs_read_slots));
+	memset(&nfs_stats, '\0', sizeof(nfs_stats));
+	nfs_stats.start = get_timer(0);
+	nfs_read_size = nfs_get_read_size();
+	/*
+	 * Start with a single request: if the first read fails the file is
+	 * probably a symlink, which is dealt with before reading anything else
+	 */
+	nfs_read_window = 1;
+	nfs_in_flight = 0;
+	nfs_next_offset = 0;
+	nfs_file_end = -1;
+	nfs_read_fill();
 }
 
 /**************************************************************************
@@ -455,7 +588,7 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		nfs_read_resend();
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
@@ -711,19 +844,64 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	return 0;
 }
 
+static void nfs_show_progress(int rlen)
+{
+	ulong shown = DIV_ROUND_UP(nfs_stats.bytes, NFS_HASH_BYTES);
+
+	nfs_stats.bytes += rlen;
+	for (; shown < DIV_ROUND_UP(nfs_stats.bytes, NFS_HASH_BYTES); shown++) {
+		if (shown && !(shown % HASHES_PER_LINE))
+			puts("\n\t ");
+		putc('#');
+	}
+}
+
+static void nfs_show_stats(void)
+{
+	ulong time = get_timer(nfs_stats.start);
+
+	if (time > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(nfs_stats.bytes / time * 1000, "/s");
+	}
+	printf("\n\t %lu reads of up to %d bytes, window %d, %lu retransmitted",
+	       nfs_stats.reads, nfs_read_size, CONFIG_NFS_READ_WINDOW,
+	       nfs_stats.resends);
+}
+
+static void nfs_read_done(struct nfs_read_slot *slot)
+{
+	slot->xid = 0;
+	nfs_in_flight--;
+}
+
+/*
+ * Replies are matched to their request by transaction ID, so they can come
+ * in any order. The data is parsed in place, as it may be larger than
+ * struct rpc_t when IP fragments are reassembled.
+ */
 static int nfs_read_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
-	int rlen;
+	struct nfs_read_slot *slot = NULL;
+	unsigned long id;
+	int rlen, hdrlen, eof = 0;
 	uchar *data_ptr;
+	int i;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	memset(&rpc_pkt.u.data[0], '\0', NFS_READ_HDR_SIZE);
+	memcpy(&rpc_pkt.u.data[0], pkt, min_t(uint, len, NFS_READ_HDR_SIZE));
 
-	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
-		return -NFS_RPC_ERR;
-	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
+	id = ntohl(rpc_pkt.u.reply.id);
+	for (i = 0; id && i < nfs_read_window; i++) {
+		if (nfs_read_slots[i].xid == id) {
+			slot = &nfs_read_slots[i];
+			break;
+		}
+	}
+	if (!slot)
 		return -NFS_RPC_DROP;
 
 	if (rpc_pkt.u.reply.rstatus  ||
@@ -737,34 +915,46 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (choosen_nfs_version != NFS_V3) {
 		rlen = ntohl(rpc_pkt.u.reply.data[18]);
-		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
+		hdrlen = 19;
 	} else {  /* NFS_V3 */
 		int nfsv3_data_offset =
 			nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
 
 		/* count value */
 		rlen = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
-		/* Skip unused values :
-			EOF:		32 bits value,
+		eof = ntohl(rpc_pkt.u.reply.data[2 + nfsv3_data_offset]);
+		/* Skip unused value :
 			data_size:	32 bits value,
 		*/
-		data_ptr = (uchar *)
-			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
+		hdrlen = 4 + nfsv3_data_offset;
+	}
+	data_ptr = pkt + ((uchar *)&rpc_pkt.u.reply.data[hdrlen] -
+			  (uchar *)&rpc_pkt);
+
+	if (rlen < 0 || rlen > slot->len || data_ptr + rlen > pkt + len)
+		return -9999;
+
+	if (rlen && store_block(data_ptr, slot->offset, rlen))
+		return -9999;
+
+	nfs_show_progress(rlen);
+	/* the file can be read, so use the whole window from now on */
+	nfs_read_window = CONFIG_NFS_READ_WINDOW;
+
+	if (eof || (rlen < slot->len &&
+		    (choosen_nfs_version != NFS_V3 || !rlen))) {
+		/* the file ends here */
+		if (nfs_file_end < 0 || slot->offset + rlen < nfs_file_end)
+			nfs_file_end = slot->offset + rlen;
+		nfs_read_done(slot);
+	} else if (rlen < slot->len) {
+		/* NFSv3 servers may return less than asked; get the rest */
+		nfs_read_issue(slot, slot->offset + rlen, slot->len - rlen);
+	} else {
+		nfs_read_done(slot);
 	}
-
-	if (((uchar *)&(rpc_pkt.u.reply.data[0]) - (uchar *)(&rpc_pkt) + rlen) > len)
-			return -9999;
-
-	if (store_block(data_ptr, nfs_offset, rlen))
-			return -9999;
 
 	return rlen;
 }
@@ -794,7 +984,8 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 	debug("%s\n", __func__);
 
-	if (len > sizeof(struct rpc_t))
+	/* only READ replies may be larger, if IP fragments are reassembled */
+	if (len > sizeof(struct rpc_t) && nfs_state != STATE_READ_REQ)
 		return;
 
 	if (dest != nfs_our_port)
@@ -865,9 +1056,7 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			nfs_send();
 		} else {
 			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
-			nfs_send();
+			nfs_read_start();
 		}
 		break;
 
@@ -894,20 +1083,21 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		if (rlen == -NFS_RPC_DROP)
 			break;
 		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
-			nfs_send();
-		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
+		if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
-		} else {
-			if (!rlen)
-				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
-				debug("NFS READ error (%d)\n", rlen);
+		} else if (rlen < 0) {
+			debug("NFS READ error (%d)\n", rlen);
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
+		} else if (nfs_file_end >= 0 && !nfs_in_flight) {
+			nfs_show_stats();
+			nfs_download_state = NETLOOP_SUCCESS;
+			nfs_state = STATE_UMOUNT_REQ;
+			nfs_send();
+		} else {
+			nfs_read_fill();
 		}
 		break;
 	}
@@ -38,11 +38,13 @@
 /*
  * Block size used for NFS read accesses.  A RPC reply packet (including  all
  * headers) must fit within a single Ethernet frame to avoid fragmentation.
- * However, if CONFIG_IP_DEFRAG is set, a bigger value could be used.  In any
- * case, most NFS servers are optimized for a power of 2.
+ * However, if CONFIG_IP_DEFRAG is set, a bigger value could be used (see
+ * CONFIG_NFS_READ_SIZE).  In any case, most NFS servers are optimized for a
+ * power of 2.
  */
 #define NFS_READ_SIZE	1024	/* biggest power of two that fits Ether frame */
 #define NFS_MAX_ATTRS	26
+#define NFS2_MAXDATA	8192	/* largest READ reply of an NFSv2 server */
 
 /* Values for Accept State flag on RPC answers (See: rfc1831) */
 enum rpc_accept_stat {
@@ -0,0 +1,602 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Writing downloaded files straight to a storage device
+ *
+ * While a device is set, the sink is registered with eth_rx_set_sink() and
+ * protocols pass it the payload of each packet, still in the buffer the
+ * driver received it in. It is gathered in a ring buffer and written
+ * to the device a chunk at a time, as soon as the file is complete up to
+ * the end of the chunk. Writes to block devices are queued with
+ * blk_submit(), so that they overlap with the rest of the download on
+ * devices which support it.
+ */
+
+#include <blk.h>
+#include <hash.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <mtd.h>
+#include <net.h>
+#include <part.h>
+#include <linux/err.h>
+#include <net/sink.h>
+
+/* Number of blocks of data received out of order which can be tracked */
+#define SINK_AHEAD	16
+
+enum sink_type {
+	SINK_NONE,
+	SINK_BLK,
+	SINK_MTD,
+};
+
+/**
+ * struct sink_range - data received past the contiguous edge
+ *
+ * @start: Offset in the file of the first byte
+ * @end: Offset in the file after the last byte
+ */
+struct sink_range {
+	ulong start;
+	ulong end;
+};
+
+/**
+ * struct net_sink - where the next file downloaded is written
+ *
+ * Offsets in the file map to @buf modulo @size. Data from @done up to @queued
+ * is being written to the device, data from @queued up to @edge is complete
+ * but does not yet fill a chunk.
+ *
+ * @type: Kind of device, SINK_NONE to store files in memory as usual
+ * @desc: Block device
+ * @blk_start: First block to write on @desc
+ * @blk_end: Block after the last one which may be written on @desc
+ * @mtd: MTD device
+ * @mtd_start: Offset of the first byte to write on @mtd
+ * @mtd_pos: Offset on @mtd for the next chunk, after skipping bad blocks
+ * @chunk: Size of the chunks written to the device
+ * @unit: Smallest size which can be written to the device
+ * @size: Size of @buf, a multiple of @chunk
+ * @buf: Buffer holding data on its way to the device
+ * @reqs: Block requests, one for each chunk in @buf
+ * @done: Offset in the file up to which writes have completed
+ * @queued: Offset in the file up to which writes have been started
+ * @edge: Offset in the file up to which all data has been received
+ * @ahead: Data received past @edge, in ascending order
+ * @ahead_cnt: Number of entries in @ahead
+ * @algo: Hash algorithm, NULL for none
+ * @hash_ctx: Hash context while a transfer is in progress
+ * @digest: Expected digest
+ * @verify: true to check the hash against @digest
+ * @busy: true once the current transfer has passed on some data
+ */
+struct net_sink {
+	enum sink_type type;
+	struct blk_desc *desc;
+	lbaint_t blk_start;
+	lbaint_t blk_end;
+	struct mtd_info *mtd;
+	u64 mtd_start;
+	u64 mtd_pos;
+	ulong chunk;
+	ulong unit;
+	ulong size;
+	u8 *buf;
+	struct blk_req *reqs;
+	ulong done;
+	ulong queued;
+	ulong edge;
+	struct sink_range ahead[SINK_AHEAD];
+	int ahead_cnt;
+	struct hash_algo *algo;
+	void *hash_ctx;
+	u8 digest[HASH_MAX_DIGEST_SIZE];
+	bool verify;
+	bool busy;
+};
+
+static struct net_sink sink;
+
+static struct blk_req *sink_req(ulong offset)
+{
+	return &sink.reqs[(offset / sink.chunk) % (sink.size / sink.chunk)];
+}
+
+/* Wait for the oldest write in progress */
+static int sink_wait_one(void)
+{
+	struct blk_req *req = sink_req(sink.done);
+	long ret;
+
+	ret = blk_wait(sink.desc->bdev, req);
+	if (ret != req->blkcnt) {
+		printf("\nnet sink: write at block " LBAFU " failed (%ld)\n",
+		       req->start, ret);
+		return ret < 0 ? ret : -EIO;
+	}
+	sink.done += req->blkcnt * sink.unit;
+
+	return 0;
+}
+
+static int sink_wait_all(void)
+{
+	int ret;
+
+	while (sink.done < sink.queued) {
+		ret = sink_wait_one();
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Collect writes which have completed, without waiting */
+static int sink_reap(void)
+{
+	struct blk_req *req;
+	int ret;
+
+	if (sink.done == sink.queued)
+		return 0;
+	ret = blk_poll(sink.desc->bdev);
+	if (ret < 0)
+		return ret;
+	while (sink.done < sink.queued) {
+		req = sink_req(sink.done);
+		if (!req->done)
+			break;
+		ret = sink_wait_one();
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int sink_put_blk(ulong offset, void *buf, ulong len)
+{
+	struct blk_req *req = sink_req(offset);
+	int ret;
+
+	req->op = BLK_REQ_WRITE;
+	req->start = sink.blk_start + offset / sink.unit;
+	req->blkcnt = len / sink.unit;
+	req->buffer = buf;
+	if (req->start + req->blkcnt > sink.blk_end) {
+		printf("\nnet sink: file does not fit on the device\n");
+		return -ENOSPC;
+	}
+
+	do {
+		ret = blk_submit(sink.desc->bdev, req);
+		if (ret == -EBUSY)
+			blk_poll(sink.desc->bdev);
+	} while (ret == -EBUSY);
+	if (ret)
+		return ret;
+	sink.queued = offset + len;
+
+	return 0;
+}
+
+static int sink_put_mtd(ulong offset, void *buf, ulong len)
+{
+	struct mtd_info *mtd = sink.mtd;
+	struct erase_info erase = {};
+	size_t retlen;
+	int ret;
+
+	while (mtd_can_have_bb(mtd) && sink.mtd_pos < mtd->size &&
+	       mtd_block_isbad(mtd, sink.mtd_pos)) {
+		printf("\nnet sink: skipping bad block at 0x%llx\n",
+		       sink.mtd_pos);
+		sink.mtd_pos += mtd->erasesize;
+	}
+	if (sink.mtd_pos + len > mtd->size) {
+		printf("\nnet sink: file does not fit on the device\n");
+		return -ENOSPC;
+	}
+
+	erase.mtd = mtd;
+	erase.addr = sink.mtd_pos;
+	erase.len = mtd->erasesize;
+	ret = mtd_erase(mtd, &erase);
+	if (!ret)
+		ret = mtd_write(mtd, sink.mtd_pos, len, &retlen, buf);
+	if (ret) {
+		printf("\nnet sink: write at 0x%llx failed (%d)\n",
+		       sink.mtd_pos, ret);
+		return ret;
+	}
+	sink.mtd_pos += mtd->erasesize;
+	sink.queued = offset + len;
+	sink.done = sink.queued;
+
+	return 0;
+}
+
+/* Start writing data at @offset in the file, @len being a multiple of unit */
+static int sink_put(ulong offset, void *buf, ulong len)
+{
+	if (IS_ENABLED(CONFIG_MTD) && sink.type == SINK_MTD)
+		return sink_put_mtd(offset, buf, len);
+
+	return sink_put_blk(offset, buf, len);
+}
+
+static int sink_hash(const void *buf, ulong len, bool last)
+{
+	if (!sink.hash_ctx)
+		return 0;
+
+	return sink.algo->hash_update(sink.algo, sink.hash_ctx, buf, len,
+				      last);
+}
+
+static int sink_hash_finish(u8 *digest)
+{
+	int ret;
+
+	if (!sink.hash_ctx)
+		return 0;
+	ret = sink.algo->hash_finish(sink.algo, sink.hash_ctx, digest,
+				     sink.algo->digest_size);
+	sink.hash_ctx = NULL;
+
+	return ret;
+}
+
+/* Write out each chunk which is complete */
+static int sink_flush(void)
+{
+	u8 *buf;
+	int ret;
+
+	while (sink.edge - sink.queued >= sink.chunk) {
+		buf = sink.buf + sink.queued % sink.size;
+		ret = sink_hash(buf, sink.chunk, false);
+		if (!ret)
+			ret = sink_put(sink.queued, buf, sink.chunk);
+		if (ret)
+			return ret;
+	}
+
+	return sink_reap();
+}
+
+/* Record that the data from @start to @end has been received */
+static int sink_mark(ulong start, ulong end)
+{
+	struct sink_range *ahead = sink.ahead;
+	int i, j;
+
+	if (start > sink.edge) {
+		for (i = 0; i < sink.ahead_cnt && ahead[i].end < start; i++)
+			;
+		for (j = i; j < sink.ahead_cnt && ahead[j].start <= end; j++) {
+			start = min(start, ahead[j].start);
+			end = max(end, ahead[j].end);
+		}
+		if (i == j) {
+			if (sink.ahead_cnt == SINK_AHEAD)
+				return -ENOSPC;
+			memmove(&ahead[i + 1], &ahead[i],
+				(sink.ahead_cnt - i) * sizeof(*ahead));
+			sink.ahead_cnt++;
+		} else {
+			memmove(&ahead[i + 1], &ahead[j],
+				(sink.ahead_cnt - j) * sizeof(*ahead));
+			sink.ahead_cnt -= j - i - 1;
+		}
+		ahead[i].start = start;
+		ahead[i].end = end;
+
+		return 0;
+	}
+
+	sink.edge = end;
+	for (i = 0; i < sink.ahead_cnt && ahead[i].start <= sink.edge; i++)
+		sink.edge = max(sink.edge, ahead[i].end);
+	memmove(ahead, &ahead[i], (sink.ahead_cnt - i) * sizeof(*ahead));
+	sink.ahead_cnt -= i;
+
+	return 0;
+}
+
+/* Drop the current transfer, if any */
+static void sink_end(void)
+{
+	u8 digest[HASH_MAX_DIGEST_SIZE];
+
+	if (!sink.busy)
+		return;
+	sink_wait_all();
+	sink_hash_finish(digest);
+	sink.busy = false;
+}
+
+static int sink_alloc(ulong chunk)
+{
+	sink.chunk = chunk;
+	sink.size = max(roundup(CONFIG_NET_SINK_BUF_SIZE, chunk), 2 * chunk);
+	sink.buf = memalign(ARCH_DMA_MINALIGN, sink.size);
+	sink.reqs = calloc(sink.size / chunk, sizeof(*sink.reqs));
+	if (!sink.buf || !sink.reqs) {
+		net_sink_off();
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int sink_store(ulong offset, const void *src, ulong len);
+
+static const struct eth_rx_sink net_rx_sink = {
+	.name	= "net sink",
+	.store	= sink_store,
+};
+
+/* Have protocols pass payloads to the sink, dropping it if that fails */
+static int sink_register(void)
+{
+	int ret;
+
+	ret = eth_rx_set_sink(&net_rx_sink);
+	if (ret)
+		net_sink_off();
+
+	return ret;
+}
+
+int net_sink_blk(const char *ifname, const char *dev_part, ulong start)
+{
+	struct disk_partition info;
+	struct blk_desc *desc;
+	ulong chunk;
+	int ret;
+
+	ret = blk_get_device_part_str(ifname, dev_part, &desc, &info, 1);
+	if (ret < 0)
+		return ret;
+	if (start >= info.size)
+		return -ERANGE;
+
+	net_sink_off();
+	sink.desc = desc;
+	sink.blk_start = info.start + start;
+	sink.blk_end = info.start + info.size;
+	sink.unit = desc->blksz;
+	chunk = rounddown(CONFIG_NET_SINK_BUF_SIZE / 4, desc->blksz);
+	ret = sink_alloc(max(chunk, desc->blksz));
+	if (ret)
+		return ret;
+	sink.type = SINK_BLK;
+
+	return sink_register();
+}
+
+int net_sink_mtd(const char *name, u64 offset)
+{
+	struct mtd_info *mtd;
+	int ret;
+
+	if (!IS_ENABLED(CONFIG_MTD))
+		return -ENOSYS;
+	mtd_probe_devices();
+	mtd = get_mtd_device_nm(name);
+	if (IS_ERR_OR_NULL(mtd))
+		return -ENODEV;
+	if (offset >= mtd->size || mtd_mod_by_eb(offset, mtd)) {
+		put_mtd_device(mtd);
+		return -ERANGE;
+	}
+
+	net_sink_off();
+	sink.mtd = mtd;
+	sink.mtd_start = offset;
+	sink.unit = mtd->writesize;
+	ret = sink_alloc(mtd->erasesize);
+	if (ret)
+		return ret;
+	sink.type = SINK_MTD;
+
+	return sink_register();
+}
+
+int net_sink_hash(const char *algo, const char *digest)
+{
+	struct hash_algo *ha;
+	int ret;
+
+	if (!IS_ENABLED(CONFIG_HASH))
+		return -ENOSYS;
+	if (sink.type == SINK_NONE)
+		return -ENODEV;
+	ret = hash_progressive_lookup_algo(algo, &ha);
+	if (ret)
+		return ret;
+	if (digest) {
+		if (strlen(digest) != ha->digest_size * 2)
+			return -EINVAL;
+		ret = hash_parse_string(algo, digest, sink.digest);
+		if (ret)
+			return ret;
+	}
+	sink.algo = ha;
+	sink.verify = digest;
+
+	return 0;
+}
+
+void net_sink_off(void)
+{
+	if (eth_rx_get_sink() == &net_rx_sink)
+		eth_rx_set_sink(NULL);
+	sink_end();
+	free(sink.buf);
+	free(sink.reqs);
+	if (IS_ENABLED(CONFIG_MTD) && sink.mtd)
+		put_mtd_device(sink.mtd);
+	memset(&sink, '\0', sizeof(sink));
+}
+
+void net_sink_show(void)
+{
+	switch (sink.type) {
+	case SINK_NONE:
+		printf("Files are stored in memory\n");
+		return;
+	case SINK_BLK:
+		printf("Next file goes to %s %d at block " LBAFU "\n",
+		       blk_get_uclass_name(sink.desc->uclass_id),
+		       sink.desc->devnum, sink.blk_start);
+		break;
+	case SINK_MTD:
+		printf("Next file goes to %s at 0x%llx\n", sink.mtd->name,
+		       sink.mtd_start);
+		break;
+	}
+	printf("Buffer 0x%lx, chunk 0x%lx\n", sink.size, sink.chunk);
+	if (sink.algo)
+		printf("Hash %s%s\n", sink.algo->name,
+		       sink.verify ? ", verified" : "");
+}
+
+bool net_sink_active(void)
+{
+	return sink.type != SINK_NONE;
+}
+
+ulong net_sink_size(void)
+{
+	return sink.size ? sink.size - sink.chunk : 0;
+}
+
+void net_sink_start(void)
+{
+	if (sink.type == SINK_NONE)
+		return;
+	sink_end();
+	sink.done = 0;
+	sink.queued = 0;
+	sink.edge = 0;
+	sink.ahead_cnt = 0;
+	sink.mtd_pos = sink.mtd_start;
+}
+
+/*
+ * Accept part of the file being downloaded. The data may arrive in any
+ * order, may overlap data already received and is written to the device
+ * once the file is complete up to the end of a chunk. Returns -ENOSPC if the
+ * data is too far ahead to be held
+ */
+static int sink_store(ulong offset, const void *src, ulong len)
+{
+	ulong end = offset + len;
+	ulong pos, part;
+	int ret;
+
+	if (!sink.busy) {
+		if (sink.algo) {
+			ret = sink.algo->hash_init(sink.algo, &sink.hash_ctx);
+			if (ret)
+				return ret;
+		}
+		sink.busy = true;
+	}
+
+	if (end <= sink.edge)
+		return 0;
+	if (offset < sink.edge) {
+		src += sink.edge - offset;
+		offset = sink.edge;
+		len = end - offset;
+	}
+
+	while (end > sink.done + sink.size) {
+		if (sink.done == sink.queued) {
+			printf("\nnet sink: no room for data at 0x%lx\n",
+			       offset);
+			return -ENOSPC;
+		}
+		ret = sink_wait_one();
+		if (ret)
+			return ret;
+	}
+
+	pos = offset % sink.size;
+	part = min(len, sink.size - pos);
+	memcpy(sink.buf + pos, src, part);
+	if (part < len)
+		memcpy(sink.buf, src + part, len - part);
+	eth_count_rx_copy(NULL, len);
+
+	ret = sink_mark(offset, end);
+	if (ret) {
+		printf("\nnet sink: too many gaps at 0x%lx\n", offset);
+		return ret;
+	}
+
+	return sink_flush();
+}
+
+int net_sink_finish(ulong size)
+{
+	u8 digest[HASH_MAX_DIGEST_SIZE];
+	ulong len, pad;
+	u8 *buf;
+	int i, ret;
+
+	if (!sink.busy)
+		return 0;
+	if (sink.edge != size || sink.ahead_cnt) {
+		printf("net sink: only 0x%lx of 0x%lx bytes received\n",
+		       sink.edge, size);
+		ret = -EIO;
+		goto out;
+	}
+
+	ret = sink_flush();
+	if (ret)
+		goto out;
+	len = size - sink.queued;
+	if (len) {
+		buf = sink.buf + sink.queued % sink.size;
+		pad = roundup(len, sink.unit) - len;
+		memset(buf + len, sink.type == SINK_MTD ? 0xff : 0, pad);
+		ret = sink_hash(buf, len, true);
+		if (!ret)
+			ret = sink_put(sink.queued, buf, len + pad);
+		if (ret)
+			goto out;
+	}
+	ret = sink_wait_all();
+	if (ret)
+		goto out;
+
+	if (sink.hash_ctx) {
+		ret = sink_hash_finish(digest);
+		if (ret)
+			goto out;
+		printf("%s ==> ", sink.algo->name);
+		for (i = 0; i < sink.algo->digest_size; i++)
+			printf("%02x", digest[i]);
+		printf("\n");
+		if (sink.verify &&
+		    memcmp(digest, sink.digest, sink.algo->digest_size)) {
+			printf("net sink: %s does not match\n",
+			       sink.algo->name);
+			ret = -EILSEQ;
+			goto out;
+		}
+	}
+	printf("0x%lx bytes written\n", size);
+
+out:
+	net_sink_off();
+
+	return ret;
+}
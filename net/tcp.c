@@ -25,33 +25,63 @@
 #include <net/tcp.h>
 
 /*
- * TCP sliding window  control used by us to request re-TX
+ * Search for TCP_SACK and review the comments before the code section
+ * TCP_SACK is the number of blocks of data received out of order, past a
+ * hole in the stream, which are tracked
  */
-static struct tcp_sack_v tcp_lost;
-
-/* TCP option timestamp */
-static u32 loc_timestamp;
-static u32 rmt_timestamp;
 
-static u32 tcp_seq_init;
-static u32 tcp_ack_edge;
+/* Compare sequence numbers, which wrap around */
+#define TCP_SEQ_LT(a, b) ((s32)((a) - (b)) < 0)
 
-static int tcp_activity_count;
-
-/*
- * Search for TCP_SACK and review the comments before the code section
- * TCP_SACK is the number of packets at the front of the stream
+/**
+ * struct tcp_conn - state of a TCP connection
+ * @state: TCP connection state
+ * @lport: our port, which identifies the connection
+ * @tcp_lost: TCP sliding window control used by us to request re-TX
+ * @loc_timestamp: our TCP option timestamp
+ * @rmt_timestamp: TCP option timestamp of the peer
+ * @tcp_seq_init: initial sequence number of the peer
+ * @tcp_ack_edge: right edge of the contiguous data received
+ * @tcp_activity_count: packets received since the last progress mark
+ * @sack: blocks of data received out of order, in ascending order
+ * @sack_cnt: number of blocks in @sack
+ * @sack_recent: sequence number of the last data received out of order
+ * @wscale: shift of the window we advertise
+ * @wscale_ok: the peer accepted window scaling
+ * @rcv_segs: segments received in order since the last acknowledgment
+ * @ack_now: the next acknowledgment must not be delayed
+ * @ack_pending: an acknowledgment was delayed
+ * @ack_rport: peer port of the delayed acknowledgment
+ * @ack_seq: sequence number of the delayed acknowledgment
  */
-
-enum pkt_state {PKT, NOPKT};
-struct sack_r {
-	struct sack_edges se;
-	enum pkt_state st;
+struct tcp_conn {
+	enum tcp_state state;
+	u16 lport;
+	struct tcp_sack_v tcp_lost;
+	u32 loc_timestamp;
+	u32 rmt_timestamp;
+	u32 tcp_seq_init;
+	u32 tcp_ack_edge;
+	int tcp_activity_count;
+	struct sack_edges sack[TCP_SACK];
+	unsigned int sack_cnt;
+	u32 sack_recent;
+	u8 wscale;
+	bool wscale_ok;
+	unsigned int rcv_segs;
+	bool ack_now;
+	bool ack_pending;
+	u16 ack_rport;
+	u32 ack_seq;
 };
 
-static struct sack_r edge_a[TCP_SACK];
-static unsigned int sack_idx;
-static unsigned int prev_len;
+static struct tcp_conn tcp_conns[CONFIG_PROT_TCP_CONNS];
+
+/* Connection of the packet being sent or received */
+static struct tcp_conn *conn = &tcp_conns[0];
+
+/* Receive window, in bytes */
+static ulong tcp_rx_win = CONFIG_PROT_TCP_RX_WINDOW * 1024;
 
 /*
  * TCP lengths are stored as a rounded up number of 32 bit words.
@@ -63,9 +93,6 @@ static unsigned int prev_len;
 #define SHIFT_TO_TCPHDRLEN_FIELD(x) ((x) << 4)
 #define GET_TCP_HDR_LEN_IN_BYTES(x) ((x) >> 2)
 
-/* TCP connection state */
-static enum tcp_state current_tcp_state;
-
 /* Current TCP RX packet handler */
 static rxhand_tcp *tcp_packet_handler;
 
@@ -76,7 +103,7 @@ static rxhand_tcp *tcp_packet_handler;
  */
 enum tcp_state tcp_get_tcp_state(void)
 {
-	return current_tcp_state;
+	return conn->state;
 }
 
 /**
@@ -85,7 +112,95 @@ enum tcp_state tcp_get_tcp_state(void)
  */
 void tcp_set_tcp_state(enum tcp_state new_state)
 {
-	current_tcp_state = new_state;
+	conn->state = new_state;
+}
+
+/**
+ * tcp_get_ack_edge() - get the edge of the data received in order
+ *
+ * Return: sequence number following the data received in order
+ */
+u32 tcp_get_ack_edge(void)
+{
+	return conn->tcp_ack_edge;
+}
+
+/**
+ * tcp_set_rx_window() - set the memory available for received data
+ * @size: number of bytes, 0 for no limit
+ */
+void tcp_set_rx_window(ulong size)
+{
+	tcp_rx_win = CONFIG_PROT_TCP_RX_WINDOW * 1024;
+	if (size)
+		tcp_rx_win = clamp_t(ulong, size, 2 * TCP_MSS, tcp_rx_win);
+}
+
+/**
+ * tcp_rx_window() - get the receive window to advertise
+ * @action: TCP action of the packet
+ *
+ * The window is only scaled once both sides have sent the window scale
+ * option, never in SYN packets (RFC 7323).
+ *
+ * Return: value of the window field
+ */
+static u16 tcp_rx_window(u8 action)
+{
+	ulong win = tcp_rx_win;
+
+	if (!(action & TCP_SYN) && conn->wscale_ok)
+		win >>= conn->wscale;
+
+	return min_t(ulong, win, U16_MAX);
+}
+
+/**
+ * tcp_conn_reset() - forget everything about a connection
+ * @c: connection
+ * @lport: our port, which the connection uses from now on
+ */
+static void tcp_conn_reset(struct tcp_conn *c, u16 lport)
+{
+	memset(c, '\0', sizeof(*c));
+	c->lport = lport;
+}
+
+/**
+ * tcp_conn_find() - find the connection which uses a port
+ * @lport: our port
+ * @alloc: set up a new connection if none uses @lport
+ *
+ * A new connection replaces a closed one if there is one, then one which
+ * is being closed and then the others in turn.
+ *
+ * Return: the connection, NULL if none uses @lport and @alloc is false
+ */
+static struct tcp_conn *tcp_conn_find(u16 lport, bool alloc)
+{
+	static unsigned int next_victim;
+	struct tcp_conn *victim = NULL;
+	struct tcp_conn *c;
+
+	for (c = tcp_conns; c < tcp_conns + CONFIG_PROT_TCP_CONNS; c++) {
+		if (c->lport == lport)
+			return c;
+		if (c->state == TCP_CLOSED)
+			victim = c;
+		else if (c->state >= TCP_CLOSE_WAIT &&
+			 (!victim || victim->state != TCP_CLOSED))
+			victim = c;
+	}
+	if (!alloc)
+		return NULL;
+
+	if (!victim) {
+		victim = &tcp_conns[next_victim];
+		next_victim = (next_victim + 1) % CONFIG_PROT_TCP_CONNS;
+	}
+	tcp_conn_reset(victim, lport);
+
+	return victim;
 }
 
 static void dummy_handler(uchar *pkt, u16 dport,
@@ -154,23 +269,25 @@ u16 tcp_set_pseudo_header(uchar *pkt, struct in_addr src, struct in_addr dest,
  */
 int net_set_ack_options(union tcp_build_pkt *b)
 {
+	int hlen = TCP_HDR_SIZE + TCP_TSOPT_SIZE;
+
 	b->sack.hdr.tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(TCP_HDR_SIZE));
 
 	b->sack.t_opt.kind = TCP_O_TS;
 	b->sack.t_opt.len = TCP_OPT_LEN_A;
-	b->sack.t_opt.t_snd = htons(loc_timestamp);
-	b->sack.t_opt.t_rcv = rmt_timestamp;
+	b->sack.t_opt.t_snd = htons(conn->loc_timestamp);
+	b->sack.t_opt.t_rcv = conn->rmt_timestamp;
 	b->sack.sack_v.kind = TCP_1_NOP;
 	b->sack.sack_v.len = 0;
 
 	if (IS_ENABLED(CONFIG_PROT_TCP_SACK)) {
-		if (tcp_lost.len > TCP_OPT_LEN_2) {
+		if (conn->tcp_lost.len > TCP_OPT_LEN_2) {
 			debug_cond(DEBUG_DEV_PKT, "TCP ack opt lost.len %x\n",
-				   tcp_lost.len);
-			b->sack.sack_v.len = tcp_lost.len;
+				   conn->tcp_lost.len);
+			b->sack.sack_v.len = conn->tcp_lost.len;
 			b->sack.sack_v.kind = TCP_V_SACK;
-			b->sack.sack_v.hill[0].l = htonl(tcp_lost.hill[0].l);
-			b->sack.sack_v.hill[0].r = htonl(tcp_lost.hill[0].r);
+			b->sack.sack_v.hill[0].l = htonl(conn->tcp_lost.hill[0].l);
+			b->sack.sack_v.hill[0].r = htonl(conn->tcp_lost.hill[0].r);
 
 			/*
 			 * These SACK structures are initialized with NOPs to
@@ -178,22 +295,19 @@ int net_set_ack_options(union tcp_build_pkt *b)
 			 * SACK structures used for both header padding and
 			 * internally.
 			 */
-			b->sack.sack_v.hill[1].l = htonl(tcp_lost.hill[1].l);
-			b->sack.sack_v.hill[1].r = htonl(tcp_lost.hill[1].r);
-			b->sack.sack_v.hill[2].l = htonl(tcp_lost.hill[2].l);
-			b->sack.sack_v.hill[2].r = htonl(tcp_lost.hill[2].r);
+			b->sack.sack_v.hill[1].l = htonl(conn->tcp_lost.hill[1].l);
+			b->sack.sack_v.hill[1].r = htonl(conn->tcp_lost.hill[1].r);
+			b->sack.sack_v.hill[2].l = htonl(conn->tcp_lost.hill[2].l);
+			b->sack.sack_v.hill[2].r = htonl(conn->tcp_lost.hill[2].r);
 			b->sack.sack_v.hill[3].l = TCP_O_NOP;
 			b->sack.sack_v.hill[3].r = TCP_O_NOP;
 		}
 
-		b->sack.hdr.tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(ROUND_TCPHDR_LEN(TCP_HDR_SIZE +
-										 TCP_TSOPT_SIZE +
-										 tcp_lost.len));
+		hlen += conn->tcp_lost.len;
 	} else {
 		b->sack.sack_v.kind = 0;
-		b->sack.hdr.tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(ROUND_TCPHDR_LEN(TCP_HDR_SIZE +
-										 TCP_TSOPT_SIZE));
 	}
+	b->sack.hdr.tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(ROUND_TCPHDR_LEN(hlen));
 
 	/*
 	 * This returns the actual rounded up length of the
@@ -204,13 +318,13 @@ int net_set_ack_options(union tcp_build_pkt *b)
 }
 
 /**
- * net_set_ack_options() - set TCP options in SYN packets
+ * net_set_syn_options() - set TCP options in SYN packets
  * @b: the packet
  */
 void net_set_syn_options(union tcp_build_pkt *b)
 {
 	if (IS_ENABLED(CONFIG_PROT_TCP_SACK))
-		tcp_lost.len = 0;
+		conn->tcp_lost.len = 0;
 
 	b->ip.hdr.tcp_hlen = 0xa0;
 
@@ -218,7 +332,10 @@ void net_set_syn_options(union tcp_build_pkt *b)
 	b->ip.mss.len = TCP_OPT_LEN_4;
 	b->ip.mss.mss = htons(TCP_MSS);
 	b->ip.scale.kind = TCP_O_SCL;
-	b->ip.scale.scale = TCP_SCALE;
+	for (conn->wscale = 0; conn->wscale < TCP_SCALE_MAX &&
+	     tcp_rx_win >> conn->wscale > U16_MAX; conn->wscale++)
+		;
+	b->ip.scale.scale = conn->wscale;
 	b->ip.scale.len = TCP_OPT_LEN_3;
 	if (IS_ENABLED(CONFIG_PROT_TCP_SACK)) {
 		b->ip.sack_p.kind = TCP_P_SACK;
@@ -229,8 +346,8 @@ void net_set_syn_options(union tcp_build_pkt *b)
 	}
 	b->ip.t_opt.kind = TCP_O_TS;
 	b->ip.t_opt.len = TCP_OPT_LEN_A;
-	loc_timestamp = get_ticks();
-	rmt_timestamp = 0;
+	conn->loc_timestamp = get_ticks();
+	conn->rmt_timestamp = 0;
 	b->ip.t_opt.t_snd = 0;
 	b->ip.t_opt.t_rcv = 0;
 	b->ip.end = TCP_O_END;
@@ -244,6 +361,8 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 	int pkt_len;
 	int tcp_len;
 
+	conn = tcp_conn_find(sport, true);
+
 	/*
 	 * Header: 5 32 bit words. 4 bits TCP header Length,
 	 *         4 bits reserved options
@@ -258,16 +377,18 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 			   "TCP Hdr:SYN (%pI4, %pI4, sq=%u, ak=%u)\n",
 			   &net_server_ip, &net_ip,
 			   tcp_seq_num, tcp_ack_num);
-		tcp_activity_count = 0;
+		/* A port may be used again, e.g. by the next wget */
+		if (conn->state != TCP_SYN_SENT)
+			tcp_conn_reset(conn, sport);
 		net_set_syn_options(b);
 		tcp_seq_num = 0;
 		tcp_ack_num = 0;
 		pkt_hdr_len = IP_TCP_O_SIZE;
-		if (current_tcp_state == TCP_SYN_SENT) {  /* Too many SYNs */
+		if (conn->state == TCP_SYN_SENT) {  /* Too many SYNs */
 			action = TCP_FIN;
-			current_tcp_state = TCP_FIN_WAIT_1;
+			conn->state = TCP_FIN_WAIT_1;
 		} else {
-			current_tcp_state = TCP_SYN_SENT;
+			conn->state = TCP_SYN_SENT;
 		}
 		break;
 	case TCP_SYN | TCP_ACK:
@@ -285,20 +406,20 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 			   &net_server_ip, &net_ip, tcp_seq_num, tcp_ack_num);
 		payload_len = 0;
 		pkt_hdr_len = IP_TCP_HDR_SIZE;
-		current_tcp_state = TCP_FIN_WAIT_1;
+		conn->state = TCP_FIN_WAIT_1;
 		break;
 	case TCP_RST | TCP_ACK:
 	case TCP_RST:
 		debug_cond(DEBUG_DEV_PKT,
 			   "TCP Hdr:RST  (%pI4, %pI4, s=%u, a=%u)\n",
 			   &net_server_ip, &net_ip, tcp_seq_num, tcp_ack_num);
-		current_tcp_state = TCP_CLOSED;
+		conn->state = TCP_CLOSED;
 		break;
 	/* Notify connection closing */
 	case (TCP_FIN | TCP_ACK):
 	case (TCP_FIN | TCP_ACK | TCP_PUSH):
-		if (current_tcp_state == TCP_CLOSE_WAIT)
-			current_tcp_state = TCP_CLOSING;
+		if (conn->state == TCP_CLOSE_WAIT)
+			conn->state = TCP_CLOSING;
 
 		debug_cond(DEBUG_DEV_PKT,
 			   "TCP Hdr:FIN ACK PSH(%pI4, %pI4, s=%u, a=%u, A=%x)\n",
@@ -317,9 +438,20 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 	pkt_len	= pkt_hdr_len + payload_len;
 	tcp_len	= pkt_len - IP_HDR_SIZE;
 
-	tcp_ack_edge = tcp_ack_num;
+	/*
+	 * Data received on an open connection is acknowledged up to the edge
+	 * of the data received in order, kept by tcp_hole(), whatever the
+	 * application asks for.
+	 */
+	if (conn->state == TCP_ESTABLISHED && !payload_len &&
+	    !(action & (TCP_SYN | TCP_FIN | TCP_RST)))
+		tcp_ack_num = conn->tcp_ack_edge;
+	conn->tcp_ack_edge = tcp_ack_num;
+	conn->rcv_segs = 0;
+	conn->ack_now = false;
+	conn->ack_pending = false;
 	/* TCP Header */
-	b->ip.hdr.tcp_ack = htonl(tcp_ack_edge);
+	b->ip.hdr.tcp_ack = htonl(conn->tcp_ack_edge);
 	b->ip.hdr.tcp_src = htons(sport);
 	b->ip.hdr.tcp_dst = htons(dport);
 	b->ip.hdr.tcp_seq = htonl(tcp_seq_num);
@@ -338,8 +470,10 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 	 * SOCs is may not be considered a constraint to buffer space, if
 	 * it is, then the u-boot tftp or nfs kernel netboot should be
 	 * considered.
+	 * The window is set by CONFIG_PROT_TCP_RX_WINDOW and by the memory
+	 * the application has, see tcp_set_rx_window().
 	 */
-	b->ip.hdr.tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	b->ip.hdr.tcp_win = htons(tcp_rx_window(action));
 
 	b->ip.hdr.tcp_xsum = 0;
 	b->ip.hdr.tcp_ugr = 0;
@@ -353,112 +487,105 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 	return pkt_hdr_len;
 }
 
+/**
+ * tcp_sack_report() - set the SACK blocks to send to the peer
+ *
+ * The block holding the data received out of order last comes first,
+ * then the others in ascending order (RFC 2018). The last of the
+ * TCP_SACK_HILLS blocks of the option is used for padding.
+ */
+static void tcp_sack_report(void)
+{
+	struct sack_edges *s = conn->sack;
+	unsigned int i, hill = 0;
+
+	for (i = 0; i < conn->sack_cnt; i++) {
+		if (!TCP_SEQ_LT(conn->sack_recent, s[i].l) &&
+		    TCP_SEQ_LT(conn->sack_recent, s[i].r)) {
+			conn->tcp_lost.hill[hill++] = s[i];
+			break;
+		}
+	}
+	for (i = 0; i < conn->sack_cnt && hill < TCP_SACK_HILLS - 1; i++) {
+		if (!hill || s[i].l != conn->tcp_lost.hill[0].l)
+			conn->tcp_lost.hill[hill++] = s[i];
+	}
+	conn->tcp_lost.len = TCP_OPT_LEN_2 + hill * TCP_OPT_LEN_8;
+}
+
 /**
  * tcp_hole() - Selective Acknowledgment (Essential for fast stream transfer)
  * @tcp_seq_num: TCP sequence start number
  * @len: the length of sequence numbers
+ *
+ * Data received in order moves the acknowledge edge forward, over the
+ * blocks which were received out of order and are now contiguous. Data
+ * received past a hole is merged into the scoreboard of blocks. Both
+ * duplicates and data past a hole are acknowledged at once, so that the
+ * peer can retransmit quickly.
  */
 void tcp_hole(u32 tcp_seq_num, u32 len)
 {
-	u32 idx_sack, sack_in;
-	u32 sack_end = TCP_SACK - 1;
-	u32 hill = 0;
-	enum pkt_state expect = PKT;
-	u32 seq = tcp_seq_num - tcp_seq_init;
-	u32 hol_l = tcp_ack_edge - tcp_seq_init;
-	u32 hol_r = 0;
-
-	/* Place new seq number in correct place in receive array */
-	if (prev_len == 0)
-		prev_len = len;
-
-	idx_sack = sack_idx + ((tcp_seq_num - tcp_ack_edge) / prev_len);
-	if (idx_sack < TCP_SACK) {
-		edge_a[idx_sack].se.l = tcp_seq_num;
-		edge_a[idx_sack].se.r = tcp_seq_num + len;
-		edge_a[idx_sack].st = PKT;
-
-		/*
-		 * The fin (last) packet is not the same length as data
-		 * packets, and if it's length is recorded and used for
-		 *  array index calculation, calculation breaks.
-		 */
-		if (prev_len < len)
-			prev_len = len;
+	struct sack_edges *s = conn->sack;
+	u32 l = tcp_seq_num;
+	u32 r = tcp_seq_num + len;
+	unsigned int i, n;
+
+	debug_cond(DEBUG_DEV_PKT, "TCP seq %u, len %u, edge %u, blocks %u\n",
+		   tcp_seq_num - conn->tcp_seq_init, len,
+		   conn->tcp_ack_edge - conn->tcp_seq_init, conn->sack_cnt);
+
+	if (!TCP_SEQ_LT(conn->tcp_ack_edge, r)) {
+		/* Duplicate, our acknowledgment may have been lost */
+		conn->ack_now = true;
+	} else if (!TCP_SEQ_LT(conn->tcp_ack_edge, l)) {
+		conn->tcp_ack_edge = r;
+		conn->rcv_segs++;
+		for (i = 0; i < conn->sack_cnt &&
+		     !TCP_SEQ_LT(conn->tcp_ack_edge, s[i].l); i++) {
+			if (TCP_SEQ_LT(conn->tcp_ack_edge, s[i].r))
+				conn->tcp_ack_edge = s[i].r;
+		}
+		if (i) {
+			/* A hole was filled */
+			conn->sack_cnt -= i;
+			memmove(s, s + i, conn->sack_cnt * sizeof(*s));
+			conn->ack_now = true;
+		}
+	} else {
+		conn->ack_now = true;
+		conn->sack_recent = l;
+
+		/* Merge the blocks which overlap or touch the data */
+		for (i = 0; i < conn->sack_cnt && TCP_SEQ_LT(s[i].r, l); i++)
+			;
+		for (n = i; n < conn->sack_cnt && !TCP_SEQ_LT(r, s[n].l); n++) {
+			if (TCP_SEQ_LT(s[n].l, l))
+				l = s[n].l;
+			if (TCP_SEQ_LT(r, s[n].r))
+				r = s[n].r;
+		}
+		if (n == i) {
+			/* A new block, the last one is dropped if full */
+			if (i == TCP_SACK)
+				goto report;
+			if (conn->sack_cnt == TCP_SACK)
+				conn->sack_cnt--;
+			memmove(s + i + 1, s + i,
+				(conn->sack_cnt - i) * sizeof(*s));
+			conn->sack_cnt++;
+		} else if (n > i + 1) {
+			memmove(s + i + 1, s + n,
+				(conn->sack_cnt - n) * sizeof(*s));
+			conn->sack_cnt -= n - i - 1;
+		}
+		s[i].l = l;
+		s[i].r = r;
 	}
 
-	debug_cond(DEBUG_DEV_PKT,
-		   "TCP 1 seq %d, edg %d, len %d, sack_idx %d, sack_end %d\n",
-		    seq, hol_l, len, sack_idx, sack_end);
-
-	/* Right edge of contiguous stream, is the left edge of first hill */
-	hol_l = tcp_seq_num - tcp_seq_init;
-	hol_r = hol_l + len;
-
+report:
 	if (IS_ENABLED(CONFIG_PROT_TCP_SACK))
-		tcp_lost.len = TCP_OPT_LEN_2;
-
-	debug_cond(DEBUG_DEV_PKT,
-		   "TCP 1 in %d, seq %d, pkt_l %d, pkt_r %d, sack_idx %d, sack_end %d\n",
-		   idx_sack, seq, hol_l, hol_r, sack_idx, sack_end);
-
-	for (sack_in = sack_idx; sack_in < sack_end && hill < TCP_SACK_HILLS;
-	     sack_in++)  {
-		switch (expect) {
-		case NOPKT:
-			switch (edge_a[sack_in].st) {
-			case NOPKT:
-				debug_cond(DEBUG_INT_STATE, "N");
-				break;
-			case PKT:
-				debug_cond(DEBUG_INT_STATE, "n");
-				if (IS_ENABLED(CONFIG_PROT_TCP_SACK)) {
-					tcp_lost.hill[hill].l =
-						edge_a[sack_in].se.l;
-					tcp_lost.hill[hill].r =
-						edge_a[sack_in].se.r;
-				}
-				expect = PKT;
-				break;
-			}
-			break;
-		case PKT:
-			switch (edge_a[sack_in].st) {
-			case NOPKT:
-				debug_cond(DEBUG_INT_STATE, "p");
-				if (sack_in > sack_idx &&
-				    hill < TCP_SACK_HILLS) {
-					hill++;
-					if (IS_ENABLED(CONFIG_PROT_TCP_SACK))
-						tcp_lost.len += TCP_OPT_LEN_8;
-				}
-				expect = NOPKT;
-				break;
-			case PKT:
-				debug_cond(DEBUG_INT_STATE, "P");
-
-				if (tcp_ack_edge == edge_a[sack_in].se.l) {
-					tcp_ack_edge = edge_a[sack_in].se.r;
-					edge_a[sack_in].st = NOPKT;
-					sack_idx++;
-				} else {
-					if (IS_ENABLED(CONFIG_PROT_TCP_SACK) &&
-					    hill < TCP_SACK_HILLS)
-						tcp_lost.hill[hill].r =
-							edge_a[sack_in].se.r;
-				if (IS_ENABLED(CONFIG_PROT_TCP_SACK) &&
-				    sack_in == sack_end - 1)
-					tcp_lost.hill[hill].r =
-						edge_a[sack_in].se.r;
-				}
-				break;
-			}
-			break;
-		}
-	}
-	debug_cond(DEBUG_INT_STATE, "\n");
-	if (!IS_ENABLED(CONFIG_PROT_TCP_SACK) || tcp_lost.len <= TCP_OPT_LEN_2)
-		sack_idx = 0;
+		tcp_sack_report();
 }
 
 /**
@@ -476,26 +603,27 @@ void tcp_parse_options(uchar *o, int o_len)
 	 * All other options have length fields.
 	 */
 	for (p = o; p < (o + o_len); p = p + p[1]) {
-		if (!p[1])
+		/* Process optional NOPs */
+		while (p < o + o_len - 1 && p[0] == TCP_1_NOP)
+			p++;
+		if (p[0] == TCP_O_END || p >= o + o_len - 1 || !p[1])
 			return; /* Finished processing options */
 
 		switch (p[0]) {
-		case TCP_O_END:
-			return;
-		case TCP_O_MSS:
 		case TCP_O_SCL:
+			/* Our window is scaled if the peer answers our SYN */
+			if (conn->state == TCP_SYN_SENT)
+				conn->wscale_ok = true;
+			break;
+		case TCP_O_MSS:
 		case TCP_P_SACK:
 		case TCP_V_SACK:
 			break;
 		case TCP_O_TS:
 			tsopt = (struct tcp_t_opt *)p;
-			rmt_timestamp = tsopt->t_snd;
-			return;
+			conn->rmt_timestamp = tsopt->t_snd;
+			break;
 		}
-
-		/* Process optional NOPs */
-		if (p[0] == TCP_O_NOP)
-			p++;
 	}
 }
 
@@ -507,7 +635,6 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 	u8 tcp_push = tcp_flags & TCP_PUSH;
 	u8 tcp_ack = tcp_flags & TCP_ACK;
 	u8 action = TCP_DATA;
-	int i;
 
 	/*
 	 * tcp_flags are examined to determine TX action in a given state
@@ -521,20 +648,20 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 	debug_cond(DEBUG_INT_STATE, "TCP STATE ENTRY %x\n", action);
 	if (tcp_rst) {
 		action = TCP_DATA;
-		current_tcp_state = TCP_CLOSED;
+		conn->state = TCP_CLOSED;
 		net_set_state(NETLOOP_FAIL);
 		debug_cond(DEBUG_INT_STATE, "TCP Reset %x\n", tcp_flags);
 		return TCP_RST;
 	}
 
-	switch  (current_tcp_state) {
+	switch  (conn->state) {
 	case TCP_CLOSED:
 		debug_cond(DEBUG_INT_STATE, "TCP CLOSED %x\n", tcp_flags);
 		if (tcp_syn) {
 			action = TCP_SYN | TCP_ACK;
-			tcp_seq_init = tcp_seq_num;
-			tcp_ack_edge = tcp_seq_num + 1;
-			current_tcp_state = TCP_SYN_RECEIVED;
+			conn->tcp_seq_init = tcp_seq_num;
+			conn->tcp_ack_edge = tcp_seq_num + 1;
+			conn->state = TCP_SYN_RECEIVED;
 		} else if (tcp_ack || tcp_fin) {
 			action = TCP_DATA;
 		}
@@ -545,18 +672,17 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 			   tcp_flags, tcp_seq_num);
 		if (tcp_fin) {
 			action = action | TCP_PUSH;
-			current_tcp_state = TCP_CLOSE_WAIT;
+			conn->state = TCP_CLOSE_WAIT;
 		} else if (tcp_ack || (tcp_syn && tcp_ack)) {
 			action |= TCP_ACK;
-			tcp_seq_init = tcp_seq_num;
-			tcp_ack_edge = tcp_seq_num + 1;
-			sack_idx = 0;
-			edge_a[sack_idx].se.l = tcp_ack_edge;
-			edge_a[sack_idx].se.r = tcp_ack_edge;
-			prev_len = 0;
-			current_tcp_state = TCP_ESTABLISHED;
-			for (i = 0; i < TCP_SACK; i++)
-				edge_a[i].st = NOPKT;
+			/* The peer's SYN was counted when it was received */
+			if (tcp_syn) {
+				conn->tcp_seq_init = tcp_seq_num;
+				conn->tcp_ack_edge = tcp_seq_num + 1;
+			}
+			conn->sack_cnt = 0;
+			conn->rcv_segs = 0;
+			conn->state = TCP_ESTABLISHED;
 
 			if (tcp_syn && tcp_ack)
 				action |= TCP_PUSH;
@@ -571,11 +697,9 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 			tcp_fin = TCP_DATA;  /* cause standalone FIN */
 		}
 
-		if ((tcp_fin) &&
-		    (!IS_ENABLED(CONFIG_PROT_TCP_SACK) ||
-		     tcp_lost.len <= TCP_OPT_LEN_2)) {
+		if (tcp_fin && !conn->sack_cnt) {
 			action = action | TCP_FIN | TCP_PUSH | TCP_ACK;
-			current_tcp_state = TCP_CLOSE_WAIT;
+			conn->state = TCP_CLOSE_WAIT;
 		} else if (tcp_ack) {
 			action = TCP_DATA;
 		}
@@ -593,7 +717,7 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 		debug_cond(DEBUG_INT_STATE, "TCP_FIN_WAIT_2 (%x)\n", tcp_flags);
 		if (tcp_ack) {
 			action = TCP_PUSH | TCP_ACK;
-			current_tcp_state = TCP_CLOSED;
+			conn->state = TCP_CLOSED;
 			puts("\n");
 		} else if (tcp_syn) {
 			action = TCP_DATA;
@@ -604,20 +728,20 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 	case TCP_FIN_WAIT_1:
 		debug_cond(DEBUG_INT_STATE, "TCP_FIN_WAIT_1 (%x)\n", tcp_flags);
 		if (tcp_fin) {
-			tcp_ack_edge++;
+			conn->tcp_ack_edge++;
 			action = TCP_ACK | TCP_FIN;
-			current_tcp_state = TCP_FIN_WAIT_2;
+			conn->state = TCP_FIN_WAIT_2;
 		}
 		if (tcp_syn)
 			action = TCP_RST;
 		if (tcp_ack)
-			current_tcp_state = TCP_CLOSED;
+			conn->state = TCP_CLOSED;
 		break;
 	case TCP_CLOSING:
 		debug_cond(DEBUG_INT_STATE, "TCP_CLOSING (%x)\n", tcp_flags);
 		if (tcp_ack) {
 			action = TCP_PUSH;
-			current_tcp_state = TCP_CLOSED;
+			conn->state = TCP_CLOSED;
 			puts("\n");
 		} else if (tcp_syn) {
 			action = TCP_RST;
@@ -629,6 +753,39 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 	return action;
 }
 
+bool tcp_ack_delayed(int dport, int sport, int payload_len, u8 action,
+		     u32 tcp_seq_num)
+{
+	struct tcp_conn *c = tcp_conn_find(sport, false);
+
+	if (!c || c->state != TCP_ESTABLISHED || payload_len ||
+	    (action & (TCP_SYN | TCP_FIN | TCP_RST)) || c->ack_now ||
+	    c->rcv_segs >= CONFIG_PROT_TCP_ACK_SEGS)
+		return false;
+
+	c->ack_pending = true;
+	c->ack_rport = dport;
+	c->ack_seq = tcp_seq_num;
+
+	return true;
+}
+
+void tcp_flush_acks(void)
+{
+	struct tcp_conn *c;
+
+	for (c = tcp_conns; c < tcp_conns + CONFIG_PROT_TCP_CONNS; c++) {
+		if (!c->ack_pending)
+			continue;
+		c->ack_pending = false;
+		if (c->state != TCP_ESTABLISHED)
+			continue;
+		c->ack_now = true;
+		net_send_tcp_packet(0, c->ack_rport, c->lport, TCP_ACK,
+				    c->ack_seq, c->tcp_ack_edge);
+	}
+}
+
 /**
  * rxhand_tcp_f() - process receiving data and call data handler.
  * @b: the packet
@@ -641,6 +798,7 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 	u8  tcp_action = TCP_DATA;
 	u32 tcp_seq_num, tcp_ack_num;
 	int tcp_hdr_len, payload_len;
+	struct tcp_conn *c;
 
 	/* Verify IP header */
 	debug_cond(DEBUG_DEV_PKT,
@@ -669,6 +827,16 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 		return;
 	}
 
+	/* A connection is only set up for a SYN from the peer */
+	c = tcp_conn_find(ntohs(b->ip.hdr.tcp_dst),
+			  b->ip.hdr.tcp_flags == TCP_SYN);
+	if (!c) {
+		debug_cond(DEBUG_DEV_PKT, "TCP RX no connection on port %u\n",
+			   ntohs(b->ip.hdr.tcp_dst));
+		return;
+	}
+	conn = c;
+
 	tcp_hdr_len = GET_TCP_HDR_LEN_IN_BYTES(b->ip.hdr.tcp_hlen);
 	payload_len = tcp_len - tcp_hdr_len;
 
@@ -686,10 +854,10 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 	tcp_action = tcp_state_machine(b->ip.hdr.tcp_flags,
 				       tcp_seq_num, payload_len);
 
-	tcp_activity_count++;
-	if (tcp_activity_count > TCP_ACTIVITY) {
+	conn->tcp_activity_count++;
+	if (conn->tcp_activity_count > TCP_ACTIVITY) {
 		puts("| ");
-		tcp_activity_count = 0;
+		conn->tcp_activity_count = 0;
 	}
 
 	if ((tcp_action & TCP_PUSH) || payload_len > 0) {
@@ -704,7 +872,7 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 	} else if (tcp_action != TCP_DATA) {
 		debug_cond(DEBUG_DEV_PKT,
 			   "TCP Action (action=%x,Seq=%u,Ack=%u,Pay=%d)\n",
-			   tcp_action, tcp_ack_num, tcp_ack_edge, payload_len);
+			   tcp_action, tcp_ack_num, conn->tcp_ack_edge, payload_len);
 
 		/*
 		 * Warning: Incoming Ack & Seq sequence numbers are transposed
@@ -713,6 +881,6 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 		net_send_tcp_packet(0, ntohs(b->ip.hdr.tcp_src),
 				    ntohs(b->ip.hdr.tcp_dst),
 				    (tcp_action & (~TCP_PUSH)),
-				    tcp_ack_num, tcp_ack_edge);
+				    tcp_ack_num, conn->tcp_ack_edge);
 	}
 }
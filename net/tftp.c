@@ -13,10 +13,12 @@
 #include <led.h>
 #include <lmb.h>
 #include <log.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <net.h>
 #include <net6.h>
 #include <asm/global_data.h>
+#include <net/sink.h>
 #include <net/tftp.h>
 #include "bootp.h"
 
@@ -150,26 +152,71 @@ static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = CONFIG_TFTP_BLOCKSIZE;
 static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
 
+/* Largest block which fits in an Ethernet frame */
+#define TFTP_MTU_BLOCKSIZE	1468
+
+/* Timeouts and out-of-order blocks seen during the current transfer */
+static uint tftp_timeouts;
+static uint tftp_out_of_order;
+#ifdef CONFIG_TFTP_WINDOWSIZE_ADAPTIVE
+/* Largest window size allowed for the current transfer */
+static ushort tftp_window_size_max;
+/* Window size to ask for, learnt from the loss seen on earlier transfers */
+static ushort tftp_window_size_adapted;
+/* Set to avoid IP fragmentation after transfers failed with a window of 1 */
+static bool tftp_block_size_backoff;
+/* Block size option before it was reduced for the backoff, 0 if it was not */
+static ushort tftp_block_size_unadapted;
+#endif
+#ifdef CONFIG_TFTP_MCAST
+/* true to ask the server for the multicast option (RFC 2090) */
+static bool tftp_mcast_wanted;
+/* Set to fetch the file by unicast after multicast failed */
+static bool tftp_mcast_off;
+/* UDP port of the multicast group, 0 if not receiving by multicast */
+static ushort tftp_mcast_port;
+/* true if we acknowledge blocks on behalf of the group */
+static bool tftp_mcast_master;
+/* Port to send a new request to when the group goes quiet */
+static int tftp_mcast_server_port;
+/* Blocks received so far, block 1 being bit 0 */
+static ulong *tftp_mcast_bitmap;
+/* Number of blocks the bitmap has room for */
+static ulong tftp_mcast_bitmap_blocks;
+/* Number of blocks received */
+static ulong tftp_mcast_held;
+/* First block not received yet */
+static ulong tftp_mcast_next;
+/* Number of the last block, 0 until the short block at the end is seen */
+static ulong tftp_mcast_last;
+/* Highest block received, used to undo the wrap of the block number */
+static ulong tftp_mcast_top;
+#else
+#define tftp_mcast_port	0
+#endif
+
 static inline int store_block(int block, uchar *src, unsigned int len)
 {
 	ulong offset = block * tftp_block_size + tftp_block_wrap_offset -
 			tftp_block_size;
 	ulong newsize = offset + len;
 	ulong store_addr = tftp_load_addr + offset;
-	void *ptr;
 
-	if (CONFIG_IS_ENABLED(LMB)) {
-		if (store_addr < tftp_load_addr ||
-		    lmb_read_check(store_addr, len)) {
-			puts("\nTFTP error: ");
-			puts("trying to overwrite reserved memory...\n");
+	if (eth_rx_get_sink()) {
+		if (eth_rx_sink_store(offset, src, len))
 			return -1;
+	} else {
+		if (CONFIG_IS_ENABLED(LMB)) {
+			if (store_addr < tftp_load_addr ||
+			    lmb_read_check(store_addr, len)) {
+				puts("\nTFTP error: ");
+				puts("trying to overwrite reserved memory...\n");
+				return -1;
+			}
 		}
-	}
 
-	ptr = map_sysmem(store_addr, len);
-	memcpy(ptr, src, len);
-	unmap_sysmem(ptr);
+		eth_rx_store(store_addr, src, len);
+	}
 
 	if (net_boot_file_size < newsize)
 		net_boot_file_size = newsize;
@@ -277,6 +324,251 @@ static void update_block_number(void)
 	show_block_marker();
 }
 
+#ifdef CONFIG_TFTP_WINDOWSIZE_ADAPTIVE
+/*
+ * Start from the window size which worked last time, limited by the size
+ * allowed for this transfer
+ */
+static void tftp_adapt_start(void)
+{
+	tftp_window_size_max = tftp_window_size_option;
+	if (!tftp_window_size_adapted ||
+	    tftp_window_size_adapted > tftp_window_size_max)
+		tftp_window_size_adapted = tftp_window_size_max;
+	tftp_window_size_option = tftp_window_size_adapted;
+
+	if (tftp_block_size_backoff &&
+	    tftp_block_size_option > TFTP_MTU_BLOCKSIZE) {
+		tftp_block_size_unadapted = tftp_block_size_option;
+		tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
+	}
+}
+
+/*
+ * Put back the options which tftp_adapt_start() changed, so that each
+ * transfer starts from the options set by the user
+ */
+static void tftp_adapt_restore(void)
+{
+	if (tftp_window_size_max)
+		tftp_window_size_option = tftp_window_size_max;
+	if (tftp_block_size_unadapted) {
+		tftp_block_size_option = tftp_block_size_unadapted;
+		tftp_block_size_unadapted = 0;
+	}
+}
+
+/*
+ * Pick the window size for the next transfer, much like a congestion
+ * controller: halve it when blocks were lost, double it back up to the
+ * largest size allowed after a clean transfer. Once the window is down to 1
+ * and the transfer still fails, stop using blocks which need IP
+ * fragmentation.
+ *
+ * The window cannot change once it has been agreed with the server, as
+ * acknowledging blocks early makes it resend the rest of the window.
+ *
+ * @failed: true if the transfer is being restarted after too many timeouts
+ */
+static void tftp_adapt_end(bool failed)
+{
+	if (tftp_put_active)
+		return;
+
+	if (failed || tftp_timeouts || tftp_out_of_order) {
+		if (tftp_window_size_adapted > 1)
+			tftp_window_size_adapted /= 2;
+		else if (failed)
+			tftp_block_size_backoff = true;
+	} else {
+		tftp_window_size_adapted = min_t(uint, tftp_window_size_max,
+						 tftp_window_size_adapted * 2);
+		tftp_block_size_backoff = false;
+	}
+	debug("TFTP next windowsize = %d\n", tftp_window_size_adapted);
+}
+#else
+static inline void tftp_adapt_start(void) {}
+static inline void tftp_adapt_restore(void) {}
+static inline void tftp_adapt_end(bool failed) {}
+#endif
+
+#ifdef CONFIG_TFTP_MCAST
+/* Leave the multicast group and forget the blocks received */
+static void tftp_mcast_cleanup(void)
+{
+	if (tftp_mcast_port)
+		eth_mcast_join(net_mcast_addr, 0);
+	net_mcast_addr.s_addr = 0;
+	tftp_mcast_port = 0;
+	tftp_mcast_master = false;
+	free(tftp_mcast_bitmap);
+	tftp_mcast_bitmap = NULL;
+	tftp_mcast_bitmap_blocks = 0;
+	tftp_mcast_held = 0;
+	tftp_mcast_next = 1;
+	tftp_mcast_last = 0;
+	tftp_mcast_top = 0;
+}
+
+/*
+ * Give up on multicast and fetch the file again by unicast. This is not a
+ * retry of the transfer, so it does not count against netretry.
+ */
+static void tftp_mcast_fallback(const char *msg)
+{
+	tftp_mcast_off = true;
+	tftp_mcast_cleanup();
+	printf("\n%s; using unicast\n", msg);
+	net_set_state(NETLOOP_RESTART);
+}
+
+void tftp_mcast_reset(void)
+{
+	tftp_mcast_off = false;
+}
+
+/*
+ * Handle the value of the "multicast" option in an OACK, "addr,port,mc".
+ * The address and port may be left empty once the group is known. mc is 1
+ * if we are the master client, which acknowledges blocks for the group.
+ *
+ * Return: 0 if OK, -ve if multicast cannot be used
+ */
+static int tftp_mcast_option(char *val)
+{
+	struct in_addr addr;
+	char *port, *mc;
+
+	port = strchr(val, ',');
+	if (!port)
+		return -EINVAL;
+	*port++ = '\0';
+	mc = strchr(port, ',');
+	if (!mc)
+		return -EINVAL;
+	*mc++ = '\0';
+	tftp_mcast_master = dectoul(mc, NULL) == 1;
+	if (tftp_mcast_port)
+		return 0;
+
+	if (!*val || !*port)
+		return -EINVAL;
+	addr = string_to_ip(val);
+	/* Only class D addresses are multicast */
+	if ((ntohl(addr.s_addr) & 0xf0000000) != 0xe0000000)
+		return -EINVAL;
+	if (eth_mcast_join(addr, 1))
+		return -ENOSYS;
+	net_mcast_addr = addr;
+	tftp_mcast_port = dectoul(port, NULL);
+	debug("TFTP multicast group %pI4:%d\n", &addr, tftp_mcast_port);
+
+	return 0;
+}
+
+/*
+ * Mark a block as received, growing the bitmap as needed
+ *
+ * Return: 1 if the block was already received, 0 if not, -ENOMEM if the
+ * bitmap cannot grow
+ */
+static int tftp_mcast_mark(ulong block)
+{
+	ulong bit = block - 1;
+
+	if (bit >= tftp_mcast_bitmap_blocks) {
+		ulong old = BITS_TO_LONGS(tftp_mcast_bitmap_blocks);
+		ulong longs = BITS_TO_LONGS(max(bit + 1,
+						tftp_mcast_bitmap_blocks * 2));
+		ulong *map;
+
+		map = realloc(tftp_mcast_bitmap, longs * sizeof(ulong));
+		if (!map)
+			return -ENOMEM;
+		memset(map + old, '\0', (longs - old) * sizeof(ulong));
+		tftp_mcast_bitmap = map;
+		tftp_mcast_bitmap_blocks = longs * BITS_PER_LONG;
+	}
+	if (tftp_mcast_bitmap[BIT_WORD(bit)] & BIT_MASK(bit))
+		return 1;
+	tftp_mcast_bitmap[BIT_WORD(bit)] |= BIT_MASK(bit);
+
+	return 0;
+}
+
+static bool tftp_mcast_held_block(ulong block)
+{
+	ulong bit = block - 1;
+
+	return bit < tftp_mcast_bitmap_blocks &&
+		(tftp_mcast_bitmap[BIT_WORD(bit)] & BIT_MASK(bit));
+}
+
+static void tftp_complete(void);
+
+/*
+ * Store a block sent to the group. Blocks may arrive in any order and may
+ * be missed altogether: the master acknowledges the last block before the
+ * first one it is missing, so the server goes back and sends that again.
+ */
+static void tftp_mcast_data(ushort seq, uchar *pkt, unsigned int len)
+{
+	ulong block = tftp_mcast_top + (short)(seq - (ushort)tftp_mcast_top);
+	bool done;
+	int ret;
+
+	if ((long)block < 1 || (tftp_mcast_last && block > tftp_mcast_last))
+		return;
+	if (tftp_state != STATE_DATA) {
+		if (!tftp_mcast_held)
+			new_transfer();
+		tftp_state = STATE_DATA;
+	}
+	timeout_count = 0;
+	timeout_count_max = tftp_timeout_count_max;
+	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+
+	ret = tftp_mcast_mark(block);
+	if (ret < 0) {
+		puts("\nTFTP error: out of memory for multicast\n");
+		eth_halt();
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	if (!ret) {
+		if (store_block(block, pkt, len)) {
+			eth_halt();
+			net_set_state(NETLOOP_FAIL);
+			return;
+		}
+		tftp_mcast_held++;
+		tftp_mcast_top = max(tftp_mcast_top, block);
+		if (len < tftp_block_size)
+			tftp_mcast_last = block;
+		while (tftp_mcast_held_block(tftp_mcast_next))
+			tftp_mcast_next++;
+		if (!(tftp_mcast_held % 10))
+			putc('#');
+		if (!(tftp_mcast_held % (10 * HASHES_PER_LINE)))
+			puts("\n\t ");
+	}
+
+	/* The last ACK also tells the server that we have the whole file */
+	done = tftp_mcast_last && tftp_mcast_next > tftp_mcast_last;
+	if (tftp_mcast_master || done) {
+		tftp_cur_block = (ushort)(tftp_mcast_next - 1);
+		tftp_send();
+	}
+	if (done) {
+		tftp_mcast_cleanup();
+		tftp_complete();
+	}
+}
+#else
+static inline void tftp_mcast_cleanup(void) {}
+#endif
+
 /* The TFTP get or put is complete */
 static void tftp_complete(void)
 {
@@ -295,6 +587,14 @@ static void tftp_complete(void)
 		print_size(net_boot_file_size /
 			time_start * 1000, "/s");
 	}
+	if (!tftp_put_active && (tftp_windowsize > 1 ||
+				 IS_ENABLED(CONFIG_TFTP_WINDOWSIZE_ADAPTIVE))) {
+		printf("\n\t window %d, block size %d,", tftp_windowsize,
+		       tftp_block_size);
+		printf(" %u timeouts, %u out of order", tftp_timeouts,
+		       tftp_out_of_order);
+	}
+	tftp_adapt_end(false);
 	puts("\ndone\n");
 
 	led_activity_off();
@@ -353,6 +653,10 @@ static void tftp_send(void)
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, tftp_block_size_option, 0);
 
+#ifdef CONFIG_TFTP_MCAST
+		if (tftp_state == STATE_SEND_RRQ && tftp_mcast_wanted)
+			pkt += sprintf((char *)pkt, "multicast%c%c", 0, 0);
+#endif
 		/* try for more effic. window size.
 		 * Implemented only for tftp get.
 		 * Don't bother sending if it's 1
@@ -457,11 +761,12 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	int i;
 	u16 timeout_val_rcvd;
 
-	if (dest != tftp_our_port) {
-			return;
-	}
+	if (dest != tftp_our_port &&
+	    (!tftp_mcast_port || dest != tftp_mcast_port))
+		return;
 	if (tftp_state != STATE_SEND_RRQ && src != tftp_remote_port &&
-	    tftp_state != STATE_RECV_WRQ && tftp_state != STATE_SEND_WRQ)
+	    tftp_state != STATE_RECV_WRQ && tftp_state != STATE_SEND_WRQ &&
+	    dest != tftp_mcast_port)
 		return;
 
 	if (len < 2)
@@ -572,10 +877,28 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("windowsize = %s, %d\n",
 				      (char *)pkt + i + 11, tftp_windowsize);
 			}
+#ifdef CONFIG_TFTP_MCAST
+			if (tftp_mcast_wanted &&
+			    strcasecmp((char *)pkt + i, "multicast") == 0 &&
+			    tftp_mcast_option((char *)pkt + i + 10)) {
+				tftp_mcast_fallback("Cannot use multicast");
+				return;
+			}
+#endif
 		}
 
 		tftp_next_ack = tftp_windowsize;
 
+#ifdef CONFIG_TFTP_MCAST
+		if (tftp_mcast_port && tftp_state == STATE_OACK) {
+			/* The master asks for the first block it is missing */
+			tftp_cur_block = (ushort)(tftp_mcast_next - 1);
+			if (tftp_mcast_master)
+				tftp_send();
+			break;
+		}
+#endif
+
 #ifdef CONFIG_CMD_TFTPPUT
 		if (tftp_put_active && tftp_state == STATE_OACK) {
 			/* Get ready to send the first block */
@@ -590,6 +913,12 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			return;
 		len -= 2;
 
+#ifdef CONFIG_TFTP_MCAST
+		if (tftp_mcast_port) {
+			tftp_mcast_data(ntohs(*(__be16 *)pkt), pkt + 2, len);
+			break;
+		}
+#endif
 		if (ntohs(*(__be16 *)pkt) != (ushort)(tftp_cur_block + 1)) {
 			debug("Received unexpected block: %d, expected: %d\n",
 			      ntohs(*(__be16 *)pkt),
@@ -609,6 +938,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 * This just overwellms the server, let's just send one.
 			 */
 			if (tftp_last_nack != tftp_cur_block) {
+				tftp_out_of_order++;
 				tftp_send();
 				tftp_last_nack = tftp_cur_block;
 				tftp_next_ack = (ushort)(tftp_cur_block +
@@ -702,10 +1032,28 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 static void tftp_timeout_handler(void)
 {
 	if (++timeout_count > timeout_count_max) {
+#ifdef CONFIG_TFTP_MCAST
+		if (tftp_mcast_port) {
+			tftp_mcast_fallback("Multicast timed out");
+			return;
+		}
+#endif
+		tftp_adapt_end(true);
 		restart("Retry count exceeded");
 	} else {
 		puts("T ");
+		tftp_timeouts++;
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+#ifdef CONFIG_TFTP_MCAST
+		/*
+		 * Only the master may acknowledge; the others ask again, so
+		 * that the server can make them master if the old one left
+		 */
+		if (tftp_mcast_port && !tftp_mcast_master) {
+			tftp_state = STATE_SEND_RRQ;
+			tftp_remote_port = tftp_mcast_server_port;
+		}
+#endif
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
 	}
@@ -746,7 +1094,7 @@ static void sanitize_tftp_block_size_option(enum proto_t protocol)
 		 * (and small enough that it fits net_tx_packet which
 		 * has room for PKTSIZE_ALIGN bytes).
 		 */
-		cap = 1468;
+		cap = TFTP_MTU_BLOCKSIZE;
 	}
 	if (tftp_block_size_option > cap) {
 		printf("Capping tftp block size option to %d (was %d)\n",
@@ -760,6 +1108,7 @@ void tftp_start(enum proto_t protocol)
 {
 	__maybe_unused char *ep;             /* Environment pointer */
 
+	tftp_adapt_restore();
 	if (saved_tftp_block_size_option) {
 		tftp_block_size_option = saved_tftp_block_size_option;
 		saved_tftp_block_size_option = 0;
@@ -779,6 +1128,8 @@ void tftp_start(enum proto_t protocol)
 		ep = env_get("tftpwindowsize");
 		if (ep != NULL)
 			tftp_window_size_option = simple_strtol(ep, NULL, 10);
+		if (!tftp_window_size_option)
+			tftp_window_size_option = 1;
 
 		ep = env_get("tftptimeout");
 		if (ep != NULL)
@@ -802,6 +1153,14 @@ void tftp_start(enum proto_t protocol)
 	}
 
 	sanitize_tftp_block_size_option(protocol);
+	tftp_adapt_start();
+#ifdef CONFIG_TFTP_MCAST
+	tftp_mcast_cleanup();
+	tftp_mcast_wanted = protocol == TFTPGET && !tftp_mcast_off &&
+		!net_sink_active() && env_get_yesno("tftpmcast") != 0;
+#endif
+	tftp_timeouts = 0;
+	tftp_out_of_order = 0;
 
 	debug("TFTP blocksize = %i, TFTP windowsize = %d timeout = %ld ms\n",
 	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
@@ -930,6 +1289,9 @@ void tftp_start(enum proto_t protocol)
 	ep = env_get("tftpsrcp");
 	if (ep != NULL)
 		tftp_our_port = simple_strtol(ep, NULL, 10);
+#endif
+#ifdef CONFIG_TFTP_MCAST
+	tftp_mcast_server_port = tftp_remote_port;
 #endif
 	tftp_cur_block = 0;
 	tftp_windowsize = 1;
@@ -13,9 +13,11 @@
 #include <lmb.h>
 #include <mapmem.h>
 #include <net.h>
+#include <net/sink.h>
 #include <net/tcp.h>
 #include <net/wget.h>
 #include <stdlib.h>
+#include <vsprintf.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -25,44 +27,90 @@ DECLARE_GLOBAL_DATA_PTR;
 static const char bootfile1[] = "GET ";
 static const char bootfile3[] = " HTTP/1.0\r\n\r\n";
 static const char http_eom[] = "\r\n\r\n";
-static const char http_ok[] = "200";
 static const char linefeed[] = "\r\n";
 static struct in_addr web_server_ip;
-static int our_port;
-static int wget_timeout_count;
 
+/* Largest packet which can be queued before the HTTP header */
+#define PKT_QUEUE_PACKET_SIZE 0x800
+
+/*
+ * Packets received before the HTTP header. They are kept with the
+ * connection rather than in the load buffer, where they could overwrite
+ * data received on other connections.
+ */
 struct pkt_qd {
-	uchar *pkt;
 	unsigned int tcp_seq_num;
 	unsigned int len;
+	uchar pkt[PKT_QUEUE_PACKET_SIZE];
 };
 
-/*
- * This is a control structure for out of order packets received.
- * The actual packet bufers are in the kernel space, and are
- * expected to be overwritten by the downloaded image.
- */
 #define PKTQ_SZ (PKTBUFSRX / 4)
-static struct pkt_qd pkt_q[PKTQ_SZ];
-static int pkt_q_idx;
-static unsigned int packets;
 
-static unsigned int initial_data_seq_num;
-static unsigned int next_data_seq_num;
+/**
+ * struct wget_conn - connection fetching a range of the file
+ * @state: wget state of the connection
+ * @port: our TCP port
+ * @start: offset in the file of the first byte of the range
+ * @end: offset in the file after the last byte of the range, 0 for the
+ *	end of the file
+ * @done: number of bytes of the range received in order
+ * @offset: offset in the file of the first byte of the current response
+ * @cut: the server sends more than the range, so the connection is reset
+ *	once the range is complete
+ * @complete: the range has been received and the connection closed
+ * @packets: number of packets received on the connection
+ * @tick_packets: value of @packets at the last timeout tick
+ * @stalled: number of timeout ticks without a packet
+ * @initial_data_seq_num: TCP sequence number of the first byte of data
+ * @next_data_seq_num: TCP sequence number of the next byte of data
+ * @retry_action: action for TCP retry
+ * @retry_tcp_ack_num: TCP retry acknowledge number
+ * @retry_tcp_seq_num: TCP retry sequence number
+ * @retry_len: TCP retry length
+ * @pkt_q: packets received before the HTTP header
+ * @pkt_q_idx: number of packets in @pkt_q
+ */
+struct wget_conn {
+	enum wget_state state;
+	int port;
+	ulong start;
+	ulong end;
+	ulong done;
+	ulong offset;
+	bool cut;
+	bool complete;
+	unsigned int packets;
+	unsigned int tick_packets;
+	int stalled;
+	unsigned int initial_data_seq_num;
+	unsigned int next_data_seq_num;
+	u8 retry_action;
+	unsigned int retry_tcp_ack_num;
+	unsigned int retry_tcp_seq_num;
+	int retry_len;
+	struct pkt_qd pkt_q[PKTQ_SZ];
+	int pkt_q_idx;
+};
 
-static enum  wget_state current_wget_state;
+static struct wget_conn wget_conns[CONFIG_PROT_TCP_CONNS];
+/* Number of connections fetching the file */
+static int wget_nconns;
+/* Number of connections asked for with the 'wgetconns' variable */
+static int wget_max_conns;
+/* Size of the file, 0 if the server did not tell */
+static ulong wget_file_size;
+/* The server accepts range requests */
+static bool wget_ranges;
+/* Number of times connections were reopened to resume a transfer */
+static int wget_resumes;
+/* Last TCP port used */
+static int wget_port;
 
 static char *image_url;
 static unsigned int wget_timeout = WGET_TIMEOUT;
 
 static enum net_loop_state wget_loop_state;
 
-/* Timeout retry parameters */
-static u8 retry_action;			/* actions for TCP retry */
-static unsigned int retry_tcp_ack_num;	/* TCP retry acknowledge number*/
-static unsigned int retry_tcp_seq_num;	/* TCP retry sequence number */
-static int retry_len;			/* TCP retry length */
-
 /**
  * store_block() - store block in memory
  * @src: source of data
@@ -73,20 +121,22 @@ static inline int store_block(uchar *src, unsigned int offset, unsigned int len)
 {
 	ulong store_addr = image_load_addr + offset;
 	ulong newsize = offset + len;
-	uchar *ptr;
 
-	if (CONFIG_IS_ENABLED(LMB)) {
-		if (store_addr < image_load_addr ||
-		    lmb_read_check(store_addr, len)) {
-			printf("\nwget error: ");
-			printf("trying to overwrite reserved memory...\n");
+	if (eth_rx_get_sink()) {
+		if (eth_rx_sink_store(offset, src, len))
 			return -1;
+	} else {
+		if (CONFIG_IS_ENABLED(LMB)) {
+			if (store_addr < image_load_addr ||
+			    lmb_read_check(store_addr, len)) {
+				printf("\nwget error: ");
+				printf("trying to overwrite reserved memory...\n");
+				return -1;
+			}
 		}
-	}
 
-	ptr = map_sysmem(store_addr, len);
-	memcpy(ptr, src, len);
-	unmap_sysmem(ptr);
+		eth_rx_store(store_addr, src, len);
+	}
 
 	if (net_boot_file_size < (offset + len))
 		net_boot_file_size = newsize;
@@ -94,80 +144,253 @@ static inline int store_block(uchar *src, unsigned int offset, unsigned int len)
 	return 0;
 }
 
+/**
+ * wget_store() - store data received on a connection
+ * @conn: connection
+ * @src: data
+ * @tcp_seq_num: TCP sequence number of the data
+ * @len: length of the data
+ *
+ * Data before the response body or past the end of the range of the
+ * connection is dropped.
+ *
+ * Return: 0 if OK, -1 on error
+ */
+static int wget_store(struct wget_conn *conn, uchar *src,
+		      unsigned int tcp_seq_num, unsigned int len)
+{
+	int skip = conn->initial_data_seq_num - tcp_seq_num;
+	ulong offset;
+
+	if (skip > 0) {
+		if (skip >= len)
+			return 0;
+		src += skip;
+		len -= skip;
+		tcp_seq_num += skip;
+	}
+	offset = conn->offset + tcp_seq_num - conn->initial_data_seq_num;
+
+	if (conn->end) {
+		if (offset >= conn->end)
+			return 0;
+		len = min_t(ulong, len, conn->end - offset);
+	}
+
+	return store_block(src, offset, len);
+}
+
+/**
+ * wget_range_end() - get the end of the range of a connection
+ * @conn: connection
+ *
+ * Return: offset in the file after the last byte of the range, 0 if unknown
+ */
+static ulong wget_range_end(struct wget_conn *conn)
+{
+	return conn->end ? conn->end : wget_file_size;
+}
+
+/**
+ * wget_send_request() - send the HTTP request of a connection
+ * @conn: connection
+ * @server_port: TCP port of the server
+ * @tcp_seq_num: TCP sequence number
+ * @tcp_ack_num: TCP acknowledge number
+ *
+ * The whole file is asked for with a HTTP/1.0 request. Ranges, which
+ * are used to fetch parts of the file in parallel or to resume a
+ * transfer, are asked for with a HTTP/1.1 range request.
+ */
+static void wget_send_request(struct wget_conn *conn, unsigned int server_port,
+			      unsigned int tcp_seq_num,
+			      unsigned int tcp_ack_num)
+{
+	uchar *ptr, *offset;
+
+	ptr = net_tx_packet + net_eth_hdr_size() +
+		IP_TCP_HDR_SIZE + TCP_TSOPT_SIZE + 2;
+	offset = ptr;
+
+	memcpy(offset, &bootfile1, strlen(bootfile1));
+	offset += strlen(bootfile1);
+
+	memcpy(offset, image_url, strlen(image_url));
+	offset += strlen(image_url);
+
+	conn->offset = conn->start + conn->done;
+	if (!conn->offset && !conn->end) {
+		memcpy(offset, &bootfile3, strlen(bootfile3));
+		offset += strlen(bootfile3);
+	} else {
+		offset += sprintf((char *)offset,
+				  " HTTP/1.1\r\nHost: %pI4\r\nRange: bytes=%lu-",
+				  &web_server_ip, conn->offset);
+		if (conn->end)
+			offset += sprintf((char *)offset, "%lu", conn->end - 1);
+		offset += sprintf((char *)offset,
+				  "\r\nConnection: close\r\n\r\n");
+	}
+	net_send_tcp_packet((offset - ptr), server_port, conn->port,
+			    TCP_PUSH, tcp_seq_num, tcp_ack_num);
+}
+
 /**
  * wget_send_stored() - wget response dispatcher
+ * @conn: connection to send on
  *
  * WARNING, This, and only this, is the place in wget.c where
  * SEQUENCE NUMBERS are swapped between incoming (RX)
  * and outgoing (TX).
  * Procedure wget_handler() is correct for RX traffic.
  */
-static void wget_send_stored(void)
+static void wget_send_stored(struct wget_conn *conn)
 {
-	u8 action = retry_action;
-	int len = retry_len;
-	unsigned int tcp_ack_num = retry_tcp_seq_num + (len == 0 ? 1 : len);
-	unsigned int tcp_seq_num = retry_tcp_ack_num;
+	u8 action = conn->retry_action;
+	int len = conn->retry_len;
+	unsigned int tcp_ack_num = conn->retry_tcp_seq_num +
+				   (len == 0 ? 1 : len);
+	unsigned int tcp_seq_num = conn->retry_tcp_ack_num;
 	unsigned int server_port;
-	uchar *ptr, *offset;
 
 	server_port = env_get_ulong("httpdstp", 10, SERVER_PORT) & 0xffff;
 
-	switch (current_wget_state) {
+	switch (conn->state) {
 	case WGET_CLOSED:
 		debug_cond(DEBUG_WGET, "wget: send SYN\n");
-		current_wget_state = WGET_CONNECTING;
-		net_send_tcp_packet(0, server_port, our_port, action,
+		conn->state = WGET_CONNECTING;
+		net_send_tcp_packet(0, server_port, conn->port, action,
 				    tcp_seq_num, tcp_ack_num);
-		packets = 0;
+		conn->packets = 0;
 		break;
 	case WGET_CONNECTING:
-		pkt_q_idx = 0;
-		net_send_tcp_packet(0, server_port, our_port, action,
+		conn->pkt_q_idx = 0;
+		net_send_tcp_packet(0, server_port, conn->port, action,
 				    tcp_seq_num, tcp_ack_num);
-
-		ptr = net_tx_packet + net_eth_hdr_size() +
-			IP_TCP_HDR_SIZE + TCP_TSOPT_SIZE + 2;
-		offset = ptr;
-
-		memcpy(offset, &bootfile1, strlen(bootfile1));
-		offset += strlen(bootfile1);
-
-		memcpy(offset, image_url, strlen(image_url));
-		offset += strlen(image_url);
-
-		memcpy(offset, &bootfile3, strlen(bootfile3));
-		offset += strlen(bootfile3);
-		net_send_tcp_packet((offset - ptr), server_port, our_port,
-				    TCP_PUSH, tcp_seq_num, tcp_ack_num);
-		current_wget_state = WGET_CONNECTED;
+		wget_send_request(conn, server_port, tcp_seq_num, tcp_ack_num);
+		conn->state = WGET_CONNECTED;
 		break;
 	case WGET_CONNECTED:
 	case WGET_TRANSFERRING:
 	case WGET_TRANSFERRED:
-		net_send_tcp_packet(0, server_port, our_port, action,
+		net_send_tcp_packet(0, server_port, conn->port, action,
 				    tcp_seq_num, tcp_ack_num);
 		break;
 	}
 }
 
-static void wget_send(u8 action, unsigned int tcp_seq_num,
-		      unsigned int tcp_ack_num, int len)
+static void wget_send(struct wget_conn *conn, u8 action,
+		      unsigned int tcp_seq_num, unsigned int tcp_ack_num,
+		      int len)
 {
-	retry_action = action;
-	retry_tcp_ack_num = tcp_ack_num;
-	retry_tcp_seq_num = tcp_seq_num;
-	retry_len = len;
+	conn->retry_action = action;
+	conn->retry_tcp_ack_num = tcp_ack_num;
+	conn->retry_tcp_seq_num = tcp_seq_num;
+	conn->retry_len = len;
 
-	wget_send_stored();
+	wget_send_stored(conn);
 }
 
-void wget_fail(char *error_message, unsigned int tcp_seq_num,
-	       unsigned int tcp_ack_num, u8 action)
+static void wget_fail(struct wget_conn *conn, char *error_message,
+		      unsigned int tcp_seq_num, unsigned int tcp_ack_num,
+		      u8 action)
 {
 	printf("wget: Transfer Fail - %s\n", error_message);
 	net_set_timeout_handler(0, NULL);
-	wget_send(action, tcp_seq_num, tcp_ack_num, 0);
+	wget_send(conn, action, tcp_seq_num, tcp_ack_num, 0);
+}
+
+#define RANDOM_PORT_START 1024
+#define RANDOM_PORT_RANGE 0x4000
+
+/**
+ * random_port() - make port a little random (1024-17407)
+ *
+ * Return: random port number from 1024 to 17407
+ *
+ * This keeps the math somewhat trivial to compute, and seems to work with
+ * all supported protocols/clients/servers
+ */
+static unsigned int random_port(void)
+{
+	return RANDOM_PORT_START + (get_timer(0) % RANDOM_PORT_RANGE);
+}
+
+/**
+ * wget_next_port() - get the port for a new connection
+ *
+ * Return: the port following the last one used, in the random port range
+ */
+static unsigned int wget_next_port(void)
+{
+	wget_port = RANDOM_PORT_START +
+		(wget_port + 1 - RANDOM_PORT_START) % RANDOM_PORT_RANGE;
+
+	return wget_port;
+}
+
+/**
+ * wget_connect() - open a connection to fetch a range of the file
+ * @conn: connection
+ * @start: offset in the file of the first byte of the range
+ * @end: offset in the file after the last byte of the range, 0 for the
+ *	end of the file
+ */
+static void wget_connect(struct wget_conn *conn, ulong start, ulong end)
+{
+	memset(conn, '\0', sizeof(*conn));
+	conn->port = wget_next_port();
+	conn->start = start;
+	conn->end = end;
+	conn->state = WGET_CLOSED;
+
+	wget_send(conn, TCP_SYN, 0, 0, 0);
+}
+
+/**
+ * wget_resume() - reopen a connection to fetch the rest of its range
+ * @conn: connection
+ *
+ * The old connection is reset and a new one asks for the part of the
+ * range which was not received yet.
+ */
+static void wget_resume(struct wget_conn *conn)
+{
+	unsigned int server_port;
+	ulong start = conn->start, end = conn->end, done = conn->done;
+	unsigned int packets = conn->packets;
+
+	server_port = env_get_ulong("httpdstp", 10, SERVER_PORT) & 0xffff;
+	if (conn->state != WGET_CLOSED && conn->state != WGET_CONNECTING)
+		net_send_tcp_packet(0, server_port, conn->port, TCP_RST,
+				    conn->retry_tcp_ack_num,
+				    conn->retry_tcp_seq_num);
+
+	wget_resumes++;
+	if (wget_nconns > 1)
+		printf("\nwget: range %d: resuming at %lu\n",
+		       (int)(conn - wget_conns), start + done);
+	else
+		printf("\nwget: resuming at %lu\n", start + done);
+
+	wget_connect(conn, start, end);
+	conn->done = done;
+	conn->packets = packets;
+}
+
+/**
+ * wget_can_resume() - check whether a connection can be resumed
+ * @conn: connection
+ *
+ * Return: true if the rest of the range can be asked for on a new
+ *	connection
+ */
+static bool wget_can_resume(struct wget_conn *conn)
+{
+	if (wget_resumes >= WGET_RESUME_COUNT)
+		return false;
+
+	return wget_ranges || !(conn->start + conn->done);
 }
 
 /*
@@ -175,29 +398,151 @@ void wget_fail(char *error_message, unsigned int tcp_seq_num,
  */
 static void wget_timeout_handler(void)
 {
-	if (++wget_timeout_count > WGET_RETRY_COUNT) {
-		puts("\nRetry count exceeded; starting again\n");
-		wget_send(TCP_RST, 0, 0, 0);
-		net_start_again();
-	} else {
-		puts("T ");
-		net_set_timeout_handler(wget_timeout +
-					WGET_TIMEOUT * wget_timeout_count,
-					wget_timeout_handler);
-		wget_send_stored();
+	struct wget_conn *conn;
+
+	for (conn = wget_conns; conn < wget_conns + wget_nconns; conn++) {
+		if (conn->complete)
+			continue;
+		if (conn->packets != conn->tick_packets) {
+			conn->tick_packets = conn->packets;
+			conn->stalled = 0;
+			continue;
+		}
+
+		if (++conn->stalled <= WGET_RETRY_COUNT) {
+			puts("T ");
+			wget_send_stored(conn);
+		} else if (wget_can_resume(conn)) {
+			wget_resume(conn);
+		} else {
+			puts("\nRetry count exceeded; starting again\n");
+			wget_send(conn, TCP_RST, 0, 0, 0);
+			net_start_again();
+			return;
+		}
 	}
+
+	net_set_timeout_handler(wget_timeout, wget_timeout_handler);
 }
 
-#define PKT_QUEUE_OFFSET 0x20000
-#define PKT_QUEUE_PACKET_SIZE 0x800
+/* Smallest range worth fetching over a connection of its own */
+#define WGET_MIN_RANGE	0x40000
+/* Ranges fetched in parallel start on this boundary */
+#define WGET_RANGE_ALIGN	0x1000
+
+/**
+ * wget_header_field() - find a field of a HTTP header
+ * @hdr: HTTP header, up to and including the empty line ending it
+ * @name: name of the field, followed by a colon
+ *
+ * Return: value of the field, NULL if not found
+ */
+static const char *wget_header_field(const char *hdr, const char *name)
+{
+	const char *end = strstr(hdr, http_eom);
+	const char *pos;
+
+	for (pos = hdr; pos && pos < end; pos = strstr(pos, linefeed)) {
+		pos += strlen(linefeed);
+		if (!strncasecmp(pos, name, strlen(name))) {
+			pos += strlen(name);
+			while (*pos == ' ')
+				pos++;
+			return pos;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * wget_parse_header() - check the HTTP header received on a connection
+ * @conn: connection
+ * @hdr: HTTP header
+ *
+ * This checks that the response contains what was asked for and learns
+ * the size of the file and whether the server accepts range requests.
+ *
+ * Return: 0 if OK, -1 if the response is an error
+ */
+static int wget_parse_header(struct wget_conn *conn, const char *hdr)
+{
+	const char *pos;
+	ulong status;
+
+	pos = strchr(hdr, ' ');
+	status = pos ? simple_strtoul(pos + 1, NULL, 10) : 0;
+
+	switch (status) {
+	case 200:
+		pos = wget_header_field(hdr, "Content-Length:");
+		if (pos)
+			wget_file_size = simple_strtoul(pos, NULL, 10);
+		pos = wget_header_field(hdr, "Accept-Ranges:");
+		wget_ranges = pos && !strncmp(pos, "bytes", 5);
+		if (conn->offset) {
+			/* The server sends the whole file again */
+			if (wget_nconns > 1)
+				return -1;
+			debug_cond(DEBUG_WGET, "wget: range ignored\n");
+			conn->start = 0;
+			conn->done = 0;
+			conn->offset = 0;
+		}
+		return 0;
+	case 206:
+		pos = wget_header_field(hdr, "Content-Range:");
+		if (!pos || strncmp(pos, "bytes ", 6) ||
+		    simple_strtoul(pos + 6, NULL, 10) != conn->offset)
+			return -1;
+		pos = strchr(pos, '/');
+		if (pos && pos[1] != '*')
+			wget_file_size = simple_strtoul(pos + 1, NULL, 10);
+		wget_ranges = true;
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+/**
+ * wget_split() - fetch the file over several connections
+ * @conn: first connection, fetching the whole file
+ *
+ * The file is split into one range per connection and connections are
+ * opened for all the ranges but the first, which is left to @conn. It is
+ * reset once it has received its range.
+ */
+static void wget_split(struct wget_conn *conn)
+{
+	ulong part;
+	int i, n;
+
+	n = min_t(ulong, wget_max_conns, wget_file_size / WGET_MIN_RANGE);
+	if (n < 2)
+		return;
+
+	part = ALIGN(DIV_ROUND_UP(wget_file_size, n), WGET_RANGE_ALIGN);
+	n = DIV_ROUND_UP(wget_file_size, part);
+	printf("\nwget: fetching %lu bytes over %d connections\n",
+	       wget_file_size, n);
+
+	conn->end = part;
+	conn->cut = true;
+	wget_nconns = n;
+	for (i = 1; i < n; i++)
+		wget_connect(&wget_conns[i], i * part,
+			     min(wget_file_size, (i + 1) * part));
+}
 
-static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
-			   u8 action, unsigned int tcp_ack_num, unsigned int len)
+static void wget_connected(struct wget_conn *conn, uchar *pkt,
+			   unsigned int tcp_seq_num, u8 action,
+			   unsigned int tcp_ack_num, unsigned int len)
 {
-	uchar *pkt_in_q;
+	u32 edge = tcp_get_ack_edge();
+	struct pkt_qd *pkt_in_q;
 	char *pos;
 	int hlen, i;
-	uchar *ptr1;
 
 	pkt[len] = '\0';
 	pos = strstr((char *)pkt, http_eom);
@@ -205,24 +550,18 @@ static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 	if (!pos) {
 		debug_cond(DEBUG_WGET,
 			   "wget: Connected, data before Header %p\n", pkt);
-		pkt_in_q = (void *)image_load_addr + PKT_QUEUE_OFFSET +
-			(pkt_q_idx * PKT_QUEUE_PACKET_SIZE);
-
-		ptr1 = map_sysmem((ulong)pkt_in_q, len);
-		memcpy(ptr1, pkt, len);
-		unmap_sysmem(ptr1);
-
-		pkt_q[pkt_q_idx].pkt = pkt_in_q;
-		pkt_q[pkt_q_idx].tcp_seq_num = tcp_seq_num;
-		pkt_q[pkt_q_idx].len = len;
-		pkt_q_idx++;
-
-		if (pkt_q_idx >= PKTQ_SZ) {
+		if (conn->pkt_q_idx >= PKTQ_SZ ||
+		    len > PKT_QUEUE_PACKET_SIZE) {
 			printf("wget: Fatal error, queue overrun!\n");
 			net_set_state(NETLOOP_FAIL);
 
 			return;
 		}
+		pkt_in_q = &conn->pkt_q[conn->pkt_q_idx++];
+		memcpy(pkt_in_q->pkt, pkt, len);
+		eth_count_rx_copy(NULL, len);
+		pkt_in_q->tcp_seq_num = tcp_seq_num;
+		pkt_in_q->len = len;
 	} else {
 		debug_cond(DEBUG_WGET, "wget: Connected HTTP Header %p\n", pkt);
 		/* sizeof(http_eom) - 1 is the string length of (http_eom) */
@@ -232,57 +571,98 @@ static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 			i = pos - (char *)pkt;
 		else
 			i = hlen;
-		printf("%.*s", i,  pkt);
+		/* Only the first response of a transfer is shown */
+		if (!conn->start && !conn->done && wget_nconns == 1)
+			printf("%.*s", i,  pkt);
 
-		current_wget_state = WGET_TRANSFERRING;
+		conn->state = WGET_TRANSFERRING;
 
-		initial_data_seq_num = tcp_seq_num + hlen;
-		next_data_seq_num    = tcp_seq_num + len;
+		conn->initial_data_seq_num = tcp_seq_num + hlen;
 
-		if (strstr((char *)pkt, http_ok) == 0) {
+		if (wget_parse_header(conn, (char *)pkt)) {
 			debug_cond(DEBUG_WGET,
 				   "wget: Connected Bad Xfer\n");
 			wget_loop_state = NETLOOP_FAIL;
-			wget_send(action, tcp_seq_num, tcp_ack_num, len);
+			wget_send(conn, action, tcp_seq_num, tcp_ack_num, len);
 		} else {
 			debug_cond(DEBUG_WGET,
 				   "wget: Connected Pkt %p hlen %x\n",
 				   pkt, hlen);
 
-			net_boot_file_size = 0;
+			if (!conn->offset)
+				net_boot_file_size = 0;
+			if (conn == wget_conns && !conn->offset &&
+			    wget_max_conns > 1 && wget_ranges)
+				wget_split(conn);
 
 			if (len > hlen) {
-				if (store_block(pkt + hlen, 0, len - hlen) != 0) {
+				if (wget_store(conn, pkt + hlen,
+					       conn->initial_data_seq_num,
+					       len - hlen) != 0) {
 					wget_loop_state = NETLOOP_FAIL;
-					wget_fail("wget: store error\n", tcp_seq_num, tcp_ack_num, action);
+					wget_fail(conn, "wget: store error\n",
+						  tcp_seq_num, tcp_ack_num,
+						  action);
 					net_set_state(NETLOOP_FAIL);
 					return;
 				}
 			}
 
-			for (i = 0; i < pkt_q_idx; i++) {
+			for (i = 0; i < conn->pkt_q_idx; i++) {
 				int err;
 
-				ptr1 = map_sysmem((ulong)pkt_q[i].pkt,
-						  pkt_q[i].len);
-				err = store_block(ptr1,
-					  pkt_q[i].tcp_seq_num -
-					  initial_data_seq_num,
-					  pkt_q[i].len);
-				unmap_sysmem(ptr1);
+				err = wget_store(conn, conn->pkt_q[i].pkt,
+						 conn->pkt_q[i].tcp_seq_num,
+						 conn->pkt_q[i].len);
 				debug_cond(DEBUG_WGET,
 					   "wget: Conncted pkt Q %p len %x\n",
-					   pkt_q[i].pkt, pkt_q[i].len);
+					   conn->pkt_q[i].pkt,
+					   conn->pkt_q[i].len);
 				if (err) {
 					wget_loop_state = NETLOOP_FAIL;
-					wget_fail("wget: store error\n", tcp_seq_num, tcp_ack_num, action);
+					wget_fail(conn, "wget: store error\n",
+						  tcp_seq_num, tcp_ack_num,
+						  action);
 					net_set_state(NETLOOP_FAIL);
 					return;
 				}
 			}
+			conn->next_data_seq_num = edge;
+			conn->done = conn->offset - conn->start + edge -
+				conn->initial_data_seq_num;
 		}
 	}
-	wget_send(action, tcp_seq_num, tcp_ack_num, len);
+	wget_send(conn, action, tcp_seq_num, tcp_ack_num, len);
+}
+
+/**
+ * wget_complete() - handle the end of the range of a connection
+ * @conn: connection
+ *
+ * Once all the ranges are complete, the transfer is successful.
+ */
+static void wget_complete(struct wget_conn *conn)
+{
+	unsigned int packets = 0;
+
+	conn->complete = true;
+	if (wget_nconns > 1)
+		printf("\nwget: range %d: %lu bytes at %lu done, %u packets\n",
+		       (int)(conn - wget_conns), conn->done, conn->start,
+		       conn->packets);
+
+	for (conn = wget_conns; conn < wget_conns + wget_nconns; conn++) {
+		if (!conn->complete)
+			return;
+		packets += conn->packets;
+	}
+
+	printf("Packets received %d, Transfer Successful\n", packets);
+	net_set_state(wget_loop_state);
+	efi_set_bootdev("Net", "", image_url,
+			map_sysmem(image_load_addr, 0),
+			net_boot_file_size);
+	env_set_hex("filesize", net_boot_file_size);
 }
 
 /**
@@ -305,11 +685,19 @@ static void wget_handler(uchar *pkt, u16 dport,
 			 u8 action, unsigned int len)
 {
 	enum tcp_state wget_tcp_state = tcp_get_tcp_state();
+	struct wget_conn *conn;
+	ulong end;
 
-	net_set_timeout_handler(wget_timeout, wget_timeout_handler);
-	packets++;
+	for (conn = wget_conns; conn < wget_conns + wget_nconns; conn++) {
+		if (conn->port == ntohs(dport))
+			break;
+	}
+	if (conn == wget_conns + wget_nconns || conn->complete)
+		return;
+
+	conn->packets++;
 
-	switch (current_wget_state) {
+	switch (conn->state) {
 	case WGET_CLOSED:
 		debug_cond(DEBUG_WGET, "wget: Handler: Error!, State wrong\n");
 		break;
@@ -321,11 +709,11 @@ static void wget_handler(uchar *pkt, u16 dport,
 			if (wget_tcp_state == TCP_ESTABLISHED) {
 				debug_cond(DEBUG_WGET,
 					   "wget: Cting, send, len=%x\n", len);
-				wget_send(action, tcp_seq_num, tcp_ack_num,
-					  len);
+				wget_send(conn, action, tcp_seq_num,
+					  tcp_ack_num, len);
 			} else {
 				printf("%.*s", len,  pkt);
-				wget_fail("wget: Handler Connected Fail\n",
+				wget_fail(conn, "wget: Handler Connected Fail\n",
 					  tcp_seq_num, tcp_ack_num, action);
 			}
 		}
@@ -334,10 +722,11 @@ static void wget_handler(uchar *pkt, u16 dport,
 		debug_cond(DEBUG_WGET, "wget: Connected seq=%u, len=%x\n",
 			   tcp_seq_num, len);
 		if (!len) {
-			wget_fail("Image not found, no data returned\n",
+			wget_fail(conn, "Image not found, no data returned\n",
 				  tcp_seq_num, tcp_ack_num, action);
 		} else {
-			wget_connected(pkt, tcp_seq_num, action, tcp_ack_num, len);
+			wget_connected(conn, pkt, tcp_seq_num, action,
+				       tcp_ack_num, len);
 		}
 		break;
 	case WGET_TRANSFERRING:
@@ -345,22 +734,37 @@ static void wget_handler(uchar *pkt, u16 dport,
 			   "wget: Transferring, seq=%x, ack=%x,len=%x\n",
 			   tcp_seq_num, tcp_ack_num, len);
 
-		if (next_data_seq_num != tcp_seq_num) {
-			debug_cond(DEBUG_WGET, "wget: seq=%x packet was lost\n", next_data_seq_num);
-			return;
-		}
-		next_data_seq_num = tcp_seq_num + len;
-
-		if (store_block(pkt, tcp_seq_num - initial_data_seq_num, len) != 0) {
-			wget_fail("wget: store error\n",
+		/*
+		 * Data received past a hole is stored as well, TCP reports it
+		 * to the server which only has to resend the hole
+		 */
+		if (conn->next_data_seq_num != tcp_seq_num)
+			debug_cond(DEBUG_WGET, "wget: seq=%x packet was lost\n",
+				   conn->next_data_seq_num);
+		conn->next_data_seq_num = tcp_get_ack_edge();
+
+		if (wget_store(conn, pkt, tcp_seq_num, len) != 0) {
+			wget_fail(conn, "wget: store error\n",
 				  tcp_seq_num, tcp_ack_num, action);
 			net_set_state(NETLOOP_FAIL);
 			return;
 		}
+		conn->done = conn->offset - conn->start +
+			conn->next_data_seq_num - conn->initial_data_seq_num;
+		end = wget_range_end(conn);
+
+		if (conn->cut && conn->start + conn->done >= end) {
+			/* The rest of the file is fetched by other connections */
+			net_send_tcp_packet(0, ntohs(sport), conn->port, TCP_RST,
+					    tcp_ack_num, tcp_seq_num + len);
+			conn->done = end - conn->start;
+			wget_complete(conn);
+			break;
+		}
 
 		switch (wget_tcp_state) {
 		case TCP_FIN_WAIT_2:
-			wget_send(TCP_ACK, tcp_seq_num, tcp_ack_num, len);
+			wget_send(conn, TCP_ACK, tcp_seq_num, tcp_ack_num, len);
 			fallthrough;
 		case TCP_SYN_SENT:
 		case TCP_SYN_RECEIVED:
@@ -370,44 +774,29 @@ static void wget_handler(uchar *pkt, u16 dport,
 			net_set_state(NETLOOP_FAIL);
 			break;
 		case TCP_ESTABLISHED:
-			wget_send(TCP_ACK, tcp_seq_num, tcp_ack_num,
+			wget_send(conn, TCP_ACK, tcp_seq_num, tcp_ack_num,
 				  len);
 			wget_loop_state = NETLOOP_SUCCESS;
 			break;
 		case TCP_CLOSE_WAIT:     /* End of transfer */
-			current_wget_state = WGET_TRANSFERRED;
-			wget_send(action | TCP_ACK | TCP_FIN,
+			wget_send(conn, action | TCP_ACK | TCP_FIN,
 				  tcp_seq_num, tcp_ack_num, len);
+			if (end && conn->start + conn->done < end &&
+			    wget_can_resume(conn)) {
+				/* The server closed the connection early */
+				wget_resume(conn);
+				break;
+			}
+			conn->state = WGET_TRANSFERRED;
 			break;
 		}
 		break;
 	case WGET_TRANSFERRED:
-		printf("Packets received %d, Transfer Successful\n", packets);
-		net_set_state(wget_loop_state);
-		efi_set_bootdev("Net", "", image_url,
-				map_sysmem(image_load_addr, 0),
-				net_boot_file_size);
-		env_set_hex("filesize", net_boot_file_size);
+		wget_complete(conn);
 		break;
 	}
 }
 
-#define RANDOM_PORT_START 1024
-#define RANDOM_PORT_RANGE 0x4000
-
-/**
- * random_port() - make port a little random (1024-17407)
- *
- * Return: random port number from 1024 to 17407
- *
- * This keeps the math somewhat trivial to compute, and seems to work with
- * all supported protocols/clients/servers
- */
-static unsigned int random_port(void)
-{
-	return RANDOM_PORT_START + (get_timer(0) % RANDOM_PORT_RANGE);
-}
-
 #define BLOCKSIZE 512
 
 void wget_start(void)
@@ -451,11 +840,23 @@ void wget_start(void)
 
 	net_set_timeout_handler(wget_timeout, wget_timeout_handler);
 	tcp_set_tcp_handler(wget_handler);
+	wget_max_conns = env_get_ulong("wgetconns", 10, 1);
+	wget_max_conns = clamp(wget_max_conns, 1, CONFIG_PROT_TCP_CONNS);
+	if (net_sink_active()) {
+		/* Data must arrive in order, within reach of the sink buffer */
+		tcp_set_rx_window(net_sink_size());
+		wget_max_conns = 1;
+	} else {
+		/* Let the server send as much as there is memory for */
+		tcp_set_rx_window(CONFIG_IS_ENABLED(LMB) ?
+				  lmb_get_free_size(image_load_addr) : 0);
+	}
+	wget_nconns = 1;
+	wget_file_size = 0;
+	wget_ranges = false;
+	wget_resumes = 0;
 
-	wget_timeout_count = 0;
-	current_wget_state = WGET_CLOSED;
-
-	our_port = random_port();
+	wget_port = random_port();
 
 	/*
 	 * Zero out server ether to force arp resolution in case
@@ -465,7 +866,7 @@ void wget_start(void)
 
 	memset(net_server_ethaddr, 0, 6);
 
-	wget_send(TCP_SYN, 0, 0, 0);
+	wget_connect(&wget_conns[0], 0, 0);
 }
 
 #if (IS_ENABLED(CONFIG_CMD_DNS))
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0+
+
+"""Generate the slice-by-8 lookup tables for lib/crc32.c and lib/crc32c.c
+
+Run this from anywhere; it rewrites lib/crc32table.h and lib/crc32ctable.h
+in the source tree.
+"""
+
+import os
+
+our_path = os.path.dirname(os.path.realpath(__file__))
+src_path = os.path.dirname(our_path)
+
+# Output file, table name, reflected polynomial, attribute, function
+TABLES = [
+    ('crc32table.h', 'crc32_le_table', 0xedb88320, '__efi_runtime_rodata ',
+     'make_crc_table()'),
+    ('crc32ctable.h', 'crc32c_le_table', 0x82f63b78, '', 'crc32c_init()'),
+]
+
+def make_rows(poly):
+    """Work out the eight rows of the table for a polynomial
+
+    Args:
+        poly (int): Bit-reflected polynomial
+
+    Returns:
+        list of list of int: Row k gives the CRC of each byte value followed
+            by k zero bytes
+    """
+    rows = [[0] * 256 for _ in range(8)]
+    for n in range(256):
+        crc = n
+        for _ in range(8):
+            crc = (crc >> 1) ^ poly if crc & 1 else crc >> 1
+        rows[0][n] = crc
+    for k in range(1, 8):
+        for n in range(256):
+            crc = rows[k - 1][n]
+            rows[k][n] = (crc >> 8) ^ rows[0][crc & 0xff]
+    return rows
+
+def make_header(name, poly, attr, func):
+    """Produce the contents of a header file holding one table
+
+    Args:
+        name (str): Name of the C array
+        poly (int): Bit-reflected polynomial
+        attr (str): Attribute to put before the name, with a trailing space,
+            or ''
+        func (str): Function which makes the first row at runtime
+
+    Returns:
+        str: Contents of the header file
+    """
+    out = ['/* SPDX-License-Identifier: GPL-2.0+ */',
+           '/*',
+           f' * Lookup tables for the reflected polynomial 0x{poly:08x}, as made by',
+           f' * {func}. Row k gives the CRC of each byte value followed by k',
+           ' * zero bytes, so that slice-by-8 can handle eight bytes per step. Only the',
+           ' * first row is needed to go a byte at a time.',
+           ' *',
+           ' * Generated by scripts/gen_crc32table.py - do not edit',
+           ' */',
+           '',
+           f'static const uint32_t {attr}{name}[CRC32_TABLE_ROWS][256] = {{']
+    for k, row in enumerate(make_rows(poly)):
+        if k == 1:
+            out.append('#if CRC32_TABLE_ROWS == 8')
+        out.append('\t{')
+        for i in range(0, 256, 4):
+            out.append('\t\t' + ', '.join(f'0x{val:08x}'
+                                          for val in row[i:i + 4]) + ',')
+        out.append('\t},')
+    out += ['#endif', '};']
+    return '\n'.join(out) + '\n'
+
+def main():
+    """Write out each header file"""
+    for fname, name, poly, attr, func in TABLES:
+        with open(os.path.join(src_path, 'lib', fname), 'w',
+                  encoding='utf-8') as outf:
+            outf.write(make_header(name, poly, attr, func))
+
+if __name__ == '__main__':
+    main()
@@ -65,6 +65,7 @@ static int bootdev_test_cmd_select(struct unit_test_state *uts)
 	ut_assert_nextline("Status:    Probed");
 	ut_assert_nextline("Uclass:    mmc");
 	ut_assert_nextline("Bootflows: 0 (0 valid)");
+	ut_assert_nextline("Scan time: 0 ms");
 	ut_assert_console_end();
 
 	/* select by bootdev name */
@@ -6,9 +6,15 @@
  * Written by Simon Glass <sjg@chromium.org>
  */
 
+#include <hash.h>
 #include <image.h>
+#include <image-stream.h>
+#include <malloc.h>
 #include <test/suites.h>
 #include <test/ut.h>
+#include <linux/libfdt.h>
+#include <linux/sizes.h>
+#include <u-boot/sha256.h>
 #include "bootstd_common.h"
 
 /* Test of image phase */
@@ -33,3 +39,208 @@ static int test_image_phase(struct unit_test_state *uts)
 	return 0;
 }
 BOOTSTD_TEST(test_image_phase, 0);
+
+#if CONFIG_IS_ENABLED(FIT_HASH_CHUNKS)
+#define CHUNK_TEST_SIZE		(SZ_16K + 100)
+#define CHUNK_TEST_CHUNK	SZ_4K
+
+/* Create a FIT with one image, hashed a chunk at a time */
+static int setup_chunk_fit(struct unit_test_state *uts, void *fit, int size,
+			   const u8 *data, int data_size, ulong chunk_size,
+			   int *image_nodep, int *hash_nodep)
+{
+	const int count = fit_hash_chunk_count(data_size, chunk_size);
+	u8 values[count * SHA256_SUM_LEN];
+	u8 value[SHA256_SUM_LEN];
+	int images, node, hash;
+	int len;
+
+	ut_assertok(fit_hash_chunks(data, data_size, "sha256", chunk_size,
+				    values, &len));
+	ut_asserteq(SHA256_SUM_LEN, len);
+	len = sizeof(value);
+	ut_assertok(hash_block("sha256", values, sizeof(values), value, &len));
+
+	ut_assertok(fdt_create_empty_tree(fit, size));
+	images = fdt_add_subnode(fit, 0, FIT_IMAGES_PATH + 1);
+	ut_assert(images >= 0);
+	node = fdt_add_subnode(fit, images, "kernel-1");
+	ut_assert(node >= 0);
+	ut_assertok(fdt_setprop(fit, node, FIT_DATA_PROP, data, data_size));
+	hash = fdt_add_subnode(fit, node, "hash-1");
+	ut_assert(hash >= 0);
+	ut_assertok(fdt_setprop_string(fit, hash, FIT_ALGO_PROP, "sha256"));
+	ut_assertok(fdt_setprop_u32(fit, hash, FIT_CHUNK_SIZE_PROP,
+				    chunk_size));
+	ut_assertok(fdt_setprop(fit, hash, FIT_CHUNK_VALUE_PROP, values,
+				sizeof(values)));
+	ut_assertok(fdt_setprop(fit, hash, FIT_VALUE_PROP, value,
+				sizeof(value)));
+
+	/* Offsets move as properties are added, so look them up again */
+	*image_nodep = fdt_path_offset(fit, FIT_IMAGES_PATH "/kernel-1");
+	*hash_nodep = fdt_subnode_offset(fit, *image_nodep, "hash-1");
+	ut_assert(*hash_nodep >= 0);
+
+	return 0;
+}
+
+/* Test verifying a hash node which hashes each chunk of its image */
+static int test_image_hash_chunks(struct unit_test_state *uts)
+{
+	const int fit_size = CHUNK_TEST_SIZE + SZ_4K;
+	int image_node, hash_node;
+	u8 *data, *fit, *values;
+	ulong chunk_size;
+	int i;
+
+	data = malloc(CHUNK_TEST_SIZE);
+	fit = malloc(fit_size);
+	ut_assertnonnull(data);
+	ut_assertnonnull(fit);
+	for (i = 0; i < CHUNK_TEST_SIZE; i++)
+		data[i] = i * 3 + (i >> 8);
+
+	ut_assertok(setup_chunk_fit(uts, fit, fit_size, data, CHUNK_TEST_SIZE,
+				    CHUNK_TEST_CHUNK, &image_node, &hash_node));
+	ut_assertok(fit_image_hash_get_chunk_size(fit, hash_node,
+						  &chunk_size));
+	ut_asserteq(CHUNK_TEST_CHUNK, chunk_size);
+	ut_asserteq(1, fit_image_verify(fit, image_node));
+
+	/* A change in the last, short chunk is found */
+	fit_image_get_data(fit, image_node, (const void **)&values,
+			   &chunk_size);
+	values[CHUNK_TEST_SIZE - 1] ^= 1;
+	ut_asserteq(0, fit_image_verify(fit, image_node));
+	values[CHUNK_TEST_SIZE - 1] ^= 1;
+	ut_asserteq(1, fit_image_verify(fit, image_node));
+
+	/* So is a change in the chunk hashes, which no longer match the root */
+	values = (u8 *)fdt_getprop(fit, hash_node, FIT_CHUNK_VALUE_PROP, NULL);
+	values[0] ^= 1;
+	ut_asserteq(0, fit_image_verify(fit, image_node));
+	values[0] ^= 1;
+
+	/* A chunk size of 0 is not valid */
+	ut_assertok(fdt_setprop_inplace_u32(fit, hash_node,
+					    FIT_CHUNK_SIZE_PROP, 0));
+	ut_asserteq(-EINVAL, fit_image_hash_get_chunk_size(fit, hash_node,
+							   &chunk_size));
+	ut_asserteq(0, fit_image_verify(fit, image_node));
+
+	free(fit);
+	free(data);
+
+	return 0;
+}
+BOOTSTD_TEST(test_image_hash_chunks, 0);
+
+/* Test a chunk size larger than the image, which has just one chunk */
+static int test_image_hash_chunk_big(struct unit_test_state *uts)
+{
+	const int data_size = 100;
+	const int fit_size = SZ_4K;
+	u8 value[SHA256_SUM_LEN];
+	int image_node, hash_node;
+	u8 *data, *fit, *image;
+	const u8 *values;
+	int len, i;
+
+	ut_asserteq(0, fit_hash_chunk_count(0, SZ_4K));
+	ut_asserteq(1, fit_hash_chunk_count(data_size, SZ_4K));
+	ut_asserteq(1, fit_hash_chunk_count(SZ_4K, SZ_4K));
+	ut_asserteq(2, fit_hash_chunk_count(SZ_4K + 1, SZ_4K));
+
+	/* Sizes near the top of the range must not wrap */
+	ut_asserteq(3, fit_hash_chunk_count(ULONG_MAX, ULONG_MAX / 2));
+	ut_asserteq(1, fit_hash_chunk_count(ULONG_MAX - 1, ULONG_MAX));
+
+	data = malloc(data_size);
+	fit = malloc(fit_size);
+	ut_assertnonnull(data);
+	ut_assertnonnull(fit);
+	for (i = 0; i < data_size; i++)
+		data[i] = i * 7;
+
+	ut_assertok(setup_chunk_fit(uts, fit, fit_size, data, data_size,
+				    SZ_4K, &image_node, &hash_node));
+	ut_asserteq(1, fit_image_verify(fit, image_node));
+
+	/* The only chunk hash is the hash of the whole image */
+	values = fdt_getprop(fit, hash_node, FIT_CHUNK_VALUE_PROP, &len);
+	ut_assertnonnull(values);
+	ut_asserteq(SHA256_SUM_LEN, len);
+	len = sizeof(value);
+	ut_assertok(hash_block("sha256", data, data_size, value, &len));
+	ut_asserteq_mem(value, values, SHA256_SUM_LEN);
+
+	/* A change anywhere is found */
+	image = (u8 *)fdt_getprop(fit, image_node, FIT_DATA_PROP, NULL);
+	image[data_size - 1] ^= 1;
+	ut_asserteq(0, fit_image_verify(fit, image_node));
+	image[data_size - 1] ^= 1;
+	ut_asserteq(1, fit_image_verify(fit, image_node));
+
+	/* Empty chunk hashes, with a root hash to match, only suit no data */
+	len = sizeof(value);
+	ut_assertok(hash_block("sha256", data, 0, value, &len));
+	ut_assertok(fdt_setprop_inplace(fit, hash_node, FIT_VALUE_PROP, value,
+					len));
+	ut_assertok(fdt_setprop(fit, hash_node, FIT_CHUNK_VALUE_PROP, NULL, 0));
+	ut_asserteq(0, fit_image_verify(fit, image_node));
+
+	free(fit);
+	free(data);
+
+	return 0;
+}
+BOOTSTD_TEST(test_image_hash_chunk_big, 0);
+
+#if CONFIG_IS_ENABLED(IMAGE_STREAM)
+/* Test checking each chunk of an image as it is copied */
+static int test_image_stream_chunks(struct unit_test_state *uts)
+{
+	const int fit_size = CHUNK_TEST_SIZE + SZ_4K;
+	struct image_stream st;
+	int image_node, hash_node;
+	u8 *data, *fit, *out;
+	int i;
+
+	data = malloc(CHUNK_TEST_SIZE);
+	fit = malloc(fit_size);
+	out = malloc(CHUNK_TEST_SIZE);
+	ut_assertnonnull(data);
+	ut_assertnonnull(fit);
+	ut_assertnonnull(out);
+	for (i = 0; i < CHUNK_TEST_SIZE; i++)
+		data[i] = i * 5 + (i >> 7);
+	ut_assertok(setup_chunk_fit(uts, fit, fit_size, data, CHUNK_TEST_SIZE,
+				    CHUNK_TEST_CHUNK, &image_node, &hash_node));
+
+	/* Use steps which do not line up with the hashed chunks */
+	memset(&st, '\0', sizeof(st));
+	st.comp = IH_COMP_NONE;
+	st.src = data;
+	st.size = CHUNK_TEST_SIZE;
+	st.chunk = 1000;
+	st.dst = out;
+	st.dst_size = CHUNK_TEST_SIZE;
+	ut_assertok(fit_image_stream_verify(fit, image_node, hash_node, &st));
+	ut_asserteq(CHUNK_TEST_SIZE, st.len);
+	ut_asserteq_mem(data, out, CHUNK_TEST_SIZE);
+
+	/* A bad byte in the middle stops the copy at the end of its chunk */
+	data[CHUNK_TEST_CHUNK + 10] ^= 1;
+	ut_asserteq(-EACCES, fit_image_stream_verify(fit, image_node,
+						     hash_node, &st));
+
+	free(out);
+	free(fit);
+	free(data);
+
+	return 0;
+}
+BOOTSTD_TEST(test_image_stream_chunks, 0);
+#endif
+#endif
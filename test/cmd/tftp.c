@@ -0,0 +1,314 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for receiving files by TFTP multicast (RFC 2090)
+ *
+ * A fake server answers on the sandbox Ethernet device. It offers a group
+ * in the OACK, makes the board the master client and sends each block to
+ * the group when the previous one is acknowledged.
+ */
+
+#include <command.h>
+#include <dm.h>
+#include <env.h>
+#include <mapmem.h>
+#include <net.h>
+#include <asm/eth.h>
+#include <asm/unaligned.h>
+#include <test/cmd.h>
+#include <test/ut.h>
+
+#define TFTP_PORT	69
+/* Port the fake server sends from, as its transfer ID */
+#define TFTP_TID	21313
+
+#define TFTP_RRQ	1
+#define TFTP_DATA	3
+#define TFTP_ACK	4
+#define TFTP_ERROR	5
+#define TFTP_OACK	6
+
+#define TFTP_BLOCK_SIZE	512
+
+#define TEST_GROUP	"239.1.2.3"
+#define TEST_GROUP_PORT	1758
+/* Value of the multicast option: group, port and 1 for the master client */
+#define TEST_MCAST	TEST_GROUP ",1758,1"
+/* Not a class D address, so the board cannot join it */
+#define TEST_MCAST_BAD	"10.1.2.3,1758,1"
+
+/* Not a multiple of the block size, so the last block is short */
+#define TEST_SIZE	3000
+#define TEST_ADDR	0x20000
+
+/**
+ * struct tftp_test_server - State of the fake TFTP server
+ *
+ * @mcast: Value of the multicast option sent in the OACK, NULL to ignore
+ *	the option and send the file by unicast
+ * @unicast: true to send the file by unicast when asked, false to answer
+ *	with a 'File not found' error
+ * @group: true if blocks are being sent to the multicast group
+ * @rrqs: Number of read requests received
+ * @mcast_rrqs: Number of read requests asking for the multicast option
+ * @group_blocks: Number of blocks sent to the multicast group
+ * @data: Contents of the file
+ */
+struct tftp_test_server {
+	const char *mcast;
+	bool unicast;
+	bool group;
+	int rrqs;
+	int mcast_rrqs;
+	int group_blocks;
+	u8 data[TEST_SIZE];
+};
+
+/* Add a UDP packet from the server to the packets the board will receive */
+static int tftp_test_reply(struct udevice *dev, struct ethernet_hdr *req,
+			   struct in_addr dst, ushort dport, const void *data,
+			   int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ip_udp_hdr *ip = (void *)req + ETHER_HDR_SIZE;
+	struct ethernet_hdr *eth;
+	struct ip_udp_hdr *ipr;
+	u32 group = ntohl(dst.s_addr);
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return 0;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	if (dst.s_addr == ip->ip_src.s_addr) {
+		memcpy(eth->et_dest, req->et_src, ARP_HLEN);
+	} else {
+		/* Map the group to its Ethernet address, as in RFC 1112 */
+		eth->et_dest[0] = 0x01;
+		eth->et_dest[1] = 0x00;
+		eth->et_dest[2] = 0x5e;
+		eth->et_dest[3] = (group >> 16) & 0x7f;
+		eth->et_dest[4] = group >> 8;
+		eth->et_dest[5] = group;
+	}
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	ipr = (void *)eth + ETHER_HDR_SIZE;
+	ipr->ip_hl_v = 0x45;
+	ipr->ip_tos = 0;
+	ipr->ip_len = htons(IP_UDP_HDR_SIZE + len);
+	ipr->ip_id = 0;
+	ipr->ip_off = htons(IP_FLAGS_DFRAG);
+	ipr->ip_ttl = 255;
+	ipr->ip_p = IPPROTO_UDP;
+	ipr->ip_sum = 0;
+	net_copy_ip(&ipr->ip_src, &ip->ip_dst);
+	net_copy_ip(&ipr->ip_dst, &dst);
+	ipr->ip_sum = compute_ip_checksum(ipr, IP_HDR_SIZE);
+	ipr->udp_src = htons(TFTP_TID);
+	ipr->udp_dst = htons(dport);
+	ipr->udp_len = htons(UDP_HDR_SIZE + len);
+	ipr->udp_xsum = 0;
+	memcpy((void *)ipr + IP_UDP_HDR_SIZE, data, len);
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + len;
+	priv->recv_packets++;
+
+	return 0;
+}
+
+/* Send block @block of the file, to the group or to the board */
+static int tftp_test_data(struct udevice *dev, struct ethernet_hdr *req,
+			  struct tftp_test_server *srv, uint block)
+{
+	struct ip_udp_hdr *ip = (void *)req + ETHER_HDR_SIZE;
+	u8 pkt[4 + TFTP_BLOCK_SIZE];
+	uint offset = (block - 1) * TFTP_BLOCK_SIZE;
+	int len = min(TEST_SIZE - offset, (uint)TFTP_BLOCK_SIZE);
+
+	put_unaligned_be16(TFTP_DATA, pkt);
+	put_unaligned_be16(block, pkt + 2);
+	memcpy(pkt + 4, srv->data + offset, len);
+	if (!srv->group)
+		return tftp_test_reply(dev, req, ip->ip_src,
+				       ntohs(ip->udp_src), pkt, 4 + len);
+	srv->group_blocks++;
+
+	return tftp_test_reply(dev, req, string_to_ip(TEST_GROUP),
+			       TEST_GROUP_PORT, pkt, 4 + len);
+}
+
+/* Answer a read request */
+static int tftp_test_rrq(struct udevice *dev, struct ethernet_hdr *req,
+			 struct tftp_test_server *srv, const char *opt,
+			 const char *end)
+{
+	struct ip_udp_hdr *ip = (void *)req + ETHER_HDR_SIZE;
+	bool mcast = false;
+	u8 pkt[64];
+	int len;
+
+	srv->rrqs++;
+	/* Skip the file name and mode, then look through the options */
+	opt += strnlen(opt, end - opt) + 1;
+	for (opt += strnlen(opt, end - opt) + 1; opt < end;
+	     opt += strnlen(opt, end - opt) + 1) {
+		if (!strcmp(opt, "multicast"))
+			mcast = true;
+	}
+	srv->mcast_rrqs += mcast;
+	srv->group = false;
+
+	if (mcast && srv->mcast) {
+		put_unaligned_be16(TFTP_OACK, pkt);
+		len = 2 + sprintf((char *)pkt + 2, "multicast%c%s", 0,
+				  srv->mcast) + 1;
+		srv->group = true;
+	} else if (srv->unicast) {
+		return tftp_test_data(dev, req, srv, 1);
+	} else {
+		put_unaligned_be16(TFTP_ERROR, pkt);
+		put_unaligned_be16(1, pkt + 2);
+		len = 4 + sprintf((char *)pkt + 4, "File not found") + 1;
+	}
+
+	return tftp_test_reply(dev, req, ip->ip_src, ntohs(ip->udp_src), pkt,
+			       len);
+}
+
+static int tftp_test_handler(struct udevice *dev, void *packet,
+			     unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct tftp_test_server *srv = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	u8 *tftp = packet + ETHER_HDR_SIZE + IP_UDP_HDR_SIZE;
+	uint block;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP)
+		return 0;
+
+	switch (get_unaligned_be16(tftp)) {
+	case TFTP_RRQ:
+		if (ntohs(ip->udp_dst) == TFTP_PORT)
+			return tftp_test_rrq(dev, eth, srv, (char *)tftp + 2,
+					     (char *)packet + len);
+		break;
+	case TFTP_ACK:
+		block = get_unaligned_be16(tftp + 2);
+		if (ntohs(ip->udp_dst) == TFTP_TID &&
+		    block * TFTP_BLOCK_SIZE <= TEST_SIZE)
+			return tftp_test_data(dev, eth, srv, block + 1);
+		break;
+	}
+
+	return 0;
+}
+
+/* Load the file with the fake server, returning the command's result */
+static int tftp_test_load(struct unit_test_state *uts,
+			  struct tftp_test_server *srv)
+{
+	struct eth_sandbox_priv *priv;
+	struct udevice *dev;
+	int i, ret;
+
+	ut_assertok(uclass_get_device(UCLASS_ETH, 0, &dev));
+	priv = dev_get_priv(dev);
+	for (i = 0; i < TEST_SIZE; i++)
+		srv->data[i] = i * 7 + (i >> 8);
+	memset(map_sysmem(TEST_ADDR, TEST_SIZE), '\0', TEST_SIZE);
+
+	sandbox_eth_set_tx_handler(0, tftp_test_handler);
+	sandbox_eth_set_priv(0, srv);
+	ret = run_commandf("tftpboot %x 1.1.2.4:file", TEST_ADDR);
+	sandbox_eth_set_tx_handler(0, NULL);
+	sandbox_eth_set_priv(0, NULL);
+
+	/* The group is always left at the end */
+	ut_asserteq(0, priv->mcast_groups);
+	if (!ret) {
+		ut_asserteq(TEST_SIZE, env_get_hex("filesize", 0));
+		ut_asserteq_mem(srv->data, map_sysmem(TEST_ADDR, TEST_SIZE),
+				TEST_SIZE);
+	}
+
+	return ret;
+}
+
+static int tftp_test_setup(void)
+{
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set("tftpmcast", NULL);
+
+	return 0;
+}
+
+/* A file is sent to the group when the server accepts the option */
+static int net_test_tftp_mcast(struct unit_test_state *uts)
+{
+	struct tftp_test_server srv = {
+		.mcast		= TEST_MCAST,
+		.unicast	= true,
+	};
+
+	tftp_test_setup();
+	ut_assertok(tftp_test_load(uts, &srv));
+	ut_asserteq(1, srv.rrqs);
+	ut_asserteq(1, srv.mcast_rrqs);
+	ut_asserteq(DIV_ROUND_UP(TEST_SIZE, TFTP_BLOCK_SIZE),
+		    srv.group_blocks);
+
+	/* With tftpmcast set to no, the option is not asked for */
+	env_set("tftpmcast", "no");
+	srv.rrqs = 0;
+	srv.mcast_rrqs = 0;
+	srv.group_blocks = 0;
+	ut_assertok(tftp_test_load(uts, &srv));
+	ut_asserteq(1, srv.rrqs);
+	ut_asserteq(0, srv.mcast_rrqs);
+	ut_asserteq(0, srv.group_blocks);
+	env_set("tftpmcast", NULL);
+
+	return 0;
+}
+CMD_TEST(net_test_tftp_mcast, 0);
+
+/* A group which cannot be joined makes the board use unicast */
+static int net_test_tftp_mcast_fallback(struct unit_test_state *uts)
+{
+	struct tftp_test_server srv = {
+		.mcast		= TEST_MCAST_BAD,
+		.unicast	= true,
+	};
+
+	tftp_test_setup();
+	ut_assertok(tftp_test_load(uts, &srv));
+	ut_asserteq(2, srv.rrqs);
+	ut_asserteq(1, srv.mcast_rrqs);
+	ut_asserteq(0, srv.group_blocks);
+
+	/* If the unicast transfer fails too, the next one tries multicast */
+	srv.unicast = false;
+	srv.rrqs = 0;
+	srv.mcast_rrqs = 0;
+	ut_asserteq(1, tftp_test_load(uts, &srv));
+	ut_asserteq(2, srv.rrqs);
+	ut_asserteq(1, srv.mcast_rrqs);
+
+	srv.mcast = TEST_MCAST;
+	srv.rrqs = 0;
+	srv.mcast_rrqs = 0;
+	ut_assertok(tftp_test_load(uts, &srv));
+	ut_asserteq(1, srv.rrqs);
+	ut_asserteq(1, srv.mcast_rrqs);
+	ut_asserteq(DIV_ROUND_UP(TEST_SIZE, TFTP_BLOCK_SIZE),
+		    srv.group_blocks);
+
+	return 0;
+}
+CMD_TEST(net_test_tftp_mcast_fallback, 0);
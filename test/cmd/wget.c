@@ -6,16 +6,21 @@
  * Ying-Chun Liu (PaulLiu) <paul.liu@linaro.org>
  */
 
+#include <blk.h>
 #include <command.h>
 #include <dm.h>
 #include <env.h>
 #include <fdtdec.h>
 #include <log.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
 #include <net/tcp.h>
 #include <net/wget.h>
+#include <os.h>
+#include <sandbox_host.h>
 #include <asm/eth.h>
+#include <asm/unaligned.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
@@ -25,6 +30,7 @@
 
 #define SHIFT_TO_TCPHDRLEN_FIELD(x) ((x) << 4)
 #define LEN_B_TO_DW(x) ((x) >> 2)
+#define GET_TCP_HDR_LEN_IN_BYTES(x) ((x) >> 2)
 
 int net_set_ack_options(union tcp_build_pkt *b);
 
@@ -234,3 +240,772 @@ static int net_test_wget(struct unit_test_state *uts)
 	return 0;
 }
 CMD_TEST(net_test_wget, UTF_CONSOLE);
+
+/* Download the test file, returning the change in the receive statistics */
+static int wget_rx_stats(struct unit_test_state *uts, struct udevice *dev,
+			 struct eth_rx_stats *delta)
+{
+	struct eth_rx_stats before, after;
+
+	ut_assertok(eth_get_rx_stats(dev, &before));
+	ut_assertok(run_command("wget ${loadaddr} 1.1.2.2:/index.html", 0));
+	ut_assert_nextline("HTTP/1.1 200 OK");
+	ut_assert_nextline("Packets received 5, Transfer Successful");
+	ut_assert_nextline("Bytes transferred = 32 (20 hex)");
+	ut_assertok(eth_get_rx_stats(dev, &after));
+
+	delta->bytes = after.bytes - before.bytes;
+	delta->stored_bytes = after.stored_bytes - before.stored_bytes;
+	delta->copied = after.copied - before.copied;
+
+	return 0;
+}
+
+static int net_test_wget_rx_copy(struct unit_test_state *uts)
+{
+	char *prev_ethact = env_get("ethact");
+	char *prev_ethrotate = env_get("ethrotate");
+	char *prev_loadaddr = env_get("loadaddr");
+	struct eth_rx_stats direct, copy;
+	struct udevice *dev;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000",
+					      &dev));
+	sandbox_eth_set_tx_handler(0, sb_http_handler);
+	sandbox_eth_set_priv(0, uts);
+
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set("loadaddr", "0x20000");
+
+	/* The payload is copied once, straight out of the receive buffer */
+	ut_assertok(wget_rx_stats(uts, dev, &direct));
+	ut_asserteq(32, direct.stored_bytes);
+	ut_asserteq(direct.stored_bytes, direct.copied);
+
+	/* A driver which copies each frame adds the whole frame again */
+	sandbox_eth_set_rx_copy(0, true);
+	ut_assertok(wget_rx_stats(uts, dev, &copy));
+	sandbox_eth_set_rx_copy(0, false);
+	ut_asserteq(direct.bytes, copy.bytes);
+	ut_asserteq(direct.stored_bytes, copy.stored_bytes);
+	ut_asserteq(copy.stored_bytes + copy.bytes, copy.copied);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	ut_assert_console_end();
+
+	env_set("ethact", prev_ethact);
+	env_set("ethrotate", prev_ethrotate);
+	env_set("loadaddr", prev_loadaddr);
+
+	return 0;
+}
+CMD_TEST(net_test_wget_rx_copy, UTF_CONSOLE);
+
+/* Number of connections the fake HTTP server keeps track of */
+#define SB_HTTP_CONNS		8
+/* Segments of data queued at most, leaving room for replies to SYN and FIN */
+#define SB_HTTP_QUEUE		(PKTBUFSRX - 2)
+
+/**
+ * struct sb_http_conn - connection to the fake HTTP server
+ *
+ * The server starts its sequence numbers at 0, so byte @n of the response
+ * has sequence number @n + 1.
+ *
+ * @port: TCP port of the client, 0 if the entry is unused
+ * @sport: TCP port of the server
+ * @hwaddr: MAC address of the client
+ * @client_ip: IP address of the client
+ * @server_ip: IP address of the server
+ * @rcv_nxt: next sequence number expected from the client
+ * @hdr: response header
+ * @hdr_len: length of @hdr
+ * @start: offset in the file of the first byte of the response body
+ * @len: length of the response, header included, 0 until the request
+ *	arrived
+ * @sent: number of bytes of the response sent
+ * @acked: last sequence number acknowledged by the client
+ * @lost: offset in the response of a segment which was not sent, plus 1,
+ *	0 if none
+ * @fin: the response is complete and FIN was sent
+ * @closed: the connection was closed or reset by the client
+ */
+struct sb_http_conn {
+	u16 port;
+	u16 sport;
+	uchar hwaddr[ARP_HLEN];
+	struct in_addr client_ip;
+	struct in_addr server_ip;
+	u32 rcv_nxt;
+	char hdr[160];
+	int hdr_len;
+	ulong start;
+	ulong len;
+	ulong sent;
+	u32 acked;
+	ulong lost;
+	bool fin;
+	bool closed;
+};
+
+/**
+ * struct sb_http_server - fake HTTP server sending a single file
+ *
+ * Each time the client sends a packet, the server fills up the receive
+ * queue of the sandbox driver with segments of the responses which are
+ * not sent yet, taking turns between the connections. Room is kept for
+ * the replies to SYN and FIN, which are never dropped.
+ *
+ * @size: size of the file
+ * @ranges: the server accepts range requests
+ * @close_at: the first response is cut short by closing the connection
+ *	after this many bytes of the body, 0 to send it all
+ * @reorder: send the second segment of each response before the first,
+ *	so that the client gets data before the HTTP header
+ * @lose_at: the segment at this offset in the first response is lost and
+ *	only sent again once the client reports the data after it with SACK,
+ *	0 to lose nothing
+ * @wscale: answer the window scale option of the client, with a shift of 0
+ * @requests: number of requests received
+ * @partial: number of 206 responses sent
+ * @last_range: first byte asked for by the last range request
+ * @client_wscale: window scale shift sent by the client, -1 if none
+ * @sack_ok: the client allows SACK
+ * @sack_l: start of the first SACK block received, as an offset in the
+ *	response
+ * @sack_r: end of the first SACK block received, 0 if none
+ * @resent: number of segments sent again
+ * @segs: number of segments of data sent
+ * @acks: number of packets from the client which acknowledged more data
+ *	without carrying any
+ * @rx_win: largest receive window advertised by the client, in bytes
+ * @conns: connections
+ * @next: connection to send a segment on first
+ */
+struct sb_http_server {
+	ulong size;
+	bool ranges;
+	ulong close_at;
+	bool reorder;
+	ulong lose_at;
+	bool wscale;
+	int requests;
+	int partial;
+	ulong last_range;
+	int client_wscale;
+	bool sack_ok;
+	ulong sack_l;
+	ulong sack_r;
+	int resent;
+	int segs;
+	int acks;
+	ulong rx_win;
+	struct sb_http_conn conns[SB_HTTP_CONNS];
+	int next;
+};
+
+/* Content of the file sent by the fake HTTP server, never \r or \0 */
+static uchar sb_http_byte(ulong pos)
+{
+	return 0x20 + (pos ^ pos >> 8 ^ pos >> 16) % 0x5f;
+}
+
+static struct sb_http_conn *sb_http_find(struct sb_http_server *srv,
+					 u16 port, bool alloc)
+{
+	struct sb_http_conn *conn, *free = NULL;
+
+	for (conn = srv->conns; conn < srv->conns + SB_HTTP_CONNS; conn++) {
+		if (conn->port == port)
+			return conn;
+		if (!free && (!conn->port || conn->closed))
+			free = conn;
+	}
+	if (alloc && free)
+		memset(free, '\0', sizeof(*free));
+
+	return alloc ? free : NULL;
+}
+
+/**
+ * sb_http_send() - queue a segment for the client to receive
+ *
+ * @dev: sandbox Ethernet device
+ * @conn: connection
+ * @flags: TCP flags
+ * @seq: sequence number
+ * @pos: offset in the response of the data to send
+ * @len: number of bytes of data to send
+ * Return: 0 if OK, -ENOSPC if the receive queue is full
+ */
+static int sb_http_send(struct udevice *dev, struct sb_http_conn *conn,
+			u8 flags, u32 seq, ulong pos, int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_http_server *srv = priv->priv;
+	struct ethernet_hdr *eth_send;
+	struct ip_tcp_hdr *tcp_send;
+	int pkt_len, opt_len = 0, i;
+	uchar *data;
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return -ENOSPC;
+
+	eth_send = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_send->et_dest, conn->hwaddr, ARP_HLEN);
+	memcpy(eth_send->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_send->et_protlen = htons(PROT_IP);
+	tcp_send = (void *)eth_send + ETHER_HDR_SIZE;
+	tcp_send->tcp_src = htons(conn->sport);
+	tcp_send->tcp_dst = htons(conn->port);
+	tcp_send->tcp_seq = htonl(seq);
+	tcp_send->tcp_ack = htonl(conn->rcv_nxt);
+	tcp_send->tcp_flags = flags;
+	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	tcp_send->tcp_ugr = 0;
+
+	data = (void *)tcp_send + IP_TCP_HDR_SIZE;
+	if ((flags & TCP_SYN) && srv->wscale && srv->client_wscale >= 0) {
+		data[opt_len++] = TCP_1_NOP;
+		data[opt_len++] = TCP_O_SCL;
+		data[opt_len++] = TCP_OPT_LEN_3;
+		data[opt_len++] = 0;
+	}
+	tcp_send->tcp_hlen =
+		SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(TCP_HDR_SIZE + opt_len));
+	data += opt_len;
+	if (len)
+		srv->segs++;
+	for (i = 0; i < len; i++, pos++) {
+		if (pos < conn->hdr_len)
+			data[i] = conn->hdr[pos];
+		else
+			data[i] = sb_http_byte(conn->start + pos - conn->hdr_len);
+	}
+
+	pkt_len = IP_TCP_HDR_SIZE + opt_len + len;
+	tcp_send->tcp_xsum = 0;
+	tcp_send->tcp_xsum = tcp_set_pseudo_header((uchar *)tcp_send,
+						   conn->client_ip,
+						   conn->server_ip,
+						   pkt_len - IP_HDR_SIZE,
+						   pkt_len);
+	net_set_ip_header((uchar *)tcp_send, conn->client_ip, conn->server_ip,
+			  pkt_len, IPPROTO_TCP);
+
+	priv->recv_packet_length[priv->recv_packets] = ETHER_HDR_SIZE + pkt_len;
+	++priv->recv_packets;
+
+	return 0;
+}
+
+/* Send the next segment of the response, or FIN once it is all sent */
+static int sb_http_send_next(struct udevice *dev, struct sb_http_conn *conn)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_http_server *srv = priv->priv;
+	int len;
+
+	if (conn->sent == conn->len) {
+		conn->fin = true;
+		return sb_http_send(dev, conn, TCP_ACK | TCP_FIN,
+				    conn->len + 1, 0, 0);
+	}
+
+	len = min_t(ulong, TCP_MSS, conn->len - conn->sent);
+	if (srv->reorder && !conn->sent && conn->len > TCP_MSS) {
+		/* Both segments must fit in the queue */
+		if (priv->recv_packets + 2 > SB_HTTP_QUEUE)
+			return -ENOSPC;
+		sb_http_send(dev, conn, TCP_ACK, TCP_MSS + 1, TCP_MSS,
+			     min_t(ulong, TCP_MSS, conn->len - TCP_MSS));
+		sb_http_send(dev, conn, TCP_ACK, 1, 0, TCP_MSS);
+		conn->sent = min_t(ulong, 2 * TCP_MSS, conn->len);
+		return 0;
+	}
+	if (srv->lose_at && conn->sent == srv->lose_at && srv->requests == 1 &&
+	    !conn->lost) {
+		conn->lost = conn->sent + 1;
+		conn->sent += len;
+		return 0;
+	}
+	if (sb_http_send(dev, conn, TCP_ACK, conn->sent + 1, conn->sent, len))
+		return -ENOSPC;
+	conn->sent += len;
+
+	return 0;
+}
+
+/* Fill the receive queue with segments, taking turns between connections */
+static void sb_http_pump(struct udevice *dev)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_http_server *srv = priv->priv;
+	struct sb_http_conn *conn;
+	int i, idle = 0;
+
+	while (priv->recv_packets < SB_HTTP_QUEUE && idle < SB_HTTP_CONNS) {
+		i = srv->next;
+		srv->next = (srv->next + 1) % SB_HTTP_CONNS;
+		conn = &srv->conns[i];
+		if (!conn->port || conn->closed || !conn->len || conn->fin ||
+		    sb_http_send_next(dev, conn)) {
+			idle++;
+			continue;
+		}
+		idle = 0;
+	}
+}
+
+/* Set up the response to a request */
+static void sb_http_request(struct sb_http_server *srv,
+			    struct sb_http_conn *conn, const uchar *data,
+			    int len)
+{
+	char req[256];
+	ulong end = srv->size;
+	const char *range;
+	char *pos;
+
+	snprintf(req, sizeof(req), "%.*s", len, data);
+	srv->requests++;
+	conn->start = 0;
+	range = strstr(req, "\r\nRange: bytes=");
+	if (srv->ranges && range) {
+		conn->start = simple_strtoul(range + 15, &pos, 10);
+		if (*pos == '-' && pos[1] != '\r')
+			end = simple_strtoul(pos + 1, NULL, 10) + 1;
+		srv->last_range = conn->start;
+		srv->partial++;
+		conn->hdr_len = snprintf(conn->hdr, sizeof(conn->hdr),
+					 "HTTP/1.1 206 Partial Content\r\n"
+					 "Content-Range: bytes %lu-%lu/%lu\r\n"
+					 "Content-Length: %lu\r\n\r\n",
+					 conn->start, end - 1, srv->size,
+					 end - conn->start);
+	} else {
+		conn->hdr_len = snprintf(conn->hdr, sizeof(conn->hdr),
+					 "HTTP/1.1 200 OK\r\n"
+					 "Content-Length: %lu\r\n%s\r\n",
+					 srv->size, srv->ranges ?
+					 "Accept-Ranges: bytes\r\n" : "");
+	}
+	if (srv->close_at && srv->requests == 1)
+		end = min(end, conn->start + srv->close_at);
+	conn->len = conn->hdr_len + end - conn->start;
+}
+
+/* Note the options sent by the client */
+static void sb_http_options(struct sb_http_server *srv, struct ip_tcp_hdr *tcp,
+			    int hlen)
+{
+	const uchar *opt = (void *)tcp + IP_TCP_HDR_SIZE;
+	const uchar *end = (void *)tcp + IP_HDR_SIZE + hlen;
+
+	while (opt < end && *opt != TCP_O_END) {
+		if (*opt == TCP_1_NOP) {
+			opt++;
+			continue;
+		}
+		if (opt + 1 >= end || opt[1] < 2)
+			break;
+		switch (*opt) {
+		case TCP_O_SCL:
+			srv->client_wscale = opt[2];
+			break;
+		case TCP_P_SACK:
+			srv->sack_ok = true;
+			break;
+		case TCP_V_SACK:
+			if (!srv->sack_r && opt[1] >= 2 + 8) {
+				srv->sack_l = get_unaligned_be32(opt + 2) - 1;
+				srv->sack_r = get_unaligned_be32(opt + 6) - 1;
+			}
+			break;
+		}
+		opt += opt[1];
+	}
+}
+
+static int sb_http_server_handler(struct udevice *dev, void *packet,
+				  unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_http_server *srv = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+	struct sb_http_conn *conn;
+	int hlen, plen;
+	u32 seq, ack;
+	ulong win;
+
+	if (ntohs(eth->et_protlen) == PROT_ARP)
+		return sb_arp_handler(dev, packet, len);
+	if (ntohs(eth->et_protlen) != PROT_IP || tcp->ip_p != IPPROTO_TCP)
+		return -EPROTONOSUPPORT;
+
+	conn = sb_http_find(srv, ntohs(tcp->tcp_src),
+			    tcp->tcp_flags == TCP_SYN);
+	if (!conn)
+		return 0;
+	seq = ntohl(tcp->tcp_seq);
+	ack = ntohl(tcp->tcp_ack);
+	hlen = GET_TCP_HDR_LEN_IN_BYTES(tcp->tcp_hlen);
+	plen = ntohs(tcp->ip_len) - IP_HDR_SIZE - hlen;
+	sb_http_options(srv, tcp, hlen);
+
+	if (tcp->tcp_flags & TCP_RST) {
+		conn->closed = true;
+	} else if (tcp->tcp_flags == TCP_SYN) {
+		conn->port = ntohs(tcp->tcp_src);
+		conn->sport = ntohs(tcp->tcp_dst);
+		memcpy(conn->hwaddr, eth->et_src, ARP_HLEN);
+		conn->client_ip = tcp->ip_src;
+		conn->server_ip = tcp->ip_dst;
+		conn->rcv_nxt = seq + 1;
+		sb_http_send(dev, conn, TCP_SYN | TCP_ACK, 0, 0, 0);
+	} else if (!conn->closed) {
+		win = ntohs(tcp->tcp_win);
+		if (srv->wscale && srv->client_wscale > 0)
+			win <<= srv->client_wscale;
+		srv->rx_win = max(srv->rx_win, win);
+		if (conn->len && !plen && tcp->tcp_flags == TCP_ACK &&
+		    ack != conn->acked) {
+			conn->acked = ack;
+			srv->acks++;
+		}
+		/* Resend the hole once the client reported the data after it */
+		if (conn->lost && ack == conn->lost &&
+		    (srv->sack_r || !srv->sack_ok) &&
+		    !sb_http_send(dev, conn, TCP_ACK, conn->lost,
+				  conn->lost - 1,
+				  min_t(ulong, TCP_MSS,
+					conn->len - conn->lost + 1))) {
+			conn->lost = 0;
+			srv->resent++;
+		}
+		if (plen > 0 && !conn->len) {
+			sb_http_request(srv, conn, (void *)tcp + hlen + IP_HDR_SIZE,
+					plen);
+			conn->rcv_nxt = seq + plen;
+		}
+		if (tcp->tcp_flags & TCP_FIN) {
+			conn->rcv_nxt = seq + plen + 1;
+			conn->closed = true;
+			if (conn->fin)
+				sb_http_send(dev, conn, TCP_ACK,
+					     conn->len + 2, 0, 0);
+			else
+				sb_http_send(dev, conn, TCP_ACK | TCP_FIN,
+					     conn->sent + 1, 0, 0);
+		}
+	}
+	sb_http_pump(dev);
+
+	return 0;
+}
+
+/* Fill the memory the file is downloaded to, and some after it */
+static void sb_http_fill(ulong addr, ulong size)
+{
+	memset(map_sysmem(addr, size), 0xa5, size);
+}
+
+/**
+ * sb_http_check() - check the file downloaded from the fake HTTP server
+ *
+ * @uts: test state
+ * @addr: address the file was loaded at
+ * @size: size of the file
+ * @guard: bytes after the file which must still be as set by sb_http_fill()
+ * Return: 0 if OK, -ve on error
+ */
+static int sb_http_check(struct unit_test_state *uts, ulong addr, ulong size,
+			 ulong guard)
+{
+	const uchar *buf = map_sysmem(addr, size + guard);
+	ulong i;
+
+	for (i = 0; i < size && buf[i] == sb_http_byte(i); i++)
+		;
+	ut_asserteq(size, i);
+	for (; i < size + guard && buf[i] == 0xa5; i++)
+		;
+	ut_asserteq(size + guard, i);
+
+	return 0;
+}
+
+/* Download a file over two connections, each asking for a range */
+static int net_test_wget_ranges(struct unit_test_state *uts)
+{
+	char *prev_ethact = env_get("ethact");
+	char *prev_ethrotate = env_get("ethrotate");
+	char *prev_loadaddr = env_get("loadaddr");
+	struct sb_http_server srv = {
+		.size		= 0x80000 + 1234,
+		.ranges		= true,
+		/* The resumed range is shorter than 128 KiB */
+		.close_at	= 0x30000,
+		.reorder	= true,
+	};
+
+	if (CONFIG_PROT_TCP_CONNS < 2)
+		return -EAGAIN;
+
+	sandbox_eth_set_tx_handler(0, sb_http_server_handler);
+	sandbox_eth_set_priv(0, &srv);
+
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set("loadaddr", "0x100000");
+	env_set("wgetconns", "2");
+	sb_http_fill(0x100000, srv.size + 0x40000);
+	ut_assertok(run_command("wget ${loadaddr} 1.1.2.2:/file.bin", 0));
+	ut_assert_skip_to_line("wget: fetching %lu bytes over 2 connections",
+			       srv.size);
+	ut_assert_skip_to_line("wget: range 0: resuming at %lu",
+			       srv.close_at);
+	ut_assert_skip_to_line("Bytes transferred = %lu (%lx hex)", srv.size,
+			       srv.size);
+	ut_assert_console_end();
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("wgetconns", NULL);
+	env_set("ethact", prev_ethact);
+	env_set("ethrotate", prev_ethrotate);
+	env_set("loadaddr", prev_loadaddr);
+
+	/* The whole file, then one range per connection and the resume */
+	ut_asserteq(3, srv.requests);
+	ut_asserteq(2, srv.partial);
+	ut_asserteq(srv.close_at, srv.last_range);
+	ut_assertok(sb_http_check(uts, 0x100000, srv.size, 0x40000));
+
+	return 0;
+}
+CMD_TEST(net_test_wget_ranges, UTF_CONSOLE);
+
+/* Resume a download when the server closes the connection early */
+static int net_test_wget_resume(struct unit_test_state *uts)
+{
+	char *prev_ethact = env_get("ethact");
+	char *prev_ethrotate = env_get("ethrotate");
+	char *prev_loadaddr = env_get("loadaddr");
+	struct sb_http_server srv = {
+		.size		= 0x20000,
+		.ranges		= true,
+		.close_at	= 0x3000,
+		.reorder	= true,
+	};
+
+	sandbox_eth_set_tx_handler(0, sb_http_server_handler);
+	sandbox_eth_set_priv(0, &srv);
+
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set("loadaddr", "0x100000");
+	sb_http_fill(0x100000, srv.size + 0x40000);
+	ut_assertok(run_command("wget ${loadaddr} 1.1.2.2:/file.bin", 0));
+	ut_assert_nextline("HTTP/1.1 200 OK");
+	ut_assert_skip_to_line("wget: resuming at %lu", srv.close_at);
+	ut_assert_skip_to_line("Bytes transferred = %lu (%lx hex)", srv.size,
+			       srv.size);
+	ut_assert_console_end();
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("ethact", prev_ethact);
+	env_set("ethrotate", prev_ethrotate);
+	env_set("loadaddr", prev_loadaddr);
+
+	ut_asserteq(2, srv.requests);
+	ut_asserteq(1, srv.partial);
+	ut_asserteq(srv.close_at, srv.last_range);
+	/* Data received before the header must not land past the file */
+	ut_assertok(sb_http_check(uts, 0x100000, srv.size, 0x40000));
+
+	return 0;
+}
+CMD_TEST(net_test_wget_resume, UTF_CONSOLE);
+
+/* Recover a lost segment with SACK, acknowledging every other segment */
+static int net_test_wget_sack(struct unit_test_state *uts)
+{
+	char *prev_ethact = env_get("ethact");
+	char *prev_ethrotate = env_get("ethrotate");
+	char *prev_loadaddr = env_get("loadaddr");
+	struct sb_http_server srv = {
+		.size		= 0x10000,
+		.lose_at	= 4 * TCP_MSS,
+		.client_wscale	= -1,
+	};
+
+	if (!IS_ENABLED(CONFIG_PROT_TCP_SACK))
+		return -EAGAIN;
+
+	sandbox_eth_set_tx_handler(0, sb_http_server_handler);
+	sandbox_eth_set_priv(0, &srv);
+
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set("loadaddr", "0x100000");
+	sb_http_fill(0x100000, srv.size + 0x1000);
+	ut_assertok(run_command("wget ${loadaddr} 1.1.2.2:/file.bin", 0));
+	ut_assert_nextline("HTTP/1.1 200 OK");
+	ut_assert_skip_to_line("Bytes transferred = %lu (%lx hex)", srv.size,
+			       srv.size);
+	ut_assert_console_end();
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("ethact", prev_ethact);
+	env_set("ethrotate", prev_ethrotate);
+	env_set("loadaddr", prev_loadaddr);
+
+	/* The segment after the hole was reported and only the hole resent */
+	ut_assert(srv.sack_ok);
+	ut_asserteq(srv.lose_at + TCP_MSS, srv.sack_l);
+	ut_assert(srv.sack_r >= srv.sack_l + TCP_MSS);
+	ut_asserteq(1, srv.resent);
+	ut_assertok(sb_http_check(uts, 0x100000, srv.size, 0x1000));
+
+	/* Data received in order is not acknowledged segment by segment */
+	ut_assert(srv.acks * CONFIG_PROT_TCP_ACK_SEGS <= srv.segs + 2);
+
+	return 0;
+}
+CMD_TEST(net_test_wget_sack, UTF_CONSOLE);
+
+/* Download a file, returning the receive window advertised by the client */
+static int wget_rx_win(struct unit_test_state *uts, bool wscale, ulong *winp)
+{
+	struct sb_http_server srv = {
+		.size		= 0x8000,
+		.wscale		= wscale,
+		.client_wscale	= -1,
+	};
+
+	sandbox_eth_set_priv(0, &srv);
+	sb_http_fill(0x100000, srv.size);
+	ut_assertok(run_command("wget ${loadaddr} 1.1.2.2:/file.bin", 0));
+	ut_assert_nextline("HTTP/1.1 200 OK");
+	ut_assert_skip_to_line("Bytes transferred = %lu (%lx hex)", srv.size,
+			       srv.size);
+	ut_assertok(sb_http_check(uts, 0x100000, srv.size, 0));
+
+	/* The client always offers to scale its window */
+	ut_assert(srv.client_wscale >= 0);
+	*winp = srv.rx_win;
+
+	return 0;
+}
+
+/* Scale the receive window only if the server answers the option */
+static int net_test_wget_wscale(struct unit_test_state *uts)
+{
+	char *prev_ethact = env_get("ethact");
+	char *prev_ethrotate = env_get("ethrotate");
+	char *prev_loadaddr = env_get("loadaddr");
+	ulong win = CONFIG_PROT_TCP_RX_WINDOW * 1024;
+	ulong scaled, unscaled;
+
+	sandbox_eth_set_tx_handler(0, sb_http_server_handler);
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set("loadaddr", "0x100000");
+
+	ut_assertok(wget_rx_win(uts, true, &scaled));
+	ut_assertok(wget_rx_win(uts, false, &unscaled));
+	ut_assert_console_end();
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("ethact", prev_ethact);
+	env_set("ethrotate", prev_ethrotate);
+	env_set("loadaddr", prev_loadaddr);
+
+	ut_asserteq(win, scaled);
+	ut_asserteq(min_t(ulong, win, U16_MAX), unscaled);
+
+	return 0;
+}
+CMD_TEST(net_test_wget_wscale, UTF_CONSOLE);
+
+/* Write a file through the net sink to a host block device */
+static int net_test_wget_sink(struct unit_test_state *uts)
+{
+	char *prev_ethact = env_get("ethact");
+	char *prev_ethrotate = env_get("ethrotate");
+	char *prev_loadaddr = env_get("loadaddr");
+	struct sb_http_server srv = {
+		.size		= 0x20000 + 1234,
+	};
+	const ulong img_size = 0x40000, start = 8;
+	struct udevice *dev, *blk;
+	struct blk_desc *desc;
+	char fname[256];
+	uchar *buf;
+	int fd, ret;
+	ulong i;
+
+	if (!IS_ENABLED(CONFIG_NET_SINK))
+		return -EAGAIN;
+
+	/* An empty disk image, removed again at the end */
+	ret = os_persistent_file(fname, sizeof(fname), "net_sink.img");
+	ut_assert(!ret || ret == -ENOENT);
+	fd = os_open(fname, OS_O_RDWR | OS_O_CREAT | OS_O_TRUNC);
+	ut_assert(fd >= 0);
+	buf = calloc(1, img_size);
+	ut_assertnonnull(buf);
+	ut_asserteq(img_size, os_write(fd, buf, img_size));
+	os_close(fd);
+
+	ut_assertok(host_create_device("sink", true, DEFAULT_BLKSZ, &dev));
+	ut_assertok(host_attach_file(dev, fname));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(device_probe(blk));
+	desc = dev_get_uclass_plat(blk);
+
+	sandbox_eth_set_tx_handler(0, sb_http_server_handler);
+	sandbox_eth_set_priv(0, &srv);
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set("loadaddr", "0x100000");
+
+	ut_assertok(run_commandf("net sink blk host %d %lx", desc->devnum,
+				 start));
+	ut_assertok(run_command("wget ${loadaddr} 1.1.2.2:/file.bin", 0));
+	ut_assert_nextline("HTTP/1.1 200 OK");
+	ut_assert_skip_to_line("0x%lx bytes written", srv.size);
+	ut_assert_skip_to_line("Bytes transferred = %lu (%lx hex)", srv.size,
+			       srv.size);
+	ut_assert_console_end();
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("ethact", prev_ethact);
+	env_set("ethrotate", prev_ethrotate);
+	env_set("loadaddr", prev_loadaddr);
+
+	/* Read the whole device back */
+	ut_asserteq(img_size / desc->blksz,
+		    blk_dread(desc, 0, img_size / desc->blksz, buf));
+	for (i = 0; i < start * desc->blksz && !buf[i]; i++)
+		;
+	ut_asserteq(start * desc->blksz, i);
+	for (; i < start * desc->blksz + srv.size &&
+	     buf[i] == sb_http_byte(i - start * desc->blksz); i++)
+		;
+	ut_asserteq(start * desc->blksz + srv.size, i);
+	/* The last block is padded with zeroes, the rest left alone */
+	for (; i < img_size && !buf[i]; i++)
+		;
+	ut_asserteq(img_size, i);
+	free(buf);
+
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(device_unbind(dev));
+	ut_assertok(os_unlink(fname));
+
+	return 0;
+}
+CMD_TEST(net_test_wget_sink, UTF_CONSOLE);
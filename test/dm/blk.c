@@ -5,11 +5,14 @@
 
 #include <blk.h>
 #include <dm.h>
+#include <malloc.h>
+#include <os.h>
 #include <part.h>
 #include <sandbox_host.h>
 #include <usb.h>
 #include <asm/global_data.h>
 #include <asm/state.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
 #include <test/test.h>
 #include <test/ut.h>
@@ -334,3 +337,137 @@ static int dm_test_blk_foreach(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_foreach, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+/* Test queueing requests and reaping their completions */
+static int dm_test_blk_queue(struct unit_test_state *uts)
+{
+	const int blks = 24;
+	struct udevice *dev, *blk;
+	struct blk_req reqs[6];
+	struct blk_desc *desc;
+	char fname[256];
+	char *ref, *buf;
+	int i;
+
+	ut_assertok(os_persistent_file(fname, sizeof(fname), "2MB.ext2.img"));
+	ut_assertok(host_create_device("test", true, DEFAULT_BLKSZ, &dev));
+	ut_assertok(host_attach_file(dev, fname));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(device_probe(blk));
+	desc = dev_get_uclass_plat(blk);
+
+	ref = malloc(blks * DEFAULT_BLKSZ);
+	buf = calloc(blks, DEFAULT_BLKSZ);
+	ut_assertnonnull(ref);
+	ut_assertnonnull(buf);
+	ut_asserteq(blks, blk_read(blk, 0, blks, ref));
+	blkcache_invalidate(desc->uclass_id, desc->devnum);
+
+	/* more requests than the sandbox device can hold in its queue */
+	for (i = 0; i < ARRAY_SIZE(reqs); i++) {
+		reqs[i].op = BLK_REQ_READ;
+		reqs[i].start = i * 4;
+		reqs[i].blkcnt = 4;
+		reqs[i].buffer = buf + i * 4 * DEFAULT_BLKSZ;
+	}
+	ut_asserteq(blks, blk_run_reqs(blk, reqs, ARRAY_SIZE(reqs)));
+	ut_asserteq_mem(ref, buf, blks * DEFAULT_BLKSZ);
+
+	/* requests stay pending until the device is polled */
+	memset(buf, '\0', blks * DEFAULT_BLKSZ);
+	ut_assertok(blk_submit(blk, &reqs[0]));
+	ut_assertok(blk_submit(blk, &reqs[1]));
+	ut_asserteq(false, reqs[0].done);
+	ut_asserteq(2, blk_poll(blk));
+	ut_asserteq(true, reqs[0].done);
+	ut_asserteq(4, reqs[0].result);
+	ut_asserteq(true, reqs[1].done);
+
+	for (i = 2; i < 6; i++)
+		ut_assertok(blk_submit(blk, &reqs[i]));
+	ut_asserteq(-EBUSY, blk_submit(blk, &reqs[0]));
+	ut_asserteq(4, blk_wait(blk, &reqs[2]));
+	ut_asserteq(true, reqs[5].done);
+	ut_asserteq_mem(ref, buf, blks * DEFAULT_BLKSZ);
+	ut_asserteq(0, blk_poll(blk));
+
+	free(buf);
+	free(ref);
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(device_unbind(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_blk_queue, UTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(BLOCK_CACHE)
+/* Test the block cache lookups, partial hits and memory limit */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct block_cache_stats stats;
+	char buf[DEFAULT_BLKSZ * 20], out[DEFAULT_BLKSZ * 4];
+	int i;
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i / DEFAULT_BLKSZ;
+
+	/* room for four pages of four blocks */
+	ut_asserteq(-EINVAL, blkcache_configure(3, DEFAULT_BLKSZ * 16));
+	ut_assertok(blkcache_configure(4, DEFAULT_BLKSZ * 16));
+
+	/* a single block is cached even though it does not fill a page */
+	blkcache_fill(UCLASS_HOST, 0, 5, 1, DEFAULT_BLKSZ,
+		      buf + 5 * DEFAULT_BLKSZ);
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 0, 5, 1, DEFAULT_BLKSZ,
+				     out));
+	ut_asserteq_mem(buf + 5 * DEFAULT_BLKSZ, out, DEFAULT_BLKSZ);
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 0, 4, 1, DEFAULT_BLKSZ,
+				     out));
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 1, 5, 1, DEFAULT_BLKSZ,
+				     out));
+
+	/* a read spanning two pages, then a partial hit */
+	blkcache_fill(UCLASS_HOST, 0, 2, 4, DEFAULT_BLKSZ,
+		      buf + 2 * DEFAULT_BLKSZ);
+	ut_asserteq(4, blkcache_read(UCLASS_HOST, 0, 2, 4, DEFAULT_BLKSZ,
+				     out));
+	ut_asserteq_mem(buf + 2 * DEFAULT_BLKSZ, out, DEFAULT_BLKSZ * 4);
+	ut_asserteq(2, blkcache_read(UCLASS_HOST, 0, 4, 3, DEFAULT_BLKSZ,
+				     out));
+	ut_asserteq_mem(buf + 4 * DEFAULT_BLKSZ, out, DEFAULT_BLKSZ * 2);
+
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.hits);
+	ut_asserteq(1, stats.partial_hits);
+	ut_asserteq(2, stats.misses);
+	ut_asserteq(2, stats.entries);
+	ut_asserteq(DEFAULT_BLKSZ * 8, stats.size);
+
+	/* a fifth page pushes out the least recently used one */
+	blkcache_fill(UCLASS_HOST, 0, 8, 4, DEFAULT_BLKSZ,
+		      buf + 8 * DEFAULT_BLKSZ);
+	blkcache_fill(UCLASS_HOST, 0, 12, 4, DEFAULT_BLKSZ,
+		      buf + 12 * DEFAULT_BLKSZ);
+	blkcache_fill(UCLASS_HOST, 0, 16, 1, DEFAULT_BLKSZ,
+		      buf + 16 * DEFAULT_BLKSZ);
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 0, 2, 1, DEFAULT_BLKSZ,
+				     out));
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 0, 5, 1, DEFAULT_BLKSZ,
+				     out));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.evictions);
+	ut_asserteq(4, stats.entries);
+
+	/* a write drops everything for the device */
+	blkcache_invalidate(UCLASS_HOST, 0);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+	ut_asserteq(0, stats.size);
+
+	ut_assertok(blkcache_configure(CONFIG_BLOCK_CACHE_PAGE_BLOCKS,
+				       CONFIG_BLOCK_CACHE_SIZE));
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, 0);
+#endif
@@ -403,6 +403,44 @@ static int dm_test_eth_rotate(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_eth_rotate, UTF_SCAN_FDT);
 
+#if CONFIG_IS_ENABLED(NET_RACE)
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_race(struct unit_test_state *uts)
+{
+	/* The first interface to answer wins, whatever ethact says */
+	sandbox_eth_disable_response(0, true);
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "race");
+	ut_assertok(net_loop(PING));
+	ut_asserteq_str("eth@10003000", env_get("ethact"));
+
+	/* Without a race, ethact is tried first */
+	sandbox_eth_disable_response(0, false);
+	env_set("ethact", "eth@10004000");
+	env_set("ethrotate", NULL);
+	ut_assertok(net_loop(PING));
+	ut_asserteq_str("eth@10004000", env_get("ethact"));
+
+	return 0;
+}
+
+static int dm_test_eth_race(struct unit_test_state *uts)
+{
+	int retval;
+
+	net_ping_ip = string_to_ip("1.1.2.2");
+
+	retval = _dm_test_eth_race(uts);
+
+	/* Restore the env */
+	env_set("ethrotate", NULL);
+	sandbox_eth_disable_response(0, false);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_race, UTF_SCAN_FDT);
+#endif
+
 /* The asserts include a return on fail; cleanup in the caller */
 static int _dm_test_net_retry(struct unit_test_state *uts)
 {
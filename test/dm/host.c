@@ -74,6 +74,52 @@ static int dm_test_host(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_host, UTF_SCAN_FDT);
 
+/* Check that a filesystem kept mounted is dropped when the device changes */
+static int dm_test_host_fs_mount(struct unit_test_state *uts)
+{
+	static char label[] = "test";
+	char sb[2 * DEFAULT_BLKSZ], zero[2 * DEFAULT_BLKSZ];
+	struct udevice *dev, *blk;
+	struct blk_desc *desc;
+	char fname[256];
+	ulong mem_start;
+
+	if (!CONFIG_IS_ENABLED(FS_MOUNT_CACHE))
+		return -EAGAIN;
+
+	mem_start = ut_check_delta(0);
+	ut_assertok(host_create_device(label, true, DEFAULT_BLKSZ, &dev));
+	ut_assertok(os_persistent_file(fname, sizeof(fname), "2MB.ext2.img"));
+	ut_assertok(host_attach_file(dev, fname));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(device_probe(blk));
+	desc = dev_get_uclass_plat(blk);
+
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_asserteq(FS_TYPE_EXT, fs_get_type());
+	fs_close();
+
+	/* wipe the superblock, so the filesystem is no longer found */
+	ut_asserteq(2, blk_read(blk, 2, 2, sb));
+	memset(zero, '\0', sizeof(zero));
+	ut_asserteq(2, blk_write(blk, 2, 2, zero));
+	ut_assert(fs_set_blk_dev_with_part(desc, 0));
+	ut_asserteq(FS_TYPE_ANY, fs_get_type());
+
+	ut_asserteq(2, blk_write(blk, 2, 2, sb));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_asserteq(FS_TYPE_EXT, fs_get_type());
+	fs_close();
+
+	/* removing the device must unmount the filesystem */
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(device_unbind(dev));
+	ut_asserteq(0, ut_check_delta(mem_start));
+
+	return 0;
+}
+DM_TEST(dm_test_host_fs_mount, UTF_SCAN_FDT);
+
 /* reusing the same label should work */
 static int dm_test_host_dup(struct unit_test_state *uts)
 {
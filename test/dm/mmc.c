@@ -6,6 +6,7 @@
 #include <dm.h>
 #include <mmc.h>
 #include <part.h>
+#include <asm/test.h>
 #include <dm/test.h>
 #include <test/test.h>
 #include <test/ut.h>
@@ -51,3 +52,54 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+/* Test reading in several chunks, with each one prepared in advance */
+static int dm_test_mmc_stream(struct unit_test_state *uts)
+{
+	char write[10 * 512], read[10 * 512];
+	struct blk_desc *dev_desc;
+	struct mmc_config *cfg;
+	struct udevice *dev;
+	uint counted, prepared, stops, new_counted, new_prepared, new_stops;
+	struct mmc *mmc;
+	uint b_max, chunks;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(MMC_STREAM_READ))
+		return -EAGAIN;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	mmc = mmc_get_mmc_dev(dev);
+
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i * 3;
+	ut_asserteq(10, blk_dwrite(dev_desc, 0, 10, write));
+
+	/* force the read to be split into several chunks, the last one short */
+	cfg = (struct mmc_config *)mmc->cfg;
+	b_max = cfg->b_max;
+	for (i = 2; i <= 3; i++) {
+		cfg->b_max = i;
+		blkcache_invalidate(dev_desc->uclass_id, dev_desc->devnum);
+		memset(read, '\0', sizeof(read));
+		sandbox_mmc_get_read_counts(dev, &counted, &prepared, &stops);
+		ut_asserteq(10, blk_dread(dev_desc, 0, 10, read));
+		ut_asserteq_mem(write, read, sizeof(write));
+
+		/*
+		 * Each chunk must have been prepared in advance and each
+		 * multi-block one sized by CMD23, so never stopped
+		 */
+		chunks = DIV_ROUND_UP(10, i);
+		sandbox_mmc_get_read_counts(dev, &new_counted, &new_prepared,
+					    &new_stops);
+		ut_asserteq(chunks, new_prepared - prepared);
+		ut_asserteq(10 / i, new_counted - counted);
+		ut_asserteq(stops, new_stops);
+	}
+	cfg->b_max = b_max;
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_stream, UTF_SCAN_PDATA | UTF_SCAN_FDT);
@@ -195,3 +195,70 @@ static int dm_test_virtio_ring(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_virtio_ring, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+/* Test of the virtqueue with indirect descriptors */
+static int dm_test_virtio_ring_indirect(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+	struct virtio_dev_priv *uc_priv;
+	struct vring_desc *table;
+	struct virtqueue *vq;
+	struct virtio_sg sg[3];
+	struct virtio_sg *sgs[3];
+	unsigned int len;
+	u8 buffer[3][32];
+	int i;
+
+	ut_assertok(uclass_first_device_err(UCLASS_VIRTIO, &bus));
+	ut_assertok(device_find_first_child(bus, &dev));
+	ut_assertnonnull(dev);
+
+	/* fake the device probe, negotiating indirect descriptors */
+	uc_priv = dev_get_uclass_priv(bus);
+	uc_priv->vdev = dev;
+	uc_priv->features |= BIT_ULL(VIRTIO_RING_F_INDIRECT_DESC);
+
+	for (i = 0; i < 3; i++) {
+		sg[i].addr = buffer[i];
+		sg[i].length = sizeof(buffer[i]);
+		sgs[i] = &sg[i];
+	}
+
+	/* a chain of three buffers only uses one ring entry */
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	ut_assertnonnull(vq->indirect_desc);
+	ut_assertok(virtqueue_add(vq, sgs, 1, 2));
+	ut_asserteq(vq->vring.num - 1, vq->num_free);
+	ut_asserteq(VRING_DESC_F_INDIRECT,
+		    virtio16_to_cpu(dev, vq->vring.desc[0].flags));
+	ut_asserteq(3 * sizeof(struct vring_desc),
+		    virtio32_to_cpu(dev, vq->vring.desc[0].len));
+
+	table = (void *)(uintptr_t)virtio64_to_cpu(dev, vq->vring.desc[0].addr);
+	ut_asserteq_ptr(buffer[0],
+			(void *)(uintptr_t)virtio64_to_cpu(dev, table[0].addr));
+	ut_asserteq(VRING_DESC_F_NEXT, virtio16_to_cpu(dev, table[0].flags));
+	ut_asserteq(VRING_DESC_F_NEXT | VRING_DESC_F_WRITE,
+		    virtio16_to_cpu(dev, table[1].flags));
+	ut_asserteq(VRING_DESC_F_WRITE, virtio16_to_cpu(dev, table[2].flags));
+	ut_asserteq(2, virtio16_to_cpu(dev, table[1].next));
+
+	/* a single buffer still goes in the ring directly */
+	ut_assertok(virtqueue_add(vq, sgs, 0, 1));
+	ut_asserteq(vq->vring.num - 2, vq->num_free);
+	ut_asserteq(0, virtio16_to_cpu(dev, vq->vring.desc[1].flags) &
+		    VRING_DESC_F_INDIRECT);
+
+	/* completion returns the first buffer and frees the entry */
+	vq->vring.used->idx = 1;
+	vq->vring.used->ring[0].id = 0;
+	vq->vring.used->ring[0].len = 33;
+	ut_asserteq_ptr(buffer[0], virtqueue_get_buf(vq, &len));
+	ut_asserteq(33, len);
+	ut_asserteq(vq->vring.num - 1, vq->num_free);
+	ut_assertok(virtio_del_vqs(dev));
+	uc_priv->features &= ~BIT_ULL(VIRTIO_RING_F_INDIRECT_DESC);
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_ring_indirect, UTF_SCAN_PDATA | UTF_SCAN_FDT);
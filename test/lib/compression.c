@@ -8,12 +8,14 @@
 #include <command.h>
 #include <gzip.h>
 #include <image.h>
+#include <image-stream.h>
 #include <log.h>
 #include <malloc.h>
 #include <mapmem.h>
 #include <asm/io.h>
 
 #include <u-boot/lz4.h>
+#include <u-boot/sha256.h>
 #include <u-boot/zlib.h>
 #include <bzlib.h>
 
@@ -606,3 +608,122 @@ static int compression_test_bootm_none(struct unit_test_state *uts)
 	return run_bootm_test(uts, IH_COMP_NONE, compress_using_none);
 }
 LIB_TEST(compression_test_bootm_none, 0);
+
+#if CONFIG_IS_ENABLED(IMAGE_STREAM)
+/* A block device for image_stream_run() which only allows aligned reads */
+struct stream_dev {
+	const void *data;
+	ulong size;
+	ulong align;
+};
+
+static long stream_dev_read(void *priv, ulong offset, ulong size, void *buf)
+{
+	struct stream_dev *dev = priv;
+
+	if ((offset | size) & (dev->align - 1))
+		return -EINVAL;
+	if (offset + size > dev->size)
+		return -EIO;
+	memcpy(buf, dev->data + offset, size);
+
+	return size;
+}
+
+/**
+ * run_stream_test() - Test hashing and decompressing in a single pass
+ *
+ * @comp_type:	Compression type to test
+ * @compress:	Our function to compress data
+ * Return: 0 if OK, non-zero on failure
+ */
+static int run_stream_test(struct unit_test_state *uts, int comp_type,
+			   mutate_func compress)
+{
+	const ulong plain_len = strlen(plain);
+	u8 digest[SHA256_SUM_LEN];
+	struct image_stream st;
+	struct stream_dev dev;
+	ulong compress_size;
+	u8 *disk, *out;
+
+	printf("Testing: %s\n", genimg_get_comp_name(comp_type));
+	disk = calloc(1, TEST_BUFFER_SIZE * 2);
+	out = malloc(TEST_BUFFER_SIZE);
+	ut_assertnonnull(disk);
+	ut_assertnonnull(out);
+
+	/* Put the data at an odd offset, to check alignment is handled */
+	ut_assertok(compress(uts, (void *)plain, plain_len, disk + 13,
+			     TEST_BUFFER_SIZE, &compress_size));
+	sha256_csum_wd(disk + 13, compress_size, digest, CHUNKSZ_SHA256);
+
+	/* From memory, in small chunks */
+	memset(&st, '\0', sizeof(st));
+	st.comp = comp_type;
+	st.src = disk + 13;
+	st.size = compress_size;
+	st.chunk = 48;
+	st.algo = "sha256";
+	st.dst = out;
+	st.dst_size = TEST_BUFFER_SIZE;
+	ut_assertok(image_stream_run(&st));
+	ut_asserteq(plain_len, st.len);
+	ut_asserteq_mem(plain, out, plain_len);
+	ut_asserteq(SHA256_SUM_LEN, st.digest_len);
+	ut_asserteq_mem(digest, st.digest, SHA256_SUM_LEN);
+
+	/* From a device with 16-byte blocks */
+	dev.data = disk;
+	dev.size = TEST_BUFFER_SIZE * 2;
+	dev.align = 16;
+	memset(out, '\0', TEST_BUFFER_SIZE);
+	st.src = NULL;
+	st.read = stream_dev_read;
+	st.priv = &dev;
+	st.offset = 13;
+	st.align = dev.align;
+	ut_assertok(image_stream_run(&st));
+	ut_asserteq(plain_len, st.len);
+	ut_asserteq_mem(plain, out, plain_len);
+	ut_asserteq_mem(digest, st.digest, SHA256_SUM_LEN);
+
+	/* Not enough space for the output */
+	st.dst_size = plain_len - 1;
+	ut_asserteq(-ENOSPC, image_stream_run(&st));
+
+	/* Read errors are reported */
+	st.dst_size = TEST_BUFFER_SIZE;
+	dev.size = 64;
+	ut_asserteq(-EIO, image_stream_run(&st));
+	dev.size = TEST_BUFFER_SIZE * 2;
+
+	/* Corrupt data changes the hash, even if it decompresses */
+	disk[13 + compress_size - 1] ^= 1;
+	if (!image_stream_run(&st))
+		ut_assert(memcmp(digest, st.digest, SHA256_SUM_LEN));
+
+	free(out);
+	free(disk);
+
+	return 0;
+}
+
+static int compression_test_stream_gzip(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_GZIP, compress_using_gzip);
+}
+LIB_TEST(compression_test_stream_gzip, 0);
+
+static int compression_test_stream_zstd(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+LIB_TEST(compression_test_stream_zstd, 0);
+
+static int compression_test_stream_none(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_NONE, compress_using_none);
+}
+LIB_TEST(compression_test_stream_none, 0);
+#endif
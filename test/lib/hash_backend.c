@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for choosing the SHA block function at runtime
+ */
+
+#include <hash.h>
+#include <linker_lists.h>
+#include <string.h>
+#include <test/lib.h>
+#include <test/ut.h>
+
+/* Find the generic backend for an algorithm */
+static const struct hash_backend *find_generic(const char *algo)
+{
+	struct hash_backend *start, *backend;
+	const int count = ll_entry_count(struct hash_backend, hash_backend);
+
+	start = ll_entry_start(struct hash_backend, hash_backend);
+	for (backend = start; backend != start + count; backend++) {
+		if (!strcmp(backend->algo, algo) &&
+		    !strcmp(backend->name, "generic"))
+			return backend;
+	}
+
+	return NULL;
+}
+
+static int lib_hash_backend_get(struct unit_test_state *uts)
+{
+	static const char *const algos[] = { "sha1", "sha256", "sha512" };
+	const struct hash_backend *backend;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(algos); i++) {
+		backend = hash_backend_get(algos[i]);
+		ut_assertnonnull(backend);
+		ut_asserteq_str(algos[i], backend->algo);
+		ut_assert(hash_backend_usable(backend));
+		ut_assert(backend->priority >= find_generic(algos[i])->priority);
+	}
+	ut_assertnull(hash_backend_get("sha3"));
+
+	return 0;
+}
+LIB_TEST(lib_hash_backend_get, 0);
+
+/* Each usable backend must give the same result as the generic one */
+static int lib_hash_backend_match(struct unit_test_state *uts)
+{
+	static const uint block_counts[] = { 1, 2, 7 };
+	struct hash_backend *start, *backend;
+	const int count = ll_entry_count(struct hash_backend, hash_backend);
+	const struct hash_backend *generic;
+	u64 expect[8], state[8];
+	u8 data[7 * 128];
+	int i, j;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 131 + 7;
+
+	start = ll_entry_start(struct hash_backend, hash_backend);
+	for (backend = start; backend != start + count; backend++) {
+		if (!hash_backend_usable(backend))
+			continue;
+		generic = find_generic(backend->algo);
+		ut_assertnonnull(generic);
+		ut_asserteq(generic->block_size, backend->block_size);
+
+		for (j = 0; j < ARRAY_SIZE(block_counts); j++) {
+			for (i = 0; i < ARRAY_SIZE(state); i++)
+				expect[i] = 0x0123456789abcdefULL * (i + 1);
+			memcpy(state, expect, sizeof(state));
+			generic->process(expect, data, block_counts[j]);
+			backend->process(state, data, block_counts[j]);
+			ut_asserteq_mem(expect, state, sizeof(state));
+		}
+	}
+
+	return 0;
+}
+LIB_TEST(lib_hash_backend_match, 0);
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for running jobs on several CPUs
+ */
+
+#include <cyclic.h>
+#include <hash.h>
+#include <malloc.h>
+#include <smp_work.h>
+#include <test/lib.h>
+#include <test/ut.h>
+#include <linux/errno.h>
+#include <linux/sizes.h>
+#include <u-boot/schedule.h>
+
+#define TEST_CPUS	CONFIG_SMP_WORK_CPUS
+
+struct smp_test_job {
+	int *started;
+	int ret;
+};
+
+/* Wait until all jobs have started, so that each must be on its own CPU */
+static int smp_test_wait(void *arg)
+{
+	struct smp_test_job *tj = arg;
+	ulong i;
+
+	__atomic_fetch_add(tj->started, 1, __ATOMIC_SEQ_CST);
+	for (i = 0; i < 1000000000UL; i++) {
+		if (__atomic_load_n(tj->started, __ATOMIC_SEQ_CST) == TEST_CPUS)
+			break;
+	}
+
+	return tj->ret;
+}
+
+/* Test that jobs run on all CPUs at once */
+static int lib_smp_work_cpus(struct unit_test_state *uts)
+{
+	struct smp_test_job tj[TEST_CPUS];
+	struct smp_job jobs[TEST_CPUS];
+	uint seen = 0;
+	int started;
+	int i;
+
+	for (i = 0; i < TEST_CPUS; i++) {
+		tj[i].started = &started;
+		tj[i].ret = 0;
+		jobs[i].func = smp_test_wait;
+		jobs[i].arg = &tj[i];
+	}
+
+	/* Run twice to check that the CPUs can be started again */
+	started = 0;
+	ut_assertok(smp_work_run(jobs, TEST_CPUS));
+	started = 0;
+	ut_assertok(smp_work_run(jobs, TEST_CPUS));
+	ut_asserteq(TEST_CPUS, started);
+	for (i = 0; i < TEST_CPUS; i++) {
+		ut_assert(jobs[i].cpu < TEST_CPUS);
+		seen |= 1 << jobs[i].cpu;
+	}
+	ut_asserteq((1 << TEST_CPUS) - 1, seen);
+
+	/* The first error is returned, after all jobs have run */
+	tj[1].ret = -EINVAL;
+	tj[2].ret = -ENOENT;
+	started = 0;
+	ut_asserteq(-EINVAL, smp_work_run(jobs, TEST_CPUS));
+	ut_asserteq(TEST_CPUS, started);
+
+	return 0;
+}
+LIB_TEST(lib_smp_work_cpus, 0);
+
+#if IS_ENABLED(CONFIG_CYCLIC)
+static struct smp_test_cyclic {
+	struct cyclic_info cyclic;
+	int calls;
+	bool on_secondary;
+} smp_test_cyclic;
+
+static void smp_test_cyclic_func(struct cyclic_info *c)
+{
+	struct smp_test_cyclic *tc = container_of(c, struct smp_test_cyclic,
+						  cyclic);
+
+	tc->calls++;
+	if (smp_work_secondary())
+		tc->on_secondary = true;
+}
+
+/* Once all jobs have started, so each is on its own CPU, call schedule() */
+static int smp_test_schedule(void *arg)
+{
+	int i;
+
+	smp_test_wait(arg);
+	for (i = 0; i < 10000; i++)
+		schedule();
+
+	return 0;
+}
+
+/* Test that cyclic functions keep running, only on the boot CPU */
+static int lib_smp_work_cyclic(struct unit_test_state *uts)
+{
+	struct smp_test_job tj[TEST_CPUS];
+	struct smp_job jobs[TEST_CPUS];
+	int started = 0;
+	int i;
+
+	for (i = 0; i < TEST_CPUS; i++) {
+		tj[i].started = &started;
+		tj[i].ret = 0;
+		jobs[i].func = smp_test_schedule;
+		jobs[i].arg = &tj[i];
+	}
+
+	smp_test_cyclic.calls = 0;
+	smp_test_cyclic.on_secondary = false;
+	cyclic_register(&smp_test_cyclic.cyclic, smp_test_cyclic_func, 0,
+			"smp_test");
+	ut_assertok(smp_work_run(jobs, TEST_CPUS));
+	cyclic_unregister(&smp_test_cyclic.cyclic);
+
+	ut_asserteq(TEST_CPUS, started);
+	ut_assert(smp_test_cyclic.calls > 0);
+	ut_assert(!smp_test_cyclic.on_secondary);
+	ut_assert(!smp_work_secondary());
+
+	return 0;
+}
+LIB_TEST(lib_smp_work_cyclic, 0);
+#endif
+
+/* Test hashing on several CPUs */
+static int lib_smp_work_hash(struct unit_test_state *uts)
+{
+	static const char *const algos[] = {
+		"sha256", "sha1", "crc32", "sha512", "sha256", "nonesuch",
+	};
+	const int count = ARRAY_SIZE(algos);
+	uint8_t digest[HASH_MAX_DIGEST_SIZE];
+	struct hash_job *jobs;
+	const ulong size = SZ_1M;
+	u8 *buf;
+	int len;
+	int i;
+
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	for (i = 0; i < size; i++)
+		buf[i] = i * 7 + (i >> 9);
+	jobs = calloc(count, sizeof(*jobs));
+	ut_assertnonnull(jobs);
+	for (i = 0; i < count; i++) {
+		jobs[i].algo = algos[i];
+		jobs[i].data = buf + i * 1000;
+		jobs[i].len = size - i * 100000;
+		jobs[i].id = i;
+	}
+
+	ut_asserteq(-EPROTONOSUPPORT, hash_run_jobs(jobs, count));
+	for (i = 0; i < count - 1; i++) {
+		len = sizeof(digest);
+		ut_assertok(hash_block(algos[i], jobs[i].data, jobs[i].len,
+				       digest, &len));
+		ut_asserteq(len, jobs[i].digest_len);
+		ut_asserteq_mem(digest, jobs[i].digest, len);
+	}
+	ut_asserteq(0, jobs[count - 1].digest_len);
+
+	free(jobs);
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_smp_work_hash, 0);
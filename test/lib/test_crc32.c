@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for crc32 and crc32c
+ *
+ * The results are compared against a bit-at-a-time calculation for a range
+ * of lengths and alignments, so that the slice-by-8 code and any CPU
+ * instructions are checked at the edges of their blocks.
+ */
+
+#include <test/lib.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+
+#define CRC32_POLY	0xedb88320
+#define CRC32C_POLY	0x82f63b78
+
+static const char check[] = "123456789";
+
+/* Calculate a CRC without inversion, one bit at a time */
+static u32 crc_bitwise(u32 crc, const u8 *p, int len, u32 poly)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (crc & 1 ? poly : 0);
+	}
+
+	return crc;
+}
+
+static void fill_buf(u8 *buf, int size)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = i * 37 + (i >> 3);
+}
+
+static int lib_crc32(struct unit_test_state *uts)
+{
+	const u8 *str = (const u8 *)check;
+	u8 buf[160];
+	int off, len;
+	u32 crc;
+
+	ut_asserteq(0xcbf43926, crc32(0, str, 9));
+	ut_asserteq(0xcbf43926, crc32(crc32(0, str, 4), str + 4, 5));
+	ut_asserteq(0, crc32(0, str, 0));
+
+	fill_buf(buf, sizeof(buf));
+	for (off = 0; off < 8; off++) {
+		for (len = 0; len + off <= sizeof(buf); len++) {
+			crc = crc_bitwise(0x12345678, buf + off, len,
+					  CRC32_POLY);
+			ut_asserteq(crc, crc32_no_comp(0x12345678, buf + off,
+						       len));
+			ut_asserteq(crc, crc32_le_base(0x12345678, buf + off,
+						       len));
+			ut_asserteq(~crc_bitwise(~0, buf + off, len, CRC32_POLY),
+				    crc32(0, buf + off, len));
+		}
+	}
+
+	return 0;
+}
+LIB_TEST(lib_crc32, 0);
+
+#if IS_ENABLED(CONFIG_CRC32C)
+static int lib_crc32c(struct unit_test_state *uts)
+{
+	u32 table[256], crc;
+	u8 buf[160];
+	int off, len;
+
+	crc32c_init(table, CRC32C_POLY);
+	ut_asserteq(0xe3069283, ~crc32c_cal(~0, check, 9, table));
+
+	fill_buf(buf, sizeof(buf));
+	for (off = 0; off < 8; off++) {
+		for (len = 0; len + off <= sizeof(buf); len++) {
+			crc = crc_bitwise(0x12345678, buf + off, len,
+					  CRC32C_POLY);
+			ut_asserteq(crc, crc32c_cal(0x12345678,
+						    (char *)buf + off, len,
+						    table));
+			ut_asserteq(crc, crc32c_le_base(0x12345678, buf + off,
+							len));
+		}
+	}
+
+	/* A table for another polynomial must still be used as given */
+	crc32c_init(table, CRC32_POLY);
+	ut_asserteq(0xcbf43926, ~crc32c_cal(~0, check, 9, table));
+	ut_asserteq(crc32_no_comp(1, buf, sizeof(buf)),
+		    crc32c_cal(1, (char *)buf, sizeof(buf), table));
+
+	return 0;
+}
+LIB_TEST(lib_crc32c, 0);
+#endif
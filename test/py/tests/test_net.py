@@ -9,6 +9,7 @@ import u_boot_utils
 import uuid
 import datetime
 import re
+import time
 
 """
 Note: This test relies on boardenv_* containing configuration values to define
@@ -72,6 +73,18 @@ env__net_nfs_readable_file = {
     'crc32': 'c2244b26',
 }
 
+# Details regarding a file that may be read from a HTTP server. This variable
+# may be omitted or set to None if wget testing is not possible or desired.
+# The rate at which the file is downloaded is logged. If 'rate_min' (in bytes
+# per second) is given, the test fails when the download is slower.
+env__net_wget_readable_file = {
+    'fn': 'ubtest-readable.bin',
+    'addr': 0x10000000,
+    'size': 5058624,
+    'crc32': 'c2244b26',
+    'rate_min': 10000000,
+}
+
 # Details regarding a file that may be read from a TFTP server. This variable
 # may be omitted or set to None if PXE testing is not possible or desired.
 env__net_pxe_readable_file = {
@@ -335,6 +348,57 @@ def test_net_nfs(u_boot_console):
     output = u_boot_console.run_command('crc32 %x $filesize' % addr)
     assert expected_crc in output
 
+@pytest.mark.buildconfigspec('cmd_wget')
+def test_net_wget(u_boot_console):
+    """Test the wget command.
+
+    A file is downloaded from the HTTP server, its size and optionally its
+    CRC32 are validated. The download rate is logged so that changes to the
+    TCP stack can be compared, and optionally checked against a minimum.
+
+    The details of the file to download are provided by the boardenv_* file;
+    see the comment at the beginning of this file.
+    """
+
+    if not net_set_up:
+        pytest.skip('Network not initialized')
+
+    f = u_boot_console.config.env.get('env__net_wget_readable_file', None)
+    if not f:
+        pytest.skip('No HTTP readable file to read')
+
+    addr = f.get('addr', None)
+    if not addr:
+        addr = u_boot_utils.find_ram_base(u_boot_console)
+
+    fn = f['fn']
+    tstart = time.time()
+    output = u_boot_console.run_command('wget %x /%s' % (addr, fn))
+    tend = time.time()
+    expected_text = 'Bytes transferred = '
+    sz = f.get('size', None)
+    if sz:
+        expected_text += '%d' % sz
+    assert expected_text in output
+
+    if sz:
+        rate = sz / (tend - tstart)
+        u_boot_console.log.info('Downloading %d bytes took %f seconds, '
+                                '%d bytes/s' % (sz, tend - tstart, rate))
+        rate_min = f.get('rate_min', None)
+        if rate_min:
+            assert rate >= rate_min
+
+    expected_crc = f.get('crc32', None)
+    if not expected_crc:
+        return
+
+    if u_boot_console.config.buildconfig.get('config_cmd_crc32', 'n') != 'y':
+        return
+
+    output = u_boot_console.run_command('crc32 %x $filesize' % addr)
+    assert expected_crc in output
+
 @pytest.mark.buildconfigspec("cmd_pxe")
 def test_net_pxe_get(u_boot_console):
     """Test the pxe get command.
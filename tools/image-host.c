@@ -53,7 +53,9 @@ static int fit_set_hash_value(void *fit, int noffset, uint8_t *value,
  * fit_image_process_hash - Process a single subnode of the images/ node
  *
  * Check each subnode and process accordingly. For hash nodes we generate
- * a hash of the supplied data and store it in the node.
+ * a hash of the supplied data and store it in the node. If the node has a
+ * chunk-size property, each chunk is hashed into chunk-value and the value is
+ * the hash of chunk-value.
  *
  * @fit:	pointer to the FIT format image header
  * @image_name:	name of image being processed (used to display errors)
@@ -67,8 +69,11 @@ static int fit_image_process_hash(void *fit, const char *image_name,
 {
 	uint8_t value[FIT_MAX_HASH_LEN];
 	const char *node_name;
+	uint8_t *chunk_values;
+	ulong chunk_size;
 	int value_len;
 	const char *algo;
+	int count;
 	int ret;
 
 	node_name = fit_get_name(fit, noffset, NULL);
@@ -80,7 +85,43 @@ static int fit_image_process_hash(void *fit, const char *image_name,
 		return -ENOENT;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	/* Hash each chunk, then use the hash of all of those as the value */
+	ret = fit_image_hash_get_chunk_size(fit, noffset, &chunk_size);
+	if (ret == -EINVAL) {
+		fprintf(stderr,
+			"Bad chunk size for '%s' hash node in '%s' image node\n",
+			node_name, image_name);
+		return ret;
+	} else if (!ret) {
+		count = fit_hash_chunk_count(size, chunk_size);
+		chunk_values = malloc(count * FIT_MAX_HASH_LEN);
+		if (!chunk_values)
+			return -ENOMEM;
+		ret = fit_hash_chunks(data, size, algo, chunk_size,
+				      chunk_values, &value_len);
+		if (!ret)
+			ret = calculate_hash(chunk_values, count * value_len,
+					     algo, value, &value_len) ?
+				-EPROTONOSUPPORT : 0;
+		if (!ret) {
+			ret = fdt_setprop(fit, noffset, FIT_CHUNK_VALUE_PROP,
+					  chunk_values, count * value_len);
+			if (ret) {
+				fprintf(stderr,
+					"Can't set hash '%s' property for '%s' node(%s)\n",
+					FIT_CHUNK_VALUE_PROP, node_name,
+					fdt_strerror(ret));
+				ret = ret == -FDT_ERR_NOSPACE ? -ENOSPC : -EIO;
+			}
+		}
+		free(chunk_values);
+		if (ret == -EPROTONOSUPPORT)
+			fprintf(stderr,
+				"Unsupported hash algorithm (%s) for '%s' hash node in '%s' image node\n",
+				algo, node_name, image_name);
+		if (ret)
+			return ret;
+	} else if (calculate_hash(data, size, algo, value, &value_len)) {
 		fprintf(stderr,
 			"Unsupported hash algorithm (%s) for '%s' hash node in '%s' image node\n",
 			algo, node_name, image_name);
@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0+
+
+"""
+Minimal TFTP server with the multicast option (RFC 2090)
+
+This serves the files in one directory, for loading the same image into
+many boards at once and for testing CONFIG_TFTP_MCAST. Clients asking for
+the multicast option join one session per file: each block is sent once to
+the multicast group and only the master client acknowledges it. When the
+master has the whole file the next client becomes master and asks for the
+first block it is missing. Other clients are served by plain unicast TFTP.
+
+Example, with a sandbox build on a veth pair whose host end is 10.77.0.1:
+
+    sudo tools/tftp-mcast.py -a 10.77.0.1 /srv/tftp
+"""
+
+import argparse
+import os
+import random
+import select
+import socket
+import struct
+import sys
+import time
+
+RRQ, WRQ, DATA, ACK, ERROR, OACK = range(1, 7)
+
+
+def parse_args():
+    """Parse command line arguments."""
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument('root', help='directory to serve')
+    parser.add_argument('-a', '--addr', default='0.0.0.0',
+                        help='address to listen on and send multicast from')
+    parser.add_argument('-p', '--port', type=int, default=69,
+                        help='port to listen on (default 69)')
+    parser.add_argument('-g', '--group', default='239.255.69.69',
+                        help='multicast group (default 239.255.69.69)')
+    parser.add_argument('-G', '--group-port', type=int, default=1758,
+                        help='multicast port (default 1758)')
+    parser.add_argument('-t', '--timeout', type=float, default=1.0,
+                        help='seconds to wait for an ACK (default 1)')
+    parser.add_argument('-d', '--drop', type=float, default=0,
+                        help='percentage of blocks to drop, for testing')
+    parser.add_argument('-v', '--verbose', action='store_true')
+    return parser.parse_args()
+
+
+class Session:
+    """A transfer of one file, with its own socket (transfer ID)
+
+    Args:
+        server (Server): Server the session belongs to
+        data (bytes): File contents
+        blksize (int): Block size
+    """
+    def __init__(self, server, data, blksize):
+        self.server = server
+        self.data = data
+        self.blksize = blksize
+        self.blocks = len(data) // blksize + 1
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind((server.args.addr, 0))
+        self.sent = 0
+        self.deadline = None
+        self.retries = 0
+
+    def send_block(self, block, dest):
+        """Send a block, unless it is dropped on purpose"""
+        self.sent = block
+        self.deadline = time.time() + self.server.args.timeout
+        if random.uniform(0, 100) < self.server.args.drop:
+            return
+        start = (block - 1) * self.blksize
+        pkt = struct.pack('>HH', DATA, block & 0xffff)
+        self.sock.sendto(pkt + self.data[start:start + self.blksize], dest)
+
+    def unwrap(self, seq):
+        """Get the full block number from a 16-bit one, near the last sent"""
+        block = self.sent + ((seq - self.sent + 0x8000) & 0xffff) - 0x8000
+        return max(block, 0)
+
+    def close(self):
+        self.server.sessions.remove(self)
+        self.sock.close()
+
+
+class Unicast(Session):
+    """A plain TFTP transfer to one client"""
+    def __init__(self, server, data, blksize, client):
+        super().__init__(server, data, blksize)
+        self.client = client
+
+    def recv(self, pkt, addr):
+        op, seq = struct.unpack('>HH', pkt[:4])
+        if op != ACK or addr != self.client:
+            return
+        block = self.unwrap(seq)
+        if block >= self.blocks:
+            self.close()
+        elif block == self.sent or block + 1 == self.sent:
+            self.retries = 0
+            self.send_block(block + 1, self.client)
+
+    def tick(self):
+        self.retries += 1
+        if self.retries > 10:
+            self.close()
+        elif self.sent:
+            self.send_block(self.sent, self.client)
+        else:
+            self.deadline = time.time() + self.server.args.timeout
+
+
+class Multicast(Session):
+    """A transfer of one file to a multicast group
+
+    The list of clients is kept in the order they asked. The first one is
+    the master while it has one.
+    """
+    def __init__(self, server, name, data, blksize):
+        super().__init__(server, data, blksize)
+        self.name = name
+        self.group = (server.args.group, server.args.group_port)
+        self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF,
+                             socket.inet_aton(server.args.addr))
+        self.clients = []
+        self.opts = {}
+        self.master = None
+        self.acked = False
+
+    def oack(self, client):
+        """Tell a client about the group and whether it is the master"""
+        opts = dict(self.opts[client])
+        opts['multicast'] = '%s,%d,%d' % (self.group[0], self.group[1],
+                                          client == self.master)
+        pkt = struct.pack('>H', OACK)
+        for key, val in opts.items():
+            pkt += key.encode() + b'\0' + str(val).encode() + b'\0'
+        self.sock.sendto(pkt, client)
+
+    def add(self, client, opts):
+        if client not in self.clients:
+            self.clients.append(client)
+            self.server.log('%s joins %s, %d clients' %
+                            (client[0], self.name, len(self.clients)))
+        self.opts[client] = opts
+        if not self.master:
+            self.next_master()
+        else:
+            self.oack(client)
+
+    def remove(self, client):
+        if client in self.clients:
+            self.clients.remove(client)
+            self.server.log('%s leaves %s, %d clients' %
+                            (client[0], self.name, len(self.clients)))
+        if client == self.master:
+            self.master = None
+            self.next_master()
+
+    def next_master(self):
+        """Pick the longest-waiting client as master, or end the session"""
+        if not self.clients:
+            self.close()
+            return
+        self.master = self.clients[0]
+        self.acked = False
+        self.retries = 0
+        self.deadline = time.time() + self.server.args.timeout
+        self.oack(self.master)
+
+    def recv(self, pkt, addr):
+        op, seq = struct.unpack('>HH', pkt[:4])
+        if op == ERROR:
+            self.remove(addr)
+            return
+        if op != ACK:
+            return
+        block = self.unwrap(seq)
+        if block >= self.blocks:
+            # This client has the whole file, whether master or not
+            self.remove(addr)
+        elif addr == self.master:
+            self.acked = True
+            self.retries = 0
+            self.send_block(block + 1, self.group)
+
+    def tick(self):
+        self.retries += 1
+        if self.retries > 5:
+            self.server.log('%s is not answering' % self.master[0])
+            self.remove(self.master)
+        elif self.acked:
+            self.send_block(self.sent, self.group)
+        else:
+            self.deadline = time.time() + self.server.args.timeout
+            self.oack(self.master)
+
+
+class Server:
+    def __init__(self, args):
+        self.args = args
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind((args.addr, args.port))
+        self.sessions = []
+
+    def log(self, msg):
+        if self.args.verbose:
+            print(msg, file=sys.stderr)
+
+    def error(self, code, msg, addr):
+        pkt = struct.pack('>HH', ERROR, code) + msg.encode() + b'\0'
+        self.sock.sendto(pkt, addr)
+
+    def request(self, pkt, addr):
+        """Handle a read request"""
+        fields = pkt[2:].split(b'\0')
+        name = fields[0].decode()
+        opts = {}
+        for i in range(2, len(fields) - 1, 2):
+            opts[fields[i].decode().lower()] = fields[i + 1].decode()
+        root = os.path.realpath(self.args.root)
+        path = os.path.realpath(os.path.join(root, name.lstrip('/')))
+        if os.path.commonpath([root, path]) != root:
+            self.log('%s asks for %s, outside the root' % (addr[0], name))
+            self.error(2, 'Access violation', addr)
+            return
+        try:
+            with open(path, 'rb') as inf:
+                data = inf.read()
+        except OSError:
+            self.error(1, 'File not found', addr)
+            return
+
+        reply = {}
+        blksize = 512
+        if 'blksize' in opts:
+            blksize = min(int(opts['blksize']), 1468)
+        if 'timeout' in opts:
+            reply['timeout'] = opts['timeout']
+        if 'tsize' in opts:
+            reply['tsize'] = len(data)
+
+        if 'multicast' in opts:
+            for sess in self.sessions:
+                if isinstance(sess, Multicast) and sess.name == name:
+                    break
+            else:
+                sess = Multicast(self, name, data, blksize)
+                self.sessions.append(sess)
+            reply['blksize'] = sess.blksize
+            sess.add(addr, reply)
+            return
+
+        sess = Unicast(self, data, blksize, addr)
+        self.sessions.append(sess)
+        if 'blksize' in opts:
+            reply['blksize'] = blksize
+        if reply:
+            pkt = struct.pack('>H', OACK)
+            for key, val in reply.items():
+                pkt += key.encode() + b'\0' + str(val).encode() + b'\0'
+            sess.sock.sendto(pkt, addr)
+            sess.deadline = time.time() + self.args.timeout
+        else:
+            sess.send_block(1, addr)
+        self.log('%s gets %s by unicast' % (addr[0], name))
+
+    def run(self):
+        while True:
+            socks = [self.sock] + [sess.sock for sess in self.sessions]
+            deadlines = [sess.deadline for sess in self.sessions
+                         if sess.deadline]
+            wait = max(0, min(deadlines) - time.time()) if deadlines else None
+            ready, _, _ = select.select(socks, [], [], wait)
+            for sock in ready:
+                pkt, addr = sock.recvfrom(65536)
+                if len(pkt) < 4:
+                    continue
+                if sock == self.sock:
+                    if struct.unpack('>H', pkt[:2])[0] == RRQ:
+                        self.request(pkt, addr)
+                    continue
+                for sess in self.sessions:
+                    if sess.sock == sock:
+                        sess.recv(pkt, addr)
+                        break
+            now = time.time()
+            for sess in list(self.sessions):
+                if (sess in self.sessions and sess.deadline and
+                        sess.deadline <= now):
+                    sess.tick()
+
+
+def main():
+    Server(parse_args()).run()
+
+
+if __name__ == '__main__':
+    main()